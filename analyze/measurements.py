@@ -16,11 +16,17 @@ def print_csv(pathname, array):
             csvwriter.writerow(value)
     return
 
+# The make command of the current compilation unit, None if nothing has been compiled yet
+last_makecommand = None
+
 # Executes one specific measurement runs
 def execute_command(makecommand, runcommand):
-    # remove previous compilation unit
-    subprocess.run(["rm", "./brainsimulation"], check=False)
-    print(subprocess.run(makecommand, check=True))
+    global last_makecommand
+    # only recompile if the compile parameters changed, runtime parameters do not need a new compilation unit
+    if makecommand != last_makecommand:
+        subprocess.run(["rm", "./brainsimulation"], check=False)
+        print(subprocess.run(makecommand, check=True))
+        last_makecommand = makecommand
     
     # execute simulation
     result = subprocess.run(runcommand, check=True, stdout=subprocess.PIPE)
@@ -34,6 +40,18 @@ def execute_command(makecommand, runcommand):
     print("Measured Time: "+str(time))
     return time
 
+# Model parameters that can be set at runtime and their command line flags
+model_parameter_flags = {
+    "d_neighborfactor": "--dneighborfactor",
+    "id_neighborfactor": "--idneighborfactor",
+    "energy_factor": "--energyfactor",
+    "energy_weight": "--energyweight",
+    "delta_factor": "--deltafactor",
+    "slope_factor": "--slopefactor",
+    "slope_weight": "--slopeweight",
+    "damping": "--damping"
+    }
+
 # Parses a given runtime parameter into the commands actually executed for the simulation
 def parse_runcommand(parameter, value):
     if parameter == "gridsize":
@@ -76,6 +94,8 @@ def parse_runcommand(parameter, value):
         return ["-x",str(value)]
     elif parameter == "num_y_nodes":
         return ["-y",str(value)]
+    elif parameter in model_parameter_flags:
+        return [model_parameter_flags[parameter],str(value)]
     else:
         print("Parameter "+str(parameter)+" is not known.")
         return []
@@ -167,7 +187,8 @@ if __name__ == "__main__":
         #"ticks": [50, 100, 200, 300, 400, 500, 1000, 2000, 3000, 4000, 5000, 10000, 20000, 30000, 40000, 50000, 100000, 200000, 300000, 400000, 500000, 1000000],
         #"obsnodes" : [1,2,3,4,5,6,7,8,9,10],
         #"inputnodes" : [1,2,3,4,5,6,7,8,9,10],
-        #"startnodes" : [1,2,3,4,5,6,7,8,9,10]
+        #"startnodes" : [1,2,3,4,5,6,7,8,9,10],
+        #"delta_factor" : [0.1, 0.25, 0.5, 0.75, 1]
         }
     #param1 = "num_x_nodes"
     #param2 = "num_y_nodes"
@@ -0,0 +1,254 @@
+# This script runs a fixed matrix of workloads with repeated trials and compares their runtimes to a stored baseline
+
+import subprocess
+import re
+import json
+import math
+import os
+import sys
+import random
+import shutil
+import platform
+import argparse
+import datetime
+
+from measurements import parse_runcommand
+
+# Directory of the results, the baseline and the builds per thread count
+results_dir = "./analyze/regression"
+
+# The workloads: grid size (x = y), ticks, number of observation nodes and number of input nodes.
+# The ticks are chosen so that each run takes a fraction of a second to a few seconds on a current processor.
+workloads = [
+    {"name": "small-sparse", "grid": 128, "ticks": 5000, "obsnodes": 1, "inputnodes": 1},
+    {"name": "small-dense", "grid": 128, "ticks": 5000, "obsnodes": 64, "inputnodes": 32},
+    {"name": "medium-sparse", "grid": 512, "ticks": 1000, "obsnodes": 1, "inputnodes": 1},
+    {"name": "medium-dense", "grid": 512, "ticks": 1000, "obsnodes": 64, "inputnodes": 32},
+    {"name": "large-sparse", "grid": 1024, "ticks": 300, "obsnodes": 1, "inputnodes": 1},
+    {"name": "large-dense", "grid": 1024, "ticks": 300, "obsnodes": 64, "inputnodes": 32},
+    ]
+
+# The smaller matrix of --quick, for checking the harness itself
+quick_workloads = [
+    {"name": "small-sparse", "grid": 64, "ticks": 500, "obsnodes": 1, "inputnodes": 1},
+    {"name": "small-dense", "grid": 64, "ticks": 500, "obsnodes": 16, "inputnodes": 8},
+    ]
+
+# Runs a command and returns its standard output, or None if it fails
+def run_output(command):
+    try:
+        return subprocess.run(command, check=True, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                              universal_newlines=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+# Collects the build and machine metadata stored with each result
+def collect_metadata(dflags, thread_counts):
+    cpu = platform.processor()
+    if os.path.exists("/proc/cpuinfo"):
+        with open("/proc/cpuinfo") as cpuinfo:
+            for line in cpuinfo:
+                if line.startswith("model name"):
+                    cpu = line.split(":", 1)[1].strip()
+                    break
+    compiler = run_output(["cc", "--version"])
+    return {
+        "date": datetime.datetime.now().isoformat(timespec="seconds"),
+        "commit": run_output(["git", "rev-parse", "HEAD"]),
+        "dirty": bool(run_output(["git", "status", "--porcelain", "--untracked-files=no"])),
+        "compiler": compiler.splitlines()[0] if compiler else None,
+        "dflags": dflags,
+        "hostname": platform.node(),
+        "platform": platform.platform(),
+        "cpu": cpu,
+        "processors": os.cpu_count(),
+        "thread_counts": thread_counts,
+        }
+
+# Builds the simulation once per thread count and returns the paths of the builds
+def build(thread_counts, dflags):
+    build_dir = results_dir + "/build"
+    if not os.path.exists(build_dir):
+        os.makedirs(build_dir)
+    binaries = {}
+    for threads in thread_counts:
+        # the number of threads is THREADFACTOR times the number of processors, rounded down
+        factor = (threads + 0.5) / os.cpu_count()
+        makecommand = ["make", "-B", "DFLAGS=-DTHREADFACTOR=" + str(factor) + " " + dflags]
+        print(makecommand)
+        subprocess.run(makecommand, check=True, stdout=subprocess.DEVNULL)
+        binaries[threads] = build_dir + "/brainsimulation-t" + str(threads)
+        shutil.copy("./brainsimulation", binaries[threads])
+    return binaries
+
+# Returns the command line of a workload
+def workload_command(binary, workload):
+    runcommand = [binary]
+    for parameter, value in [("num_x_nodes", workload["grid"]), ("num_y_nodes", workload["grid"]),
+                             ("ticks", workload["ticks"]), ("obsnodes", workload["obsnodes"]),
+                             ("inputnodes", workload["inputnodes"])]:
+        runcommand += parse_runcommand(parameter, value)
+    return runcommand
+
+# Runs a workload once and returns the total time the simulation reports
+def run_trial(runcommand):
+    result = subprocess.run(runcommand, check=True, stdout=subprocess.PIPE, universal_newlines=True)
+    time = re.search("Total time = (.*) seconds", result.stdout)
+    return float(time.group(1))
+
+# Runs all configurations, trials times each after one untimed run, in a shuffled order per round so that
+# drifts of the machine (e.g., its temperature) spread over all configurations
+def run_matrix(binaries, matrix, trials):
+    configurations = []
+    for workload in matrix:
+        for threads, binary in sorted(binaries.items()):
+            configurations.append({"key": workload["name"] + "-t" + str(threads), "workload": workload,
+                                   "threads": threads, "command": workload_command(binary, workload),
+                                   "samples": []})
+    for configuration in configurations:
+        run_trial(configuration["command"])
+    for trial in range(trials):
+        order = list(configurations)
+        random.shuffle(order)
+        for configuration in order:
+            configuration["samples"].append(run_trial(configuration["command"]))
+        print("Finished round " + str(trial + 1) + " of " + str(trials) + ".")
+    results = {}
+    for configuration in configurations:
+        samples = configuration["samples"]
+        results[configuration["key"]] = {
+            "workload": configuration["workload"],
+            "threads": configuration["threads"],
+            "command": " ".join(configuration["command"][1:]),
+            "samples": samples,
+            "median": median(samples),
+            "mean": sum(samples) / len(samples),
+            "stdev": stdev(samples),
+            "min": min(samples),
+            }
+    return results
+
+def median(values):
+    ordered = sorted(values)
+    middle = len(ordered) // 2
+    return ordered[middle] if len(ordered) % 2 else (ordered[middle - 1] + ordered[middle]) / 2
+
+def stdev(values):
+    if len(values) < 2:
+        return 0.0
+    mean = sum(values) / len(values)
+    return math.sqrt(sum((value - mean) ** 2 for value in values) / (len(values) - 1))
+
+# One-sided Mann-Whitney U test of whether the current samples tend to be larger (slower) than the baseline samples.
+# Exact without ties, otherwise the normal approximation with tie and continuity correction.
+def mann_whitney_slower(current, baseline):
+    n1 = len(current)
+    n2 = len(baseline)
+    combined = sorted([(value, 0) for value in current] + [(value, 1) for value in baseline])
+    # average ranks of tied values
+    ranks = [0.0] * len(combined)
+    ties = []
+    i = 0
+    while i < len(combined):
+        j = i
+        while j + 1 < len(combined) and combined[j + 1][0] == combined[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2 + 1
+        ties.append(j - i + 1)
+        i = j + 1
+    u = sum(rank for rank, (value, group) in zip(ranks, combined) if group == 0) - n1 * (n1 + 1) / 2
+    if all(count == 1 for count in ties):
+        # the number of ways to reach each U with n1 of n1 + n2 values, built up one value at a time
+        counts = [[[0] * (a * b + 1) for b in range(n2 + 1)] for a in range(n1 + 1)]
+        for a in range(n1 + 1):
+            for b in range(n2 + 1):
+                if a == 0 or b == 0:
+                    counts[a][b][0] = 1
+                    continue
+                for value in range(a * b + 1):
+                    # the largest value is either from the first group (adding b to U) or from the second
+                    counts[a][b][value] = (counts[a - 1][b][value - b] if value >= b else 0) \
+                                          + (counts[a][b - 1][value] if value <= a * (b - 1) else 0)
+        total = sum(counts[n1][n2])
+        return sum(counts[n1][n2][int(round(u)):]) / total
+    mean = n1 * n2 / 2
+    n = n1 + n2
+    variance = n1 * n2 / 12 * ((n + 1) - sum(t ** 3 - t for t in ties) / (n * (n - 1)))
+    if variance <= 0:
+        return 1.0
+    z = (u - mean - 0.5) / math.sqrt(variance)
+    return 0.5 * math.erfc(z / math.sqrt(2))
+
+# Compares the results to the baseline, prints a table and returns the keys of significant slowdowns
+def compare(results, baseline, alpha, threshold):
+    for field in ["cpu", "processors", "compiler", "dflags", "hostname"]:
+        if results["metadata"].get(field) != baseline["metadata"].get(field):
+            print("WARNING: The results differ from the baseline in " + field + ": "
+                  + repr(results["metadata"].get(field)) + " instead of " + repr(baseline["metadata"].get(field)) + ".")
+    print("%-22s %12s %12s %9s %10s  %s" % ("configuration", "baseline s", "current s", "change", "p", "verdict"))
+    slowdowns = []
+    for key, current in results["results"].items():
+        if key not in baseline["results"]:
+            print("%-22s %12s %12.4f %9s %10s  %s" % (key, "-", current["median"], "-", "-", "new"))
+            continue
+        reference = baseline["results"][key]
+        change = current["median"] / reference["median"] - 1
+        p_slower = mann_whitney_slower(current["samples"], reference["samples"])
+        p_faster = mann_whitney_slower(reference["samples"], current["samples"])
+        verdict = "unchanged"
+        p = p_slower
+        if p_slower < alpha and change > threshold:
+            verdict = "SLOWER"
+            slowdowns.append(key)
+        elif p_faster < alpha and -change > threshold:
+            verdict = "faster"
+            p = p_faster
+        print("%-22s %12.4f %12.4f %+8.1f%% %10.4f  %s" % (key, reference["median"], current["median"],
+                                                            100 * change, p, verdict))
+    return slowdowns
+
+# Main entry point
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Runs the performance regression matrix and compares it to a "
+                                                 "baseline. Run from the repository root.")
+    parser.add_argument("--trials", type=int, default=7, help="timed runs per configuration (default 7)")
+    parser.add_argument("--threads", type=int, nargs="+",
+                        help="thread counts (default 1 and the number of processors)")
+    parser.add_argument("--dflags", default="", help="additional compile-time switches, e.g. -DACTIVITY_TRACKING=0")
+    parser.add_argument("--baseline", default=results_dir + "/baseline.json", help="the baseline to compare to")
+    parser.add_argument("--save-baseline", action="store_true", help="stores the results as the new baseline")
+    parser.add_argument("--alpha", type=float, default=0.01, help="significance level (default 0.01)")
+    parser.add_argument("--threshold", type=float, default=0.05,
+                        help="minimum relative slowdown of the median to flag (default 0.05)")
+    parser.add_argument("--quick", action="store_true", help="runs a small matrix to check the harness")
+    args = parser.parse_args()
+    if args.trials < 3:
+        parser.error("at least 3 trials are needed for a comparison")
+    thread_counts = sorted(set(args.threads if args.threads else [1, os.cpu_count()]))
+    if not os.path.exists("./testoutput"):
+        os.makedirs("./testoutput")
+    metadata = collect_metadata(args.dflags, thread_counts)
+    binaries = build(thread_counts, args.dflags)
+    results = {"metadata": metadata,
+               "trials": args.trials,
+               "results": run_matrix(binaries, quick_workloads if args.quick else workloads, args.trials)}
+    stamp = metadata["date"].replace(":", "") + "-" + (metadata["commit"] or "unknown")[:10]
+    path = results_dir + "/results-" + stamp + ".json"
+    with open(path, "w") as output:
+        json.dump(results, output, indent=2)
+    print("Results written to " + path + ".")
+    if args.save_baseline:
+        shutil.copy(path, args.baseline)
+        print("Results stored as baseline " + args.baseline + ".")
+        sys.exit(0)
+    if not os.path.exists(args.baseline):
+        print("No baseline " + args.baseline + " to compare to, store one with --save-baseline.")
+        sys.exit(0)
+    with open(args.baseline) as baseline_file:
+        baseline = json.load(baseline_file)
+    slowdowns = compare(results, baseline, args.alpha, args.threshold)
+    if slowdowns:
+        print("ERROR: Significant slowdowns of " + ", ".join(slowdowns) + ".")
+        sys.exit(1)
+    print("No significant slowdowns.")
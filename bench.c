@@ -0,0 +1,760 @@
+#include "definitions.h"
+#include "utils.h"
+#include "brainsimulation.h"
+#include "brainsetup.h"
+#include "kernels.h"
+#include "nodefunc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#define dup _dup
+#define dup2 _dup2
+#define close _close
+#define open _open
+#define fdopen _fdopen
+#define NULL_DEVICE "NUL"
+#else
+#include <time.h>
+#include <unistd.h>
+#define NULL_DEVICE "/dev/null"
+#endif
+
+/**
+ * @file
+ * Benchmark suite of the simulator, built and run by `make bench`.
+ *
+ * Micro-benchmarks time the parts of a tick in isolation: the stencil (the sums of the 4neighbors kernel), process()
+ * and the inlined process_sums() and process_means_unit() of the sweeps, the two barriers per tick, the injection of
+ * the sparse and the dense inputs after each row, the extraction of observations and the csv output. The
+ * macro-benchmark times whole ticks of the engine across grid sizes and thread counts. Each benchmark is run
+ * BENCH_WARMUP times untimed and then BENCH_REPETITIONS times timed. The rates are computed from the median
+ * repetition. All results are written as JSON.
+ *
+ * Usage: brainbench [--quick] [--maxthreads N] [--output PATH]
+ */
+
+/** Number of untimed runs before the timed repetitions of each benchmark. */
+#define BENCH_WARMUP 1
+/** Number of timed repetitions of each benchmark. */
+#define BENCH_REPETITIONS 5
+/** Maximum number of configurations of a benchmark (grid sizes or thread counts). */
+#define BENCH_MAX_CONFIGURATIONS 16
+
+/**
+ * The settings of a benchmark run.
+ */
+typedef struct {
+    /**
+    * The grid sizes (x = y) of the micro-benchmarks and of the macro-benchmark.
+    */
+    int grid_sizes[BENCH_MAX_CONFIGURATIONS];
+    /**
+    * The number of grid sizes.
+    */
+    int number_grid_sizes;
+    /**
+    * The thread counts of the barrier and macro-benchmarks.
+    */
+    int thread_counts[BENCH_MAX_CONFIGURATIONS];
+    /**
+    * The number of thread counts.
+    */
+    int number_thread_counts;
+    /**
+    * The ticks per repetition of the grid benchmarks.
+    */
+    int ticks;
+    /**
+    * The JSON output.
+    */
+    FILE *json;
+    /**
+    * The report of the results, printed to the original stdout. stdout itself is silenced while benchmarking, so that
+    * the messages of the engine (progress, files, generated inputs) do not end up in the report.
+    */
+    FILE *report;
+    /**
+    * 1 before the first result has been written.
+    */
+    int first_result;
+}
+        benchsettings_t;
+
+/**
+ * What a benchmark processes per repetition, for computing its rates.
+ */
+typedef struct {
+    /**
+    * The name of the benchmark.
+    */
+    const char *name;
+    /**
+    * What the benchmark processes if it is not a grid benchmark (e.g., "values"), labelled with the number of items.
+    * NULL for grid benchmarks.
+    */
+    const char *items_name;
+    /**
+    * The x-size of the grid, 0 if not a grid benchmark.
+    */
+    int number_nodes_x;
+    /**
+    * The y-size of the grid, 0 if not a grid benchmark.
+    */
+    int number_nodes_y;
+    /**
+    * The number of threads.
+    */
+    int threads;
+    /**
+    * The ticks per repetition.
+    */
+    int ticks;
+    /**
+    * The node updates (or processed items) per repetition.
+    */
+    double items;
+    /**
+    * The bytes read and written from memory per repetition (estimated).
+    */
+    double bytes;
+}
+        benchcase_t;
+
+// monotonic seconds with sub-microsecond resolution
+static double bench_seconds() {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+#endif
+}
+
+// redirects stdout to the null device, returns a duplicate of the original stdout
+static int silence_stdout() {
+    fflush(stdout);
+    int saved = dup(fileno(stdout));
+    int null_device = open(NULL_DEVICE, O_WRONLY);
+    if (null_device >= 0) {
+        dup2(null_device, fileno(stdout));
+        close(null_device);
+    }
+    return saved;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double value_a = *(const double *) a;
+    double value_b = *(const double *) b;
+    return value_a < value_b ? -1 : value_a > value_b;
+}
+
+// runs the benchmark (calling reset before each run, untimed), writes its statistics and rates as one JSON object
+static void measure(benchsettings_t *settings, const benchcase_t *benchcase, void (*reset)(void *),
+                    void (*run)(void *), void *argument) {
+    double seconds[BENCH_REPETITIONS];
+    for (int r = 0; r < BENCH_WARMUP + BENCH_REPETITIONS; r++) {
+        if (reset != NULL) {
+            reset(argument);
+        }
+        double start = bench_seconds();
+        run(argument);
+        double end = bench_seconds();
+        if (r >= BENCH_WARMUP) {
+            seconds[r - BENCH_WARMUP] = end - start;
+        }
+    }
+    double mean = 0;
+    for (int r = 0; r < BENCH_REPETITIONS; r++) {
+        mean += seconds[r];
+    }
+    mean /= BENCH_REPETITIONS;
+    double variance = 0;
+    for (int r = 0; r < BENCH_REPETITIONS; r++) {
+        variance += (seconds[r] - mean) * (seconds[r] - mean);
+    }
+    variance = BENCH_REPETITIONS > 1 ? variance / (BENCH_REPETITIONS - 1) : 0;
+    qsort(seconds, BENCH_REPETITIONS, sizeof(double), compare_doubles);
+    double median = BENCH_REPETITIONS % 2 ? seconds[BENCH_REPETITIONS / 2]
+                                          : (seconds[BENCH_REPETITIONS / 2 - 1] + seconds[BENCH_REPETITIONS / 2]) / 2;
+    double items_per_second = median > 0 ? benchcase->items / median : 0;
+    double ns_per_tick = benchcase->ticks > 0 ? median * 1e9 / benchcase->ticks : 0;
+    double gb_per_second = median > 0 ? benchcase->bytes / median * 1e-9 : 0;
+    char label[32];
+    if (benchcase->items_name != NULL) {
+        sprintf(label, "%.0f %s", benchcase->items, benchcase->items_name);
+    } else {
+        sprintf(label, "%d x %d", benchcase->number_nodes_x, benchcase->number_nodes_y);
+    }
+    fprintf(settings->report, "%-18s %-15s %2d threads: %10.3f ms (+- %.3f), %12.0f updates/s, %10.0f ns/tick, %6.2f GB/s\n",
+            benchcase->name, label, benchcase->threads, median * 1e3, sqrt(variance) * 1e3, items_per_second,
+            ns_per_tick, gb_per_second);
+    fflush(settings->report);
+    fprintf(settings->json, "%s\n    {\"name\": \"%s\", \"number_nodes_x\": %d, \"number_nodes_y\": %d, "
+                            "\"threads\": %d, \"ticks\": %d, \"items\": %.0f, \"bytes\": %.0f,\n"
+                            "     \"seconds\": {\"min\": %.9g, \"median\": %.9g, \"mean\": %.9g, \"max\": %.9g, "
+                            "\"stddev\": %.9g, \"variance\": %.9g},\n"
+                            "     \"node_updates_per_second\": %.6g, \"ns_per_tick\": %.6g, \"gb_per_second\": %.6g}",
+            settings->first_result ? "" : ",", benchcase->name, benchcase->number_nodes_x, benchcase->number_nodes_y,
+            benchcase->threads, benchcase->ticks, benchcase->items, benchcase->bytes, seconds[0], median, mean,
+            seconds[BENCH_REPETITIONS - 1], sqrt(variance), variance, items_per_second, ns_per_tick, gb_per_second);
+    settings->first_result = 0;
+}
+
+/* ---- stencil: the sums of the 4neighbors kernel, stored per node ---- */
+
+typedef struct {
+    nodeval_t **grid;
+    nodeval_t **sums;
+    int number_nodes_x;
+    int number_nodes_y;
+    int ticks;
+}
+        stencilbench_t;
+
+static void run_stencil(void *argument) {
+    stencilbench_t *bench = argument;
+    const nodeval_t *row_buffer[3];
+    const nodeval_t **rows = row_buffer + 1;
+    for (int t = 0; t < bench->ticks; t++) {
+        for (int i = 0; i < bench->number_nodes_x; i++) {
+            rows[-1] = i > 0 ? bench->grid[i - 1] : NULL;
+            rows[0] = bench->grid[i];
+            rows[1] = i + 1 < bench->number_nodes_x ? bench->grid[i + 1] : NULL;
+            int border_row = i == 0 || i + 1 == bench->number_nodes_x;
+            nodeval_t *sums = bench->sums[i];
+            for (int j = 0; j < bench->number_nodes_y; j++) {
+                nodeval_t d_sum, id_sum;
+                kernel_sums_4neighbors(rows, j, bench->number_nodes_y,
+                                       border_row || j == 0 || j + 1 == bench->number_nodes_y, &d_sum, &id_sum);
+                sums[j] = d_sum + id_sum;
+            }
+        }
+    }
+}
+
+static void bench_stencil(benchsettings_t *settings, int size) {
+    stencilbench_t bench = {alloc_2d(size, size), alloc_2d(size, size), size, size, settings->ticks};
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            bench.grid[i][j] = (nodeval_t) ((i * 31 + j * 17) % 97) / 97;
+        }
+    }
+    double items = (double) size * size * settings->ticks;
+    // each node is read once from memory (its neighbors are cached) and its sum written once
+    benchcase_t benchcase = {"stencil", NULL, size, size, 1, settings->ticks, items, items * 2 * sizeof(nodeval_t)};
+    measure(settings, &benchcase, NULL, run_stencil, &bench);
+    free_2d(bench.grid, size);
+    free_2d(bench.sums, size);
+}
+
+/* ---- process: the node function on precomputed neighborhoods ---- */
+
+typedef struct {
+    int number_nodes;
+    int ticks;
+    nodeval_t *act;
+    nodeval_t *slope;
+    nodeval_t *d_neighbors;
+    nodeval_t *id_neighbors;
+    nodeval_t *d_sums;
+    nodeval_t *id_sums;
+    modelparameters_t parameters;
+    modelcoefficients_t coefficients;
+}
+        processbench_t;
+
+static void run_process(void *argument) {
+    processbench_t *bench = argument;
+    for (int t = 0; t < bench->ticks; t++) {
+        for (int k = 0; k < bench->number_nodes; k++) {
+            nodestate_t state = process(bench->act[k], bench->slope[k], 4, bench->d_neighbors + 4 * (size_t) k, 4,
+                                        bench->id_neighbors + 4 * (size_t) k, &bench->parameters);
+            bench->act[k] = state.act;
+            bench->slope[k] = state.slope;
+        }
+    }
+}
+
+// the inlined node function of the sweeps on the sums of a kernel
+static void run_process_sums(void *argument) {
+    processbench_t *bench = argument;
+    for (int t = 0; t < bench->ticks; t++) {
+        for (int k = 0; k < bench->number_nodes; k++) {
+            nodestate_t state = process_sums(bench->act[k], bench->slope[k], bench->d_sums[k], bench->id_sums[k],
+                                             &bench->coefficients);
+            bench->act[k] = state.act;
+            bench->slope[k] = state.slope;
+        }
+    }
+}
+
+// the inlined node function of the sweeps with all model parameters 1, on the means of the neighborhoods
+static void run_process_means_unit(void *argument) {
+    processbench_t *bench = argument;
+    for (int t = 0; t < bench->ticks; t++) {
+        for (int k = 0; k < bench->number_nodes; k++) {
+            nodestate_t state = process_means_unit(bench->act[k], bench->slope[k], bench->d_sums[k] / 4,
+                                                   bench->id_sums[k] / 4);
+            bench->act[k] = state.act;
+            bench->slope[k] = state.slope;
+        }
+    }
+}
+
+static void reset_process(void *argument) {
+    processbench_t *bench = argument;
+    for (int k = 0; k < bench->number_nodes; k++) {
+        bench->act[k] = 0;
+        bench->slope[k] = 0;
+    }
+}
+
+static void bench_process(benchsettings_t *settings, int size) {
+    processbench_t bench;
+    bench.number_nodes = size * size;
+    bench.ticks = settings->ticks;
+    bench.act = malloc(bench.number_nodes * sizeof(nodeval_t));
+    bench.slope = malloc(bench.number_nodes * sizeof(nodeval_t));
+    bench.d_neighbors = malloc(4 * (size_t) bench.number_nodes * sizeof(nodeval_t));
+    bench.id_neighbors = malloc(4 * (size_t) bench.number_nodes * sizeof(nodeval_t));
+    for (size_t k = 0; k < 4 * (size_t) bench.number_nodes; k++) {
+        bench.d_neighbors[k] = (nodeval_t) (k % 13) / 1300;
+        bench.id_neighbors[k] = (nodeval_t) (k % 7) / 700;
+    }
+    bench.d_sums = malloc(bench.number_nodes * sizeof(nodeval_t));
+    bench.id_sums = malloc(bench.number_nodes * sizeof(nodeval_t));
+    for (int k = 0; k < bench.number_nodes; k++) {
+        bench.d_sums[k] = (nodeval_t) (k % 13) / 325;
+        bench.id_sums[k] = (nodeval_t) (k % 7) / 175;
+    }
+    init_model_parameters(&bench.parameters);
+    bench.parameters.damping = 0.01;
+    init_model_coefficients(&bench.coefficients, &bench.parameters, 4, 4);
+    double items = (double) bench.number_nodes * settings->ticks;
+    // act and slope are read and written, the eight neighbors read
+    benchcase_t benchcase = {"process", NULL, size, size, 1, settings->ticks, items, items * 12 * sizeof(nodeval_t)};
+    measure(settings, &benchcase, reset_process, run_process, &bench);
+    // act and slope are read and written, the two sums read
+    benchcase_t sums_benchcase = {"process_sums", NULL, size, size, 1, settings->ticks, items,
+                                  items * 6 * sizeof(nodeval_t)};
+    measure(settings, &sums_benchcase, reset_process, run_process_sums, &bench);
+    benchcase_t unit_benchcase = {"process_means_unit", NULL, size, size, 1, settings->ticks, items,
+                                  items * 6 * sizeof(nodeval_t)};
+    measure(settings, &unit_benchcase, reset_process, run_process_means_unit, &bench);
+    free(bench.act);
+    free(bench.slope);
+    free(bench.d_neighbors);
+    free(bench.id_neighbors);
+    free(bench.d_sums);
+    free(bench.id_sums);
+}
+
+/* ---- barrier: two waits per tick, as in the tick loop ---- */
+
+#if MULTITHREADING
+typedef struct {
+    threadbarrier_t barrier;
+    int threads;
+    int ticks;
+}
+        barrierbench_t;
+
+static unsigned int run_barrier_thread(void *argument) {
+    barrierbench_t *bench = argument;
+    for (int t = 0; t < bench->ticks; t++) {
+        wait_at_barrier(&bench->barrier);
+        wait_at_barrier(&bench->barrier);
+    }
+    return 0;
+}
+
+static void run_barrier(void *argument) {
+    barrierbench_t *bench = argument;
+    threadhandle_t **handles = malloc(bench->threads * sizeof(threadhandle_t *));
+    for (int i = 1; i < bench->threads; i++) {
+        handles[i] = create_and_run_thread(run_barrier_thread, bench);
+    }
+    run_barrier_thread(bench);
+    join_and_close_simulation_threads(handles + 1, bench->threads - 1);
+    free(handles);
+}
+
+static void bench_barrier(benchsettings_t *settings, int threads) {
+    barrierbench_t bench;
+    bench.threads = threads;
+    bench.ticks = 100 * settings->ticks;
+    init_thread_barrier(&bench.barrier, threads);
+    benchcase_t benchcase = {"barrier", "barriers", 0, 0, threads, bench.ticks, bench.ticks, 0};
+    measure(settings, &benchcase, NULL, run_barrier, &bench);
+    destroy_thread_barrier(&bench.barrier);
+}
+#endif
+
+/* ---- inputs: adding the inputs of each row after computing it, as the sweeps do ---- */
+
+#define BENCH_INPUT_CLASSES 16
+#define BENCH_INPUT_PERIOD 64
+
+typedef struct {
+    nodeval_t **state;
+    partialsimulationcontext_t context;
+    kernel_t kernel;
+    simulationoptions_t options;
+    int number_nodes_x;
+    int ticks;
+}
+        inputbench_t;
+
+static void run_inputs(void *argument) {
+    inputbench_t *bench = argument;
+    for (int t = 0; t < bench->ticks; t++) {
+        for (int i = 0; i < bench->number_nodes_x; i++) {
+            add_row_inputs(&bench->context, i, t, bench->state[i]);
+        }
+    }
+}
+
+// measures the row inputs of one thread owning the whole grid, with the inputs either sparse or as dense input plane
+static void measure_inputs(benchsettings_t *settings, const char *name, int size, int number_inputs,
+                           nodeinputseries_t *inputs, inputplane_t *input_plane) {
+    inputbench_t bench;
+    bench.state = alloc_2d(size, size);
+    init_zeros_2d(bench.state, size, size);
+    bench.number_nodes_x = size;
+    bench.ticks = settings->ticks;
+    init_simulation_options(&bench.options);
+    init_kernel(&bench.kernel, NULL);
+    init_partial_simulation_context(&bench.context, bench.ticks, 1, size, size, 0, NULL, bench.state, bench.state,
+                                    bench.state, NULL, NULL, NULL, &bench.kernel, input_plane != NULL ? 0 : number_inputs,
+                                    input_plane != NULL ? NULL : inputs, input_plane, NULL, NULL, &bench.options, 0,
+                                    size, NULL);
+    // the sparse inputs are read from their series, the dense ones read the class of each node
+    double items = (double) (input_plane != NULL ? (size_t) size * size : (size_t) number_inputs) * bench.ticks;
+    benchcase_t benchcase = {name, NULL, size, size, 1, bench.ticks, items, items * 3 * sizeof(nodeval_t)};
+    measure(settings, &benchcase, NULL, run_inputs, &bench);
+    free(bench.context.partial_observationnodes);
+    free(bench.context.partial_inputs);
+    free(bench.context.partial_input_row_offsets);
+    free_kernel(&bench.kernel);
+    free_2d(bench.state, size);
+}
+
+// the sparse inputs of 1% of the nodes, and the inputs of all nodes in a dense plane of BENCH_INPUT_CLASSES classes
+static void bench_inputs(benchsettings_t *settings, int size) {
+    int number_inputs = size * size;
+    int number_sparse = number_inputs / 100 > 0 ? number_inputs / 100 : 1;
+    int *x_indices = malloc(number_sparse * sizeof(int));
+    int *y_indices = malloc(number_sparse * sizeof(int));
+    int *frequencies = malloc(number_sparse * sizeof(int));
+    for (int k = 0; k < number_sparse; k++) {
+        // spread over the grid in a fixed pseudo-random order
+        long long node = (long long) k * 7919 % ((long long) size * size);
+        x_indices[k] = (int) (node / size);
+        y_indices[k] = (int) (node % size);
+        frequencies[k] = 5 + k % 40;
+    }
+    nodeinputseries_t *inputs = generate_input_frequencies(number_sparse, x_indices, y_indices, frequencies, 1);
+    measure_inputs(settings, "inputs", size, number_sparse, inputs, NULL);
+    for (int k = 0; k < number_sparse; k++) {
+        free(inputs[k].timeseries);
+    }
+    free(inputs);
+    // the dense plane requires series of one period, so all nodes share BENCH_INPUT_CLASSES series of equal length
+    nodeval_t *class_series[BENCH_INPUT_CLASSES];
+    for (int c = 0; c < BENCH_INPUT_CLASSES; c++) {
+        class_series[c] = malloc(BENCH_INPUT_PERIOD * sizeof(nodeval_t));
+        for (int t = 0; t < BENCH_INPUT_PERIOD; t++) {
+            class_series[c][t] = (nodeval_t) ((c + 1) * t % 7) / 7;
+        }
+    }
+    inputs = malloc(number_inputs * sizeof(nodeinputseries_t));
+    for (int k = 0; k < number_inputs; k++) {
+        inputs[k].x_index = k / size;
+        inputs[k].y_index = k % size;
+        inputs[k].z_index = 0;
+        inputs[k].timeseries = class_series[k % BENCH_INPUT_CLASSES];
+        inputs[k].timeseries_ticks = BENCH_INPUT_PERIOD;
+    }
+    inputplane_t input_plane;
+    generate_input_plane(&input_plane, size, size, number_inputs, inputs);
+    measure_inputs(settings, "inputs_plane", size, number_inputs, inputs, &input_plane);
+    free_input_plane(&input_plane);
+    for (int c = 0; c < BENCH_INPUT_CLASSES; c++) {
+        free(class_series[c]);
+    }
+    free(inputs);
+    free(x_indices);
+    free(y_indices);
+    free(frequencies);
+}
+
+/* ---- extraction: storing 64 observation nodes per tick ---- */
+
+#define BENCH_OBSERVATION_NODES 64
+
+typedef struct {
+    nodeval_t **state;
+    nodetimeseries_t *observationnodes;
+    nodetimeseries_t *observationpointers[BENCH_OBSERVATION_NODES];
+    int ticks;
+}
+        extractionbench_t;
+
+static void run_extraction(void *argument) {
+    extractionbench_t *bench = argument;
+    for (int t = 0; t < bench->ticks; t++) {
+        extract_observationnodes(t, BENCH_OBSERVATION_NODES, bench->observationpointers, bench->state);
+    }
+}
+
+static void bench_extraction(benchsettings_t *settings, int size) {
+    extractionbench_t bench;
+    bench.state = alloc_2d(size, size);
+    init_zeros_2d(bench.state, size, size);
+    bench.ticks = 100 * settings->ticks;
+    int x_indices[BENCH_OBSERVATION_NODES];
+    int y_indices[BENCH_OBSERVATION_NODES];
+    for (int k = 0; k < BENCH_OBSERVATION_NODES; k++) {
+        x_indices[k] = (int) ((long long) k * 7919 % size);
+        y_indices[k] = (int) ((long long) k * 104729 % size);
+    }
+    bench.observationnodes = init_observation_timeseries(BENCH_OBSERVATION_NODES, x_indices, y_indices, bench.ticks);
+    for (int k = 0; k < BENCH_OBSERVATION_NODES; k++) {
+        bench.observationpointers[k] = &bench.observationnodes[k];
+    }
+    double items = (double) BENCH_OBSERVATION_NODES * bench.ticks;
+    // the node is read (missing the cache on large grids) and the sample written
+    benchcase_t benchcase = {"extraction", NULL, size, size, 1, bench.ticks, items, items * 2 * sizeof(nodeval_t)};
+    measure(settings, &benchcase, NULL, run_extraction, &bench);
+    for (int k = 0; k < BENCH_OBSERVATION_NODES; k++) {
+        free(bench.observationnodes[k].timeseries);
+    }
+    free(bench.observationnodes);
+    free_2d(bench.state, size);
+}
+
+/* ---- csv: writing one observation series ---- */
+
+typedef struct {
+    nodeval_t *values;
+    int length;
+    char path[4096];
+}
+        csvbench_t;
+
+// creates a new, empty temporary file for the csv output, returns 0 if it could not be created
+static int create_temp_file(char *path, size_t size) {
+#ifdef _WIN32
+    char directory[MAX_PATH];
+    if (GetTempPathA(MAX_PATH, directory) == 0 || GetTempFileNameA(directory, "bsb", 0, path) == 0) {
+        return 0;
+    }
+    return 1;
+#else
+    const char *directory = getenv("TMPDIR");
+    snprintf(path, size, "%s/brainbench-XXXXXX", directory != NULL && directory[0] != '\0' ? directory : "/tmp");
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return 0;
+    }
+    close(fd);
+    return 1;
+#endif
+}
+
+static void run_csv(void *argument) {
+    csvbench_t *bench = argument;
+    output_to_csv(bench->path, bench->length, bench->values);
+}
+
+static void bench_csv(benchsettings_t *settings) {
+    csvbench_t bench;
+    if (!create_temp_file(bench.path, sizeof(bench.path))) {
+        fprintf(settings->report, "WARNING: Could not create a temporary file. Skipping the csv benchmark.\n");
+        return;
+    }
+    bench.length = 1000 * settings->ticks;
+    bench.values = malloc(bench.length * sizeof(nodeval_t));
+    for (int t = 0; t < bench.length; t++) {
+        bench.values[t] = sin(t * 0.01);
+    }
+    // each value is written as about 10 characters
+    benchcase_t benchcase = {"csv", "values", 0, 0, 1, bench.length, bench.length, 10.0 * bench.length};
+    measure(settings, &benchcase, NULL, run_csv, &bench);
+    remove(bench.path);
+    free(bench.values);
+}
+
+/* ---- tick: whole ticks of the engine, with inputs and observation nodes ---- */
+
+typedef struct {
+    int number_nodes_x;
+    int number_nodes_y;
+    int ticks;
+    int threads;
+    nodeval_t **old_state;
+    nodeval_t **new_state;
+    nodeval_t **slopes;
+    kernel_t kernel;
+    int number_inputs;
+    nodeinputseries_t *inputs;
+    int num_observationnodes;
+    nodetimeseries_t *observationnodes;
+    simulationoptions_t options;
+}
+        tickbench_t;
+
+static void reset_tick(void *argument) {
+    tickbench_t *bench = argument;
+    init_zeros_2d(bench->old_state, bench->number_nodes_x, bench->number_nodes_y);
+    init_zeros_2d(bench->new_state, bench->number_nodes_x, bench->number_nodes_y);
+    init_zeros_2d(bench->slopes, bench->number_nodes_x, bench->number_nodes_y);
+}
+
+static void run_tick(void *argument) {
+    tickbench_t *bench = argument;
+    executioncontext_t executioncontext;
+    executioncontext.num_threads = bench->threads;
+    executioncontext.handles = malloc(bench->threads * sizeof(threadhandle_t *));
+    executioncontext.contexts = malloc(bench->threads * sizeof(partialsimulationcontext_t));
+    executioncontext.timings = NULL;
+    executioncontext.counters = NULL;
+    kernelfunc_t d_kernel = d_kernel_function_factory(bench->kernel.name);
+    kernelfunc_t id_kernel = id_kernel_function_factory(bench->kernel.name);
+#if MULTITHREADING
+    execute_simulation_multithreaded(&executioncontext, bench->ticks, 1, bench->number_nodes_x,
+                                     bench->number_nodes_y, bench->num_observationnodes, bench->observationnodes,
+                                     bench->old_state, bench->new_state, bench->slopes, NULL, d_kernel, id_kernel,
+                                     &bench->kernel, bench->number_inputs, bench->inputs, NULL, NULL, NULL, NULL,
+                                     &bench->options);
+#else
+    execute_simulation_singlethreaded(&executioncontext, bench->ticks, 1, bench->number_nodes_x,
+                                      bench->number_nodes_y, bench->num_observationnodes, bench->observationnodes,
+                                      bench->old_state, bench->new_state, bench->slopes, NULL, d_kernel, id_kernel,
+                                      &bench->kernel, bench->number_inputs, bench->inputs, NULL, NULL, NULL, NULL,
+                                      &bench->options);
+#endif
+    for (int i = 0; i < bench->threads; i++) {
+        free(executioncontext.contexts[i].active_tiles);
+    }
+    free(executioncontext.handles);
+    free(executioncontext.contexts);
+}
+
+static void bench_tick(benchsettings_t *settings, int size, int threads) {
+    tickbench_t bench;
+    bench.number_nodes_x = size;
+    bench.number_nodes_y = size;
+    bench.ticks = settings->ticks;
+    bench.threads = threads;
+    bench.old_state = alloc_2d(size, size);
+    bench.new_state = alloc_2d(size, size);
+    bench.slopes = alloc_2d(size, size);
+    init_simulation_options(&bench.options);
+    bench.options.parameters.damping = 0.01;
+    init_kernel(&bench.kernel, NULL);
+    init_kernel_method(&bench.kernel, "direct", size, size);
+    int x_indices[4] = {size / 4, size / 2, 3 * size / 4, size / 3};
+    int y_indices[4] = {size / 4, size / 3, size / 2, 3 * size / 4};
+    int frequencies[4] = {10, 20, 35, 50};
+    bench.number_inputs = 4;
+    bench.inputs = generate_input_frequencies(4, x_indices, y_indices, frequencies, 1);
+    bench.num_observationnodes = 4;
+    bench.observationnodes = init_observation_timeseries(4, y_indices, x_indices, bench.ticks);
+    double items = (double) size * size * bench.ticks;
+    // the old state is read, the slope read and written and the new state written
+    benchcase_t benchcase = {"tick", NULL, size, size, threads, bench.ticks, items, items * 4 * sizeof(nodeval_t)};
+    measure(settings, &benchcase, reset_tick, run_tick, &bench);
+    for (int k = 0; k < 4; k++) {
+        free(bench.inputs[k].timeseries);
+        free(bench.observationnodes[k].timeseries);
+    }
+    free(bench.inputs);
+    free(bench.observationnodes);
+    free_kernel(&bench.kernel);
+    free_2d(bench.old_state, size);
+    free_2d(bench.new_state, size);
+    free_2d(bench.slopes, size);
+}
+
+int main(int argc, const char *argv[]) {
+    benchsettings_t settings;
+    int quick = contains_flag(argc, argv, "--quick");
+    int max_threads = (int) system_processor_online_count();
+    if (contains_flag(argc, argv, "--maxthreads")) {
+        max_threads = parse_int_arg(argc, argv, "--maxthreads");
+    }
+    const char *path = "bench.json";
+    if (contains_flag(argc, argv, "--output")) {
+        path = parse_string_arg(argc, argv, "--output");
+    }
+    if (max_threads < 1 || path == NULL) {
+        printf("Usage: brainbench [--quick] [--maxthreads N] [--output PATH]\n");
+        return 1;
+    }
+    int sizes[] = {64, 256, 1024, 2048};
+    settings.number_grid_sizes = quick ? 2 : 4;
+    memcpy(settings.grid_sizes, sizes, settings.number_grid_sizes * sizeof(int));
+    settings.ticks = quick ? 20 : 100;
+    // powers of two up to the number of processors, and the number of processors itself
+    settings.number_thread_counts = 0;
+#if MULTITHREADING
+    for (int threads = 1; threads < max_threads && settings.number_thread_counts < BENCH_MAX_CONFIGURATIONS - 1;
+         threads *= 2) {
+        settings.thread_counts[settings.number_thread_counts++] = threads;
+    }
+    settings.thread_counts[settings.number_thread_counts++] = max_threads;
+#else
+    settings.thread_counts[settings.number_thread_counts++] = 1;
+#endif
+    settings.json = fopen(path, "w");
+    if (settings.json == NULL) {
+        printf("ERROR: Could not open %s.\n", path);
+        return 1;
+    }
+    settings.first_result = 1;
+    int saved_stdout = silence_stdout();
+    settings.report = saved_stdout >= 0 ? fdopen(saved_stdout, "w") : NULL;
+    if (settings.report == NULL) {
+        settings.report = stdout;
+    }
+    fprintf(settings.json, "{\n  \"configuration\": {\"multithreading\": %d, \"processors\": %u, \"warmup\": %d, "
+                           "\"repetitions\": %d, \"ticks\": %d, \"node_size\": %zu},\n  \"benchmarks\": [",
+            MULTITHREADING, system_processor_online_count(), BENCH_WARMUP, BENCH_REPETITIONS, settings.ticks,
+            sizeof(nodeval_t));
+    for (int s = 0; s < settings.number_grid_sizes; s++) {
+        bench_stencil(&settings, settings.grid_sizes[s]);
+        bench_process(&settings, settings.grid_sizes[s]);
+        bench_inputs(&settings, settings.grid_sizes[s]);
+        bench_extraction(&settings, settings.grid_sizes[s]);
+    }
+#if MULTITHREADING
+    for (int k = 0; k < settings.number_thread_counts; k++) {
+        bench_barrier(&settings, settings.thread_counts[k]);
+    }
+#endif
+    bench_csv(&settings);
+    for (int s = 0; s < settings.number_grid_sizes; s++) {
+        for (int k = 0; k < settings.number_thread_counts; k++) {
+            bench_tick(&settings, settings.grid_sizes[s], settings.thread_counts[k]);
+        }
+    }
+    fprintf(settings.json, "\n  ]\n}\n");
+    fclose(settings.json);
+    fprintf(settings.report, "Benchmark results written to %s.\n", path);
+    if (settings.report != stdout) {
+        fclose(settings.report);
+    }
+    return 0;
+}
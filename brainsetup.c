@@ -1,12 +1,16 @@
 #include "brainsetup.h"
 
 #include "utils.h"
+#include "framestream.h"
+#include "events.h"
 
 #include <stdlib.h>
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <limits.h>
 
 #define PI 3.14159265
 // we are working at a millisecond scale, hence the 1000.
@@ -44,6 +48,44 @@ typedef struct {
 } bitmapinfoheader_t;
 #pragma pack(pop)
 
+// arguments for summing the color values of a bitmap in parallel
+typedef struct {
+	const bitmapinfoheader_t *info;
+	const uint8_t *image;
+	unsigned int *sums;
+} bitmapsum_t;
+
+// arguments for generating the input time series of a bitmap in parallel
+typedef struct {
+	const unsigned int *bitmap;
+	unsigned int width;
+	int min_freq;
+	int max_freq;
+	int lowest_freq;
+	int image_index;
+	int bitmap_duration_ticks;
+	unsigned int timeseries_ticks;
+	double tick_ms;
+	unsigned char *frequency_used;
+	nodeval_t **frequency_series;
+	nodeinputseries_t *series_all;
+} bitmapseries_t;
+
+// arguments for generating an input plane in parallel
+typedef struct {
+	inputplane_t *plane;
+	const nodeinputseries_t *inputs;
+	uint64_t *hashes;
+	unsigned int *input_class;
+} inputplanegeneration_t;
+
+// arguments for initializing the observation time series of all nodes in parallel
+typedef struct {
+	nodetimeseries_t *series;
+	int node_grid_size_x;
+	int num_timeseries_elements;
+} observationseries_t;
+
 /**
  * \endcond
  */
@@ -136,6 +178,35 @@ int parse_int_arg(const int argc, const char * argv[], const char * flag) {
 	return result;
 }
 
+nodeval_t parse_nodeval_arg(const int argc, const char * argv[], const char * flag) {
+	nodeval_t *readArgs = malloc(argc * sizeof(nodeval_t));
+	nodeval_t result = 0;
+	if (parse_nodeval_args(argc, argv, flag, readArgs) != 1) {
+		printf("No argument with single floating point parameter found for: ");
+		printf("%s", flag);
+		printf("\n");
+	} else {
+		result = readArgs[0];
+	}
+	free(readArgs);
+	return result;
+}
+
+const char *parse_string_arg(const int argc, const char * argv[], const char * flag) {
+	const char ** readArgStrings = malloc(argc * sizeof(char *));
+	unsigned int count = parse_args(argc, argv, flag, readArgStrings);
+	const char *result = NULL;
+	if (count != 1) {
+		printf("No argument with single string parameter found for: ");
+		printf("%s", flag);
+		printf("\n");
+	} else {
+		result = readArgStrings[0];
+	}
+	free(readArgStrings);
+	return result;
+}
+
 nodetimeseries_t *init_observation_timeseries_from_sh(const int argc, const char *argv[],
 	int * num_observationnodes) {
 	
@@ -186,24 +257,32 @@ nodetimeseries_t *init_observation_timeseries(const int num_observationnodes,
 	for (int i = 0; i < num_observationnodes; i++) {
         series[i].x_index = x_indices[i];
         series[i].y_index = y_indices[i];
+        series[i].z_index = 0;
         series[i].timeseries = malloc(num_timeseries_elements * sizeof(nodeval_t));
         series[i].timeseries_ticks = num_timeseries_elements;
     }
     return series;
 }
 
+static void init_observation_timeseries_rows(int start, int end, void *argument) {
+	observationseries_t *observation = argument;
+	for (int y = start; y < end; y++) {
+		for (int x = 0; x < observation->node_grid_size_x; x++) {
+			int i = y * observation->node_grid_size_x + x;
+			observation->series[i].x_index = x;
+			observation->series[i].y_index = y;
+			observation->series[i].z_index = 0;
+			observation->series[i].timeseries = malloc(observation->num_timeseries_elements * sizeof(nodeval_t));
+			observation->series[i].timeseries_ticks = observation->num_timeseries_elements;
+		}
+	}
+}
+
 nodetimeseries_t *init_all_observation_timeseries(const int node_grid_size_x,
 	const int node_grid_size_y, const int num_timeseries_elements) {
 	nodetimeseries_t *series = malloc(node_grid_size_x * node_grid_size_y * sizeof(nodetimeseries_t));
-	for (int y = 0; y < node_grid_size_y; y++) {
-		for (int x = 0; x < node_grid_size_x; x++) {
-			int i = y * node_grid_size_x + x;
-			series[i].x_index = x;
-			series[i].y_index = y;
-			series[i].timeseries = malloc(num_timeseries_elements * sizeof(nodeval_t));
-			series[i].timeseries_ticks = num_timeseries_elements;
-		}
-	}
+	observationseries_t observation = {series, node_grid_size_x, num_timeseries_elements};
+	run_parallel_range(node_grid_size_y, 16, init_observation_timeseries_rows, &observation);
 	return series;
 }
 
@@ -227,6 +306,51 @@ void init_start_time_state_from_sh(const int argc, const char * argv[],
 	free(start_nodes_y);
 }
 
+nodelevel_t *init_start_levels_3d_from_sh(const int argc, const char * argv[], int *num_startnodes) {
+	nodeval_t * start_levels = malloc(argc * sizeof(nodeval_t));
+	int *start_nodes_x = malloc(argc * sizeof(int));
+	int *start_nodes_y = malloc(argc * sizeof(int));
+	int *start_nodes_z = malloc(argc * sizeof(int));
+	unsigned int startnodecount =
+		parse_nodeval_args(argc, argv, FLAG_START_LEVELS, start_levels);
+	unsigned int startnodecount_x =
+		parse_int_args(argc, argv, FLAG_START_NODES_X, start_nodes_x);
+	unsigned int startnodecount_y =
+		parse_int_args(argc, argv, FLAG_START_NODES_Y, start_nodes_y);
+	unsigned int startnodecount_z =
+		parse_int_args(argc, argv, FLAG_START_NODES_Z, start_nodes_z);
+	startnodecount = min_val(startnodecount, startnodecount_x, startnodecount_y);
+	if (startnodecount_z < startnodecount) {
+		startnodecount = startnodecount_z;
+	}
+	nodelevel_t *startnodes = malloc((startnodecount > 0 ? startnodecount : 1) * sizeof(nodelevel_t));
+	for (int i = 0; i < startnodecount; i++) {
+		startnodes[i].x_index = start_nodes_x[i];
+		startnodes[i].y_index = start_nodes_y[i];
+		startnodes[i].z_index = start_nodes_z[i];
+		startnodes[i].level = start_levels[i];
+	}
+	*num_startnodes = startnodecount;
+	free(start_levels);
+	free(start_nodes_x);
+	free(start_nodes_y);
+	free(start_nodes_z);
+	return startnodes;
+}
+
+void parse_z_indices_from_sh(const int argc, const char * argv[], const char * flag, const int num_nodes,
+	int *z_indices) {
+	int *parsed = malloc(argc * sizeof(int));
+	int count = parse_int_args(argc, argv, flag, parsed);
+	if (count < num_nodes) {
+		printf("WARNING: %d of %d nodes have no z index (%s). Using z = 0.\n", num_nodes - count, num_nodes, flag);
+	}
+	for (int i = 0; i < num_nodes; i++) {
+		z_indices[i] = i < count ? parsed[i] : 0;
+	}
+	free(parsed);
+}
+
 nodeval_t **init_nodegrid_default(int *number_nodes_x, int *number_nodes_y){
 	*number_nodes_x = 200;
 	*number_nodes_y = 200;
@@ -263,6 +387,7 @@ nodeinputseries_t *read_input_behavior(const int number_of_inputnodes, const int
     for (i = 0; i < number_of_inputnodes; ++i) {
         series[i].x_index = x_indices[i];
         series[i].y_index = y_indices[i];
+        series[i].z_index = 0;
         series[i].timeseries = malloc(number_of_elements[i] * sizeof(nodeval_t));
         series[i].timeseries_ticks = number_of_elements[i];
         parse_file(series[i], inputnodefilenames[i]);
@@ -285,6 +410,48 @@ nodeinputseries_t *generate_input_frequencies_from_sh(const int argc, const char
 	return series;
 }
 
+//determine the actual frequency of a non-0 bitmap value using linear interpolation
+static int bitmap_frequency(unsigned int bitmap_value, int min_freq, int max_freq) {
+	return min_freq + (max_freq - min_freq)*((int) bitmap_value - 1) / 764;
+}
+
+static void generate_bitmap_frequency_series(int start, int end, void *argument) {
+	bitmapseries_t *generation = argument;
+	for (int i = start; i < end; i++) {
+		if (generation->frequency_used[i]) {
+			generation->frequency_series[i] = generate_sin_time_series(generation->lowest_freq + i,
+				generation->tick_ms, generation->bitmap_duration_ticks);
+		}
+	}
+}
+
+static void copy_bitmap_series_rows(int start, int end, void *argument) {
+	bitmapseries_t *generation = argument;
+	int tick_num_start = generation->image_index * generation->bitmap_duration_ticks;
+	int tick_num_end = (generation->image_index + 1) * generation->bitmap_duration_ticks;
+	for (int y = start; y < end; y++) {
+		for (int x = 0; x < generation->width; x++) {
+			int i = y * generation->width + x;
+			nodeinputseries_t *series = &generation->series_all[i];
+			if (generation->bitmap[i] != 0) {
+				int frequency = bitmap_frequency(generation->bitmap[i], generation->min_freq, generation->max_freq);
+				nodeval_t *partial_time_series = generation->frequency_series[frequency - generation->lowest_freq];
+				//set the timeseries length to mark the time series as written
+				series->timeseries_ticks = generation->timeseries_ticks;
+				//copy the generated sin to the imput time series
+				for (int tick_num = tick_num_start; tick_num < tick_num_end; tick_num++) {
+					series->timeseries[tick_num] = partial_time_series[tick_num - tick_num_start];
+				}
+			}
+			else {
+				for (int tick_num = tick_num_start; tick_num < tick_num_end; tick_num++) {
+					series->timeseries[tick_num] = 0;
+				}
+			}
+		}
+	}
+}
+
 #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
 nodeinputseries_t *generate_input_frequencies_from_bitmap(const char * filenames[], const unsigned int num_filenames,
 	const int min_freq, const int max_freq, const int bitmap_duration_ticks, int *num_inputnodes, const double tick_ms) {
@@ -292,6 +459,8 @@ nodeinputseries_t *generate_input_frequencies_from_bitmap(const char * filenames
 	unsigned int height = 0;
 	unsigned int timeseries_ticks = bitmap_duration_ticks * num_filenames;
 	nodeinputseries_t *series_all;
+	//all timeseries are stored in a single block, instead of one allocation per pixel
+	nodeval_t *timeseries_block;
 	unsigned int num_series_written_to = 0;
 	//read bitmaps and generate sin timeseries
 	for (int image_index = 0; image_index < num_filenames; image_index++) {
@@ -302,12 +471,14 @@ nodeinputseries_t *generate_input_frequencies_from_bitmap(const char * filenames
 			width = current_width;
 			height = current_height;
 			series_all = malloc(width * height * sizeof(nodeinputseries_t));
+			timeseries_block = malloc((size_t) width * height * timeseries_ticks * sizeof(nodeval_t));
 			for (int y = 0; y < height; y++) {
 				for (int x = 0; x < width; x++) {
 					int i = y * width + x;
 					series_all[i].x_index = x;
 					series_all[i].y_index = y;
-					series_all[i].timeseries = malloc(timeseries_ticks * sizeof(nodeval_t));
+					series_all[i].z_index = 0;
+					series_all[i].timeseries = timeseries_block + (size_t) i * timeseries_ticks;
 					//dirty trick: we only set the number of ticks when writing actual values to keep track of written time series
 					series_all[i].timeseries_ticks = 0;
 				}
@@ -316,55 +487,70 @@ nodeinputseries_t *generate_input_frequencies_from_bitmap(const char * filenames
 		else if (current_width != width || current_height != height) {
 			printf("ERROR: Dimension mismatch. %s and %s do not have the same dimensions.\n", filenames[0], filenames[image_index]);
 			free(filenames);
+			free(timeseries_block);
 			free(series_all);
 			return NULL;
 		}
-		for (int y = 0; y < height; y++) {
-			for (int x = 0; x < width; x++) {
-				int i = y * width + x;
-				int frequency = 0;
-				if (bitmap[i] != 0) {
-					//determine the actual frequency using linear interpolation
-					frequency = min_freq + (max_freq - min_freq)*(bitmap[i] - 1) / 764;
-					nodeval_t * partial_time_series = generate_sin_time_series(frequency, tick_ms, bitmap_duration_ticks);
-					int tick_num_start = image_index * bitmap_duration_ticks;
-					//set the timeseries length and increase the counter of written time series if necessary
-					if (series_all[i].timeseries_ticks == 0) {
-						series_all[i].timeseries_ticks = timeseries_ticks;
-						num_series_written_to++;
-					}
-					//copy the generated sin to the imput time series
-					for (int tick_num = tick_num_start;
-						tick_num < (image_index + 1) * bitmap_duration_ticks; tick_num++) {
-						series_all[i].timeseries[tick_num] = partial_time_series[tick_num - tick_num_start];
-					}
-				}
-				else {
-					for (int tick_num = image_index * bitmap_duration_ticks;
-						tick_num < (image_index + 1) * bitmap_duration_ticks; tick_num++) {
-						series_all[i].timeseries[tick_num] = 0;
-					}
-				}
+		//generate the sin time series for each frequency occurring in the bitmap only once
+		bitmapseries_t generation;
+		generation.bitmap = bitmap;
+		generation.width = width;
+		generation.min_freq = min_freq;
+		generation.max_freq = max_freq;
+		generation.lowest_freq = min_freq < max_freq ? min_freq : max_freq;
+		generation.image_index = image_index;
+		generation.bitmap_duration_ticks = bitmap_duration_ticks;
+		generation.timeseries_ticks = timeseries_ticks;
+		generation.tick_ms = tick_ms;
+		generation.series_all = series_all;
+		int num_frequencies = abs(max_freq - min_freq) + 1;
+		generation.frequency_used = calloc(num_frequencies, sizeof(unsigned char));
+		generation.frequency_series = calloc(num_frequencies, sizeof(nodeval_t *));
+		for (int i = 0; i < width * height; i++) {
+			if (bitmap[i] != 0) {
+				generation.frequency_used[bitmap_frequency(bitmap[i], min_freq, max_freq) - generation.lowest_freq] = 1;
 			}
 		}
+		run_parallel_range(num_frequencies, 8, generate_bitmap_frequency_series, &generation);
+		run_parallel_range(height, 8, copy_bitmap_series_rows, &generation);
+		for (int i = 0; i < num_frequencies; i++) {
+			free(generation.frequency_series[i]);
+		}
+		free(generation.frequency_series);
+		free(generation.frequency_used);
 		free(bitmap);
 	}
+	for (int i = 0; i < width * height; i++) {
+		if (series_all[i].timeseries_ticks != 0) {
+			num_series_written_to++;
+		}
+	}
 	//copy only time series with set values to the final input set, discard the rest for faster input processing
+	//the written time series are moved to the front of the block, which is then shrunk
 	nodeinputseries_t *series_pruned = malloc(num_series_written_to * sizeof(nodeinputseries_t));
 	int series_pruned_index = 0;
 	for (int series_all_index = 0; series_all_index < width * height; series_all_index++) {
-		if (series_all[series_all_index].timeseries_ticks == 0) {
-			free(series_all[series_all_index].timeseries);
-		} else {
+		if (series_all[series_all_index].timeseries_ticks != 0) {
+			memmove(timeseries_block + (size_t) series_pruned_index * timeseries_ticks,
+				series_all[series_all_index].timeseries, timeseries_ticks * sizeof(nodeval_t));
 			series_pruned[series_pruned_index].x_index = series_all[series_all_index].x_index;
 			series_pruned[series_pruned_index].y_index = series_all[series_all_index].y_index;
-			series_pruned[series_pruned_index].timeseries = series_all[series_all_index].timeseries;
+			series_pruned[series_pruned_index].z_index = series_all[series_all_index].z_index;
 			series_pruned[series_pruned_index].timeseries_ticks = series_all[series_all_index].timeseries_ticks;
 			series_pruned_index++;
 		}
 	}
 	if (width > 0 && height > 0) {
 		free(series_all);
+		if (num_series_written_to > 0) {
+			timeseries_block = realloc(timeseries_block,
+				(size_t) num_series_written_to * timeseries_ticks * sizeof(nodeval_t));
+		} else {
+			free(timeseries_block);
+		}
+	}
+	for (int i = 0; i < num_series_written_to; i++) {
+		series_pruned[i].timeseries = timeseries_block + (size_t) i * timeseries_ticks;
 	}
 	*num_inputnodes = num_series_written_to;
 	return series_pruned;
@@ -388,6 +574,243 @@ nodeinputseries_t *generate_input_frequencies_from_sh_bitmap(const int argc, con
 	return series;
 }
 
+// the command line flags of the model parameters and the offsets of the parameters in modelparameters_t
+static const char *MODEL_PARAMETER_FLAGS[] = {FLAG_D_NEIGHBORFACTOR, FLAG_ID_NEIGHBORFACTOR, FLAG_ENERGY_FACTOR,
+	FLAG_ENERGY_WEIGHT, FLAG_DELTA_FACTOR, FLAG_SLOPE_FACTOR, FLAG_SLOPE_WEIGHT, FLAG_DAMPING};
+static const size_t MODEL_PARAMETER_OFFSETS[] = {offsetof(modelparameters_t, d_neighborfactor),
+	offsetof(modelparameters_t, id_neighborfactor), offsetof(modelparameters_t, energy_factor),
+	offsetof(modelparameters_t, energy_weight), offsetof(modelparameters_t, delta_factor),
+	offsetof(modelparameters_t, slope_factor), offsetof(modelparameters_t, slope_weight),
+	offsetof(modelparameters_t, damping)};
+#define NUM_MODEL_PARAMETERS 8
+
+//the map flags and the offsets of the planes in parametermaps_t, in the same order as the parameters
+static const char *MODEL_PARAMETER_MAP_FLAGS[] = {FLAG_D_NEIGHBORFACTOR_MAP, FLAG_ID_NEIGHBORFACTOR_MAP,
+	FLAG_ENERGY_FACTOR_MAP, FLAG_ENERGY_WEIGHT_MAP, FLAG_DELTA_FACTOR_MAP, FLAG_SLOPE_FACTOR_MAP, FLAG_SLOPE_WEIGHT_MAP,
+	FLAG_DAMPING_MAP};
+static const size_t MODEL_PARAMETER_MAP_OFFSETS[] = {offsetof(parametermaps_t, d_neighborfactor),
+	offsetof(parametermaps_t, id_neighborfactor), offsetof(parametermaps_t, energy_factor),
+	offsetof(parametermaps_t, energy_weight), offsetof(parametermaps_t, delta_factor),
+	offsetof(parametermaps_t, slope_factor), offsetof(parametermaps_t, slope_weight),
+	offsetof(parametermaps_t, damping)};
+
+static nodeval_t *model_parameter(modelparameters_t *parameters, int index) {
+	return (nodeval_t *) ((char *) parameters + MODEL_PARAMETER_OFFSETS[index]);
+}
+
+static nodeval_t **parameter_map(parametermaps_t *maps, int index) {
+	return (nodeval_t **) ((char *) maps + MODEL_PARAMETER_MAP_OFFSETS[index]);
+}
+
+void parse_model_parameters_from_sh(const int argc, const char * argv[], modelparameters_t *parameters) {
+	nodeval_t *values = malloc(argc * sizeof(nodeval_t));
+	for (int i = 0; i < NUM_MODEL_PARAMETERS; i++) {
+		if (contains_flag(argc, argv, MODEL_PARAMETER_FLAGS[i])) {
+			int num_values = parse_nodeval_args(argc, argv, MODEL_PARAMETER_FLAGS[i], values);
+			//multiple values define an ensemble, see parse_ensemble_parameters_from_sh
+			if (num_values == 1) {
+				*model_parameter(parameters, i) = values[0];
+			} else if (num_values == 0) {
+				printf("No floating point parameter found for: %s\n", MODEL_PARAMETER_FLAGS[i]);
+			}
+		}
+	}
+	free(values);
+}
+
+modelparameters_t *parse_ensemble_parameters_from_sh(const int argc, const char * argv[],
+	const modelparameters_t *parameters, int *ensemble_size) {
+	nodeval_t *values = malloc(argc * sizeof(nodeval_t));
+	*ensemble_size = 1;
+	for (int i = 0; i < NUM_MODEL_PARAMETERS; i++) {
+		if (contains_flag(argc, argv, MODEL_PARAMETER_FLAGS[i])) {
+			int num_values = parse_nodeval_args(argc, argv, MODEL_PARAMETER_FLAGS[i], values);
+			if (num_values > 1 && *ensemble_size > 1 && num_values != *ensemble_size) {
+				printf("ERROR: All model parameters with multiple values must have the same number of values (%s has %d, expected %d).\n",
+					MODEL_PARAMETER_FLAGS[i], num_values, *ensemble_size);
+				*ensemble_size = 0;
+				free(values);
+				return NULL;
+			}
+			if (num_values > 1) {
+				*ensemble_size = num_values;
+			}
+		}
+	}
+	if (*ensemble_size == 1) {
+		free(values);
+		return NULL;
+	}
+	//members start with the single-valued parameters, the parameters with multiple values are set per member
+	modelparameters_t *members = malloc(*ensemble_size * sizeof(modelparameters_t));
+	for (int m = 0; m < *ensemble_size; m++) {
+		members[m] = *parameters;
+	}
+	for (int i = 0; i < NUM_MODEL_PARAMETERS; i++) {
+		if (contains_flag(argc, argv, MODEL_PARAMETER_FLAGS[i])
+			&& parse_nodeval_args(argc, argv, MODEL_PARAMETER_FLAGS[i], values) == *ensemble_size) {
+			for (int m = 0; m < *ensemble_size; m++) {
+				*model_parameter(&members[m], i) = values[m];
+			}
+		}
+	}
+	free(values);
+	return members;
+}
+
+static unsigned int is_bitmap_path(const char *path) {
+	size_t length = strlen(path);
+	return length >= 4 && (strcmp(path + length - 4, ".bmp") == 0 || strcmp(path + length - 4, ".BMP") == 0);
+}
+
+//maps the color sums of a bitmap linearly to [min_value, max_value], nodes outside of the bitmap keep the default
+static nodeval_t *load_parameter_bitmap(const char *path, const int number_nodes_x, const int number_nodes_y,
+	nodeval_t default_value, nodeval_t min_value, nodeval_t max_value) {
+	unsigned int width = 0;
+	unsigned int height = 0;
+	unsigned int *bitmap = read_bitmap_contents(path, &width, &height);
+	if (bitmap == NULL) {
+		return NULL;
+	}
+	nodeval_t *map = malloc((size_t) number_nodes_x * number_nodes_y * sizeof(nodeval_t));
+	for (int x = 0; x < number_nodes_x; x++) {
+		for (int y = 0; y < number_nodes_y; y++) {
+			nodeval_t value = default_value;
+			if (x < width && y < height) {
+				value = min_value + (max_value - min_value) * bitmap[y * width + x] / 765;
+			}
+			map[(size_t) x * number_nodes_y + y] = value;
+		}
+	}
+	free(bitmap);
+	return map;
+}
+
+//reads exactly number_nodes_x * number_nodes_y doubles
+static nodeval_t *load_parameter_raw(const char *path, const int number_nodes_x, const int number_nodes_y) {
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		printf("ERROR: Could not open parameter map: %s\n", path);
+		return NULL;
+	}
+	size_t number_nodes = (size_t) number_nodes_x * number_nodes_y;
+	nodeval_t *map = malloc(number_nodes * sizeof(nodeval_t));
+	size_t read_result = fread(map, sizeof(nodeval_t), number_nodes, file);
+	uint8_t trailing;
+	if (read_result != number_nodes || fread(&trailing, 1, 1, file) != 0) {
+		printf("ERROR: Parameter map %s must contain exactly %d x %d doubles.\n", path, number_nodes_x, number_nodes_y);
+		free(map);
+		map = NULL;
+	}
+	fclose(file);
+	return map;
+}
+
+parametermaps_t *parse_parameter_maps_from_sh(const int argc, const char * argv[], const int number_nodes_x,
+	const int number_nodes_y, modelparameters_t *parameters, unsigned int *error) {
+	const char **args = malloc(argc * sizeof(char *));
+	parametermaps_t *maps = calloc(1, sizeof(parametermaps_t));
+	unsigned int non_uniform = 0;
+	size_t number_nodes = (size_t) number_nodes_x * number_nodes_y;
+	*error = 0;
+	for (int i = 0; i < NUM_MODEL_PARAMETERS && !*error; i++) {
+		if (!contains_flag(argc, argv, MODEL_PARAMETER_MAP_FLAGS[i])) {
+			continue;
+		}
+		unsigned int count = parse_args(argc, argv, MODEL_PARAMETER_MAP_FLAGS[i], args);
+		nodeval_t *map = NULL;
+		if (count >= 1 && is_bitmap_path(args[0])) {
+			if (count != 3) {
+				printf("ERROR: Bitmap parameter maps need a path, a min and a max value: %s\n",
+					MODEL_PARAMETER_MAP_FLAGS[i]);
+			} else {
+				map = load_parameter_bitmap(args[0], number_nodes_x, number_nodes_y, *model_parameter(parameters, i),
+					atof(args[1]), atof(args[2]));
+			}
+		} else if (count == 1) {
+			map = load_parameter_raw(args[0], number_nodes_x, number_nodes_y);
+		} else {
+			printf("No argument with single string parameter found for: %s\n", MODEL_PARAMETER_MAP_FLAGS[i]);
+		}
+		if (map == NULL) {
+			*error = 1;
+			break;
+		}
+		//uniform maps are not stored, so that the sweeps do not read them
+		size_t node = 1;
+		while (node < number_nodes && map[node] == map[0]) {
+			node++;
+		}
+		if (node == number_nodes) {
+			*model_parameter(parameters, i) = map[0];
+			free(map);
+		} else {
+			*parameter_map(maps, i) = map;
+			non_uniform = 1;
+		}
+	}
+	free(args);
+	if (*error || !non_uniform) {
+		for (int i = 0; i < NUM_MODEL_PARAMETERS; i++) {
+			free(*parameter_map(maps, i));
+		}
+		free(maps);
+		return NULL;
+	}
+	return maps;
+}
+
+void init_ensemble_observation_timeseries(nodetimeseries_t *series, int num_observationnodes, int ensemble_size) {
+	for (int i = 0; i < num_observationnodes; i++) {
+		series[i].timeseries = realloc(series[i].timeseries,
+			(size_t) series[i].timeseries_ticks * ensemble_size * sizeof(nodeval_t));
+	}
+}
+
+framestream_t *open_frame_stream_from_sh(const int argc, const char * argv[], int number_nodes_x, int number_nodes_y,
+	const double tick_ms) {
+	//the path is read directly, as "-" (stdin) would be treated as the next flag by parse_args
+	const char *path = NULL;
+	for (int i = 0; i < argc - 1; i++) {
+		if (str_equals(FLAG_FREQ_STREAM, argv[i])) {
+			path = argv[i + 1];
+		}
+	}
+	if (path == NULL) {
+		printf("No argument with single string parameter found for: %s\n", FLAG_FREQ_STREAM);
+		return NULL;
+	}
+	int frame_duration_ticks = parse_int_arg(argc, argv, FLAG_BITMAP_DURATION);
+	int min_freq = 1;
+	int max_freq = 795;
+	if (contains_flag(argc, argv, FLAG_MIN_BITMAP_FREQ)) {
+		min_freq = parse_int_arg(argc, argv, FLAG_MIN_BITMAP_FREQ);
+	}
+	if (contains_flag(argc, argv, FLAG_MAX_BITMAP_FREQ)) {
+		max_freq = parse_int_arg(argc, argv, FLAG_MAX_BITMAP_FREQ);
+	}
+	return open_frame_stream(path, number_nodes_x, number_nodes_y, min_freq, max_freq, frame_duration_ticks, tick_ms);
+}
+
+eventlog_t *init_event_log_from_sh(const int argc, const char * argv[], int number_nodes_x, int number_nodes_y) {
+	nodeval_t threshold = parse_nodeval_arg(argc, argv, FLAG_EVENTS);
+	int * x_indices = malloc(argc * sizeof(int));
+	int * y_indices = malloc(argc * sizeof(int));
+	int number_selected = parse_int_args(argc, argv, FLAG_X_EVENTNODES, x_indices);
+	if (parse_int_args(argc, argv, FLAG_Y_EVENTNODES, y_indices) != number_selected) {
+		printf("ERROR: \"%s\" and \"%s\" must have the same number of parameters.\n", FLAG_X_EVENTNODES,
+			FLAG_Y_EVENTNODES);
+		free(x_indices);
+		free(y_indices);
+		return NULL;
+	}
+	eventlog_t *log = init_event_log(threshold, contains_flag(argc, argv, FLAG_EVENT_PEAKS), number_nodes_x,
+		number_nodes_y, number_selected, x_indices, y_indices);
+	free(x_indices);
+	free(y_indices);
+	return log;
+}
+
 nodeinputseries_t *generate_input_frequencies_default(int *num_inputnodes, const double tick_ms){
 	*num_inputnodes = 40;
 	int input_nodes_x_indices_default[] = {10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28,
@@ -410,6 +833,7 @@ nodeinputseries_t *generate_input_frequencies(const int number_of_inputnodes, co
     for (i = 0; i < number_of_inputnodes; ++i) {
         series[i].x_index = x_indices[i];
         series[i].y_index = y_indices[i];
+        series[i].z_index = 0;
         series[i].timeseries = generate_sin_frequency(frequencies[i], tick_ms);
         series[i].timeseries_ticks = calculate_period_length(frequencies[i], tick_ms);
     }
@@ -417,6 +841,110 @@ nodeinputseries_t *generate_input_frequencies(const int number_of_inputnodes, co
 }
 
 
+unsigned int qualifies_for_input_plane(const int number_nodes_x, const int number_nodes_y,
+                                       const int number_of_inputnodes, const nodeinputseries_t *inputs) {
+	if (number_of_inputnodes < 1
+		|| number_of_inputnodes < INPUT_PLANE_DENSITY * number_nodes_x * number_nodes_y) {
+		return 0;
+	}
+	//all inputs must be in the grid, share their timeseries length and each node may only have one input
+	unsigned char *has_input = calloc((size_t) number_nodes_x * number_nodes_y, sizeof(unsigned char));
+	unsigned int qualifies = 1;
+	for (int i = 0; i < number_of_inputnodes && qualifies; i++) {
+		int x = inputs[i].x_index;
+		int y = inputs[i].y_index;
+		if (x < 0 || x >= number_nodes_x || y < 0 || y >= number_nodes_y
+			|| inputs[i].timeseries_ticks != inputs[0].timeseries_ticks
+			|| has_input[(size_t) x * number_nodes_y + y]) {
+			qualifies = 0;
+		} else {
+			has_input[(size_t) x * number_nodes_y + y] = 1;
+		}
+	}
+	free(has_input);
+	return qualifies;
+}
+
+// hashes the series of a range of inputs (FNV-1a over the values), equal series have equal hashes
+static void hash_input_series(int start, int end, void *argument) {
+	inputplanegeneration_t *generation = argument;
+	for (int i = start; i < end; i++) {
+		const nodeval_t *series = generation->inputs[i].timeseries;
+		uint64_t hash = 14695981039346656037u;
+		for (int tick = 0; tick < generation->plane->period_ticks; tick++) {
+			uint64_t bits;
+			memcpy(&bits, &series[tick], sizeof(bits));
+			hash = (hash ^ bits) * 1099511628211u;
+		}
+		generation->hashes[i] = hash;
+	}
+}
+
+// writes the classes of a range of inputs to their nodes
+static void write_input_classes(int start, int end, void *argument) {
+	inputplanegeneration_t *generation = argument;
+	for (int i = start; i < end; i++) {
+		const nodeinputseries_t *input = &generation->inputs[i];
+		generation->plane->node_class[(size_t) input->x_index * generation->plane->number_nodes_y + input->y_index] =
+			generation->input_class[i] + 1;
+	}
+}
+
+void generate_input_plane(inputplane_t *plane, const int number_nodes_x, const int number_nodes_y,
+                          const int number_of_inputnodes, const nodeinputseries_t *inputs) {
+	plane->number_nodes_x = number_nodes_x;
+	plane->number_nodes_y = number_nodes_y;
+	plane->period_ticks = number_of_inputnodes > 0 ? inputs[0].timeseries_ticks : 1;
+	plane->number_classes = 0;
+	plane->node_class = calloc((size_t) number_nodes_x * number_nodes_y, sizeof(unsigned int));
+	plane->class_series = malloc((number_of_inputnodes > 0 ? number_of_inputnodes : 1) * sizeof(nodeval_t *));
+	inputplanegeneration_t generation;
+	generation.plane = plane;
+	generation.inputs = inputs;
+	generation.hashes = malloc((number_of_inputnodes > 0 ? number_of_inputnodes : 1) * sizeof(uint64_t));
+	generation.input_class = malloc((number_of_inputnodes > 0 ? number_of_inputnodes : 1) * sizeof(unsigned int));
+	run_parallel_range(number_of_inputnodes, 1024, hash_input_series, &generation);
+	//inputs with equal series share a class, found in an open addressing table of the classes by hash
+	size_t table_size = 1;
+	while (table_size < 2 * (size_t) number_of_inputnodes) {
+		table_size *= 2;
+	}
+	unsigned int *table = malloc(table_size * sizeof(unsigned int));
+	uint64_t *class_hashes = malloc((number_of_inputnodes > 0 ? number_of_inputnodes : 1) * sizeof(uint64_t));
+	memset(table, 0xff, table_size * sizeof(unsigned int));
+	for (int i = 0; i < number_of_inputnodes; i++) {
+		size_t slot = generation.hashes[i] & (table_size - 1);
+		while (table[slot] != UINT_MAX) {
+			unsigned int c = table[slot];
+			if (class_hashes[c] == generation.hashes[i] && (plane->class_series[c] == inputs[i].timeseries
+				|| memcmp(plane->class_series[c], inputs[i].timeseries,
+					(size_t) plane->period_ticks * sizeof(nodeval_t)) == 0)) {
+				break;
+			}
+			slot = (slot + 1) & (table_size - 1);
+		}
+		if (table[slot] == UINT_MAX) {
+			table[slot] = plane->number_classes;
+			class_hashes[plane->number_classes] = generation.hashes[i];
+			plane->class_series[plane->number_classes] = inputs[i].timeseries;
+			plane->number_classes++;
+		}
+		generation.input_class[i] = table[slot];
+	}
+	run_parallel_range(number_of_inputnodes, 1024, write_input_classes, &generation);
+	plane->class_series = realloc(plane->class_series,
+		(plane->number_classes > 0 ? plane->number_classes : 1) * sizeof(nodeval_t *));
+	free(class_hashes);
+	free(table);
+	free(generation.input_class);
+	free(generation.hashes);
+}
+
+void free_input_plane(inputplane_t *plane) {
+	free(plane->node_class);
+	free((void *) plane->class_series);
+}
+
 double *generate_sin_time_series(int hz, const double tick_ms, int number_of_samples) {
     double *series = malloc(number_of_samples * sizeof(double));
     int i;
@@ -445,6 +973,23 @@ int calculate_period_length(int hz, const double tick_ms) {
     return period;
 }
 
+static void sum_bitmap_rows(int start, int end, void *argument) {
+	bitmapsum_t *summation = argument;
+	const bitmapinfoheader_t *info = summation->info;
+	unsigned int colors = info->bit_per_px / 8;
+	//bitmaps seem to have their "0,0" coordinate in the bottom left, we want it in the top left
+	//that's way we invert the y-axis
+	for (int y = start; y < end; y++) {
+		for (int x = 0; x < info->width; x++) {
+			int target_position = (info->height - 1 - y) * info->width + x;
+			int source_position = y * info->width + x;
+			for (int color = 0; color < colors; color++) {
+				summation->sums[target_position] += summation->image[source_position * colors + color];
+			}
+		}
+	}
+}
+
 static unsigned int *load_and_sum_bitmap_file(const char *bitmap_path, bitmapinfoheader_t *bitmap_info_header) {
 	FILE *file;
 	bitmapfilehader_t bitmap_file_header;
@@ -479,7 +1024,6 @@ static unsigned int *load_and_sum_bitmap_file(const char *bitmap_path, bitmapinf
 		return NULL;
 	}
 
-	unsigned int colors = bitmap_info_header->bit_per_px / 8;
 	if (bitmap_info_header->bit_per_px != 24) {
 		printf("ERROR: Unsupported bitmap format with only %d bits per pixel."
 			" 24 bit bitmap required.\n", bitmap_info_header->bit_per_px);
@@ -495,19 +1039,10 @@ static unsigned int *load_and_sum_bitmap_file(const char *bitmap_path, bitmapinf
 		return NULL;
 	}
 
-	unsigned int *sums = malloc(bitmap_info_header->height * bitmap_info_header->width * sizeof(unsigned int));
-	//bitmaps seem to have their "0,0" coordinate in the bottom left, we want it in the top left
-	//that's way we invert the y-axis
-	for (int y = 0; y < bitmap_info_header->height; y++) {
-		for (int x = 0; x < bitmap_info_header->width; x++) {
-			int target_position = (bitmap_info_header->height - 1 - y) * bitmap_info_header->width + x;
-			int source_position = y * bitmap_info_header->width + x;
-			for (int color = 0; color < colors; color++) {
-				sums[target_position] += image[source_position * colors + color];
-			}
-		}
-	}
-	
+	unsigned int *sums = calloc(bitmap_info_header->height * bitmap_info_header->width, sizeof(unsigned int));
+	bitmapsum_t summation = {bitmap_info_header, image, sums};
+	run_parallel_range(bitmap_info_header->height, 16, sum_bitmap_rows, &summation);
+
 	fclose(file);
 	free(image);
 	return sums;
@@ -9,24 +9,32 @@
 #define FLAG_X_OBSERVATIONNODES "--xobs"
 /** Command line flag for y indices of observation nodes (multiple integer paramters).*/
 #define FLAG_Y_OBSERVATIONNODES "--yobs"
+/** Command line flag for z indices of observation nodes in a volume (multiple integer paramters).*/
+#define FLAG_Z_OBSERVATIONNODES "--zobs"
 /** Command line flag to observa all nodes (no additional parameters).*/
 #define FLAG_ALL_OBSERVATIONNODES "--allobs"
 /** Command line flag for node grid size on the x axis (single integer paramter).*/
 #define FLAG_X_NODES "-x"
 /** Command line flag for node grid size on the y axis (single integer paramter).*/
 #define FLAG_Y_NODES "-y"
+/** Command line flag for node volume size on the z axis, simulates a volume (single integer paramter).*/
+#define FLAG_Z_NODES "-z"
 /** Command line flag for starting energy levels of start nodes (multiple double paramters).*/
 #define FLAG_START_LEVELS "--startlevels"
 /** Command line flag for x indices of start nodes (multiple integer paramters).*/
 #define FLAG_START_NODES_X "--startx"
 /** Command line flag for y indices of start nodes (multiple integer paramters).*/
 #define FLAG_START_NODES_Y "--starty"
+/** Command line flag for z indices of start nodes in a volume (multiple integer paramters).*/
+#define FLAG_START_NODES_Z "--startz"
 /** Command line flag for frequencies of frequency generating nodes (multiple intger paramters).*/
 #define FLAG_FREQUENCIES "--freqs"
 /** Command line flag for x indices of frequency generating nodes (multiple integer paramters).*/
 #define FLAG_FREQ_NODES_X "--freqx"
 /** Command line flag for y indices of frequency generating nodes (multiple integer paramters).*/
 #define FLAG_FREQ_NODES_Y "--freqy"
+/** Command line flag for z indices of frequency generating nodes in a volume (multiple integer paramters).*/
+#define FLAG_FREQ_NODES_Z "--freqz"
 /** Command line flag for bitmap image paths, interpreted as frequencies (multiple string paramters).*/
 #define FLAG_FREQ_BITMAPS "--freqbitmaps"
 /** Command line flag for the frequency to be used for the min non-0 bitmap value (1) (single integer paramter).*/
@@ -37,6 +45,72 @@
  *  (single integer paramter).
  */
 #define FLAG_BITMAP_DURATION "--bitmapduration"
+/** Command line flag for the path of a raw frame stream (file, named pipe or "-" for stdin), interpreted as frequencies
+ *  like bitmaps (single string paramter). Uses the min/max frequency and duration of the bitmap flags.
+ */
+#define FLAG_FREQ_STREAM "--freqstream"
+/** Command line flag for the name of the kernel to simulate with (single string paramter).*/
+#define FLAG_KERNEL "--kernel"
+/** Command line flag for the method to compute the kernel's sums with (single string paramter).*/
+#define FLAG_KERNEL_METHOD "--kernelmethod"
+/** Command line flag for the path of a file of long-range connections between nodes (single string paramter).*/
+#define FLAG_CONNECTIONS "--connections"
+/** Command line flag for the path of a file of coupled regions to simulate instead of a single grid (single string paramter).*/
+#define FLAG_REGIONS "--regions"
+/** Command line flag for simulating by superposition of impulse responses (no paramters).*/
+#define FLAG_SUPERPOSITION "--superposition"
+/** Command line flag for the directory to cache impulse responses in (single string paramter).*/
+#define FLAG_IMPULSE_CACHE "--impulsecache"
+/** Command line flag for fast-forwarding through input-free intervals in the spectral domain (no paramters).*/
+#define FLAG_FAST_FORWARD "--fastforward"
+/** Command line flag for stopping runs early once they converged or diverged (one floating point paramter, the tolerance).*/
+#define FLAG_EARLY_STOP "--earlystop"
+/** Command line flag for recording threshold events (one floating point paramter, the threshold).*/
+#define FLAG_EVENTS "--events"
+/** Command line flag for recording peaks above the threshold in addition to crossings (no paramters).*/
+#define FLAG_EVENT_PEAKS "--eventpeaks"
+/** Command line flag for the x indices of the nodes to record events of (multiple integer parameters).*/
+#define FLAG_X_EVENTNODES "--eventx"
+/** Command line flag for the y indices of the nodes to record events of (multiple integer parameters).*/
+#define FLAG_Y_EVENTNODES "--eventy"
+/** Command line flag for the live metrics file to publish the progress in (one parameter, the path).*/
+#define FLAG_METRICS "--metrics"
+/** Command line flag for the Chrome trace file to write the phases of the threads to (one parameter, the path).*/
+#define FLAG_TRACE "--trace"
+/** Command line flag for tracing only every Nth tick (one integer parameter, default 1).*/
+#define FLAG_TRACE_SAMPLE "--tracesample"
+/** Command line flag for the direct neighbor factor (a1) of the model (one floating point paramter, or one per ensemble member).*/
+#define FLAG_D_NEIGHBORFACTOR "--dneighborfactor"
+/** Command line flag for the indirect neighbor factor (a2) of the model (one floating point paramter, or one per ensemble member).*/
+#define FLAG_ID_NEIGHBORFACTOR "--idneighborfactor"
+/** Command line flag for the energy factor (b) of the model (one floating point paramter, or one per ensemble member).*/
+#define FLAG_ENERGY_FACTOR "--energyfactor"
+/** Command line flag for the energy weight (g) of the model (one floating point paramter, or one per ensemble member).*/
+#define FLAG_ENERGY_WEIGHT "--energyweight"
+/** Command line flag for the delta factor (e) of the model (one floating point paramter, or one per ensemble member).*/
+#define FLAG_DELTA_FACTOR "--deltafactor"
+/** Command line flag for the slope factor (d) of the model (one floating point paramter, or one per ensemble member).*/
+#define FLAG_SLOPE_FACTOR "--slopefactor"
+/** Command line flag for the slope weight (h) of the model (one floating point paramter, or one per ensemble member).*/
+#define FLAG_SLOPE_WEIGHT "--slopeweight"
+/** Command line flag for the damping of the model (one floating point paramter, or one per ensemble member).*/
+#define FLAG_DAMPING "--damping"
+/** Command line flag for a per-node direct neighbor factor (a1) map (path, followed by the min and max value for bitmaps).*/
+#define FLAG_D_NEIGHBORFACTOR_MAP "--dneighborfactormap"
+/** Command line flag for a per-node indirect neighbor factor (a2) map (path, followed by the min and max value for bitmaps).*/
+#define FLAG_ID_NEIGHBORFACTOR_MAP "--idneighborfactormap"
+/** Command line flag for a per-node energy factor (b) map (path, followed by the min and max value for bitmaps).*/
+#define FLAG_ENERGY_FACTOR_MAP "--energyfactormap"
+/** Command line flag for a per-node energy weight (g) map (path, followed by the min and max value for bitmaps).*/
+#define FLAG_ENERGY_WEIGHT_MAP "--energyweightmap"
+/** Command line flag for a per-node delta factor (e) map (path, followed by the min and max value for bitmaps).*/
+#define FLAG_DELTA_FACTOR_MAP "--deltafactormap"
+/** Command line flag for a per-node slope factor (d) map (path, followed by the min and max value for bitmaps).*/
+#define FLAG_SLOPE_FACTOR_MAP "--slopefactormap"
+/** Command line flag for a per-node slope weight (h) map (path, followed by the min and max value for bitmaps).*/
+#define FLAG_SLOPE_WEIGHT_MAP "--slopeweightmap"
+/** Command line flag for a per-node damping map (path, followed by the min and max value for bitmaps).*/
+#define FLAG_DAMPING_MAP "--dampingmap"
 
 
 /**
@@ -62,6 +136,24 @@ unsigned int contains_flag(const int argc, const char * argv[], const char * fla
 */
 int parse_int_arg(const int argc, const char * argv[], const char * flag);
 
+/**
+* Parses a floating point argument from the command line for a specified flag.
+* @param argc Number of command line arguments.
+* @param argv Command line arguments.
+* @param flag The command line flag.
+* @return The parsed floating point argument for the flag, 0 if the flag is not followed by a single parameter.
+*/
+nodeval_t parse_nodeval_arg(const int argc, const char * argv[], const char * flag);
+
+/**
+* Parses a string argument from the command line for a specified flag.
+* @param argc Number of command line arguments.
+* @param argv Command line arguments.
+* @param flag The command line flag.
+* @return The string argument for the flag, NULL if the flag is not followed by a single parameter.
+*/
+const char *parse_string_arg(const int argc, const char * argv[], const char * flag);
+
 /**
  * Initializes num_oberservationnodes timeseries structs and returns them in an array
  * using settings from the command line.
@@ -117,6 +209,27 @@ nodetimeseries_t *init_all_observation_timeseries(const int node_grid_size_x,
 void init_start_time_state_from_sh(const int argc, const char * argv[], 
 	const int number_nodes_x, const int number_nodes_y, nodeval_t **nodes);
 
+/**
+ * Reads the start levels of the nodes of a volume from the command line.
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @param num_startnodes Writes the number of start nodes to this pointer.
+ * @return The start nodes. Length: num_startnodes.
+ */
+nodelevel_t *init_start_levels_3d_from_sh(const int argc, const char * argv[], int *num_startnodes);
+
+/**
+ * Sets the z indices of observation nodes or inputs of a volume from the command line. Nodes without a z index
+ * are placed at z = 0.
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @param flag The flag listing the z indices (FLAG_Z_OBSERVATIONNODES or FLAG_FREQ_NODES_Z).
+ * @param num_nodes The number of nodes.
+ * @param z_indices Writes the z index of each node to this array. Length: num_nodes.
+ */
+void parse_z_indices_from_sh(const int argc, const char * argv[], const char * flag, const int num_nodes,
+	int *z_indices);
+
 /**
  * Initializes a nodegrid with a default size and initializes it with zero.
  * @param number_nodes_x Writes the number of nodes in the x-axis to this pointer.
@@ -227,6 +340,38 @@ nodeinputseries_t *generate_input_frequencies(const int number_of_inputnodes, co
                                               const int *y_indices, const int *frequencies, const double tick_ms);
 
 
+/**
+ * Checks whether the given inputs qualify for being stored as dense input planes, i.e., whether they cover at
+ * least INPUT_PLANE_DENSITY of the node grid, all have the same timeseries length and no node has more than one
+ * input.
+ * @param number_nodes_x The x dimension of the node field.
+ * @param number_nodes_y The y dimension of the node field.
+ * @param number_of_inputnodes The number of inputs.
+ * @param inputs The inputs to check. Length: number_of_inputnodes.
+ * @return 1 if the inputs should be stored as dense input planes, 0 otherwise.
+ */
+unsigned int qualifies_for_input_plane(const int number_nodes_x, const int number_nodes_y,
+                                       const int number_of_inputnodes, const nodeinputseries_t *inputs);
+
+/**
+ * Generates a dense input plane from the given inputs. Inputs with equal series share one input class, the plane
+ * refers to their series instead of copying them. Nodes without input have no class.
+ * All inputs must have the same timeseries length (see qualifies_for_input_plane()).
+ * @param plane The input plane struct to initialize. Memory for the classes is allocated as part of initialization.
+ * @param number_nodes_x The x dimension of the node field.
+ * @param number_nodes_y The y dimension of the node field.
+ * @param number_of_inputnodes The number of inputs.
+ * @param inputs The inputs to store in the planes. Length: number_of_inputnodes.
+ */
+void generate_input_plane(inputplane_t *plane, const int number_nodes_x, const int number_nodes_y,
+                          const int number_of_inputnodes, const nodeinputseries_t *inputs);
+
+/**
+ * Frees the memory of an input plane allocated by generate_input_plane(). The series of the inputs are not freed.
+ * @param plane The input plane.
+ */
+void free_input_plane(inputplane_t *plane);
+
 /**
  * Reads a bitmap image file and returns the sum color values for each pixel in a array.
  * Array length is width * height. Get pixel using array[y * width + x].
@@ -254,6 +399,8 @@ unsigned int *read_bitmap_contents(const char *bitmap_path, unsigned int *bitmap
  * @param tick_ms The milliseconds in between each simulation tick, i.e., the required resolution in milliseconds.
  * This parameter influences the number of generated samples, as frequency is defined in periods/second (Hz).
  * @return The array of input nodes initialized with the specified frequencies. Length: num_inputnodes.
+ * The timeseries of all returned input nodes share a single allocation, which starts at the timeseries
+ * of the first input node.
 */
 nodeinputseries_t *generate_input_frequencies_from_bitmap(const char * filenames[], const unsigned int num_filenames,
 	const int min_freq, const int max_freq, const int bitmap_duration_ticks, int *num_inputnodes, const double tick_ms);
@@ -271,4 +418,81 @@ nodeinputseries_t *generate_input_frequencies_from_bitmap(const char * filenames
  */
 nodeinputseries_t *generate_input_frequencies_from_sh_bitmap(const int argc, const char * argv[], int *num_inputnodes, const double tick_ms);
 
+/**
+ * Overrides model parameters with the values specified on the command line. Parameters without a flag on the
+ * command line keep their value.
+ * Uses command line arguments.
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @param parameters The model parameters to override.
+ */
+void parse_model_parameters_from_sh(const int argc, const char * argv[], modelparameters_t *parameters);
+
+/**
+ * Parses the model parameters of an ensemble from the command line. Each model parameter flag may be followed by
+ * multiple values, one per member. All flags with multiple values must have the same number of values, which is the
+ * size of the ensemble. Parameters with a single value (or without a flag) are the same for all members.
+ * Uses command line arguments.
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @param parameters The parameters shared by all members, parsed using parse_model_parameters_from_sh().
+ * @param ensemble_size The number of members is written to this pointer. 1 if no flag has multiple values,
+ * 0 if the number of values does not match.
+ * @return The parameters of each member, NULL if no ensemble is defined. Length: ensemble_size.
+ */
+modelparameters_t *parse_ensemble_parameters_from_sh(const int argc, const char * argv[],
+	const modelparameters_t *parameters, int *ensemble_size);
+
+/**
+ * Loads per-node model parameters from the parameter map flags of the command line (e.g., --dampingmap).
+ * A map is either a 24-bit bitmap (path ending in .bmp), followed by the parameter values for the minimum (0) and the
+ * maximum (765) color sum, or a raw file of number_nodes_x * number_nodes_y doubles in the grid layout
+ * (node (x, y) at index x * number_nodes_y + y). Bitmap pixels are mapped to nodes like input bitmaps, nodes outside of
+ * the bitmap keep the uniform parameter. Maps with the same value for all nodes set the uniform parameter instead.
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @param number_nodes_x The x dimension of the node field.
+ * @param number_nodes_y The y dimension of the node field.
+ * @param parameters The uniform model parameters, parsed using parse_model_parameters_from_sh().
+ * @param error Set to 1 if a map could not be loaded, 0 otherwise.
+ * @return The per-node parameters, NULL if there are no non-uniform maps.
+ */
+parametermaps_t *parse_parameter_maps_from_sh(const int argc, const char * argv[], const int number_nodes_x,
+	const int number_nodes_y, modelparameters_t *parameters, unsigned int *error);
+
+/**
+ * Enlarges the time series of observation nodes, so that they can hold the observations of all members of an
+ * ensemble (see nodetimeseries_t).
+ * @param series The observation nodes.
+ * @param num_observationnodes The number of observation nodes.
+ * @param ensemble_size The number of members of the ensemble.
+ */
+void init_ensemble_observation_timeseries(nodetimeseries_t *series, int num_observationnodes, int ensemble_size);
+
+/**
+ * Opens the raw frame stream specified on the command line as input source. Each frame is interpreted like a bitmap
+ * and generates sin-frequency inputs for the duration specified for bitmaps.
+ * Uses command line arguments.
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @param number_nodes_x The number of nodes in the first dimension of the simulated grid.
+ * @param number_nodes_y The number of nodes in the second dimension of the simulated grid.
+ * @param tick_ms The milliseconds in between each simulation tick.
+ * @return The opened stream, NULL if it could not be opened. Close using close_frame_stream().
+ */
+framestream_t *open_frame_stream_from_sh(const int argc, const char * argv[], int number_nodes_x, int number_nodes_y,
+	const double tick_ms);
+
+/**
+ * Creates the log of threshold events specified on the command line: the threshold, whether peaks are recorded and
+ * the selected nodes (all nodes if none are selected).
+ * Uses command line arguments.
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @param number_nodes_x The number of nodes in the first dimension of the simulated grid.
+ * @param number_nodes_y The number of nodes in the second dimension of the simulated grid.
+ * @return The log, NULL if the selected nodes are invalid. Free using free_event_log().
+ */
+eventlog_t *init_event_log_from_sh(const int argc, const char * argv[], int number_nodes_x, int number_nodes_y);
+
 #endif
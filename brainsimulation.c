@@ -1,16 +1,201 @@
 #include "brainsimulation.h"
 #include "nodefunc.h"
 #include "kernels.h"
+#include "brainsetup.h"
+#include "framestream.h"
+#include "connectome.h"
+#include "superposition.h"
+#include "fastforward.h"
+#include "convergence.h"
+#include "events.h"
+#include "phasetiming.h"
+#include "perfcounters.h"
+#include "metrics.h"
+#include "trace.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <math.h>
 
+// the energy an input adds to its node at the given tick, input timeseries are repeated periodically
+static inline nodeval_t input_at_tick(int tick_number, const nodeinputseries_t *input) {
+    return input->timeseries[tick_number % input->timeseries_ticks];
+}
+
+void init_simulation_options(simulationoptions_t *options) {
+    options->input_stream = NULL;
+    options->kernel_name = NULL;
+    options->reference_engine = 0;
+    init_model_parameters(&options->parameters);
+    options->ensemble_size = 1;
+    options->ensemble_parameters = NULL;
+    options->parameter_maps = NULL;
+    options->kernel_method = NULL;
+    options->connectome = NULL;
+    options->superposition = 0;
+    options->impulse_cache = NULL;
+    options->fast_forward = 0;
+    options->early_stop_tolerance = 0;
+    options->events = NULL;
+    options->metrics = NULL;
+    options->trace = NULL;
+    options->setup_seconds = 0;
+}
+
+typedef struct {
+    nodeval_t **source;
+    nodeval_t **ensemble_state;
+    int number_nodes_y;
+    int ensemble_lanes;
+} ensemblestate_t;
+
+// copies the rows of the start state into all lanes of the ensemble state
+static void replicate_ensemble_rows(int start, int end, void *argument) {
+    ensemblestate_t *state = argument;
+    for (int x = start; x < end; x++) {
+        for (int y = 0; y < state->number_nodes_y; y++) {
+            for (int m = 0; m < state->ensemble_lanes; m++) {
+                state->ensemble_state[x][(size_t) y * state->ensemble_lanes + m] = state->source[x][y];
+            }
+        }
+    }
+}
+
+static inline int is_positive_zero(nodeval_t value) {
+    return value == 0 && !signbit(value);
+}
+
+// 1 if any node of the span has a non-zero energy level or slope
+static inline unsigned char span_is_nonzero(const nodeval_t *act_row, const nodeval_t *slope_row, int start, int end) {
+    for (int j = start; j < end; j++) {
+        if (!is_positive_zero(act_row[j]) || !is_positive_zero(slope_row[j])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// whether skipping quiescent nodes leaves the results unchanged, i.e., whether zero stays +0.0 for all nodes
+static int zero_is_stable(const kernel_t *kernel, const simulationoptions_t *options, int number_nodes_x,
+                          int number_nodes_y) {
+    modelcoefficients_t coefficients;
+    init_model_coefficients(&coefficients, &options->parameters, kernel->number_d_neighbors,
+                            kernel->number_id_neighbors);
+    if (!zero_is_fixed_point(&coefficients)) {
+        return 0;
+    }
+    if (options->parameter_maps != NULL) {
+        for (size_t node = 0; node < (size_t) number_nodes_x * number_nodes_y; node++) {
+            modelparameters_t node_parameters;
+            node_model_parameters(&node_parameters, &options->parameters, options->parameter_maps, node);
+            init_model_coefficients(&coefficients, &node_parameters, kernel->number_d_neighbors,
+                                    kernel->number_id_neighbors);
+            if (!zero_is_fixed_point(&coefficients)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// whether pruning to the light cones of the observation nodes is worth checking the cones of all of them in each row,
+// i.e., whether there are fewer of them than tiles per row
+static int qualifies_for_light_cone(int number_nodes_y, int num_observationnodes) {
+    int number_tiles = (number_nodes_y + ACTIVITY_TILE_SIZE - 1) / ACTIVITY_TILE_SIZE;
+    return num_observationnodes > 0 && num_observationnodes <= number_tiles;
+}
+
+static void init_activity_map(activitymap_t *activity, const kernel_t *kernel, nodeval_t **state, nodeval_t **slopes,
+                              int number_nodes_x, int number_nodes_y, int skip_quiescent, int light_cone) {
+    activity->skip_quiescent = skip_quiescent;
+    activity->light_cone = light_cone;
+    activity->number_tiles = (number_nodes_y + ACTIVITY_TILE_SIZE - 1) / ACTIVITY_TILE_SIZE;
+    activity->radius_rows = kernel->radius;
+    activity->radius_tiles = (kernel->radius + ACTIVITY_TILE_SIZE - 1) / ACTIVITY_TILE_SIZE;
+    size_t size = (size_t) number_nodes_x * activity->number_tiles;
+    activity->nonzero[0] = malloc(size);
+    activity->nonzero[1] = malloc(size);
+    activity->full_rows[0] = malloc(number_nodes_x);
+    activity->full_rows[1] = malloc(number_nodes_x);
+    for (int x = 0; x < number_nodes_x; x++) {
+        for (int t = 0; t < activity->number_tiles; t++) {
+            int tile_end = (t + 1) * ACTIVITY_TILE_SIZE < number_nodes_y ? (t + 1) * ACTIVITY_TILE_SIZE
+                                                                          : number_nodes_y;
+            activity->nonzero[0][(size_t) x * activity->number_tiles + t] =
+                    span_is_nonzero(state[x], slopes[x], t * ACTIVITY_TILE_SIZE, tile_end);
+        }
+        activity->full_rows[0][x] = memchr(activity->nonzero[0] + (size_t) x * activity->number_tiles, 0,
+                                           activity->number_tiles) == NULL;
+    }
+    // the new state is uninitialized, so that all of its tiles must be written once
+    memset(activity->nonzero[1], 1, size);
+    memset(activity->full_rows[1], 1, number_nodes_x);
+}
+
+// lists the parameters given per node
+static void print_parameter_maps(const parametermaps_t *maps) {
+    printf("Per-node model parameters:%s%s%s%s%s%s%s%s\n", maps->d_neighborfactor != NULL ? " d_neighborfactor" : "",
+           maps->id_neighborfactor != NULL ? " id_neighborfactor" : "",
+           maps->energy_factor != NULL ? " energy_factor" : "", maps->energy_weight != NULL ? " energy_weight" : "",
+           maps->delta_factor != NULL ? " delta_factor" : "", maps->slope_factor != NULL ? " slope_factor" : "",
+           maps->slope_weight != NULL ? " slope_weight" : "", maps->damping != NULL ? " damping" : "");
+}
+
+// lists the number of fast-forwarded intervals and ticks
+static void print_fast_forward(const fastforward_t *fast_forward, int min_ticks, int num_ticks) {
+    int number_intervals = 0;
+    int number_ticks = 0;
+    for (int tick = 0; fast_forward != NULL && tick < num_ticks; tick++) {
+        int end = fast_forward_end(fast_forward, tick);
+        if (end > tick) {
+            number_intervals++;
+            number_ticks += end - tick;
+            tick = end - 1;
+        }
+    }
+    printf("Fast-forwarding %d input-free intervals of at least %d ticks (%d ticks).\n", number_intervals,
+           min_ticks, number_ticks);
+}
+
+static void print_convergence_monitor(const convergencemonitor_t *monitor) {
+    if (monitor->steady_state) {
+        printf("Stopping early in a steady state (tolerance %g, %d ticks) or on divergence.\n", monitor->tolerance,
+               EARLY_STOP_STEADY_TICKS);
+    } else if (monitor->period > 0) {
+        printf("Stopping early in a periodic orbit of %d ticks (tolerance %g) or on divergence.\n", monitor->period,
+               monitor->tolerance);
+    } else {
+        printf("Stopping early on divergence.\n");
+    }
+}
+
+static void print_model_parameters(const char *prefix, const modelparameters_t *parameters) {
+    printf("%sd_neighborfactor = %g, id_neighborfactor = %g, energy_factor = %g, energy_weight = %g, "
+           "delta_factor = %g, slope_factor = %g, slope_weight = %g, damping = %g\n", prefix,
+           parameters->d_neighborfactor, parameters->id_neighborfactor, parameters->energy_factor,
+           parameters->energy_weight, parameters->delta_factor, parameters->slope_factor, parameters->slope_weight,
+           parameters->damping);
+}
 
 // implement the actual simulation here
 unsigned int simulate(double tick_ms, int num_ticks, int number_nodes_x, int number_nodes_y, nodeval_t **old_state,
                       int num_obervationnodes, nodetimeseries_t *observationnodes, int number_inputs,
-                      nodeinputseries_t *inputs) {
+                      nodeinputseries_t *inputs, const simulationoptions_t *options) {
+    simulationoptions_t default_options;
+    if (options == NULL) {
+        init_simulation_options(&default_options);
+        options = &default_options;
+    }
+    if (options->superposition) {
+        if (options->events != NULL) {
+            printf("ERROR: Events cannot be recorded when simulating by superposition.\n");
+            return 1;
+        }
+        return simulate_superposition(tick_ms, num_ticks, number_nodes_x, number_nodes_y, old_state,
+                                      num_obervationnodes, observationnodes, number_inputs, inputs, options);
+    }
     executioncontext_t executioncontext;
     init_executioncontext(&executioncontext);
     printf("Starting simulation.\n");
@@ -20,7 +205,7 @@ unsigned int simulate(double tick_ms, int num_ticks, int number_nodes_x, int num
     printf("Length of each tick (ms): %f\n", tick_ms);
     printf("Number of threads: %d\n", executioncontext.num_threads);
 	printf("Number of observation nodes: %d\n", num_obervationnodes);
-    struct timeval tv1, tv2;
+    struct timeval tv1, tv_setup, tv2;
     get_daytime(&tv1);
 	if (num_obervationnodes == number_nodes_x * number_nodes_y) {
 		printf("WARNING: Observing all nodes. This is very slow and result files will occupy a lot of disk space.\n");
@@ -33,27 +218,257 @@ unsigned int simulate(double tick_ms, int num_ticks, int number_nodes_x, int num
     printf("\n");
     // Starting simulation
     // initializing memory
-    nodeval_t **new_state = alloc_2d(number_nodes_x, number_nodes_y);
-    nodeval_t **slopes = alloc_2d(number_nodes_x, number_nodes_y);
-    init_zeros_2d(slopes, number_nodes_x, number_nodes_y);
-    nodeval_t ****kernels = alloc_4d(number_nodes_x, number_nodes_y, 2, 4);
+    // an ensemble stores the values of all members of a node next to each other, padded to full SIMD lanes
+    int ensemble_lanes = 1;
+    if (options->ensemble_size > 1) {
+        if (options->ensemble_parameters == NULL) {
+            printf("ERROR: No model parameters given for the %d ensemble members.\n", options->ensemble_size);
+            return 1;
+        }
+        if (options->parameter_maps != NULL) {
+            printf("ERROR: Ensembles cannot be simulated with per-node model parameters.\n");
+            return 1;
+        }
+        if (options->connectome != NULL) {
+            printf("ERROR: Ensembles cannot be simulated with long-range connections.\n");
+            return 1;
+        }
+        ensemble_lanes = ensemble_lane_count(options->ensemble_size);
+        nodeval_t **ensemble_state = alloc_2d(number_nodes_x, number_nodes_y * ensemble_lanes);
+        ensemblestate_t replication = {old_state, ensemble_state, number_nodes_y, ensemble_lanes};
+        run_parallel_range(number_nodes_x, 64, replicate_ensemble_rows, &replication);
+        old_state = ensemble_state;
+    }
+    kernel_t kernel;
+    if (init_kernel(&kernel, options->kernel_name)) {
+        if (options->ensemble_size > 1) {
+            free_2d(old_state, number_nodes_x);
+        }
+        return 1;
+    }
+    printf("Kernel: %s (%d direct, %d indirect neighbors).\n", kernel.name, kernel.number_d_neighbors,
+           kernel.number_id_neighbors);
+    // the ensemble engine and the reference engine always sum the kernel directly
+    const char *kernel_method = options->kernel_method;
+    if (options->ensemble_size > 1 || options->reference_engine) {
+        if (kernel_method != NULL && strcmp(kernel_method, "auto") != 0 && strcmp(kernel_method, "direct") != 0) {
+            printf("WARNING: Kernel method %s is not supported by the %s engine. Using direct sums.\n", kernel_method,
+                   options->ensemble_size > 1 ? "ensemble" : "reference");
+        }
+        kernel_method = "direct";
+    }
+    if (init_kernel_method(&kernel, kernel_method, number_nodes_x, number_nodes_y)) {
+        free_kernel(&kernel);
+        if (options->ensemble_size > 1) {
+            free_2d(old_state, number_nodes_x);
+        }
+        return 1;
+    }
+    nodeval_t **new_state = alloc_2d(number_nodes_x, number_nodes_y * ensemble_lanes);
+    nodeval_t **slopes = alloc_2d(number_nodes_x, number_nodes_y * ensemble_lanes);
+    init_zeros_2d(slopes, number_nodes_x, number_nodes_y * ensemble_lanes);
+    if (kernel.method == KERNEL_METHOD_FFT) {
+        printf("Kernel method: fft (%d x %d transforms).\n", kernel.fft_size, kernel.fft_size);
+    } else {
+        printf("Kernel method: %s\n", kernel_method_name(kernel.method));
+    }
+    if (options->ensemble_size > 1) {
+        printf("Simulating an ensemble of %d members (%d lanes per node).\n", options->ensemble_size, ensemble_lanes);
+        if (options->reference_engine) {
+            printf("WARNING: The reference engine does not support ensembles. Using the ensemble engine.\n");
+        }
+        for (int m = 0; m < options->ensemble_size; m++) {
+            char prefix[32];
+            sprintf(prefix, "Member %d: ", m);
+            print_model_parameters(prefix, &options->ensemble_parameters[m]);
+        }
+    } else {
+        if (options->reference_engine) {
+            printf("Using the reference engine.\n");
+        }
+        print_model_parameters("Model parameters: ", &options->parameters);
+        if (options->parameter_maps != NULL) {
+            print_parameter_maps(options->parameter_maps);
+        }
+        if (options->connectome != NULL) {
+            printf("Long-range connections: %d connections to %d target nodes.\n",
+                   options->connectome->number_connections, options->connectome->number_rows);
+        }
+    }
+    kernelfunc_t d_kernel = d_kernel_function_factory(kernel.name);
+    kernelfunc_t id_kernel = id_kernel_function_factory(kernel.name);
+    // quiescent tiles are skipped by the specialized sweeps summing the kernel directly, if that is exact, as well as
+    // tiles outside of the light cones of the observation nodes, unless connections reach beyond them or the run may
+    // stop early or records events, which requires all nodes of each tick
+    activitymap_t activity_map;
+    activitymap_t *activity = NULL;
+    if (options->ensemble_size <= 1 && !options->reference_engine && kernel.method == KERNEL_METHOD_DIRECT) {
+        int skip_quiescent = ACTIVITY_TRACKING && zero_is_stable(&kernel, options, number_nodes_x, number_nodes_y);
+        int light_cone = LIGHTCONE_PRUNING && options->connectome == NULL && !(options->early_stop_tolerance > 0)
+                         && options->events == NULL
+                         && qualifies_for_light_cone(number_nodes_y, num_obervationnodes);
+        if (skip_quiescent || light_cone) {
+            init_activity_map(&activity_map, &kernel, old_state, slopes, number_nodes_x, number_nodes_y,
+                              skip_quiescent, light_cone);
+            activity = &activity_map;
+        }
+        if (skip_quiescent) {
+            printf("Skipping quiescent tiles of %d nodes.\n", ACTIVITY_TILE_SIZE);
+        }
+        if (light_cone) {
+            printf("Skipping tiles outside of the light cones of the %d observation nodes.\n", num_obervationnodes);
+        }
+    }
+    // the per-node kernel arrays are only needed by the reference engine
+    nodeval_t ****kernels = NULL;
+    if (options->reference_engine && options->ensemble_size <= 1) {
+        int max_neighbors = kernel.number_d_neighbors > kernel.number_id_neighbors ? kernel.number_d_neighbors
+                                                                                   : kernel.number_id_neighbors;
+        kernels = alloc_4d(number_nodes_x, number_nodes_y, 2, max_neighbors);
+    }
+
+    // inputs covering most of the grid are stored as dense planes instead of sparse per-node series
+    inputplane_t input_plane;
+    inputplane_t *dense_inputs = NULL;
+    if (qualifies_for_input_plane(number_nodes_x, number_nodes_y, number_inputs, inputs)) {
+        generate_input_plane(&input_plane, number_nodes_x, number_nodes_y, number_inputs, inputs);
+        printf("Using a dense input plane for %d input nodes (%d input classes, period of %d ticks).\n",
+               number_inputs, input_plane.number_classes, input_plane.period_ticks);
+        dense_inputs = &input_plane;
+        number_inputs = 0;
+        inputs = NULL;
+    }
 
-    kernelfunc_t d_kernel = d_kernel_function_factory("");
-    kernelfunc_t id_kernel = id_kernel_function_factory("");
+    // input-free intervals are fast-forwarded in the spectral domain, which requires a shift-invariant update
+    fastforward_t *fast_forward = NULL;
+    if (options->fast_forward) {
+        if (kernel.radius != 1 || options->ensemble_size > 1 || options->reference_engine
+            || options->parameter_maps != NULL || options->connectome != NULL || options->input_stream != NULL
+            || options->events != NULL) {
+            printf("WARNING: Fast-forwarding requires a kernel of radius 1 and uniform model parameters, without "
+                   "ensembles, connections, input streams or events. Simulating all ticks.\n");
+        } else {
+            // only intervals long enough to pay off the transforms and the reconstruction of the observations
+            int min_ticks = options->fast_forward == FAST_FORWARD_ALWAYS
+                            ? FAST_FORWARD_MIN_TICKS
+                            : fast_forward_min_ticks(&kernel, number_nodes_x, number_nodes_y, num_ticks,
+                                                     num_obervationnodes);
+            if (min_ticks == 0) {
+                printf("WARNING: Fast-forwarding the input-free intervals and reconstructing %d observation nodes "
+                       "inside them is estimated to cost more than simulating them. Simulating all ticks.\n",
+                       num_obervationnodes);
+            } else {
+                fast_forward = init_fast_forward(&kernel, &options->parameters, number_nodes_x, number_nodes_y,
+                                                 num_ticks, number_inputs, inputs, dense_inputs, min_ticks,
+                                                 num_obervationnodes, observationnodes);
+                print_fast_forward(fast_forward, min_ticks, num_ticks);
+            }
+        }
+    }
 
+    // the run stops once it reached a steady state or a periodic orbit, or diverged
+    convergencemonitor_t *monitor = NULL;
+    if (options->early_stop_tolerance > 0) {
+        if (fast_forward != NULL) {
+            printf("WARNING: Early termination cannot be combined with fast-forwarding. Simulating all ticks.\n");
+        } else {
+            monitor = init_convergence_monitor(options->early_stop_tolerance, executioncontext.num_threads,
+                                               (double) number_nodes_x * number_nodes_y * ensemble_lanes, num_ticks,
+                                               number_inputs, inputs, dense_inputs, options->input_stream);
+            print_convergence_monitor(monitor);
+        }
+    }
+
+#if PHASE_TIMING
+    executioncontext.timings = init_thread_timings(executioncontext.num_threads);
+#endif
+#if PERF_COUNTERS
+    executioncontext.counters = init_perf_counters(executioncontext.num_threads);
+#endif
+    if (options->events != NULL) {
+        start_event_recording(options->events, executioncontext.num_threads, options->ensemble_size, ensemble_lanes);
+        printf("Recording %s of threshold %g%s.\n",
+               options->events->selected_y != NULL ? "the events of the selected nodes" : "the events of all nodes",
+               options->events->threshold, options->events->peaks ? ", including peaks" : "");
+    }
+
+    // the grids, kernel and inputs are set up, the remaining time is spent simulating
+    get_daytime(&tv_setup);
+    if (options->metrics != NULL) {
+        set_metrics_state(options->metrics, METRICS_SIMULATING);
+    }
 #if MULTITHREADING
     execute_simulation_multithreaded(&executioncontext, num_ticks,
                                      tick_ms, number_nodes_x, number_nodes_y, num_obervationnodes, observationnodes,
                                      old_state, new_state, slopes, kernels,
-                                     d_kernel, id_kernel, number_inputs, inputs);
+                                     d_kernel, id_kernel, &kernel, number_inputs, inputs, dense_inputs, activity,
+                                     fast_forward, monitor, options);
 #else
     execute_simulation_singlethreaded(&executioncontext, num_ticks,
         tick_ms, number_nodes_x, number_nodes_y, num_obervationnodes, observationnodes,
         old_state, new_state, slopes, kernels,
-        d_kernel, id_kernel, number_inputs, inputs);
+        d_kernel, id_kernel, &kernel, number_inputs, inputs, dense_inputs, activity, fast_forward, monitor, options);
+#endif
+#if PHASE_TIMING
+    print_thread_timings(executioncontext.timings, executioncontext.num_threads);
+#endif
+#if PERF_COUNTERS
+    print_perf_counters(executioncontext.counters, executioncontext.num_threads);
+#endif
+    if (monitor != NULL) {
+        free_convergence_monitor(monitor);
+    }
+    if (options->events != NULL) {
+        finish_event_recording(options->events);
+        printf("Recorded %zu events.\n", options->events->number_events);
+    }
+    if (dense_inputs != NULL) {
+        free_input_plane(dense_inputs);
+    }
+    if (fast_forward != NULL) {
+        free_fast_forward(fast_forward);
+    }
+    if (activity != NULL) {
+        free(activity->nonzero[0]);
+        free(activity->nonzero[1]);
+        free(activity->full_rows[0]);
+        free(activity->full_rows[1]);
+    }
+    for (int i = 0; i < executioncontext.num_threads; i++) {
+        if (executioncontext.contexts[i].ensemble_lanes > 0) {
+            free_ensemble_coefficients(&executioncontext.contexts[i].ensemble_coefficients);
+        }
+        if (executioncontext.contexts[i].parameter_maps != NULL) {
+            free_coefficient_maps(&executioncontext.contexts[i].coefficient_maps);
+        }
+        free(executioncontext.contexts[i].active_tiles);
+        if (executioncontext.contexts[i].kernel_workspace != NULL) {
+            free_kernel_workspace(executioncontext.contexts[i].kernel_workspace);
+            free(executioncontext.contexts[i].kernel_workspace);
+        }
+    }
+#if PHASE_TIMING
+    free_thread_timings(executioncontext.timings);
 #endif
+#if PERF_COUNTERS
+    free_perf_counters(executioncontext.counters);
+#endif
+    free_kernel(&kernel);
+    // the start levels stay owned by the caller, the replicated ensemble state does not
+    if (options->ensemble_size > 1) {
+        free_2d(old_state, number_nodes_x);
+    }
+    free_2d(new_state, number_nodes_x);
+    free_2d(slopes, number_nodes_x);
     printf("Simulation finished succesfully!\n");
     get_daytime(&tv2);
+    printf("Setup time = %f seconds\n", options->setup_seconds
+                                        + (double) (tv_setup.tv_usec - tv1.tv_usec) / 1000000
+                                        + (double) (tv_setup.tv_sec - tv1.tv_sec));
+    printf("Simulation time = %f seconds\n",
+           (double) (tv2.tv_usec - tv_setup.tv_usec) / 1000000 +
+           (double) (tv2.tv_sec - tv_setup.tv_sec));
+    // the total time spans simulate() with its own setup, as parsed by the analysis scripts
     printf("Total time = %f seconds\n",
            (double) (tv2.tv_usec - tv1.tv_usec) / 1000000 +
            (double) (tv2.tv_sec - tv1.tv_sec));
@@ -65,8 +480,11 @@ unsigned int execute_simulation_multithreaded(executioncontext_t *executionconte
                                               int num_obervationnodes, nodetimeseries_t *observationnodes,
                                               nodeval_t **old_state,
                                               nodeval_t **new_state, nodeval_t **slopes, nodeval_t ****kernels,
-                                              kernelfunc_t d_ptr, kernelfunc_t id_ptr,
-                                              int number_global_inputs, nodeinputseries_t *global_inputs) {
+                                              kernelfunc_t d_ptr, kernelfunc_t id_ptr, const kernel_t *kernel,
+                                              int number_global_inputs, nodeinputseries_t *global_inputs,
+                                              inputplane_t *input_plane, activitymap_t *activity,
+                                              fastforward_t *fast_forward, convergencemonitor_t *monitor,
+                                              const simulationoptions_t *options) {
     //initialize barrier
     init_thread_barrier(&executioncontext->barrier, executioncontext->num_threads);
     //spawn threads
@@ -76,8 +494,26 @@ unsigned int execute_simulation_multithreaded(executioncontext_t *executionconte
         init_partial_simulation_context(&executioncontext->contexts[i],
                                         num_ticks, tick_ms, number_nodes_x, number_nodes_y,
                                         num_obervationnodes, observationnodes, old_state,
-                                        new_state, slopes, kernels, d_ptr, id_ptr, number_global_inputs, global_inputs,
+                                        new_state, slopes, kernels, d_ptr, id_ptr, kernel, number_global_inputs, global_inputs,
+                                        input_plane, activity, fast_forward, options,
                                         thread_start_x, thread_end_x, &executioncontext->barrier);
+        executioncontext->contexts[i].monitor = monitor;
+        executioncontext->contexts[i].monitor_slot = i;
+        if (executioncontext->timings != NULL) {
+            executioncontext->contexts[i].timing = &executioncontext->timings[i];
+        }
+        if (executioncontext->counters != NULL) {
+            executioncontext->contexts[i].counters = &executioncontext->counters[i];
+        }
+        executioncontext->contexts[i].metrics = options->metrics;
+        executioncontext->contexts[i].metrics_slot = i;
+        if (options->trace != NULL) {
+            executioncontext->contexts[i].trace_buffer = &options->trace->threads[i];
+        }
+        if (options->events != NULL) {
+            executioncontext->contexts[i].events = options->events;
+            executioncontext->contexts[i].event_buffer = &options->events->buffers[i];
+        }
         executioncontext->handles[i] =
                 create_and_run_simulation_thread(execute_partial_simulation, &executioncontext->contexts[i]);
     }
@@ -92,42 +528,222 @@ unsigned int execute_simulation_singlethreaded(executioncontext_t *executioncont
                                                int num_obervationnodes, nodetimeseries_t *observationnodes,
                                                nodeval_t **old_state,
                                                nodeval_t **new_state, nodeval_t **slopes, nodeval_t ****kernels,
-                                               kernelfunc_t d_ptr, kernelfunc_t id_ptr,
-                                               int number_global_inputs, nodeinputseries_t *global_inputs) {
+                                               kernelfunc_t d_ptr, kernelfunc_t id_ptr, const kernel_t *kernel,
+                                               int number_global_inputs, nodeinputseries_t *global_inputs,
+                                               inputplane_t *input_plane, activitymap_t *activity,
+                                              fastforward_t *fast_forward, convergencemonitor_t *monitor,
+                                              const simulationoptions_t *options) {
     init_partial_simulation_context(executioncontext->contexts,
                                     num_ticks, tick_ms, number_nodes_x, number_nodes_y,
                                     num_obervationnodes, observationnodes, old_state,
-                                    new_state, slopes, kernels, d_ptr, id_ptr, number_global_inputs, global_inputs,
+                                    new_state, slopes, kernels, d_ptr, id_ptr, kernel, number_global_inputs, global_inputs,
+                                    input_plane, activity, fast_forward, options,
                                     0, number_nodes_x, &executioncontext->barrier);
+    executioncontext->contexts->monitor = monitor;
+    executioncontext->contexts->timing = executioncontext->timings;
+    executioncontext->contexts->counters = executioncontext->counters;
+    executioncontext->contexts->metrics = options->metrics;
+    if (options->trace != NULL) {
+        executioncontext->contexts->trace_buffer = options->trace->threads;
+    }
+    if (options->events != NULL) {
+        executioncontext->contexts->events = options->events;
+        executioncontext->contexts->event_buffer = options->events->buffers;
+    }
     return execute_partial_simulation(executioncontext->contexts);
 }
 
+// waits for all threads between the steps of fast-forwarding
+static void wait_fast_forward_step(partialsimulationcontext_t *context) {
+#if MULTITHREADING
+    wait_at_barrier(context->barrier);
+#endif
+}
+
+// advances the old state from first_tick to end_tick in the spectral domain and reconstructs the observations of the
+// skipped ticks, called by all threads
+static void fast_forward_ticks(partialsimulationcontext_t *context, int first_tick, int end_tick) {
+    fastforward_t *fast_forward = context->fast_forward;
+    int ticks = end_tick - first_tick;
+    int start_x = context->thread_start_x;
+    int end_x = context->thread_end_x;
+    // the columns and the reconstructed ticks are split across the threads in proportion to their rows
+    int number_nodes_x = context->number_nodes_x;
+    int start_y = (int) ((long long) start_x * context->number_nodes_y / number_nodes_x);
+    int end_y = (int) ((long long) end_x * context->number_nodes_y / number_nodes_x);
+    fast_forward_load_rows(fast_forward, context->old_state, context->slopes, start_x, end_x);
+    wait_fast_forward_step(context);
+    fast_forward_transform_columns(fast_forward, start_y, end_y);
+    wait_fast_forward_step(context);
+    if (fast_forward->num_observationnodes > 0) {
+        fast_forward_observe(fast_forward, (int) ((long long) start_x * ticks / number_nodes_x),
+                             (int) ((long long) end_x * ticks / number_nodes_x), context->global_observationnodes,
+                             first_tick);
+        wait_fast_forward_step(context);
+    }
+    fast_forward_advance_rows(fast_forward, ticks, start_x, end_x);
+    wait_fast_forward_step(context);
+    fast_forward_transform_columns(fast_forward, start_y, end_y);
+    wait_fast_forward_step(context);
+    fast_forward_store_rows(fast_forward, context->old_state, context->slopes, start_x, end_x);
+    // the skipped ticks make any tile non-zero, all tiles must be computed (or written) once afterwards
+    if (start_x == 0 && end_x > 0) {
+        if (context->activity != NULL) {
+            size_t size = (size_t) number_nodes_x * context->activity->number_tiles;
+            for (int k = 0; k < 2; k++) {
+                memset(context->activity->nonzero[k], 1, size);
+                memset(context->activity->full_rows[k], 1, number_nodes_x);
+            }
+        }
+        printf("Fast-forwarded ticks %d to %d.\n", first_tick, end_tick - 1);
+    }
+}
+
+static void print_early_stop(const convergencemonitor_t *monitor, int num_ticks) {
+    switch (monitor->status) {
+        case CONVERGENCE_STEADY_STATE:
+            printf("Stopped after tick %d of %d in a steady state. Repeating the last observations.\n",
+                   monitor->stop_tick, num_ticks);
+            break;
+        case CONVERGENCE_PERIODIC:
+            printf("Stopped after tick %d of %d in a periodic orbit of %d ticks. Repeating the last period.\n",
+                   monitor->stop_tick, num_ticks, monitor->period);
+            break;
+        default:
+            printf("WARNING: Diverged in tick %d of %d. The remaining observations are NaN.\n", monitor->stop_tick,
+                   num_ticks);
+            break;
+    }
+}
+
 unsigned int execute_partial_simulation(partialsimulationcontext_t *context) {
+    // 1 in the management thread deciding to stop the run early
+    int stopping = 0;
+    // the end of the last timed phase of this thread, if timed
+    PHASE_START(phase_last);
+    // with live metrics, the end of the last tick of this thread and the end of its computation in the current tick
+    uint64_t metrics_last = context->metrics != NULL ? metrics_clock_ns() : 0;
+    uint64_t metrics_computed = 0;
+    // with a trace, the end of the last traced phase of this thread
+    uint64_t trace_last = context->trace_buffer != NULL ? trace_clock_ns() : 0;
+#if PERF_COUNTERS
+    // counters count the calling thread, each thread opens its own
+    if (context->counters != NULL) {
+        open_perf_counters(context->counters, (double) (context->thread_end_x - context->thread_start_x)
+                                              * context->number_nodes_y * (context->ensemble_lanes > 0
+                                                                           ? context->ensemble_size : 1));
+    }
+#endif
+    if (context->connectome != NULL) {
+        // the connection sums of the first tick, all sums must be computed before any thread adds them
+        gather_connections(context->connectome, context->connection_first_row, context->connection_end_row,
+                           context->old_state);
+        PHASE_LAP(context, PHASE_CONNECTIONS, phase_last);
+        trace_lap(context->trace_buffer, TRACE_CONNECTIONS, -1, &trace_last);
+#if MULTITHREADING
+        wait_at_barrier(context->barrier);
+        PHASE_LAP(context, PHASE_WAIT_NEXT_TICK, phase_last);
+        trace_lap(context->trace_buffer, TRACE_WAIT_NEXT_TICK, -1, &trace_last);
+#endif
+    }
     for (int j = 0; j < context->num_ticks; j++) {
-        int returncode = execute_partial_tick(context);
+        // input-free intervals are skipped at once by all threads together
+        if (context->fast_forward != NULL && fast_forward_end(context->fast_forward, j) > j) {
+            int end = fast_forward_end(context->fast_forward, j);
+            // fast-forwarded intervals are traced regardless of the sampling, they are rare and long
+            uint64_t trace_begin = context->trace_buffer != NULL ? trace_clock_ns() : 0;
+            fast_forward_ticks(context, j, end);
+            if (context->metrics != NULL && context->thread_start_x == 0 && context->thread_end_x > 0) {
+                update_metrics(context->metrics, end);
+            }
+#if MULTITHREADING
+            wait_at_barrier(context->barrier);
+#endif
+            PHASE_LAP(context, PHASE_FAST_FORWARD, phase_last);
+            trace_lap(context->trace_buffer, TRACE_FAST_FORWARD, j, &trace_begin);
+            if (context->metrics != NULL) {
+                uint64_t now = metrics_clock_ns();
+                publish_thread_metrics(&context->metrics->threads[context->metrics_slot], 0, now - metrics_last,
+                                       end - j);
+                metrics_last = now;
+            }
+            j = end - 1;
+            continue;
+        }
+        // only the phases of every sample_ticks-th tick are traced
+        tracebuffer_t *trace = traced_tick(context->trace_buffer, j);
+        if (trace != NULL) {
+            trace_last = trace_clock_ns();
+        }
+        if (context->monitor != NULL) {
+            reset_convergence_slot(&context->monitor->slots[context->monitor_slot]);
+        }
+        // computes the tick and adds the input signals AFTER the actual computation of each node
+        int returncode = execute_partial_tick(context, j);
         if (returncode != 0) {
             printf("Executing tick %d failed with return code %d. Aborting simulation.\n", j, returncode);
+#if PERF_COUNTERS
+            if (context->counters != NULL) {
+                close_perf_counters(context->counters);
+            }
+#endif
             return returncode;
         }
+        PHASE_LAP(context, PHASE_COMPUTE, phase_last);
+        PHASE_FLUSH_INPUTS(context);
+        trace_lap(trace, TRACE_COMPUTE, j, &trace_last);
+        if (context->metrics != NULL) {
+            metrics_computed = metrics_clock_ns();
+        }
         //waiting at barrier, this returns 1 only if this thread has been selected as the "management" thread
 #if MULTITHREADING
-        if (wait_at_barrier(context->barrier)) {
+        int management = wait_at_barrier(context->barrier);
+        PHASE_LAP(context, PHASE_WAIT_COMPUTED, phase_last);
+        trace_lap(trace, TRACE_WAIT_COMPUTED, j, &trace_last);
+        if (management) {
 #endif
-            if (!(j % 100)) {
+            if (context->metrics != NULL) {
+                update_metrics(context->metrics, j + 1);
+            } else if (!(j % 100)) {
                 printf("Executed tick %d.\n", j);
             }
+            // no thread reads the stream's front frame until the next tick, swap in the next frame when it is due
+            if (context->input_stream != NULL && (j + 1) % context->input_stream->frame_duration_ticks == 0) {
+                trace_lap(trace, TRACE_MANAGEMENT, j, &trace_last);
+                advance_frame_stream(context->input_stream, j + 1);
+                trace_lap(trace, TRACE_INPUT, j, &trace_last);
+            }
+            // all threads computed the tick, but did not extract its observations yet
+            if (context->monitor != NULL && j + 1 < context->num_ticks) {
+                stopping = update_convergence_monitor(context->monitor, j, context->num_global_obervationnodes,
+                                                      context->global_observationnodes, context->new_state,
+                                                      context->ensemble_size,
+                                                      context->ensemble_lanes > 0 ? context->ensemble_lanes : 1);
+            }
+            PHASE_LAP(context, PHASE_MANAGEMENT, phase_last);
+            trace_lap(trace, TRACE_MANAGEMENT, j, &trace_last);
 #if MULTITHREADING
         }
 #endif
-        // add the input signals AFTER the actual computation takes place.
-        process_partial_inputs(j, context->tick_ms, context->new_state, context->number_partial_inputs,
-                               context->partial_inputs);
         //extract observation nodes
-#if MULTITHREADING
-		wait_at_barrier(context->barrier);
-#endif
-        extract_observationnodes(j, context->num_partial_obervationnodes,
-				context->partial_observationnodes, context->new_state);
+        if (context->ensemble_lanes > 0) {
+            extract_ensemble_observationnodes(j, context->num_partial_obervationnodes,
+                                              context->partial_observationnodes, context->new_state,
+                                              context->ensemble_size, context->ensemble_lanes);
+        } else {
+            extract_observationnodes(j, context->num_partial_obervationnodes,
+                                     context->partial_observationnodes, context->new_state);
+        }
+        PHASE_LAP(context, PHASE_EXTRACTION, phase_last);
+        trace_lap(trace, TRACE_OBSERVATION, j, &trace_last);
+        // the connection sums of the next tick, no thread writes the new energy levels or reads the sums until the
+        // next tick
+        if (context->connectome != NULL) {
+            gather_connections(context->connectome, context->connection_first_row, context->connection_end_row,
+                               context->new_state);
+            PHASE_LAP(context, PHASE_CONNECTIONS, phase_last);
+            trace_lap(trace, TRACE_CONNECTIONS, j, &trace_last);
+        }
         //everyone swaps their own pointers
         // swap array states -> the new_state becomes the old_state, old_state can be overwritten
         nodeval_t **tmp = context->old_state;
@@ -138,26 +754,760 @@ unsigned int execute_partial_simulation(partialsimulationcontext_t *context) {
 #if MULTITHREADING
         wait_at_barrier(context->barrier);
 #endif
+        PHASE_LAP(context, PHASE_WAIT_NEXT_TICK, phase_last);
+        trace_lap(trace, TRACE_WAIT_NEXT_TICK, j, &trace_last);
+        if (context->metrics != NULL) {
+            uint64_t now = metrics_clock_ns();
+            publish_thread_metrics(&context->metrics->threads[context->metrics_slot], metrics_computed - metrics_last,
+                                   now - metrics_computed, 1);
+            metrics_last = now;
+        }
+        // all threads stop after the tick in which the management thread decided to stop
+        if (context->monitor != NULL && context->monitor->stop_tick == j) {
+            break;
+        }
+    }
+    if (stopping) {
+        extrapolate_observations(context->monitor, context->num_ticks, context->num_global_obervationnodes,
+                                 context->global_observationnodes, context->ensemble_size);
+        print_early_stop(context->monitor, context->num_ticks);
     }
+#if PERF_COUNTERS
+    if (context->counters != NULL) {
+        close_perf_counters(context->counters);
+    }
+#endif
     return 0;
 }
 
-unsigned int execute_partial_tick(partialsimulationcontext_t *context) {
+// adds the inputs of row i to the computed energy levels of the row, inputs are added AFTER the computation of the tick
+// each node receives its sparse inputs first, then its dense input and then its input from the stream
+// members is the number of values stored per node, all members of an ensemble receive the same inputs
+// with activity tracking, all tiles receiving inputs are marked as non-zero
+static inline void apply_row_inputs(partialsimulationcontext_t *context, int i, int tick_number, nodeval_t *new_row,
+                                    int members) {
+    PHASE_START(inputs_start);
+    tracebuffer_t *trace = traced_tick(context->trace_buffer, tick_number);
+    uint64_t trace_inputs_start = trace != NULL ? trace_clock_ns() : 0;
+    unsigned char *nonzero_row = NULL;
+    if (context->activity != NULL) {
+        nonzero_row = context->activity->nonzero[(tick_number + 1) % 2] + (size_t) i * context->activity->number_tiles;
+    }
+    // the inputs of this row, sorted by y index
+    nodeinputseries_t **row_input = context->partial_inputs
+                                    + context->partial_input_row_offsets[i - context->thread_start_x];
+    nodeinputseries_t **row_inputs_end = context->partial_inputs
+                                         + context->partial_input_row_offsets[i - context->thread_start_x + 1];
+    for (; row_input < row_inputs_end; row_input++) {
+        nodeval_t *node = new_row + (size_t) (*row_input)->y_index * members;
+        nodeval_t input = input_at_tick(tick_number, *row_input);
+        for (int m = 0; m < members; m++) {
+            node[m] = node[m] + input;
+        }
+        if (nonzero_row != NULL) {
+            nonzero_row[(*row_input)->y_index / ACTIVITY_TILE_SIZE] = 1;
+        }
+    }
+    // the input classes of this row in the dense input plane, if any
+    if (context->input_plane != NULL) {
+        const inputplane_t *plane = context->input_plane;
+        const unsigned int *row_class = plane->node_class + (size_t) i * context->number_nodes_y;
+        int period_tick = tick_number % plane->period_ticks;
+        for (int j = 0; j < context->number_nodes_y; ++j) {
+            if (row_class[j] != 0) {
+                nodeval_t input = plane->class_series[row_class[j] - 1][period_tick];
+                for (int m = 0; m < members; m++) {
+                    new_row[(size_t) j * members + m] = new_row[(size_t) j * members + m] + input;
+                }
+                if (nonzero_row != NULL) {
+                    nonzero_row[j / ACTIVITY_TILE_SIZE] = 1;
+                }
+            }
+        }
+    }
+    // the frequency classes of this row in the current frame of the input stream, if any
+    if (context->input_stream != NULL && context->input_stream->front->has_frame) {
+        const uint16_t *row_frequency = context->input_stream->front->node_frequency
+                                        + (size_t) i * context->number_nodes_y;
+        for (int j = 0; j < context->number_nodes_y; ++j) {
+            if (row_frequency[j] != 0) {
+                nodeval_t input = frame_stream_input(context->input_stream, row_frequency[j], tick_number);
+                for (int m = 0; m < members; m++) {
+                    new_row[(size_t) j * members + m] = new_row[(size_t) j * members + m] + input;
+                }
+                if (nonzero_row != NULL) {
+                    nonzero_row[j / ACTIVITY_TILE_SIZE] = 1;
+                }
+            }
+        }
+    }
+    // the long-range connections ending in this row, summed from the previous tick's energy levels
+    if (context->connectome != NULL) {
+        const connectome_t *connectome = context->connectome;
+        const connectiontarget_t *target = connectome->grid_targets + connectome->grid_row_offsets[i];
+        const connectiontarget_t *targets_end = connectome->grid_targets + connectome->grid_row_offsets[i + 1];
+        for (; target < targets_end; target++) {
+            new_row[target->y] = new_row[target->y] + connectome->sums[target->row];
+            if (nonzero_row != NULL) {
+                nonzero_row[target->y / ACTIVITY_TILE_SIZE] = 1;
+            }
+        }
+    }
+    PHASE_ADD_INPUTS(context, inputs_start);
+    if (trace != NULL) {
+        trace->inputs_ns += trace_clock_ns() - trace_inputs_start;
+    }
+    // the finished row is still in cache, its changes are reduced for stopping the run early and checked for events
+    if (context->monitor != NULL) {
+        monitor_convergence_row(&context->monitor->slots[context->monitor_slot], context->old_state[i], new_row,
+                                (size_t) context->number_nodes_y * members);
+    }
+    if (context->events != NULL) {
+        record_row_events(context->events, context->event_buffer, tick_number, i, context->old_state[i], new_row);
+    }
+}
+
+// the generic engine: gathers the kernels of each node using the kernel functions (or the kernel's neighbor tables)
+// and executes process() on them
+static void sweep_reference(partialsimulationcontext_t *context, int tick_number) {
+    const kernel_t *kernel = context->kernel;
     for (int i = context->thread_start_x; i < context->thread_end_x; ++i) {
         for (int j = 0; j < context->number_nodes_y; ++j) {
+            nodeval_t *d_neighbors = context->kernels[i][j][0];
+            nodeval_t *id_neighbors = context->kernels[i][j][1];
             // call the given kernel functions for calculating the kernel
-            int d_count = (*(context->d_ptr))(context->kernels[i][j][0], context->number_nodes_x,
-                                              context->number_nodes_y, context->old_state, i, j);
-            int id_count = (*(context->id_ptr))(context->kernels[i][j][1], context->number_nodes_x,
-                                                context->number_nodes_y, context->old_state, i, j);
-            // execute one node
-            nodestate_t res = process(context->old_state[i][j],
-                                      context->slopes[i][j], d_count, context->kernels[i][j][0], id_count,
-                                      context->kernels[i][j][1]);
+            int d_count, id_count;
+            if (context->d_ptr != NULL) {
+                d_count = (*(context->d_ptr))(d_neighbors, context->number_nodes_x, context->number_nodes_y,
+                                              context->old_state, i, j);
+            } else {
+                d_count = gather_kernel_neighbors(d_neighbors, kernel->number_d_neighbors, kernel->d_neighbors,
+                                                  context->number_nodes_x, context->number_nodes_y,
+                                                  context->old_state, i, j);
+            }
+            if (context->id_ptr != NULL) {
+                id_count = (*(context->id_ptr))(id_neighbors, context->number_nodes_x, context->number_nodes_y,
+                                                context->old_state, i, j);
+            } else {
+                id_count = gather_kernel_neighbors(id_neighbors, kernel->number_id_neighbors, kernel->id_neighbors,
+                                                   context->number_nodes_x, context->number_nodes_y,
+                                                   context->old_state, i, j);
+            }
+            // execute one node, with its own parameters in heterogeneous grids
+            const modelparameters_t *parameters = context->parameters;
+            modelparameters_t node_parameters;
+            if (context->parameter_maps != NULL) {
+                node_model_parameters(&node_parameters, context->parameters, context->parameter_maps,
+                                      (size_t) i * context->number_nodes_y + j);
+                parameters = &node_parameters;
+            }
+            nodestate_t res = process(context->old_state[i][j], context->slopes[i][j],
+                                      d_count, d_neighbors, id_count, id_neighbors, parameters);
             // store result
             context->new_state[i][j] = res.act;
             context->slopes[i][j] = res.slope;
         }
+        apply_row_inputs(context, i, tick_number, context->new_state[i], 1);
+    }
+}
+
+// marks the tiles of row i that are non-zero or within the kernel's radius of a non-zero tile in the old state, all
+// other tiles stay zero in this tick
+// returns 1 if all tiles of the row are active, without marking them
+static int find_nonzero_tiles(const partialsimulationcontext_t *context, int tick_number, int i,
+                              unsigned char *active_row) {
+    const activitymap_t *activity = context->activity;
+    const unsigned char *nonzero = activity->nonzero[tick_number % 2];
+    const unsigned char *full_rows = activity->full_rows[tick_number % 2];
+    const int number_tiles = activity->number_tiles;
+    int first_x = i - activity->radius_rows > 0 ? i - activity->radius_rows : 0;
+    int last_x = i + activity->radius_rows < context->number_nodes_x ? i + activity->radius_rows
+                                                                     : context->number_nodes_x - 1;
+    // a full row within the radius activates all tiles
+    for (int x = first_x; x <= last_x; x++) {
+        if (full_rows[x]) {
+            return 1;
+        }
+    }
+    // the non-zero tiles of all rows within the radius, in the scratch space after the row
+    unsigned char *rows_nonzero = active_row + number_tiles;
+    memset(rows_nonzero, 0, number_tiles);
+    for (int x = first_x; x <= last_x; x++) {
+        const unsigned char *nonzero_row = nonzero + (size_t) x * number_tiles;
+        for (int tile = 0; tile < number_tiles; tile++) {
+            rows_nonzero[tile] |= nonzero_row[tile];
+        }
+    }
+    int all_active = 1;
+    for (int tile = 0; tile < number_tiles; tile++) {
+        int first_tile = tile - activity->radius_tiles > 0 ? tile - activity->radius_tiles : 0;
+        int last_tile = tile + activity->radius_tiles < number_tiles ? tile + activity->radius_tiles
+                                                                     : number_tiles - 1;
+        unsigned char active = 0;
+        for (int k = first_tile; k <= last_tile; k++) {
+            active |= rows_nonzero[k];
+        }
+        active_row[tile] = active;
+        all_active &= active;
+    }
+    return all_active;
+}
+
+// unmarks the tiles of row i that cannot influence any observation node anymore, i.e., that are farther than the
+// kernel's radius times the remaining ticks from all of them (chebyshev distance)
+// returns 1 if all tiles of the row are still active
+static int prune_light_cones(const partialsimulationcontext_t *context, int tick_number, int i,
+                             unsigned char *active_row) {
+    const int number_tiles = context->activity->number_tiles;
+    const long long reach = (long long) context->activity->radius_rows * (context->num_ticks - 1 - tick_number);
+    // the tiles within the cone of any observation node, in the scratch space after the row
+    unsigned char *cone_row = active_row + number_tiles;
+    memset(cone_row, 0, number_tiles);
+    for (int k = 0; k < context->num_global_obervationnodes; k++) {
+        const nodetimeseries_t *node = &context->global_observationnodes[k];
+        if (llabs((long long) node->x_index - i) > reach) {
+            continue;
+        }
+        long long first_y = node->y_index - reach > 0 ? node->y_index - reach : 0;
+        long long last_y = node->y_index + reach < context->number_nodes_y - 1 ? node->y_index + reach
+                                                                               : context->number_nodes_y - 1;
+        if (first_y <= last_y) {
+            memset(cone_row + first_y / ACTIVITY_TILE_SIZE, 1,
+                   (size_t) (last_y / ACTIVITY_TILE_SIZE - first_y / ACTIVITY_TILE_SIZE + 1));
+        }
+    }
+    int all_active = 1;
+    for (int tile = 0; tile < number_tiles; tile++) {
+        active_row[tile] &= cone_row[tile];
+        all_active &= active_row[tile];
+    }
+    return all_active;
+}
+
+// marks the active tiles of row i, i.e., those that are neither quiescent nor outside of the light cones (if skipped)
+// returns 1 if all tiles of the row are active, in which case they are only marked if the light cones are pruned
+static int find_active_tiles(const partialsimulationcontext_t *context, int tick_number, int i,
+                             unsigned char *active_row) {
+    int all_active = !context->activity->skip_quiescent || find_nonzero_tiles(context, tick_number, i, active_row);
+    if (!context->activity->light_cone) {
+        return all_active;
+    }
+    if (all_active) {
+        memset(active_row, 1, context->activity->number_tiles);
+    }
+    return prune_light_cones(context, tick_number, i, active_row);
+}
+
+// sets rows[dx] to row x + dx of the grid for -radius <= dx <= radius, NULL outside of the grid
+// returns 1 if any of the rows is outside of the grid
+static inline int kernel_rows(const nodeval_t **rows, nodeval_t **grid, int number_nodes_x, int x, int radius) {
+    int outside = 0;
+    for (int dx = -radius; dx <= radius; dx++) {
+        if (x + dx >= 0 && x + dx < number_nodes_x) {
+            rows[dx] = grid[x + dx];
+        } else {
+            rows[dx] = NULL;
+            outside = 1;
+        }
+    }
+    return outside;
+}
+
+// neighborhood sums of the registered kernels, with a common signature for DEFINE_KERNEL_SWEEP
+static inline void sums_4neighbors(const nodeval_t *const *rows, const kernel_t *kernel, int j, int number_nodes_y,
+                                   int checked, nodeval_t *d_sum, nodeval_t *id_sum) {
+    kernel_sums_4neighbors(rows, j, number_nodes_y, checked, d_sum, id_sum);
+}
+
+static inline void sums_8neighbors(const nodeval_t *const *rows, const kernel_t *kernel, int j, int number_nodes_y,
+                                   int checked, nodeval_t *d_sum, nodeval_t *id_sum) {
+    kernel_sums_8neighbors(rows, j, number_nodes_y, checked, d_sum, id_sum);
+}
+
+static inline void sums_radius(const nodeval_t *const *rows, const kernel_t *kernel, int j, int number_nodes_y,
+                               int checked, nodeval_t *d_sum, nodeval_t *id_sum) {
+    *d_sum = kernel_sum_table(rows, j, number_nodes_y, kernel->number_d_neighbors, kernel->d_neighbors, checked, 0);
+    *id_sum = kernel_sum_table(rows, j, number_nodes_y, kernel->number_id_neighbors, kernel->id_neighbors,
+                               checked, 0);
+}
+
+static inline void sums_weighted(const nodeval_t *const *rows, const kernel_t *kernel, int j, int number_nodes_y,
+                                 int checked, nodeval_t *d_sum, nodeval_t *id_sum) {
+    *d_sum = kernel_sum_table(rows, j, number_nodes_y, kernel->number_d_neighbors, kernel->d_neighbors, checked, 1);
+    *id_sum = kernel_sum_table(rows, j, number_nodes_y, kernel->number_id_neighbors, kernel->id_neighbors,
+                               checked, 1);
+}
+
+// the rows of the per-node coefficient planes of a heterogeneous grid, NULL for uniform coefficients
+typedef struct {
+    const nodeval_t *d;
+    const nodeval_t *id;
+    const nodeval_t *act;
+    const nodeval_t *slope;
+    const nodeval_t *energy_weight;
+    const nodeval_t *slope_weight;
+} coefficientrows_t;
+
+static inline const nodeval_t *coefficient_row(const nodeval_t *map, size_t offset) {
+    return map != NULL ? map + offset : NULL;
+}
+
+// gets the coefficient rows of grid row i, all NULL for homogeneous grids
+static inline coefficientrows_t coefficient_map_rows(const partialsimulationcontext_t *context, int i) {
+    coefficientrows_t rows = {NULL, NULL, NULL, NULL, NULL, NULL};
+    if (context->parameter_maps != NULL) {
+        const coefficientmaps_t *maps = &context->coefficient_maps;
+        size_t offset = (size_t) (i - context->thread_start_x) * context->number_nodes_y;
+        rows.d = coefficient_row(maps->d, offset);
+        rows.id = coefficient_row(maps->id, offset);
+        rows.act = coefficient_row(maps->act, offset);
+        rows.slope = coefficient_row(maps->slope, offset);
+        rows.energy_weight = coefficient_row(maps->energy_weight, offset);
+        rows.slope_weight = coefficient_row(maps->slope_weight, offset);
+    }
+    return rows;
+}
+
+// node processes, with a common signature for DEFINE_KERNEL_SWEEP
+// the unit processes are used if all model parameters are 1 and divide by constant neighbor counts where possible
+static inline nodestate_t process_unit_4neighbors(nodeval_t act_old, nodeval_t slope_old, nodeval_t d_sum,
+                                                  nodeval_t id_sum, const kernel_t *kernel,
+                                                  const modelcoefficients_t *coefficients,
+                                                  const coefficientrows_t *map_rows, int j) {
+    return process_means_unit(act_old, slope_old, d_sum / 4, id_sum / 4);
+}
+
+static inline nodestate_t process_unit_8neighbors(nodeval_t act_old, nodeval_t slope_old, nodeval_t d_sum,
+                                                  nodeval_t id_sum, const kernel_t *kernel,
+                                                  const modelcoefficients_t *coefficients,
+                                                  const coefficientrows_t *map_rows, int j) {
+    return process_means_unit(act_old, slope_old, d_sum / 8, id_sum / 16);
+}
+
+static inline nodestate_t process_unit_table(nodeval_t act_old, nodeval_t slope_old, nodeval_t d_sum,
+                                             nodeval_t id_sum, const kernel_t *kernel,
+                                             const modelcoefficients_t *coefficients,
+                                             const coefficientrows_t *map_rows, int j) {
+    return process_means_unit(act_old, slope_old, d_sum / kernel->number_d_neighbors,
+                              id_sum / kernel->number_id_neighbors);
+}
+
+static inline nodestate_t process_folded(nodeval_t act_old, nodeval_t slope_old, nodeval_t d_sum,
+                                         nodeval_t id_sum, const kernel_t *kernel,
+                                         const modelcoefficients_t *coefficients,
+                                         const coefficientrows_t *map_rows, int j) {
+    return process_sums(act_old, slope_old, d_sum, id_sum, coefficients);
+}
+
+// the folded process of heterogeneous grids, only the coefficients given per node are read from their planes
+static inline nodestate_t process_mapped(nodeval_t act_old, nodeval_t slope_old, nodeval_t d_sum,
+                                         nodeval_t id_sum, const kernel_t *kernel,
+                                         const modelcoefficients_t *coefficients,
+                                         const coefficientrows_t *map_rows, int j) {
+    modelcoefficients_t node = *coefficients;
+    if (map_rows->d != NULL) {
+        node.d = map_rows->d[j];
+    }
+    if (map_rows->id != NULL) {
+        node.id = map_rows->id[j];
+    }
+    if (map_rows->act != NULL) {
+        node.act = map_rows->act[j];
+    }
+    if (map_rows->slope != NULL) {
+        node.slope = map_rows->slope[j];
+    }
+    if (map_rows->energy_weight != NULL) {
+        node.energy_weight = map_rows->energy_weight[j];
+    }
+    if (map_rows->slope_weight != NULL) {
+        node.slope_weight = map_rows->slope_weight[j];
+    }
+    return process_sums(act_old, slope_old, d_sum, id_sum, &node);
+}
+
+// computes node j of the current row using the inlined sums of a kernel and the inlined node process
+#define SWEEP_NODE(KERNEL_SUMS, NODE_PROCESS, checked) { \
+        nodeval_t d_sum, id_sum; \
+        KERNEL_SUMS(rows, kernel, j, number_nodes_y, checked, &d_sum, &id_sum); \
+        nodestate_t res = NODE_PROCESS(act_row[j], slope_row[j], d_sum, id_sum, kernel, coefficients, &map_rows, j); \
+        new_row[j] = res.act; \
+        slope_row[j] = res.slope; \
+    }
+
+// defines the sweep specialized for one kernel and node process, the kernel's sums are instantiated once with bound
+// checks for the nodes at the border of the grid and once without for all inner nodes
+// with activity tracking, each row is swept in tiles, inactive tiles are zero in the new state (or undefined, if outside
+// of the light cones)
+#define DEFINE_KERNEL_SWEEP(sweep_name, KERNEL_SUMS, NODE_PROCESS) \
+static void sweep_name(partialsimulationcontext_t *context, int tick_number) { \
+    const kernel_t *kernel = context->kernel; \
+    const modelcoefficients_t *coefficients = &context->coefficients; \
+    const int radius = kernel->radius; \
+    const int number_nodes_y = context->number_nodes_y; \
+    const nodeval_t *row_buffer[2 * KERNEL_MAX_LARGE_RADIUS + 1]; \
+    const nodeval_t **rows = row_buffer + radius; \
+    const int inner_start = radius < number_nodes_y ? radius : number_nodes_y; \
+    const int inner_end = number_nodes_y - radius > inner_start ? number_nodes_y - radius : inner_start; \
+    const int tile_size = context->activity != NULL ? ACTIVITY_TILE_SIZE : number_nodes_y; \
+    const int number_tiles = context->activity != NULL ? context->activity->number_tiles : 1; \
+    for (int i = context->thread_start_x; i < context->thread_end_x; ++i) { \
+        int border_row = kernel_rows(rows, context->old_state, context->number_nodes_x, i, radius); \
+        const nodeval_t *act_row = context->old_state[i]; \
+        nodeval_t *slope_row = context->slopes[i]; \
+        nodeval_t *new_row = context->new_state[i]; \
+        coefficientrows_t map_rows = coefficient_map_rows(context, i); \
+        const unsigned char *active_row = NULL; \
+        unsigned char *nonzero_row = NULL; \
+        int row_tile_size = tile_size; \
+        int row_tiles = number_tiles; \
+        if (context->activity != NULL) { \
+            nonzero_row = context->activity->nonzero[(tick_number + 1) % 2] + (size_t) i * number_tiles; \
+            if (find_active_tiles(context, tick_number, i, context->active_tiles)) { \
+                /* fully active rows are swept at once and stay marked as non-zero */ \
+                memset(nonzero_row, 1, number_tiles); \
+                context->activity->full_rows[(tick_number + 1) % 2][i] = 1; \
+                nonzero_row = NULL; \
+                row_tile_size = number_nodes_y; \
+                row_tiles = 1; \
+            } else { \
+                active_row = context->active_tiles; \
+            } \
+        } \
+        for (int tile = 0; tile < row_tiles; tile++) { \
+            const int tile_start = tile * row_tile_size; \
+            const int tile_end = tile_start + row_tile_size < number_nodes_y ? tile_start + row_tile_size \
+                                                                            : number_nodes_y; \
+            if (active_row != NULL && !active_row[tile]) { \
+                /* the slopes of quiescent tiles are zero already, the new state only if it was zero before */ \
+                if (nonzero_row[tile]) { \
+                    memset(new_row + tile_start, 0, (tile_end - tile_start) * sizeof(nodeval_t)); \
+                    nonzero_row[tile] = 0; \
+                } \
+                continue; \
+            } \
+            int j = tile_start; \
+            if (border_row) { \
+                for (; j < tile_end; ++j) SWEEP_NODE(KERNEL_SUMS, NODE_PROCESS, 1) \
+            } else { \
+                const int checked_end = inner_start < tile_end ? inner_start : tile_end; \
+                const int unchecked_end = inner_end < tile_end ? inner_end : tile_end; \
+                for (; j < checked_end; ++j) SWEEP_NODE(KERNEL_SUMS, NODE_PROCESS, 1) \
+                for (; j < unchecked_end; ++j) SWEEP_NODE(KERNEL_SUMS, NODE_PROCESS, 0) \
+                for (; j < tile_end; ++j) SWEEP_NODE(KERNEL_SUMS, NODE_PROCESS, 1) \
+            } \
+            if (nonzero_row != NULL) { \
+                nonzero_row[tile] = span_is_nonzero(new_row, slope_row, tile_start, tile_end); \
+            } \
+        } \
+        if (nonzero_row != NULL) { \
+            context->activity->full_rows[(tick_number + 1) % 2][i] = memchr(nonzero_row, 0, number_tiles) == NULL; \
+        } \
+        apply_row_inputs(context, i, tick_number, new_row, 1); \
+    } \
+}
+
+DEFINE_KERNEL_SWEEP(sweep_4neighbors_unit, sums_4neighbors, process_unit_4neighbors)
+DEFINE_KERNEL_SWEEP(sweep_4neighbors, sums_4neighbors, process_folded)
+DEFINE_KERNEL_SWEEP(sweep_8neighbors_unit, sums_8neighbors, process_unit_8neighbors)
+DEFINE_KERNEL_SWEEP(sweep_8neighbors, sums_8neighbors, process_folded)
+DEFINE_KERNEL_SWEEP(sweep_radius_unit, sums_radius, process_unit_table)
+DEFINE_KERNEL_SWEEP(sweep_radius, sums_radius, process_folded)
+DEFINE_KERNEL_SWEEP(sweep_weighted_unit, sums_weighted, process_unit_table)
+DEFINE_KERNEL_SWEEP(sweep_weighted, sums_weighted, process_folded)
+DEFINE_KERNEL_SWEEP(sweep_4neighbors_mapped, sums_4neighbors, process_mapped)
+DEFINE_KERNEL_SWEEP(sweep_8neighbors_mapped, sums_8neighbors, process_mapped)
+DEFINE_KERNEL_SWEEP(sweep_radius_mapped, sums_radius, process_mapped)
+DEFINE_KERNEL_SWEEP(sweep_weighted_mapped, sums_weighted, process_mapped)
+
+// defines the sweep of a kernel whose sums are computed for all rows of the thread at once (see kernel_sum_planes())
+#define DEFINE_PLANE_SWEEP(sweep_name, NODE_PROCESS) \
+static void sweep_name(partialsimulationcontext_t *context, int tick_number) { \
+    const kernel_t *kernel = context->kernel; \
+    const modelcoefficients_t *coefficients = &context->coefficients; \
+    const int number_nodes_y = context->number_nodes_y; \
+    kernelworkspace_t *workspace = context->kernel_workspace; \
+    kernel_sum_planes(kernel, workspace, context->number_nodes_x, number_nodes_y, context->old_state); \
+    for (int i = context->thread_start_x; i < context->thread_end_x; ++i) { \
+        size_t offset = (size_t) (i - context->thread_start_x) * number_nodes_y; \
+        const nodeval_t *d_sums = workspace->d_sums + offset; \
+        const nodeval_t *id_sums = workspace->id_sums + offset; \
+        const nodeval_t *act_row = context->old_state[i]; \
+        nodeval_t *slope_row = context->slopes[i]; \
+        nodeval_t *new_row = context->new_state[i]; \
+        coefficientrows_t map_rows = coefficient_map_rows(context, i); \
+        for (int j = 0; j < number_nodes_y; ++j) { \
+            nodestate_t res = NODE_PROCESS(act_row[j], slope_row[j], d_sums[j], id_sums[j], kernel, coefficients, \
+                                           &map_rows, j); \
+            new_row[j] = res.act; \
+            slope_row[j] = res.slope; \
+        } \
+        apply_row_inputs(context, i, tick_number, new_row, 1); \
+    } \
+}
+
+DEFINE_PLANE_SWEEP(sweep_planes_unit, process_unit_table)
+DEFINE_PLANE_SWEEP(sweep_planes, process_folded)
+DEFINE_PLANE_SWEEP(sweep_planes_mapped, process_mapped)
+
+// ENSEMBLE_LANES members are computed in ENSEMBLE_VECTORS vectors of 2 members, the SIMD width of SSE2 and NEON,
+// several independent vectors per node hide the latency of summing the neighbors
+#define SIMD_VECTOR_LANES 2
+#define ENSEMBLE_VECTORS (ENSEMBLE_LANES / SIMD_VECTOR_LANES)
+#if defined(__GNUC__)
+// GCC and clang map the vector type to SIMD registers
+typedef nodeval_t simdvector_t __attribute__((vector_size(SIMD_VECTOR_LANES * sizeof(nodeval_t))));
+
+static inline simdvector_t vector_add(simdvector_t a, simdvector_t b) {
+    return a + b;
+}
+
+static inline simdvector_t vector_mul(simdvector_t a, simdvector_t b) {
+    return a * b;
+}
+#else
+typedef struct {
+    nodeval_t lane[SIMD_VECTOR_LANES];
+} simdvector_t;
+
+static inline simdvector_t vector_add(simdvector_t a, simdvector_t b) {
+    for (int k = 0; k < SIMD_VECTOR_LANES; k++) {
+        a.lane[k] = a.lane[k] + b.lane[k];
+    }
+    return a;
+}
+
+static inline simdvector_t vector_mul(simdvector_t a, simdvector_t b) {
+    for (int k = 0; k < SIMD_VECTOR_LANES; k++) {
+        a.lane[k] = a.lane[k] * b.lane[k];
+    }
+    return a;
+}
+#endif
+
+static inline simdvector_t vector_load(const nodeval_t *values) {
+    simdvector_t vector;
+    memcpy(&vector, values, sizeof(vector));
+    return vector;
+}
+
+static inline void vector_store(nodeval_t *values, simdvector_t vector) {
+    memcpy(values, &vector, sizeof(vector));
+}
+
+static inline simdvector_t vector_broadcast(nodeval_t value) {
+    nodeval_t values[SIMD_VECTOR_LANES];
+    for (int k = 0; k < SIMD_VECTOR_LANES; k++) {
+        values[k] = value;
+    }
+    return vector_load(values);
+}
+
+// the folded coefficients (see ensemblecoefficients_t) of ENSEMBLE_LANES members
+typedef struct {
+    simdvector_t d[ENSEMBLE_VECTORS];
+    simdvector_t id[ENSEMBLE_VECTORS];
+    simdvector_t act[ENSEMBLE_VECTORS];
+    simdvector_t slope[ENSEMBLE_VECTORS];
+    simdvector_t energy_weight[ENSEMBLE_VECTORS];
+    simdvector_t slope_weight[ENSEMBLE_VECTORS];
+} lanecoefficients_t;
+
+// the neighborhoods of a kernel as passed to the ensemble sweep, constant for the 4neighbors and 8neighbors kernels
+typedef struct {
+    int number_d_neighbors;
+    const kernelneighbor_t *d_neighbors;
+    int number_id_neighbors;
+    const kernelneighbor_t *id_neighbors;
+} ensembleneighbors_t;
+
+// sums a neighborhood of ENSEMBLE_LANES members of node j, starting at member m, in the same order as
+// kernel_sum_table() and the specialized kernel sums, each neighbor is located once for all lanes
+static inline void ensemble_sum(const nodeval_t *const *rows, int number_neighbors, const kernelneighbor_t *neighbors,
+                                int j, int m, int number_nodes_y, int ensemble_lanes, int checked, int weighted,
+                                simdvector_t *sum) {
+    for (int v = 0; v < ENSEMBLE_VECTORS; v++) {
+        sum[v] = vector_broadcast(0);
+    }
+    for (int n = 0; n < number_neighbors; n++) {
+        const nodeval_t *row = rows[neighbors[n].x];
+        int y = j + neighbors[n].y;
+        if (checked && (row == NULL || y < 0 || y >= number_nodes_y)) {
+            continue;
+        }
+        const nodeval_t *members = row + (size_t) y * ensemble_lanes + m;
+        for (int v = 0; v < ENSEMBLE_VECTORS; v++) {
+            simdvector_t values = vector_load(members + v * SIMD_VECTOR_LANES);
+            if (weighted) {
+                values = vector_mul(vector_broadcast(neighbors[n].weight), values);
+            }
+            sum[v] = vector_add(sum[v], values);
+        }
+    }
+}
+
+// computes ENSEMBLE_LANES members of node j of the current row, starting at member m, each member using its own
+// coefficients in the same order as process_sums()
+static inline void ensemble_node(const nodeval_t *const *rows, ensembleneighbors_t kernel,
+                                 const lanecoefficients_t *coefficients, int j, int m, int number_nodes_y,
+                                 int ensemble_lanes, int checked, int weighted, const nodeval_t *act_row,
+                                 nodeval_t *slope_row, nodeval_t *new_row) {
+    simdvector_t d_sum[ENSEMBLE_VECTORS];
+    simdvector_t id_sum[ENSEMBLE_VECTORS];
+    ensemble_sum(rows, kernel.number_d_neighbors, kernel.d_neighbors, j, m, number_nodes_y, ensemble_lanes, checked,
+                 weighted, d_sum);
+    ensemble_sum(rows, kernel.number_id_neighbors, kernel.id_neighbors, j, m, number_nodes_y, ensemble_lanes, checked,
+                 weighted, id_sum);
+    for (int v = 0; v < ENSEMBLE_VECTORS; v++) {
+        size_t node = (size_t) j * ensemble_lanes + m + v * SIMD_VECTOR_LANES;
+        simdvector_t act_old = vector_load(act_row + node);
+        simdvector_t slope = vector_mul(coefficients->slope[v], vector_load(slope_row + node));
+        slope = vector_add(slope, vector_mul(coefficients->d[v], d_sum[v]));
+        slope = vector_add(slope, vector_mul(coefficients->id[v], id_sum[v]));
+        slope = vector_add(slope, vector_mul(coefficients->act[v], act_old));
+        vector_store(new_row + node, vector_add(vector_mul(coefficients->energy_weight[v], act_old),
+                                                vector_mul(coefficients->slope_weight[v], slope)));
+        vector_store(slope_row + node, slope);
+    }
+}
+
+// the ensemble engine: like the specialized sweeps, but computes all members of each node in blocks of
+// ENSEMBLE_LANES members
+static inline void sweep_ensemble_kernel(partialsimulationcontext_t *context, int tick_number,
+                                         ensembleneighbors_t kernel, int weighted) {
+    const ensemblecoefficients_t *ensemble_coefficients = &context->ensemble_coefficients;
+    const int radius = context->kernel->radius;
+    const int number_nodes_y = context->number_nodes_y;
+    const int ensemble_lanes = context->ensemble_lanes;
+    const nodeval_t *row_buffer[2 * KERNEL_MAX_LARGE_RADIUS + 1];
+    const nodeval_t **rows = row_buffer + radius;
+    const int inner_start = radius < number_nodes_y ? radius : number_nodes_y;
+    const int inner_end = number_nodes_y - radius > inner_start ? number_nodes_y - radius : inner_start;
+    for (int i = context->thread_start_x; i < context->thread_end_x; ++i) {
+        int border_row = kernel_rows(rows, context->old_state, context->number_nodes_x, i, radius);
+        const nodeval_t *act_row = context->old_state[i];
+        nodeval_t *slope_row = context->slopes[i];
+        nodeval_t *new_row = context->new_state[i];
+        for (int m = 0; m < ensemble_lanes; m += ENSEMBLE_LANES) {
+            lanecoefficients_t coefficients;
+            for (int v = 0; v < ENSEMBLE_VECTORS; v++) {
+                int member = m + v * SIMD_VECTOR_LANES;
+                coefficients.d[v] = vector_load(ensemble_coefficients->d + member);
+                coefficients.id[v] = vector_load(ensemble_coefficients->id + member);
+                coefficients.act[v] = vector_load(ensemble_coefficients->act + member);
+                coefficients.slope[v] = vector_load(ensemble_coefficients->slope + member);
+                coefficients.energy_weight[v] = vector_load(ensemble_coefficients->energy_weight + member);
+                coefficients.slope_weight[v] = vector_load(ensemble_coefficients->slope_weight + member);
+            }
+            int j = 0;
+            if (border_row) {
+                for (; j < number_nodes_y; ++j) {
+                    ensemble_node(rows, kernel, &coefficients, j, m, number_nodes_y, ensemble_lanes, 1, weighted,
+                                  act_row, slope_row, new_row);
+                }
+            } else {
+                for (; j < inner_start; ++j) {
+                    ensemble_node(rows, kernel, &coefficients, j, m, number_nodes_y, ensemble_lanes, 1, weighted,
+                                  act_row, slope_row, new_row);
+                }
+                for (; j < inner_end; ++j) {
+                    ensemble_node(rows, kernel, &coefficients, j, m, number_nodes_y, ensemble_lanes, 0, weighted,
+                                  act_row, slope_row, new_row);
+                }
+                for (; j < number_nodes_y; ++j) {
+                    ensemble_node(rows, kernel, &coefficients, j, m, number_nodes_y, ensemble_lanes, 1, weighted,
+                                  act_row, slope_row, new_row);
+                }
+            }
+        }
+        apply_row_inputs(context, i, tick_number, new_row, ensemble_lanes);
+    }
+}
+
+static void sweep_ensemble_4neighbors(partialsimulationcontext_t *context, int tick_number) {
+    ensembleneighbors_t kernel = {4, KERNEL_4NEIGHBORS_D_NEIGHBORS, 4, KERNEL_4NEIGHBORS_ID_NEIGHBORS};
+    sweep_ensemble_kernel(context, tick_number, kernel, 0);
+}
+
+static void sweep_ensemble_8neighbors(partialsimulationcontext_t *context, int tick_number) {
+    ensembleneighbors_t kernel = {8, KERNEL_8NEIGHBORS_D_NEIGHBORS, 16, KERNEL_8NEIGHBORS_ID_NEIGHBORS};
+    sweep_ensemble_kernel(context, tick_number, kernel, 0);
+}
+
+static void sweep_ensemble_table(partialsimulationcontext_t *context, int tick_number) {
+    ensembleneighbors_t kernel = {context->kernel->number_d_neighbors, context->kernel->d_neighbors,
+                                  context->kernel->number_id_neighbors, context->kernel->id_neighbors};
+    sweep_ensemble_kernel(context, tick_number, kernel, kernel_is_weighted(context->kernel));
+}
+
+unsigned int execute_partial_tick(partialsimulationcontext_t *context, int tick_number) {
+    if (context->ensemble_lanes > 0) {
+        switch (context->kernel->type) {
+            case KERNEL_TYPE_4NEIGHBORS:
+                sweep_ensemble_4neighbors(context, tick_number);
+                break;
+            case KERNEL_TYPE_8NEIGHBORS:
+                sweep_ensemble_8neighbors(context, tick_number);
+                break;
+            default:
+                sweep_ensemble_table(context, tick_number);
+                break;
+        }
+        return 0;
+    }
+    if (context->reference_engine) {
+        sweep_reference(context, tick_number);
+        return 0;
+    }
+    if (context->kernel->method != KERNEL_METHOD_DIRECT) {
+        if (context->parameter_maps != NULL) {
+            sweep_planes_mapped(context, tick_number);
+        } else if (context->coefficients.unit) {
+            sweep_planes_unit(context, tick_number);
+        } else {
+            sweep_planes(context, tick_number);
+        }
+        return 0;
+    }
+    if (context->parameter_maps != NULL) {
+        switch (context->kernel->type) {
+            case KERNEL_TYPE_4NEIGHBORS:
+                sweep_4neighbors_mapped(context, tick_number);
+                break;
+            case KERNEL_TYPE_8NEIGHBORS:
+                sweep_8neighbors_mapped(context, tick_number);
+                break;
+            case KERNEL_TYPE_RADIUS:
+                sweep_radius_mapped(context, tick_number);
+                break;
+            case KERNEL_TYPE_WEIGHTED:
+            case KERNEL_TYPE_GAUSSIAN:
+            case KERNEL_TYPE_MEXICANHAT:
+                sweep_weighted_mapped(context, tick_number);
+                break;
+            default:
+                return 1;
+        }
+        return 0;
+    }
+    unsigned int unit = context->coefficients.unit;
+    switch (context->kernel->type) {
+        case KERNEL_TYPE_4NEIGHBORS:
+            unit ? sweep_4neighbors_unit(context, tick_number) : sweep_4neighbors(context, tick_number);
+            break;
+        case KERNEL_TYPE_8NEIGHBORS:
+            unit ? sweep_8neighbors_unit(context, tick_number) : sweep_8neighbors(context, tick_number);
+            break;
+        case KERNEL_TYPE_RADIUS:
+            unit ? sweep_radius_unit(context, tick_number) : sweep_radius(context, tick_number);
+            break;
+        case KERNEL_TYPE_WEIGHTED:
+        case KERNEL_TYPE_GAUSSIAN:
+        case KERNEL_TYPE_MEXICANHAT:
+            unit ? sweep_weighted_unit(context, tick_number) : sweep_weighted(context, tick_number);
+            break;
+        default:
+            return 1;
     }
     return 0;
 }
@@ -170,6 +1520,18 @@ void extract_observationnodes(int ticknumber, int num_obervationnodes, nodetimes
     return;
 }
 
+void extract_ensemble_observationnodes(int ticknumber, int num_obervationnodes, nodetimeseries_t **observationnodes,
+                                       nodeval_t **state, int ensemble_size, int ensemble_lanes) {
+    for (int i = 0; i < num_obervationnodes; ++i) {
+        const nodeval_t *members = state[observationnodes[i]->x_index]
+                                   + (size_t) observationnodes[i]->y_index * ensemble_lanes;
+        for (int m = 0; m < ensemble_size; m++) {
+            observationnodes[i]->timeseries[(size_t) m * observationnodes[i]->timeseries_ticks + ticknumber] =
+                    members[m];
+        }
+    }
+}
+
 void process_global_inputs(int tick_number, double tick_ms,
                            nodeval_t **state, int number_global_inputs, nodeinputseries_t *global_inputs) {
     for (int i = 0; i < number_global_inputs; ++i) {
@@ -177,6 +1539,10 @@ void process_global_inputs(int tick_number, double tick_ms,
     }
 }
 
+void add_row_inputs(partialsimulationcontext_t *context, int row, int tick_number, nodeval_t *new_row) {
+    apply_row_inputs(context, row, tick_number, new_row, 1);
+}
+
 void process_partial_inputs(int tick_number, double tick_ms,
                             nodeval_t **state, int number_partial_inputs, nodeinputseries_t **partial_inputs) {
     for (int i = 0; i < number_partial_inputs; ++i) {
@@ -188,7 +1554,7 @@ void process_input(int tick_number, double tick_ms,
                    nodeval_t **state, nodeinputseries_t *input) {
     int x = input->x_index;
     int y = input->y_index;
-    nodeval_t increase = input->timeseries[tick_number % input->timeseries_ticks];
+    nodeval_t increase = input_at_tick(tick_number, input);
     // printf("Increased node (%d|%d). State before %f, state now: %f.\n", x, y,
     // 	   state[x][y], state[x][y] + increase);
     state[x][y] = state[x][y] + increase;
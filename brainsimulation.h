@@ -11,6 +11,12 @@
 
 //function declarations
 
+/**
+ * Initializes the optional settings of a simulation run with their defaults (no input stream).
+ * @param options The options to initialize.
+ */
+void init_simulation_options(simulationoptions_t *options);
+
 /**
  * Simulates the brain.
  * @param tick_ms Milliseconds in between each simulation tick.
@@ -27,6 +33,7 @@
  * @param number_inputs The number of input nodes to be changed during execution.
  * @param inputs Contains information about the coordinates and the values of the input nodes to be changed during
  * execution. All values must be set. Length: number_inputs.
+ * @param options Optional settings of the simulation run. NULL to use the defaults of init_simulation_options().
  * @return Return-codes.
  */
 unsigned int simulate(double tick_ms,
@@ -37,7 +44,8 @@ unsigned int simulate(double tick_ms,
                       int num_obervationnodes,
                       nodetimeseries_t *oberservationnodes,
                       int number_inputs,
-                      nodeinputseries_t *inputs);
+                      nodeinputseries_t *inputs,
+                      const simulationoptions_t *options);
 
 /**
 * Executes the inner simulation in a multithreaded fashion. Called after setup of nodes, inputs, etc.
@@ -56,12 +64,21 @@ unsigned int simulate(double tick_ms,
 * @param slopes 2D array of nodes with their slope from the last tick iteration level. Size number_nodes_x *
 * number_nodes_y.
 * @param kernels 4D array containing the kernels of each node at each index. Each index node points to an array
-* containing (currently) two kernels, each (currently) containing 4 neighbouring noides. Dimensions: number_nodes_x *
-* number_nodes_y * 2 * 4.
-* @param d_ptr Function pointer pointing to the kernel function for the direct neighborhood.
-* @param id_ptr Function pointer pointing to the kernel function for the indirect neighborhood.
+* containing two kernels, each containing the neighbouring nodes of one neighborhood. Dimensions: number_nodes_x *
+* number_nodes_y * 2 * (maximum number of neighbors per neighborhood). Only used by the reference engine, may be NULL
+* otherwise.
+* @param d_ptr Function pointer pointing to the kernel function for the direct neighborhood. NULL to gather the
+* direct neighbors from the kernel.
+* @param id_ptr Function pointer pointing to the kernel function for the indirect neighborhood. NULL to gather the
+* indirect neighbors from the kernel.
+* @param kernel The kernel to simulate with. Selects the specialized sweep.
 * @param number_global_inputs Number of global inputs.
 * @param global_inputs Inputs on the entire node field. Length: number_global_inputs
+* @param input_plane Dense input planes on the entire node field. NULL if all inputs are passed as global_inputs.
+* @param activity The non-zero tiles of the grid. NULL to compute all nodes in each tick.
+* @param fast_forward The input-free intervals to fast-forward through. NULL to simulate all ticks.
+* @param monitor The monitor stopping the run early. NULL to simulate all ticks.
+* @param options Optional settings of the simulation run, e.g., the input stream.
 * @return Return-codes.
 */
 unsigned int execute_simulation_multithreaded(executioncontext_t *executioncontext,
@@ -69,8 +86,11 @@ unsigned int execute_simulation_multithreaded(executioncontext_t *executionconte
                                               int num_obervationnodes, nodetimeseries_t *observationnodes,
                                               nodeval_t **old_state,
                                               nodeval_t **new_state, nodeval_t **slopes, nodeval_t ****kernels,
-                                              kernelfunc_t d_ptr, kernelfunc_t id_ptr,
-                                              int number_global_inputs, nodeinputseries_t *global_inputs);
+                                              kernelfunc_t d_ptr, kernelfunc_t id_ptr, const kernel_t *kernel,
+                                              int number_global_inputs, nodeinputseries_t *global_inputs,
+                                              inputplane_t *input_plane, activitymap_t *activity,
+                                              fastforward_t *fast_forward, convergencemonitor_t *monitor,
+                                              const simulationoptions_t *options);
 
 /**
 * Executes the inner simulation in a singlethreaded fashion. Called after setup of nodes, inputs, etc.
@@ -89,12 +109,21 @@ unsigned int execute_simulation_multithreaded(executioncontext_t *executionconte
 * @param slopes 2D array of nodes with their slope from the last tick iteration level. Size number_nodes_x *
 * number_nodes_y.
 * @param kernels 4D array containing the kernels of each node at each index. Each index node points to an array
-* containing (currently) two kernels, each (currently) containing 4 neighbouring noides. Dimensions: number_nodes_x *
-* number_nodes_y * 2 * 4.
-* @param d_ptr Function pointer pointing to the kernel function for the direct neighborhood.
-* @param id_ptr Function pointer pointing to the kernel function for the indirect neighborhood.
+* containing two kernels, each containing the neighbouring nodes of one neighborhood. Dimensions: number_nodes_x *
+* number_nodes_y * 2 * (maximum number of neighbors per neighborhood). Only used by the reference engine, may be NULL
+* otherwise.
+* @param d_ptr Function pointer pointing to the kernel function for the direct neighborhood. NULL to gather the
+* direct neighbors from the kernel.
+* @param id_ptr Function pointer pointing to the kernel function for the indirect neighborhood. NULL to gather the
+* indirect neighbors from the kernel.
+* @param kernel The kernel to simulate with. Selects the specialized sweep.
 * @param number_global_inputs Number of global inputs.
 * @param global_inputs Inputs on the entire node field. Length: number_global_inputs
+* @param input_plane Dense input planes on the entire node field. NULL if all inputs are passed as global_inputs.
+* @param activity The non-zero tiles of the grid. NULL to compute all nodes in each tick.
+* @param fast_forward The input-free intervals to fast-forward through. NULL to simulate all ticks.
+* @param monitor The monitor stopping the run early. NULL to simulate all ticks.
+* @param options Optional settings of the simulation run, e.g., the input stream.
 * @return Return-codes.
 */
 unsigned int execute_simulation_singlethreaded(executioncontext_t *executioncontext,
@@ -102,8 +131,11 @@ unsigned int execute_simulation_singlethreaded(executioncontext_t *executioncont
                                                int num_obervationnodes, nodetimeseries_t *observationnodes,
                                                nodeval_t **old_state,
                                                nodeval_t **new_state, nodeval_t **slopes, nodeval_t ****kernels,
-                                               kernelfunc_t d_ptr, kernelfunc_t id_ptr,
-                                               int number_global_inputs, nodeinputseries_t *global_inputs);
+                                               kernelfunc_t d_ptr, kernelfunc_t id_ptr, const kernel_t *kernel,
+                                               int number_global_inputs, nodeinputseries_t *global_inputs,
+                                               inputplane_t *input_plane, activitymap_t *activity,
+                                               fastforward_t *fast_forward, convergencemonitor_t *monitor,
+                                              const simulationoptions_t *options);
 
 /**
  * Executes a partial simulation, as defined by a partial simulation context.
@@ -117,10 +149,15 @@ unsigned int execute_partial_simulation(partialsimulationcontext_t *context);
 /**
 * Executes a partial tick of the simulation.
 * Usually executed in a separate thread.
+* Uses the sweep specialized for the context's kernel, in which the kernel and process() are inlined,
+* or the generic reference engine if selected.
+* The partial inputs are added to each node's new energy level as soon as it has been computed,
+* i.e., inputs are added AFTER the computation of the tick.
 * @param context The partial context to handle in this call.
+* @param tick_number The number of the tick to execute. Selects the input values to add.
 * @return Return-codes, usually 0.
 */
-unsigned int execute_partial_tick(partialsimulationcontext_t *context);
+unsigned int execute_partial_tick(partialsimulationcontext_t *context, int tick_number);
 
 /**
  * Extracts and stores/saves the information into the specified observation nodes.
@@ -135,6 +172,21 @@ unsigned int execute_partial_tick(partialsimulationcontext_t *context);
 void extract_observationnodes(int ticknumber, int num_obervationnodes, nodetimeseries_t **observationnodes,
                               nodeval_t **state);
 
+/**
+ * Extracts and stores the observations of all members of an ensemble into the specified observation nodes.
+ * Called for the partial observation nodes within the partial simulation contexts.
+ *
+ * @param ticknumber The current tick number, i.e., the tick number to store.
+ * @param num_obervationnodes The number of observation nodes.
+ * @param observationnodes An array pointing to the observation nodes. Their time series must have room for all
+ * members (see nodetimeseries_t). Length: num_observationnodes.
+ * @param state The current state of all members to store.
+ * @param ensemble_size The number of members of the ensemble.
+ * @param ensemble_lanes The padded number of members stored per node in state.
+ */
+void extract_ensemble_observationnodes(int ticknumber, int num_obervationnodes, nodetimeseries_t **observationnodes,
+                                       nodeval_t **state, int ensemble_size, int ensemble_lanes);
+
 /**
  * Adds the influence of the defined input nodes to the current state.
  *
@@ -148,6 +200,17 @@ void extract_observationnodes(int ticknumber, int num_obervationnodes, nodetimes
 void process_global_inputs(int tick_number, double tick_ms,
                            nodeval_t **state, int number_global_inputs, nodeinputseries_t *global_inputs);
 
+/**
+* Adds the inputs of a row to its computed energy levels, like the sweeps do after computing each row: the sparse
+* inputs of the row, its classes of the dense input plane and its frequencies of the input stream.
+*
+* @param context The context of the thread owning the row, see init_partial_simulation_context().
+* @param row The x index of the row.
+* @param tick_number The current tick number.
+* @param new_row The computed energy levels of the row. Length: number_nodes_y.
+*/
+void add_row_inputs(partialsimulationcontext_t *context, int row, int tick_number, nodeval_t *new_row);
+
 /**
 * Adds the influence of the defined input nodes to the current state.
 *
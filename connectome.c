@@ -0,0 +1,228 @@
+#include "connectome.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// a connection while reading, with the hilbert indices of its nodes
+typedef struct {
+    uint64_t target_index;
+    uint64_t source_index;
+    connectionnode_t target;
+    connectionnode_t source;
+    nodeval_t weight;
+} connectionentry_t;
+
+// position of node (x, y) on the hilbert curve through a square of side length order (a power of 2)
+static uint64_t hilbert_index(int order, int x, int y) {
+    uint64_t index = 0;
+    for (int s = order / 2; s > 0; s /= 2) {
+        int rx = (x & s) > 0;
+        int ry = (y & s) > 0;
+        index += (uint64_t) s * s * ((3 * rx) ^ ry);
+        // rotate the quadrant, so that the curve continues at the end of the previous quadrant
+        if (ry == 0) {
+            if (rx == 1) {
+                x = order - 1 - x;
+                y = order - 1 - y;
+            }
+            int tmp = x;
+            x = y;
+            y = tmp;
+        }
+    }
+    return index;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const connectionentry_t *entry_a = a;
+    const connectionentry_t *entry_b = b;
+    if (entry_a->target_index != entry_b->target_index) {
+        return entry_a->target_index < entry_b->target_index ? -1 : 1;
+    }
+    if (entry_a->source_index != entry_b->source_index) {
+        return entry_a->source_index < entry_b->source_index ? -1 : 1;
+    }
+    return 0;
+}
+
+static int compare_targets(const void *a, const void *b) {
+    const connectiontarget_t *target_a = a;
+    const connectiontarget_t *target_b = b;
+    return target_a->y - target_b->y;
+}
+
+static int is_in_grid(connectionnode_t node, int number_nodes_x, int number_nodes_y) {
+    return node.x >= 0 && node.x < number_nodes_x && node.y >= 0 && node.y < number_nodes_y;
+}
+
+// reads all connections of the file, returns NULL on errors
+static connectionentry_t *read_connections(const char *path, int number_nodes_x, int number_nodes_y,
+                                           int *number_entries) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        printf("ERROR: Cannot open connection file %s.\n", path);
+        return NULL;
+    }
+    int order = 1;
+    while (order < number_nodes_x || order < number_nodes_y) {
+        order *= 2;
+    }
+    int capacity = 1024;
+    int count = 0;
+    connectionentry_t *entries = malloc(capacity * sizeof(connectionentry_t));
+    char line[256];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        for (char *c = line; *c != '\0'; c++) {
+            if (*c == ',') {
+                *c = ' ';
+            }
+        }
+        char first[2];
+        if (sscanf(line, "%1s", first) != 1 || first[0] == '#') {
+            continue;
+        }
+        connectionentry_t entry;
+        if (sscanf(line, "%d %d %d %d %lf", &entry.source.x, &entry.source.y, &entry.target.x, &entry.target.y,
+                   &entry.weight) != 5) {
+            printf("ERROR: Invalid connection in line %d of %s. Expected: source_x source_y target_x target_y "
+                   "weight.\n", line_number, path);
+            free(entries);
+            fclose(file);
+            return NULL;
+        }
+        if (!is_in_grid(entry.source, number_nodes_x, number_nodes_y)
+            || !is_in_grid(entry.target, number_nodes_x, number_nodes_y)) {
+            printf("ERROR: The connection in line %d of %s connects nodes outside of the grid.\n", line_number,
+                   path);
+            free(entries);
+            fclose(file);
+            return NULL;
+        }
+        entry.target_index = hilbert_index(order, entry.target.x, entry.target.y);
+        entry.source_index = hilbert_index(order, entry.source.x, entry.source.y);
+        if (count == capacity) {
+            capacity *= 2;
+            entries = realloc(entries, capacity * sizeof(connectionentry_t));
+        }
+        entries[count++] = entry;
+    }
+    fclose(file);
+    *number_entries = count;
+    return entries;
+}
+
+connectome_t *load_connectome(const char *path, int number_nodes_x, int number_nodes_y) {
+    int number_entries;
+    connectionentry_t *entries = read_connections(path, number_nodes_x, number_nodes_y, &number_entries);
+    if (entries == NULL) {
+        return NULL;
+    }
+    qsort(entries, number_entries, sizeof(connectionentry_t), compare_entries);
+    // merge duplicates, entries of the same target and source are next to each other after sorting
+    int number_connections = 0;
+    int number_rows = 0;
+    for (int k = 0; k < number_entries; k++) {
+        if (number_connections > 0 && compare_entries(&entries[k], &entries[number_connections - 1]) == 0) {
+            entries[number_connections - 1].weight += entries[k].weight;
+            continue;
+        }
+        if (number_connections == 0
+            || entries[k].target_index != entries[number_connections - 1].target_index) {
+            number_rows++;
+        }
+        entries[number_connections++] = entries[k];
+    }
+    connectome_t *connectome = malloc(sizeof(connectome_t));
+    connectome->number_rows = number_rows;
+    connectome->number_connections = number_connections;
+    connectome->row_offsets = malloc((number_rows + 1) * sizeof(int));
+    connectome->sources = malloc(number_connections * sizeof(connectionnode_t));
+    connectome->weights = malloc(number_connections * sizeof(nodeval_t));
+    connectome->row_targets = malloc(number_rows * sizeof(connectionnode_t));
+    connectome->sums = calloc(number_rows, sizeof(nodeval_t));
+    int row = -1;
+    for (int k = 0; k < number_connections; k++) {
+        if (k == 0 || entries[k].target_index != entries[k - 1].target_index) {
+            row++;
+            connectome->row_offsets[row] = k;
+            connectome->row_targets[row] = entries[k].target;
+        }
+        connectome->sources[k] = entries[k].source;
+        connectome->weights[k] = entries[k].weight;
+    }
+    connectome->row_offsets[number_rows] = number_connections;
+    free(entries);
+    // index the rows by the grid rows of their targets, for adding the sums during the sweep
+    connectome->grid_row_offsets = calloc(number_nodes_x + 1, sizeof(int));
+    connectome->grid_targets = malloc(number_rows * sizeof(connectiontarget_t));
+    for (int r = 0; r < number_rows; r++) {
+        connectome->grid_row_offsets[connectome->row_targets[r].x + 1]++;
+    }
+    for (int x = 0; x < number_nodes_x; x++) {
+        connectome->grid_row_offsets[x + 1] += connectome->grid_row_offsets[x];
+    }
+    int *fill = malloc(number_nodes_x * sizeof(int));
+    memcpy(fill, connectome->grid_row_offsets, number_nodes_x * sizeof(int));
+    for (int r = 0; r < number_rows; r++) {
+        connectiontarget_t target = {connectome->row_targets[r].y, r};
+        connectome->grid_targets[fill[connectome->row_targets[r].x]++] = target;
+    }
+    free(fill);
+    for (int x = 0; x < number_nodes_x; x++) {
+        qsort(connectome->grid_targets + connectome->grid_row_offsets[x],
+              connectome->grid_row_offsets[x + 1] - connectome->grid_row_offsets[x], sizeof(connectiontarget_t),
+              compare_targets);
+    }
+    return connectome;
+}
+
+void free_connectome(connectome_t *connectome) {
+    free(connectome->row_offsets);
+    free(connectome->sources);
+    free(connectome->weights);
+    free(connectome->row_targets);
+    free(connectome->grid_row_offsets);
+    free(connectome->grid_targets);
+    free(connectome->sums);
+    free(connectome);
+}
+
+// the first row starting at or after the given connection
+static int row_at_connection(const connectome_t *connectome, long long connection) {
+    int low = 0;
+    int high = connectome->number_rows;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (connectome->row_offsets[middle] < connection) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+void connectome_row_range(const connectome_t *connectome, int part_start, int part_end, int number_parts,
+                          int *first_row, int *end_row) {
+    long long number_connections = connectome->number_connections;
+    *first_row = row_at_connection(connectome, number_connections * part_start / number_parts);
+    *end_row = part_end >= number_parts ? connectome->number_rows
+                                        : row_at_connection(connectome, number_connections * part_end / number_parts);
+}
+
+void gather_connections(connectome_t *connectome, int first_row, int end_row, nodeval_t **state) {
+    const int *row_offsets = connectome->row_offsets;
+    const connectionnode_t *sources = connectome->sources;
+    const nodeval_t *weights = connectome->weights;
+    for (int r = first_row; r < end_row; r++) {
+        nodeval_t sum = 0;
+        for (int k = row_offsets[r]; k < row_offsets[r + 1]; k++) {
+            sum += weights[k] * state[sources[k].x][sources[k].y];
+        }
+        connectome->sums[r] = sum;
+    }
+}
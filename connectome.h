@@ -0,0 +1,133 @@
+#ifndef CONNECTOME_H
+#define CONNECTOME_H
+
+#include "definitions.h"
+
+/**
+ * @file
+ * Sparse long-range connections between distant nodes of the grid, simulated in addition to the kernel.
+ *
+ * Each connection adds the energy level of its source node at the previous tick, multiplied with the connection's
+ * weight, to the new energy level of its target node, like an input. The connections are read from a text file with
+ * one connection per line:
+ *
+ *     source_x source_y target_x target_y weight
+ *
+ * Values are separated by whitespace or commas, empty lines and lines starting with '#' are ignored. Multiple
+ * connections between the same nodes are merged by adding their weights.
+ *
+ * The connections are stored in compressed sparse row (CSR) format, one row per target node. Rows are sorted by the
+ * position of their target on a hilbert curve through the grid, and the sources of each row by their position on the
+ * curve, so that consecutive rows read nearby nodes from few grid rows. The sums of the rows are computed in parallel,
+ * each thread computing a range of rows with about the same number of connections.
+ */
+
+/**
+ * A node of the grid.
+ */
+typedef struct {
+    /**
+    * The x index of the node.
+    */
+    int x;
+    /**
+    * The y index of the node.
+    */
+    int y;
+}
+        connectionnode_t;
+
+/**
+ * A target node of a grid row.
+ */
+typedef struct {
+    /**
+    * The y index of the target node.
+    */
+    int y;
+    /**
+    * The CSR row of the target node.
+    */
+    int row;
+}
+        connectiontarget_t;
+
+struct connectome {
+    /**
+    * Number of target nodes, i.e., CSR rows.
+    */
+    int number_rows;
+    /**
+    * Number of connections, i.e., nonzeros.
+    */
+    int number_connections;
+    /**
+    * The connections of row r are row_offsets[r] to row_offsets[r + 1] - 1. Length: number_rows + 1.
+    */
+    int *row_offsets;
+    /**
+    * The source node of each connection. Length: number_connections.
+    */
+    connectionnode_t *sources;
+    /**
+    * The weight of each connection. Length: number_connections.
+    */
+    nodeval_t *weights;
+    /**
+    * The target node of each row. Length: number_rows.
+    */
+    connectionnode_t *row_targets;
+    /**
+    * The targets in grid row x are grid_targets[grid_row_offsets[x]] to grid_targets[grid_row_offsets[x + 1] - 1],
+    * sorted by y index. Length: number_nodes_x + 1.
+    */
+    int *grid_row_offsets;
+    /**
+    * The targets of all grid rows. Length: number_rows.
+    */
+    connectiontarget_t *grid_targets;
+    /**
+    * The weighted sum of the sources of each row, computed from the energy levels of the previous tick.
+    * Length: number_rows.
+    */
+    nodeval_t *sums;
+};
+
+/**
+ * Reads connections from a file and stores them in CSR format.
+ * @param path The path of the connection file.
+ * @param number_nodes_x The x-size of the grid.
+ * @param number_nodes_y The y-size of the grid.
+ * @return The connections, or NULL if the file could not be read or contains invalid connections.
+ */
+connectome_t *load_connectome(const char *path, int number_nodes_x, int number_nodes_y);
+
+/**
+ * Frees connections loaded using load_connectome().
+ * @param connectome The connections.
+ */
+void free_connectome(connectome_t *connectome);
+
+/**
+ * Gets the rows of one part of the connections, split into parts with about the same number of connections.
+ * Consecutive parts get consecutive ranges of rows.
+ * @param connectome The connections.
+ * @param part_start The start of the part, in units of which number_parts make up all connections.
+ * @param part_end The end of the part (exclusive), in the same units.
+ * @param number_parts The number of units.
+ * @param first_row Is set to the first row of the part.
+ * @param end_row Is set to the row after the last row of the part.
+ */
+void connectome_row_range(const connectome_t *connectome, int part_start, int part_end, int number_parts,
+                          int *first_row, int *end_row);
+
+/**
+ * Computes the weighted sums of the sources of a range of rows.
+ * @param connectome The connections, sums is written.
+ * @param first_row The first row to compute.
+ * @param end_row The row after the last row to compute.
+ * @param state The energy levels to sum.
+ */
+void gather_connections(connectome_t *connectome, int first_row, int end_row, nodeval_t **state);
+
+#endif
@@ -0,0 +1,138 @@
+#include "convergence.h"
+
+#include <stdlib.h>
+
+static long long greatest_common_divisor(long long a, long long b) {
+    while (b != 0) {
+        long long rest = a % b;
+        a = b;
+        b = rest;
+    }
+    return a;
+}
+
+// the least common multiple of the input periods, 0 if it exceeds half of the run (a period must repeat at least once
+// before it can be detected and pay off)
+static int input_period(int num_ticks, int number_inputs, const nodeinputseries_t *inputs,
+                        const inputplane_t *input_plane) {
+    long long period = 1;
+    for (int k = 0; k <= number_inputs; k++) {
+        long long ticks = k < number_inputs ? inputs[k].timeseries_ticks
+                                            : (input_plane != NULL ? input_plane->period_ticks : 1);
+        period = period / greatest_common_divisor(period, ticks) * ticks;
+        if (period > num_ticks / 2) {
+            return 0;
+        }
+    }
+    return (int) period;
+}
+
+convergencemonitor_t *init_convergence_monitor(nodeval_t tolerance, int num_threads, double number_values,
+                                               int num_ticks, int number_inputs, const nodeinputseries_t *inputs,
+                                               const inputplane_t *input_plane, const framestream_t *input_stream) {
+    convergencemonitor_t *monitor = malloc(sizeof(convergencemonitor_t));
+    monitor->tolerance = tolerance;
+    monitor->num_threads = num_threads;
+    monitor->slots = malloc(num_threads * sizeof(convergenceslot_t));
+    for (int i = 0; i < num_threads; i++) {
+        reset_convergence_slot(&monitor->slots[i]);
+    }
+    monitor->number_values = number_values;
+    int has_inputs = number_inputs > 0 || input_plane != NULL;
+    // the future inputs of a stream are unknown, only divergence is final
+    monitor->steady_state = !has_inputs && input_stream == NULL;
+    monitor->period = has_inputs && input_stream == NULL
+                      ? input_period(num_ticks, number_inputs, inputs, input_plane) : 0;
+    monitor->norm_history = NULL;
+    if (monitor->period > 0) {
+        monitor->norm_history = malloc(monitor->period * sizeof(nodeval_t));
+    }
+    monitor->steady_ticks = 0;
+    monitor->periodic_ticks = 0;
+    monitor->stop_tick = -1;
+    monitor->status = CONVERGENCE_RUNNING;
+    return monitor;
+}
+
+void free_convergence_monitor(convergencemonitor_t *monitor) {
+    free(monitor->slots);
+    free(monitor->norm_history);
+    free(monitor);
+}
+
+// whether all observation nodes repeat their energy levels of one period earlier
+static int observations_repeat(const convergencemonitor_t *monitor, int tick_number, int num_observationnodes,
+                               const nodetimeseries_t *observationnodes, nodeval_t **state, int ensemble_size,
+                               int ensemble_lanes) {
+    for (int k = 0; k < num_observationnodes; k++) {
+        const nodetimeseries_t *node = &observationnodes[k];
+        const nodeval_t *values = state[node->x_index] + (size_t) node->y_index * ensemble_lanes;
+        for (int m = 0; m < ensemble_size; m++) {
+            nodeval_t previous = node->timeseries[(size_t) m * node->timeseries_ticks + tick_number - monitor->period];
+            if (!(fabs(values[m] - previous) <= monitor->tolerance)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+int update_convergence_monitor(convergencemonitor_t *monitor, int tick_number, int num_observationnodes,
+                               const nodetimeseries_t *observationnodes, nodeval_t **state, int ensemble_size,
+                               int ensemble_lanes) {
+    nodeval_t max_change = 0;
+    nodeval_t norm = 0;
+    for (int i = 0; i < monitor->num_threads; i++) {
+        max_change = monitor->slots[i].max_change > max_change ? monitor->slots[i].max_change : max_change;
+        norm += monitor->slots[i].norm;
+    }
+    if (!isfinite(norm)) {
+        monitor->status = CONVERGENCE_DIVERGED;
+    } else if (monitor->steady_state) {
+        monitor->steady_ticks = max_change <= monitor->tolerance ? monitor->steady_ticks + 1 : 0;
+        if (monitor->steady_ticks >= EARLY_STOP_STEADY_TICKS) {
+            monitor->status = CONVERGENCE_STEADY_STATE;
+        }
+    } else if (monitor->period > 0) {
+        nodeval_t *previous_norm = &monitor->norm_history[tick_number % monitor->period];
+        if (tick_number >= monitor->period
+            && fabs(norm - *previous_norm) <= monitor->tolerance * monitor->number_values
+            && observations_repeat(monitor, tick_number, num_observationnodes, observationnodes, state,
+                                   ensemble_size, ensemble_lanes)) {
+            monitor->periodic_ticks++;
+        } else {
+            monitor->periodic_ticks = 0;
+        }
+        *previous_norm = norm;
+        if (monitor->periodic_ticks >= monitor->period) {
+            monitor->status = CONVERGENCE_PERIODIC;
+        }
+    }
+    if (monitor->status != CONVERGENCE_RUNNING) {
+        monitor->stop_tick = tick_number;
+        return 1;
+    }
+    return 0;
+}
+
+void extrapolate_observations(const convergencemonitor_t *monitor, int num_ticks, int num_observationnodes,
+                              nodetimeseries_t *observationnodes, int ensemble_size) {
+    for (int k = 0; k < num_observationnodes; k++) {
+        for (int m = 0; m < ensemble_size; m++) {
+            nodeval_t *series = observationnodes[k].timeseries + (size_t) m * observationnodes[k].timeseries_ticks;
+            for (int t = monitor->stop_tick + 1; t < num_ticks; t++) {
+                switch (monitor->status) {
+                    case CONVERGENCE_STEADY_STATE:
+                        series[t] = series[monitor->stop_tick];
+                        break;
+                    case CONVERGENCE_PERIODIC:
+                        series[t] = series[t - monitor->period];
+                        break;
+                    default:
+                        series[t] = NAN;
+                        break;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,184 @@
+#ifndef CONVERGENCE_H
+#define CONVERGENCE_H
+
+#include "definitions.h"
+
+#include <math.h>
+
+/**
+ * @file
+ * Early termination of runs that stopped changing or diverged.
+ *
+ * While sweeping, each thread computes the maximum change of the energy levels and the sum of the absolute energy
+ * levels of its rows, right after each row has been computed. After each tick, the management thread reduces them
+ * and stops the run once:
+ * - steady state: in runs without inputs, the maximum change stayed below the tolerance for EARLY_STOP_STEADY_TICKS
+ *   consecutive ticks. The remaining observations repeat the last ones.
+ * - periodic orbit: in runs with periodic inputs, the observation nodes and the summed absolute energy of the grid
+ *   repeated the values of one input period earlier (the least common multiple of the input periods) within the
+ *   tolerance for a full period. The remaining observations repeat the last period.
+ * - divergence: any energy level became infinite or NaN. The remaining observations are NaN.
+ *
+ * Runs with an input stream only detect divergence, as their future inputs are unknown.
+ */
+
+/**
+ * Why a monitored run stopped.
+ */
+typedef enum {
+    /** The run has not stopped early. */
+    CONVERGENCE_RUNNING,
+    /** The energy levels stopped changing. */
+    CONVERGENCE_STEADY_STATE,
+    /** The observations repeat the input period. */
+    CONVERGENCE_PERIODIC,
+    /** An energy level became infinite or NaN. */
+    CONVERGENCE_DIVERGED
+} convergencestatus_t;
+
+/**
+ * The reductions of one thread in the current tick, padded to a cache line so that the threads do not share lines.
+ */
+typedef struct {
+    /**
+    * Maximum absolute change of the energy levels of the thread's rows.
+    */
+    nodeval_t max_change;
+    /**
+    * Sum of the absolute energy levels of the thread's rows.
+    */
+    nodeval_t norm;
+    /**
+    * Padding to 64 bytes.
+    */
+    nodeval_t padding[6];
+}
+        convergenceslot_t;
+
+struct convergencemonitor {
+    /**
+    * Maximum change of an energy level (per tick, or per period) that counts as unchanged.
+    */
+    nodeval_t tolerance;
+    /**
+    * One slot per thread, reset and filled during each tick.
+    */
+    convergenceslot_t *slots;
+    /**
+    * The number of threads, i.e., slots.
+    */
+    int num_threads;
+    /**
+    * The number of values summed into the norms (nodes times ensemble lanes).
+    */
+    double number_values;
+    /**
+    * 1 if the run may stop in a steady state, i.e., has no inputs.
+    */
+    int steady_state;
+    /**
+    * The input period in ticks for detecting periodic orbits, 0 if not detected.
+    */
+    int period;
+    /**
+    * The norms of the last period ticks, tick t at t % period. NULL if periods are not detected.
+    */
+    nodeval_t *norm_history;
+    /**
+    * Number of consecutive ticks without changes above the tolerance.
+    */
+    int steady_ticks;
+    /**
+    * Number of consecutive ticks repeating the tick one period earlier.
+    */
+    int periodic_ticks;
+    /**
+    * The last simulated tick once the run stopped, -1 while running.
+    */
+    int stop_tick;
+    /**
+    * Why the run stopped.
+    */
+    convergencestatus_t status;
+};
+
+/**
+ * Creates a monitor stopping a run early.
+ * @param tolerance Maximum change of an energy level that counts as unchanged.
+ * @param num_threads The number of threads sweeping the grid.
+ * @param number_values The number of values per tick (nodes times ensemble lanes).
+ * @param num_ticks The number of ticks of the run.
+ * @param number_inputs The number of sparse inputs.
+ * @param inputs The sparse inputs. Length: number_inputs.
+ * @param input_plane The dense inputs, NULL if there are none.
+ * @param input_stream The input stream, NULL if there is none.
+ * @return The monitor.
+ */
+convergencemonitor_t *init_convergence_monitor(nodeval_t tolerance, int num_threads, double number_values,
+                                               int num_ticks, int number_inputs, const nodeinputseries_t *inputs,
+                                               const inputplane_t *input_plane, const framestream_t *input_stream);
+
+/**
+ * Frees a monitor created using init_convergence_monitor().
+ * @param monitor The monitor.
+ */
+void free_convergence_monitor(convergencemonitor_t *monitor);
+
+/**
+ * Resets the slot of a thread before it sweeps a tick.
+ * @param slot The slot of the thread.
+ */
+static inline void reset_convergence_slot(convergenceslot_t *slot) {
+    slot->max_change = 0;
+    slot->norm = 0;
+}
+
+/**
+ * Adds a computed row to the slot of a thread.
+ * @param slot The slot of the thread.
+ * @param old_row The energy levels of the row before the tick.
+ * @param new_row The energy levels of the row after the tick.
+ * @param count The number of values of the row.
+ */
+static inline void monitor_convergence_row(convergenceslot_t *slot, const nodeval_t *old_row,
+                                           const nodeval_t *new_row, size_t count) {
+    nodeval_t max_change = slot->max_change;
+    nodeval_t norm = slot->norm;
+    for (size_t j = 0; j < count; j++) {
+        nodeval_t change = fabs(new_row[j] - old_row[j]);
+        // NaN changes are caught by the norm
+        max_change = change > max_change ? change : max_change;
+        norm += fabs(new_row[j]);
+    }
+    slot->max_change = max_change;
+    slot->norm = norm;
+}
+
+/**
+ * Reduces the slots of all threads after a tick and decides whether the run stops. Called by the management thread
+ * once all threads computed the tick.
+ * @param monitor The monitor.
+ * @param tick_number The computed tick.
+ * @param num_observationnodes The number of observation nodes.
+ * @param observationnodes The observation nodes, holding the observations of all previous ticks.
+ * @param state The energy levels after the tick.
+ * @param ensemble_size The number of members of an ensemble, 1 without ensembles.
+ * @param ensemble_lanes The padded number of members stored per node in state, 1 without ensembles.
+ * @return 1 if the run stops after this tick, 0 otherwise.
+ */
+int update_convergence_monitor(convergencemonitor_t *monitor, int tick_number, int num_observationnodes,
+                               const nodetimeseries_t *observationnodes, nodeval_t **state, int ensemble_size,
+                               int ensemble_lanes);
+
+/**
+ * Fills the observations of the ticks after a stopped run, according to why it stopped.
+ * @param monitor The monitor of the stopped run.
+ * @param num_ticks The number of ticks of the run.
+ * @param num_observationnodes The number of observation nodes.
+ * @param observationnodes The observation nodes, holding the observations up to the last simulated tick.
+ * @param ensemble_size The number of members of an ensemble, 1 without ensembles.
+ */
+void extrapolate_observations(const convergencemonitor_t *monitor, int num_ticks, int num_observationnodes,
+                              nodetimeseries_t *observationnodes, int ensemble_size);
+
+#endif
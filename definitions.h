@@ -29,10 +29,105 @@
 #define THREADFACTOR 1
 #endif
 
+#ifndef INPUT_PLANE_DENSITY
+/**
+ * Ratio of input nodes to all nodes of the grid at or above which the inputs are stored as dense input planes
+ * instead of sparse per-node input series. Only inputs with equal timeseries lengths and at most one input per
+ * node can be stored densely. Set to a value > 1 to disable dense input planes. Default is 0.5.
+ */
+#define INPUT_PLANE_DENSITY 0.5
+#endif
+
+#ifndef ENSEMBLE_LANES
+/**
+ * Number of ensemble members updated together by the ensemble engine, i.e., the SIMD width the member loops are
+ * written for. The number of members of an ensemble is padded to a multiple of this value. Must be a multiple of 2,
+ * the members are computed in vectors of 2 doubles (128 bit, SSE2 or NEON). Default is 4.
+ */
+#define ENSEMBLE_LANES 4
+#endif
+
+#ifndef ACTIVITY_TRACKING
+/**
+ * 1 if the specialized sweeps track which tiles of the grid are active and skip the computation of all others, 0 to
+ * always compute all nodes. A tile is active if it or any node within the kernel's radius had a non-zero energy
+ * level or slope in the previous tick. Skipping does not change any results. Default is 1.
+ */
+#define ACTIVITY_TRACKING 1
+#endif
+
+#ifndef ACTIVITY_TILE_SIZE
+/**
+ * Number of nodes along y per tile of the activity tracking (see ACTIVITY_TRACKING). Tiles are one grid row high.
+ * Default is 32.
+ */
+#define ACTIVITY_TILE_SIZE 32
+#endif
+
+#ifndef LIGHTCONE_PRUNING
+/**
+ * 1 if the specialized sweeps only compute the tiles within the backward light cones of the observation nodes, 0 to
+ * always compute all nodes. A node can only influence the observation nodes within the kernel's radius times the
+ * remaining ticks, all others are skipped. Only used for runs observing few nodes and without long-range connections.
+ * Skipping does not change the observed results, the energy levels of skipped nodes are left undefined. Default is 1.
+ */
+#define LIGHTCONE_PRUNING 1
+#endif
+
+#ifndef FAST_FORWARD_MIN_TICKS
+/**
+ * Minimum number of consecutive input-free ticks that are fast-forwarded in the spectral domain instead of simulated,
+ * if fast-forwarding is enabled (see fastforward.h). Default is 32.
+ */
+#define FAST_FORWARD_MIN_TICKS 32
+#endif
+
+#ifndef EARLY_STOP_STEADY_TICKS
+/**
+ * Number of consecutive ticks in which no energy level may change by more than the tolerance before a run without
+ * inputs stops early in a steady state, if early termination is enabled (see convergence.h). Default is 16.
+ */
+#define EARLY_STOP_STEADY_TICKS 16
+#endif
+
+#ifndef PHASE_TIMING
+/**
+ * Set to 1 to time the phases of each tick per thread and print their statistics after each run (see phasetiming.h).
+ * Default is 0, which compiles the timing out entirely.
+ */
+#define PHASE_TIMING 0
+#endif
+
+#ifndef PERF_COUNTERS
+/**
+ * Set to 1 to count cycles, instructions, cache misses and branch misses in the phases of each tick per thread using
+ * the hardware performance counters of Linux and print them per node update after each run (see perfcounters.h).
+ * Default is 0, which compiles the counting out entirely.
+ */
+#define PERF_COUNTERS 0
+#endif
+
+#ifndef METRICS_INTERVAL_MS
+/**
+ * Minimum number of milliseconds between the updates of the rates, estimated remaining time and memory in a live
+ * metrics file (see metrics.h). The number of completed ticks and the times of the threads are updated each tick.
+ * Default is 250.
+ */
+#define METRICS_INTERVAL_MS 250
+#endif
+
+#ifndef VOLUME_CACHE_SIZE
+/**
+ * Number of bytes of cache per thread that the sweep over a volume blocks its y-lines for (see volume.h): the three
+ * x-planes of a block read by the stencil are kept below this size. Default is 262144 (256 KiB, a typical L2 cache).
+ */
+#define VOLUME_CACHE_SIZE 262144
+#endif
+
 #ifndef D_NEIGHBORFACTOR
 /**
  * Ratio of how much the direct neighbors influence the energy state of any node. This is a factor multiplied with the direct neighbor-energy. See parameter (a1) in the flowchart. Usually a number in (0,1], however numbers > 1
- * are possible. Default is 1.
+ * are possible. Default is 1. Default of the runtime parameter modelparameters_t.d_neighborfactor (--dneighborfactor).
  */
 #define D_NEIGHBORFACTOR 1
 #endif
@@ -40,24 +135,25 @@
 #ifndef ID_NEIGHBORFACTOR
 /**
  * Ratio of how much the indirect neighbors influence the energy state of any node. This is a factor multiplied with the indirect neighbor-energy. See parameter (a2) in the flowchart. Usually a number in (0,1], however numbers
- * > 1 are possible. Default is 1.
+ * > 1 are possible. Default is 1. Default of the runtime parameter modelparameters_t.id_neighborfactor (--idneighborfactor).
  */
 #define ID_NEIGHBORFACTOR 1
 #endif
 
 #ifndef DAMPING
 /**
- * DEPRECATED. CURRENTLY IGNORED. The amount of physical damping applied at each simulation step for each energy level, i.e., the ratio of energy loss
+ * The amount of physical damping applied at each simulation step for each energy level, i.e., the ratio of energy loss
  * per simulation tick. The energy level is damped using the function: enery_level = energy_level / (1 + DAMPING).
- * Default: 0.001.
+ * Default is 0 (no damping). Default of the runtime parameter modelparameters_t.damping (--damping).
  */
-#define DAMPING 0.001
+#define DAMPING 0
 #endif
 
 #ifndef ENERGY_FACTOR
 /**
  * Ratio of how much the historical energy state negatively influences the current energy slope. This is a factor multiplied with the historical energy. See parameter (b) in the flowchart.
  * Usually a number in (0,1], however numbers > 1 are possible. Default is 1.
+ * Default of the runtime parameter modelparameters_t.energy_factor (--energyfactor).
  */
 #define ENERGY_FACTOR 1
 #endif
@@ -66,6 +162,7 @@
 /**
  * Ratio of how much the historical energy state influences the current energy state. This is a factor multiplied with the historical energy. See parameter (g) in the flowchart.
  * Usually a number in (0,1], however numbers > 1 are possible. Default is 1.
+ * Default of the runtime parameter modelparameters_t.energy_weight (--energyweight).
  */
 #define ENERGY_WEIGHT 1
 #endif
@@ -74,6 +171,7 @@
 /**
  * Ratio of how much the current slope vector influences the slope calculation. This is a factor multiplied with the current slope vector. See parameter (e) in the flowchart.
  * Usually a number in (0,1], however numbers > 1 are possible. Default is 1.
+ * Default of the runtime parameter modelparameters_t.delta_factor (--deltafactor).
  */
 #define DELTA_FACTOR 1
 #endif
@@ -82,6 +180,7 @@
 /**
  * Ratio of how much the historical slope influences the current energy state. This is a factor multiplied with the historical slope. See parameter (d) in the flowchart.
  * Usually a number in (0,1], however numbers > 1 are possible. Default is 1.
+ * Default of the runtime parameter modelparameters_t.slope_factor (--slopefactor).
  */
 #define SLOPE_FACTOR 1
 #endif
@@ -90,6 +189,7 @@
 /**
  * Ratio of how much the current calculated slope influences the current energy state. This is a factor multiplied with the slope. See parameter (h) in the flowchart.
  * Usually a number in (0,1], however numbers > 1 are possible. Default is 1.
+ * Default of the runtime parameter modelparameters_t.slope_weight (--slopeweight).
  */
 #define SLOPE_WEIGHT 1
 #endif
@@ -114,6 +214,24 @@ typedef SYNCHRONIZATION_BARRIER threadbarrier_t;
 typedef pthread_barrier_t threadbarrier_t;
 #endif
 
+/**
+ * Platform-independent mutex.
+ */
+#ifdef _WIN32
+typedef CRITICAL_SECTION threadmutex_t;
+#else
+typedef pthread_mutex_t threadmutex_t;
+#endif
+
+/**
+ * Platform-independent condition variable.
+ */
+#ifdef _WIN32
+typedef CONDITION_VARIABLE threadcondition_t;
+#else
+typedef pthread_cond_t threadcondition_t;
+#endif
+
 /**
  * Type that the nodes in the brainsimulation use to store their energy level.
  */
@@ -133,8 +251,13 @@ typedef struct {
     */
     int y_index;
     /**
+    * z index of the node, only used when simulating a volume (see volume.h).
+    */
+    int z_index;
+    /**
     * Series of observed node energy levels. One element per tick.
-    * Has #timeseries_ticks as length.
+    * Has #timeseries_ticks as length. When simulating an ensemble, holds one series per member instead: the series
+    * of member m starts at timeseries[m * timeseries_ticks] (length: timeseries_ticks * ensemble size).
     */
     nodeval_t *timeseries;
     /**
@@ -158,6 +281,10 @@ typedef struct {
     */
     int y_index;
     /**
+    * z index of the node, only used when simulating a volume (see volume.h).
+    */
+    int z_index;
+    /**
     * Series of energy levels to be added at the specified node at the given tick.
     * Has #timeseries_ticks as length.
     */
@@ -169,6 +296,451 @@ typedef struct {
 }
         nodeinputseries_t;
 
+/**
+ * The start energy level of a single node of a volume (see volume.h).
+ */
+typedef struct {
+    /**
+    * x index of the node.
+    */
+    int x_index;
+    /**
+    * y index of the node.
+    */
+    int y_index;
+    /**
+    * z index of the node.
+    */
+    int z_index;
+    /**
+    * The start energy level.
+    */
+    nodeval_t level;
+}
+        nodelevel_t;
+
+/**
+ * Dense representation of the inputs of the entire node grid. Stores the input class of each node in the grid layout
+ * and one input series per class, i.e., per distinct series among the inputs (e.g., per frequency, or per sequence of
+ * frequencies of the frames of bitmap inputs). The series are those of the sparse inputs the plane was generated from.
+ */
+typedef struct {
+    /**
+    * Number of ticks after which the inputs are repeated, i.e., the length of each class series.
+    */
+    int period_ticks;
+    /**
+    * The number of nodes in the first dimension of each plane.
+    */
+    int number_nodes_x;
+    /**
+    * The number of nodes in the second dimension of each plane.
+    */
+    int number_nodes_y;
+    /**
+    * The number of input classes.
+    */
+    int number_classes;
+    /**
+    * The input class of each node plus 1, 0 for nodes without input. The class of node (x, y) is stored at
+    * node_class[x * number_nodes_y + y]. Length: number_nodes_x * number_nodes_y.
+    */
+    unsigned int *node_class;
+    /**
+    * The input series of each class, not owned by the plane. The input of class c at tick t is
+    * class_series[c][t % period_ticks]. Length: number_classes.
+    */
+    const nodeval_t **class_series;
+}
+        inputplane_t;
+
+/**
+ * Stream of raw input frames, which are read and decoded in the background during the simulation.
+ * See framestream.h.
+ */
+typedef struct framestream framestream_t;
+
+/**
+ * The non-zero tiles of the grid, for skipping the computation of quiescent tiles (see ACTIVITY_TRACKING) and of tiles
+ * outside of the light cones of the observation nodes (see LIGHTCONE_PRUNING). A tile consists of ACTIVITY_TILE_SIZE
+ * consecutive nodes of one grid row.
+ */
+typedef struct {
+    /**
+    * 1 if quiescent tiles are skipped, 0 if only the light cones limit the active tiles.
+    */
+    int skip_quiescent;
+    /**
+    * 1 if tiles outside of the backward light cones of the observation nodes are skipped.
+    */
+    int light_cone;
+    /**
+    * Number of tiles per grid row.
+    */
+    int number_tiles;
+    /**
+    * Number of grid rows around a tile that can change it within one tick, i.e., the kernel's radius.
+    */
+    int radius_rows;
+    /**
+    * Number of tiles of the same grid rows around a tile that can change it within one tick.
+    */
+    int radius_tiles;
+    /**
+    * Whether any node of a tile has a non-zero energy level or slope, tile t of grid row x at
+    * [x * number_tiles + t]. nonzero[tick % 2] describes the old state of a tick and is read by all threads,
+    * nonzero[(tick + 1) % 2] describes the new state and is written by the thread owning the row. Nodes only count
+    * as zero if they are +0.0, so that skipped nodes are bit-identical to computed ones.
+    */
+    unsigned char *nonzero[2];
+    /**
+    * Whether all tiles of a grid row are non-zero, grid row x at [x], double-buffered like nonzero. May be 0 for full
+    * rows, e.g., if inputs made the last tiles non-zero.
+    */
+    unsigned char *full_rows[2];
+}
+        activitymap_t;
+
+/**
+ * Sparse long-range connections between nodes of the grid. See connectome.h.
+ */
+typedef struct connectome connectome_t;
+
+/**
+ * Input-free intervals of a run, which are fast-forwarded in the spectral domain. See fastforward.h.
+ */
+typedef struct fastforward fastforward_t;
+
+/**
+ * Per-tick monitor stopping a run early once it converged or diverged. See convergence.h.
+ */
+typedef struct convergencemonitor convergencemonitor_t;
+
+/**
+ * Recorder of the threshold events of a run. See events.h.
+ */
+typedef struct eventlog eventlog_t;
+
+/**
+ * The threshold events recorded by one thread. See events.h.
+ */
+typedef struct eventbuffer eventbuffer_t;
+
+/**
+ * The phase timing statistics of one thread. See phasetiming.h.
+ */
+typedef struct threadtiming threadtiming_t;
+
+/**
+ * The hardware performance counters of one thread. See perfcounters.h.
+ */
+typedef struct perfcounters perfcounters_t;
+
+/**
+ * The live metrics of a run in a memory-mapped file. See metrics.h.
+ */
+typedef struct metrics metrics_t;
+
+/**
+ * The timeline of the phases of all threads of a run, exported as a Chrome trace. See trace.h.
+ */
+typedef struct tracelog tracelog_t;
+
+/**
+ * The preallocated trace events of one thread. See trace.h.
+ */
+typedef struct tracebuffer tracebuffer_t;
+
+/**
+ * Parameters of the model executed by each node (see process() in nodefunc.h).
+ * The defaults are the compile-time macros of the same names, e.g., D_NEIGHBORFACTOR.
+ */
+typedef struct {
+    /**
+    * Factor multiplied with the direct neighbor-energy, parameter (a1) in the flowchart.
+    */
+    nodeval_t d_neighborfactor;
+    /**
+    * Factor multiplied with the indirect neighbor-energy, parameter (a2) in the flowchart.
+    */
+    nodeval_t id_neighborfactor;
+    /**
+    * Factor multiplied with the historical energy for the slope calculation, parameter (b) in the flowchart.
+    */
+    nodeval_t energy_factor;
+    /**
+    * Factor multiplied with the historical energy for the new energy state, parameter (g) in the flowchart.
+    */
+    nodeval_t energy_weight;
+    /**
+    * Factor multiplied with the current slope vector, parameter (e) in the flowchart.
+    */
+    nodeval_t delta_factor;
+    /**
+    * Factor multiplied with the historical slope, parameter (d) in the flowchart.
+    */
+    nodeval_t slope_factor;
+    /**
+    * Factor multiplied with the new slope for the new energy state, parameter (h) in the flowchart.
+    */
+    nodeval_t slope_weight;
+    /**
+    * Ratio of energy lost per tick, the new energy level is divided by (1 + damping).
+    */
+    nodeval_t damping;
+}
+        modelparameters_t;
+
+/**
+ * Per-node model parameters for heterogeneous grids (see modelparameters_t). Each member is a plane holding the
+ * parameter of every node in the grid layout (node (x, y) at [x * number_nodes_y + y]), or NULL if the parameter is
+ * uniform, i.e., the value in modelparameters_t applies to all nodes.
+ */
+typedef struct {
+    /**
+    * Per-node direct neighbor factor, NULL if uniform.
+    */
+    nodeval_t *d_neighborfactor;
+    /**
+    * Per-node indirect neighbor factor, NULL if uniform.
+    */
+    nodeval_t *id_neighborfactor;
+    /**
+    * Per-node energy factor, NULL if uniform.
+    */
+    nodeval_t *energy_factor;
+    /**
+    * Per-node energy weight, NULL if uniform.
+    */
+    nodeval_t *energy_weight;
+    /**
+    * Per-node delta factor, NULL if uniform.
+    */
+    nodeval_t *delta_factor;
+    /**
+    * Per-node slope factor, NULL if uniform.
+    */
+    nodeval_t *slope_factor;
+    /**
+    * Per-node slope weight, NULL if uniform.
+    */
+    nodeval_t *slope_weight;
+    /**
+    * Per-node damping, NULL if uniform.
+    */
+    nodeval_t *damping;
+}
+        parametermaps_t;
+
+/**
+ * The model parameters folded into the minimal set of coefficients for one kernel:
+ * slope_new = slope * slope_old + d * (sum of direct neighbors) + id * (sum of indirect neighbors) + act * act_old,
+ * act_new = energy_weight * act_old + slope_weight * slope_new. The damping is folded into energy_weight and
+ * slope_weight.
+ */
+typedef struct {
+    /**
+    * Coefficient of the sum of the direct neighbors (includes the division by their number).
+    */
+    nodeval_t d;
+    /**
+    * Coefficient of the sum of the indirect neighbors (includes the division by their number).
+    */
+    nodeval_t id;
+    /**
+    * Coefficient of the old energy level in the slope.
+    */
+    nodeval_t act;
+    /**
+    * Coefficient of the old slope in the slope.
+    */
+    nodeval_t slope;
+    /**
+    * Coefficient of the old energy level in the new energy level.
+    */
+    nodeval_t energy_weight;
+    /**
+    * Coefficient of the new slope in the new energy level.
+    */
+    nodeval_t slope_weight;
+    /**
+    * 1 if all model parameters are 1 and there is no damping, which allows for a fast path without any
+    * multiplication.
+    */
+    unsigned int unit;
+}
+        modelcoefficients_t;
+
+/**
+ * The folded model coefficients (see modelcoefficients_t) of all members of an ensemble, one array per coefficient,
+ * so that the members can be updated in SIMD lanes. Length of each array: the padded number of members.
+ */
+typedef struct {
+    /**
+    * Coefficients of the sum of the direct neighbors.
+    */
+    nodeval_t *d;
+    /**
+    * Coefficients of the sum of the indirect neighbors.
+    */
+    nodeval_t *id;
+    /**
+    * Coefficients of the old energy level in the slope.
+    */
+    nodeval_t *act;
+    /**
+    * Coefficients of the old slope in the slope.
+    */
+    nodeval_t *slope;
+    /**
+    * Coefficients of the old energy level in the new energy level.
+    */
+    nodeval_t *energy_weight;
+    /**
+    * Coefficients of the new slope in the new energy level.
+    */
+    nodeval_t *slope_weight;
+}
+        ensemblecoefficients_t;
+
+/**
+ * The folded model coefficients (see modelcoefficients_t) of the nodes of a heterogeneous grid, computed from
+ * parametermaps_t. Each member is a plane in the grid layout of the rows it has been computed for, or NULL if the
+ * coefficient is the same for all nodes (the value in modelcoefficients_t).
+ */
+typedef struct {
+    /**
+    * Per-node coefficients of the sum of the direct neighbors, NULL if uniform.
+    */
+    nodeval_t *d;
+    /**
+    * Per-node coefficients of the sum of the indirect neighbors, NULL if uniform.
+    */
+    nodeval_t *id;
+    /**
+    * Per-node coefficients of the old energy level in the slope, NULL if uniform.
+    */
+    nodeval_t *act;
+    /**
+    * Per-node coefficients of the old slope in the slope, NULL if uniform.
+    */
+    nodeval_t *slope;
+    /**
+    * Per-node coefficients of the old energy level in the new energy level, NULL if uniform.
+    */
+    nodeval_t *energy_weight;
+    /**
+    * Per-node coefficients of the new slope in the new energy level, NULL if uniform.
+    */
+    nodeval_t *slope_weight;
+}
+        coefficientmaps_t;
+
+/**
+ * A kernel, i.e., the direct and indirect neighborhood of each node. See kernels.h.
+ */
+typedef struct kernel kernel_t;
+
+/**
+ * Per-thread buffers for computing the neighborhood sums of large kernels. See kernels.h.
+ */
+typedef struct kernelworkspace kernelworkspace_t;
+
+/**
+ * Optional settings of a simulation run. Initialize using init_simulation_options() before setting any members.
+ */
+typedef struct {
+    /**
+    * Stream of frames to generate sin-frequency inputs from during the simulation (in addition to the inputs
+    * passed to the simulation). NULL if no stream is used.
+    */
+    framestream_t *input_stream;
+    /**
+    * Name of the kernel to simulate with (see kernels.h). NULL for the default kernel.
+    */
+    const char *kernel_name;
+    /**
+    * 1 to simulate using the generic reference engine, which gathers each node's kernels using the kernel functions
+    * and executes process() on them. 0 to use the sweep specialized for the kernel.
+    */
+    unsigned int reference_engine;
+    /**
+    * The parameters of the model executed by each node. Ignored when simulating an ensemble.
+    */
+    modelparameters_t parameters;
+    /**
+    * Number of members of the ensemble to simulate. Each member simulates the same grid and inputs with its own model
+    * parameters. 1 to simulate only #parameters. The time series of all observation nodes must have room for the
+    * observations of all members (see nodetimeseries_t).
+    */
+    int ensemble_size;
+    /**
+    * The model parameters of each member of the ensemble. Length: #ensemble_size. Only used if #ensemble_size > 1.
+    */
+    const modelparameters_t *ensemble_parameters;
+    /**
+    * Per-node model parameters overriding #parameters for single nodes. NULL if all nodes use #parameters.
+    * Cannot be combined with ensembles.
+    */
+    const parametermaps_t *parameter_maps;
+    /**
+    * Name of the method to compute the kernel's sums with (direct, separable, fft, see kernelmethod_t). NULL or "auto"
+    * to choose the fastest method for the kernel and grid size.
+    */
+    const char *kernel_method;
+    /**
+    * Long-range connections between nodes, added to the kernel's result. NULL if there are none. Cannot be combined
+    * with ensembles.
+    */
+    connectome_t *connectome;
+    /**
+    * 1 to compute the observations by superposing the impulse responses of the input and start nodes instead of
+    * simulating the inputs (see superposition.h), unless simulating the responses costs more than a direct run,
+    * SUPERPOSITION_ALWAYS to superpose regardless. Cannot be combined with ensembles or an input stream.
+    */
+    unsigned int superposition;
+    /**
+    * Directory to cache the impulse responses in when simulating by superposition. NULL to not cache them.
+    */
+    const char *impulse_cache;
+    /**
+    * 1 to fast-forward through intervals without inputs in the spectral domain instead of simulating each tick (see
+    * fastforward.h), if they are long enough to pay off by the estimated costs, FAST_FORWARD_ALWAYS to fast-forward
+    * all intervals of at least FAST_FORWARD_MIN_TICKS ticks. Only used for kernels of radius 1 and uniform model
+    * parameters, without ensembles, connections or an input stream.
+    */
+    unsigned int fast_forward;
+    /**
+    * Tolerance for stopping a run early once it reached a steady state or a periodic orbit (or diverged), extrapolating
+    * the remaining observations (see convergence.h). 0 to always simulate all ticks. Not used when fast-forwarding.
+    */
+    nodeval_t early_stop_tolerance;
+    /**
+    * Log to record the threshold events of all (or the selected) nodes in, in addition to the observation series (see
+    * events.h). NULL to not record events. Cannot be combined with superposition.
+    */
+    eventlog_t *events;
+
+    /**
+    * Live metrics file to publish the progress of the run in instead of printing it (see metrics.h). NULL to print the
+    * progress. Must have a slot for each simulation thread.
+    */
+    metrics_t *metrics;
+
+    /**
+    * Trace to record the phases of the simulation threads in (see trace.h). NULL to not trace the run. Must have a
+    * buffer for each simulation thread.
+    */
+    tracelog_t *trace;
+
+    /**
+    * Seconds the caller spent setting up the run before calling simulate() (e.g., parsing and generating the inputs).
+    * Reported as part of the setup time of the run.
+    */
+    double setup_seconds;
+}
+        simulationoptions_t;
+
 /**
  * Struct to store the status of one node. Includes the energy-level of the node, as well as the slope.
  */
@@ -255,11 +827,144 @@ typedef struct {
 
     /**
     * 2D array containing the kernels of each node at each index.Each index node points to an array
-    * containing(currently) two kernels, each(currently) containing 4 neighbouring noides.Dimensions: number_nodes_x *
-    * number_nodes_y * 2 * 4.
+    * containing two kernels, each containing the neighbouring nodes of one neighborhood. Dimensions: number_nodes_x *
+    * number_nodes_y * 2 * (maximum number of neighbors per neighborhood).
+    * Only used by the reference engine, NULL otherwise.
     */
     nodeval_t ****kernels;
 
+    /**
+    * The kernel to simulate with.
+    */
+    const kernel_t *kernel;
+
+    /**
+    * 1 if the generic reference engine is used instead of the specialized sweep of the kernel.
+    */
+    unsigned int reference_engine;
+
+    /**
+    * The parameters of the model executed by each node. Used by the reference engine.
+    */
+    const modelparameters_t *parameters;
+
+    /**
+    * The model parameters folded into coefficients for the kernel. Used by the specialized sweeps.
+    */
+    modelcoefficients_t coefficients;
+
+    /**
+    * Per-node model parameters, NULL if all nodes use the same parameters. Used by the reference engine.
+    */
+    const parametermaps_t *parameter_maps;
+
+    /**
+    * The per-node model coefficients of the rows of this thread (row thread_start_x first). Only used if
+    * parameter_maps is not NULL.
+    */
+    coefficientmaps_t coefficient_maps;
+
+    /**
+    * The buffers of the neighborhood sums of this thread's rows. Only used if the kernel is not summed directly
+    * (see kernelmethod_t), NULL otherwise.
+    */
+    kernelworkspace_t *kernel_workspace;
+
+    /**
+    * The non-zero tiles of the entire grid. NULL if all nodes are computed in each tick.
+    */
+    activitymap_t *activity;
+
+    /**
+    * The active tiles of the row currently swept by this thread, followed by scratch space of the same size. Only used
+    * if activity is not NULL.
+    */
+    unsigned char *active_tiles;
+
+    /**
+    * The input-free intervals to fast-forward through. NULL if all ticks are simulated. The intervals are
+    * fast-forwarded by all threads together, each transforming and advancing its own rows.
+    */
+    fastforward_t *fast_forward;
+
+    /**
+    * The monitor stopping the run early, NULL if all ticks are simulated. Each thread reduces its rows into its slot
+    * of the monitor, the management thread decides after each tick whether the run stops.
+    */
+    convergencemonitor_t *monitor;
+
+    /**
+    * The slot of this thread in monitor.
+    */
+    int monitor_slot;
+
+    /**
+    * The log of threshold events, NULL if no events are recorded.
+    */
+    eventlog_t *events;
+
+    /**
+    * The buffer of events of this thread in events.
+    */
+    eventbuffer_t *event_buffer;
+
+    /**
+    * The phase timing statistics of this thread, NULL if the phases are not timed. Only used with PHASE_TIMING.
+    */
+    threadtiming_t *timing;
+
+    /**
+    * The hardware performance counters of this thread, NULL if they are not read. Only used with PERF_COUNTERS.
+    */
+    perfcounters_t *counters;
+
+    /**
+    * The live metrics of the run, NULL if the progress is printed instead.
+    */
+    metrics_t *metrics;
+
+    /**
+    * The slot of this thread in metrics.
+    */
+    int metrics_slot;
+
+    /**
+    * The trace buffer of this thread, NULL if the run is not traced.
+    */
+    tracebuffer_t *trace_buffer;
+
+    /**
+    * The long-range connections, NULL if there are none. The connection sums of all threads are computed from the
+    * energy levels of the previous tick and added to the targets during the sweep.
+    */
+    connectome_t *connectome;
+
+    /**
+    * The first row of the connections whose sums are computed by this thread.
+    */
+    int connection_first_row;
+
+    /**
+    * The row after the last row of the connections whose sums are computed by this thread.
+    */
+    int connection_end_row;
+
+    /**
+    * Number of members of the simulated ensemble, 1 if no ensemble is simulated.
+    */
+    int ensemble_size;
+
+    /**
+    * Padded number of ensemble members, i.e., the number of values stored per node in old_state, new_state and slopes
+    * (member m of node (x, y) at [x][y * ensemble_lanes + m]). 0 if no ensemble is simulated.
+    */
+    int ensemble_lanes;
+
+    /**
+    * The folded model coefficients of all ensemble members. Only used if ensemble_lanes > 0.
+    */
+    ensemblecoefficients_t ensemble_coefficients;
+
     /**
     * Node x index at which to start working in this thread (inclusive).
     */
@@ -272,11 +977,13 @@ typedef struct {
 
     /**
      * Function pointer pointing to the kernel function for the direct neighborhood.
+     * NULL if the kernel has no kernel function, the reference engine then gathers the neighbors from the kernel.
      */
     kernelfunc_t d_ptr;
 
     /**
      * Function pointer pointing to the kernel function for the indirect neighborhood.
+     * NULL if the kernel has no kernel function, the reference engine then gathers the neighbors from the kernel.
      */
     kernelfunc_t id_ptr;
 
@@ -301,10 +1008,31 @@ typedef struct {
     * Points the the inputs
     * in the sub-grid of this partial simulation.
     * Sub-grid is defined by thread_start_x and thread_end_x.
+    * Sorted by x index, then y index. Inputs on the same node keep their order from the global inputs.
     * Length: number_partial_inputs.
     */
     nodeinputseries_t **partial_inputs;
 
+    /**
+    * Sparse row index into partial_inputs. The inputs of row x are found at
+    * partial_inputs[partial_input_row_offsets[x - thread_start_x]] up to (exclusive)
+    * partial_inputs[partial_input_row_offsets[x - thread_start_x + 1]].
+    * Length: thread_end_x - thread_start_x + 1.
+    */
+    int *partial_input_row_offsets;
+
+    /**
+    * Dense input planes of the entire node grid. NULL if the inputs are processed sparsely
+    * using partial_inputs.
+    */
+    inputplane_t *input_plane;
+
+    /**
+    * Stream of input frames, adding energy to the nodes of the current frame. NULL if no stream is used.
+    * The stream is advanced by the management thread.
+    */
+    framestream_t *input_stream;
+
     /**
      * Barrier to wait at.
      */
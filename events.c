@@ -0,0 +1,186 @@
+#include "events.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+static const char *EVENT_KIND_NAMES[] = {"rising", "falling", "peak"};
+
+eventlog_t *init_event_log(nodeval_t threshold, int peaks, int number_nodes_x, int number_nodes_y,
+                           int number_selected, const int *selected_x, const int *selected_y) {
+    for (int k = 0; k < number_selected; k++) {
+        if (selected_x[k] < 0 || selected_x[k] >= number_nodes_x || selected_y[k] < 0
+            || selected_y[k] >= number_nodes_y) {
+            printf("ERROR: Event node (%d;%d) is outside of the grid.\n", selected_x[k], selected_y[k]);
+            return NULL;
+        }
+    }
+    eventlog_t *log = calloc(1, sizeof(eventlog_t));
+    log->threshold = threshold;
+    log->peaks = peaks;
+    log->number_nodes_x = number_nodes_x;
+    log->number_nodes_y = number_nodes_y;
+    if (number_selected > 0) {
+        // counting sort of the selected nodes by x index
+        log->selected_row_offsets = calloc(number_nodes_x + 1, sizeof(int));
+        log->selected_y = malloc(number_selected * sizeof(int));
+        for (int k = 0; k < number_selected; k++) {
+            log->selected_row_offsets[selected_x[k] + 1]++;
+        }
+        for (int x = 0; x < number_nodes_x; x++) {
+            log->selected_row_offsets[x + 1] += log->selected_row_offsets[x];
+        }
+        int *next = malloc(number_nodes_x * sizeof(int));
+        memcpy(next, log->selected_row_offsets, number_nodes_x * sizeof(int));
+        for (int k = 0; k < number_selected; k++) {
+            log->selected_y[next[selected_x[k]]++] = selected_y[k];
+        }
+        free(next);
+    }
+    return log;
+}
+
+static void free_event_buffers(eventlog_t *log) {
+    for (int i = 0; i < log->num_buffers; i++) {
+        free(log->buffers[i].events);
+    }
+    free(log->buffers);
+    log->buffers = NULL;
+    log->num_buffers = 0;
+}
+
+void free_event_log(eventlog_t *log) {
+    free_event_buffers(log);
+    free(log->selected_row_offsets);
+    free(log->selected_y);
+    free(log->rising);
+    free(log->events);
+    free(log);
+}
+
+void start_event_recording(eventlog_t *log, int num_threads, int ensemble_size, int ensemble_lanes) {
+    free_event_buffers(log);
+    free(log->events);
+    log->events = NULL;
+    log->number_events = 0;
+    log->ensemble_size = ensemble_size;
+    log->ensemble_lanes = ensemble_lanes;
+    log->num_buffers = num_threads;
+    log->buffers = calloc(num_threads, sizeof(eventbuffer_t));
+    free(log->rising);
+    log->rising = NULL;
+    if (log->peaks) {
+        log->rising = calloc((size_t) log->number_nodes_x * log->number_nodes_y * ensemble_size, 1);
+    }
+}
+
+static void append_event(eventbuffer_t *buffer, int tick_number, int x, int y, int member, eventkind_t kind,
+                         nodeval_t value) {
+    if (buffer->count == buffer->capacity) {
+        buffer->capacity = buffer->capacity > 0 ? 2 * buffer->capacity : 1024;
+        buffer->events = realloc(buffer->events, buffer->capacity * sizeof(nodeevent_t));
+    }
+    nodeevent_t *event = &buffer->events[buffer->count++];
+    event->tick = tick_number;
+    event->x = x;
+    event->y = y;
+    event->member = member;
+    event->kind = kind;
+    event->value = value;
+}
+
+// checks all members of node (x, y) for crossings of the threshold and peaks in the previous tick
+static inline void check_node(eventlog_t *log, eventbuffer_t *buffer, int tick_number, int x, int y,
+                              const nodeval_t *old_row, const nodeval_t *new_row) {
+    const nodeval_t threshold = log->threshold;
+    const nodeval_t *old_values = old_row + (size_t) y * log->ensemble_lanes;
+    const nodeval_t *new_values = new_row + (size_t) y * log->ensemble_lanes;
+    for (int m = 0; m < log->ensemble_size; m++) {
+        nodeval_t old_value = old_values[m];
+        nodeval_t new_value = new_values[m];
+        if (old_value < threshold && new_value >= threshold) {
+            append_event(buffer, tick_number, x, y, m, EVENT_RISING, new_value);
+        } else if (old_value >= threshold && new_value < threshold) {
+            append_event(buffer, tick_number, x, y, m, EVENT_FALLING, new_value);
+        }
+        if (log->rising != NULL) {
+            unsigned char *rising = log->rising + ((size_t) x * log->number_nodes_y + y) * log->ensemble_size + m;
+            if (*rising && new_value < old_value && old_value >= threshold) {
+                append_event(buffer, tick_number - 1, x, y, m, EVENT_PEAK, old_value);
+            }
+            // plateaus keep the direction of the last change
+            if (new_value != old_value) {
+                *rising = new_value > old_value;
+            }
+        }
+    }
+}
+
+void record_row_events(eventlog_t *log, eventbuffer_t *buffer, int tick_number, int x, const nodeval_t *old_row,
+                       const nodeval_t *new_row) {
+    if (log->selected_y != NULL) {
+        for (int k = log->selected_row_offsets[x]; k < log->selected_row_offsets[x + 1]; k++) {
+            check_node(log, buffer, tick_number, x, log->selected_y[k], old_row, new_row);
+        }
+    } else {
+        for (int y = 0; y < log->number_nodes_y; y++) {
+            check_node(log, buffer, tick_number, x, y, old_row, new_row);
+        }
+    }
+}
+
+static int compare_events(const void *a, const void *b) {
+    const nodeevent_t *event_a = a;
+    const nodeevent_t *event_b = b;
+    if (event_a->tick != event_b->tick) {
+        return event_a->tick < event_b->tick ? -1 : 1;
+    }
+    if (event_a->x != event_b->x) {
+        return event_a->x < event_b->x ? -1 : 1;
+    }
+    if (event_a->y != event_b->y) {
+        return event_a->y < event_b->y ? -1 : 1;
+    }
+    if (event_a->member != event_b->member) {
+        return event_a->member < event_b->member ? -1 : 1;
+    }
+    return (int) event_a->kind - (int) event_b->kind;
+}
+
+void finish_event_recording(eventlog_t *log) {
+    size_t number_events = 0;
+    for (int i = 0; i < log->num_buffers; i++) {
+        number_events += log->buffers[i].count;
+    }
+    log->events = malloc((number_events > 0 ? number_events : 1) * sizeof(nodeevent_t));
+    log->number_events = 0;
+    for (int i = 0; i < log->num_buffers; i++) {
+        memcpy(log->events + log->number_events, log->buffers[i].events,
+               log->buffers[i].count * sizeof(nodeevent_t));
+        log->number_events += log->buffers[i].count;
+    }
+    free_event_buffers(log);
+    qsort(log->events, log->number_events, sizeof(nodeevent_t), compare_events);
+}
+
+long events_to_csv(char *filename, const eventlog_t *log) {
+    printf("Creating %s file\n", filename);
+    long bytes = 0;
+    FILE *fp = fopen(filename, "w+");
+    if (fp == NULL) {
+        printf("File is null.\n Error: %s\n", strerror(errno));
+
+    } else {
+        fprintf(fp, "Tick,X,Y,Member,Event,Energy-value");
+        for (size_t i = 0; i < log->number_events; i++) {
+            const nodeevent_t *event = &log->events[i];
+            fprintf(fp, "\n%d,%d,%d,%d,%s,%f", event->tick, event->x, event->y, event->member,
+                    EVENT_KIND_NAMES[event->kind], event->value);
+        }
+        bytes = ftell(fp);
+        fclose(fp);
+        printf("%s file created.\n", filename);
+    }
+    return bytes;
+}
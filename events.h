@@ -0,0 +1,191 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include "definitions.h"
+
+/**
+ * @file
+ * Sparse recording of threshold events instead of full observation series.
+ *
+ * Each thread checks the nodes of each row right after computing it, comparing the new energy level to the one of the
+ * previous tick, and appends an event to its own buffer whenever a node
+ * - rises to or above the threshold (rising crossing),
+ * - falls below the threshold (falling crossing), or
+ * - had a local maximum at or above the threshold in the previous tick (peak, optional).
+ *
+ * All nodes of the grid are checked, or only the selected ones. The output is proportional to the activity of the
+ * grid instead of its size times the number of ticks. After the run, the buffers of all threads are merged and sorted
+ * by tick and node.
+ */
+
+/**
+ * The kind of a threshold event.
+ */
+typedef enum {
+    /** The energy level rose to or above the threshold. */
+    EVENT_RISING,
+    /** The energy level fell below the threshold. */
+    EVENT_FALLING,
+    /** The energy level had a local maximum at or above the threshold. */
+    EVENT_PEAK
+} eventkind_t;
+
+/**
+ * A threshold event of a node.
+ */
+typedef struct {
+    /**
+    * The tick after which the node had the event's energy level.
+    */
+    int tick;
+    /**
+    * The x index of the node.
+    */
+    int x;
+    /**
+    * The y index of the node.
+    */
+    int y;
+    /**
+    * The ensemble member, 0 without ensembles.
+    */
+    int member;
+    /**
+    * The kind of the event.
+    */
+    eventkind_t kind;
+    /**
+    * The energy level of the node after the tick.
+    */
+    nodeval_t value;
+}
+        nodeevent_t;
+
+struct eventbuffer {
+    /**
+    * The events recorded by one thread, in the order of recording. Length: count.
+    */
+    nodeevent_t *events;
+    /**
+    * The number of recorded events.
+    */
+    size_t count;
+    /**
+    * The number of events that fit into events.
+    */
+    size_t capacity;
+};
+
+struct eventlog {
+    /**
+    * The threshold of the events.
+    */
+    nodeval_t threshold;
+    /**
+    * 1 to record peaks in addition to crossings.
+    */
+    int peaks;
+    /**
+    * The x-size of the grid.
+    */
+    int number_nodes_x;
+    /**
+    * The y-size of the grid.
+    */
+    int number_nodes_y;
+    /**
+    * The selected nodes of row x have the y indices selected_y[selected_row_offsets[x]] up to (exclusive)
+    * selected_y[selected_row_offsets[x + 1]]. NULL if all nodes are checked. Length: number_nodes_x + 1.
+    */
+    int *selected_row_offsets;
+    /**
+    * The y indices of the selected nodes, sorted by x index. NULL if all nodes are checked.
+    */
+    int *selected_y;
+    /**
+    * The number of ensemble members of the run.
+    */
+    int ensemble_size;
+    /**
+    * The number of values stored per node in the grid of the run, 1 without ensembles.
+    */
+    int ensemble_lanes;
+    /**
+    * Whether each node (and member) rose in its last change, at ((x * number_nodes_y) + y) * ensemble_size + member.
+    * NULL if peaks are not recorded.
+    */
+    unsigned char *rising;
+    /**
+    * The number of per-thread buffers.
+    */
+    int num_buffers;
+    /**
+    * One buffer per thread. Length: num_buffers.
+    */
+    eventbuffer_t *buffers;
+    /**
+    * All events of the run sorted by tick, x index, y index and member, once recording finished.
+    */
+    nodeevent_t *events;
+    /**
+    * The number of events of the run.
+    */
+    size_t number_events;
+};
+
+/**
+ * Creates a log recording the threshold events of a grid.
+ * @param threshold The threshold of the events.
+ * @param peaks 1 to record peaks in addition to crossings.
+ * @param number_nodes_x The x-size of the grid.
+ * @param number_nodes_y The y-size of the grid.
+ * @param number_selected The number of selected nodes, 0 to check all nodes.
+ * @param selected_x The x indices of the selected nodes. Length: number_selected.
+ * @param selected_y The y indices of the selected nodes. Length: number_selected.
+ * @return The log, or NULL if a selected node is outside of the grid.
+ */
+eventlog_t *init_event_log(nodeval_t threshold, int peaks, int number_nodes_x, int number_nodes_y,
+                           int number_selected, const int *selected_x, const int *selected_y);
+
+/**
+ * Frees a log created using init_event_log(), including its events.
+ * @param log The log.
+ */
+void free_event_log(eventlog_t *log);
+
+/**
+ * Prepares a log for recording a run. Events of previous runs are discarded.
+ * @param log The log.
+ * @param num_threads The number of threads recording events, one buffer each.
+ * @param ensemble_size The number of ensemble members of the run, 1 without ensembles.
+ * @param ensemble_lanes The number of values stored per node in the grid of the run, 1 without ensembles.
+ */
+void start_event_recording(eventlog_t *log, int num_threads, int ensemble_size, int ensemble_lanes);
+
+/**
+ * Records the events of a computed row into the buffer of a thread.
+ * @param log The log.
+ * @param buffer The buffer of the thread computing the row.
+ * @param tick_number The computed tick.
+ * @param x The x index of the row.
+ * @param old_row The energy levels of the row before the tick.
+ * @param new_row The energy levels of the row after the tick.
+ */
+void record_row_events(eventlog_t *log, eventbuffer_t *buffer, int tick_number, int x, const nodeval_t *old_row,
+                       const nodeval_t *new_row);
+
+/**
+ * Merges the buffers of all threads into the sorted events of the log after the run.
+ * @param log The log.
+ */
+void finish_event_recording(eventlog_t *log);
+
+/**
+ * Writes the events of a log to a csv file, one event per line.
+ * @param filename The path of the file.
+ * @param log The log.
+ * @return The number of bytes written, 0 if the file could not be created.
+ */
+long events_to_csv(char *filename, const eventlog_t *log);
+
+#endif
@@ -0,0 +1,373 @@
+#include "fastforward.h"
+#include "kernels.h"
+#include "nodefunc.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define PI 3.14159265358979323846
+
+// number of lines transformed together by one pass
+#define FAST_FORWARD_BATCH 32
+
+// estimated costs in multiply-adds of the direct method (see kernel_node_cost()), calibrated on x86-64: the node
+// process of a simulated tick, a value of one pass of the transforms (including copying the lines), one squaring step
+// of a mode's matrix power, advancing a mode by one tick while reconstructing observations and adding it to one
+// observation
+#define FAST_FORWARD_COST_PROCESS 8.0
+#define FAST_FORWARD_COST_TRANSFORM 10.0
+#define FAST_FORWARD_COST_POWER 20.0
+#define FAST_FORWARD_COST_MODE_TICK 9.0
+#define FAST_FORWARD_COST_OBSERVATION 4.0
+
+// the eigenvalue of a neighbor offset along one axis for the sine mode with the given angle: shifting by +1 and -1
+// together scales the mode by 2 * cos(angle), each shift contributes half of it
+static nodeval_t axis_factor(int offset, nodeval_t cosine) {
+    return offset == 0 ? 1 : cosine;
+}
+
+// the sum of a neighborhood for sine mode (p, q), in units of the mode's energy level
+static nodeval_t neighborhood_eigenvalue(int number_neighbors, const kernelneighbor_t *neighbors, nodeval_t cosine_x,
+                                         nodeval_t cosine_y) {
+    nodeval_t sum = 0;
+    for (int k = 0; k < number_neighbors; k++) {
+        sum += neighbors[k].weight * axis_factor(neighbors[k].x, cosine_x) * axis_factor(neighbors[k].y, cosine_y);
+    }
+    return sum;
+}
+
+static void init_mode_matrices(fastforward_t *fast_forward, const kernel_t *kernel,
+                               const modelparameters_t *parameters) {
+    modelcoefficients_t coefficients;
+    init_model_coefficients(&coefficients, parameters, kernel->number_d_neighbors, kernel->number_id_neighbors);
+    int number_nodes_x = fast_forward->number_nodes_x;
+    int number_nodes_y = fast_forward->number_nodes_y;
+    for (int p = 0; p < number_nodes_x; p++) {
+        nodeval_t cosine_x = cos(PI * (p + 1) / (number_nodes_x + 1));
+        for (int q = 0; q < number_nodes_y; q++) {
+            nodeval_t cosine_y = cos(PI * (q + 1) / (number_nodes_y + 1));
+            // slope_new = slope * slope + c * act, act_new = energy_weight * act + slope_weight * slope_new
+            nodeval_t c = coefficients.d * neighborhood_eigenvalue(kernel->number_d_neighbors, kernel->d_neighbors,
+                                                                   cosine_x, cosine_y)
+                          + coefficients.id * neighborhood_eigenvalue(kernel->number_id_neighbors,
+                                                                      kernel->id_neighbors, cosine_x, cosine_y)
+                          + coefficients.act;
+            size_t mode = (size_t) p * number_nodes_y + q;
+            fast_forward->slope_act[mode] = c;
+            fast_forward->slope_slope[mode] = coefficients.slope;
+            fast_forward->act_act[mode] = coefficients.energy_weight + coefficients.slope_weight * c;
+            fast_forward->act_slope[mode] = coefficients.slope_weight * coefficients.slope;
+        }
+    }
+}
+
+// whether no input is added in the tick
+static int is_input_free(int tick_number, int number_inputs, const nodeinputseries_t *inputs,
+                         const inputplane_t *input_plane) {
+    for (int k = 0; k < number_inputs; k++) {
+        if (inputs[k].timeseries[tick_number % inputs[k].timeseries_ticks] != 0) {
+            return 0;
+        }
+    }
+    if (input_plane != NULL) {
+        for (int c = 0; c < input_plane->number_classes; c++) {
+            if (input_plane->class_series[c][tick_number % input_plane->period_ticks] != 0) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// the cost of the DST-I of lines of the given length, computed as transforms of length
+// 2 * (length + 1), which take two transforms of a power of 2 of at least twice that length unless it is one itself
+static double sine_transform_cost(int number_lines, int length) {
+    int size = 2 * (length + 1);
+    int number_transforms = 1;
+    if ((size & (size - 1)) != 0) {
+        size = 2 * size - 1;
+        number_transforms = 2;
+    }
+    int log2_size = 0;
+    while ((1 << log2_size) < size) {
+        log2_size++;
+    }
+    return FAST_FORWARD_COST_TRANSFORM * number_lines * number_transforms * (double) (1 << log2_size) * log2_size;
+}
+
+int fast_forward_min_ticks(const kernel_t *kernel, int number_nodes_x, int number_nodes_y, int num_ticks,
+                           int num_observationnodes) {
+    double number_modes = (double) number_nodes_x * number_nodes_y;
+    double step_cost = number_modes * (kernel_node_cost(kernel, number_nodes_x, number_nodes_y)
+                                       + FAST_FORWARD_COST_PROCESS);
+    // reconstructing the observations steps every mode through every skipped tick
+    double tick_cost = num_observationnodes > 0
+                       ? number_modes * (FAST_FORWARD_COST_MODE_TICK
+                                         + num_observationnodes * FAST_FORWARD_COST_OBSERVATION)
+                       : 0;
+    if (tick_cost >= step_cost) {
+        return 0;
+    }
+    // two 2D transforms and the matrix powers of the longest possible interval
+    int log2_ticks = 0;
+    while ((1 << log2_ticks) < num_ticks) {
+        log2_ticks++;
+    }
+    double fixed_cost = 2 * (sine_transform_cost(number_nodes_x, number_nodes_y)
+                             + sine_transform_cost(number_nodes_y, number_nodes_x))
+                        + number_modes * FAST_FORWARD_COST_POWER * log2_ticks;
+    double min_ticks = ceil(fixed_cost / (step_cost - tick_cost));
+    if (min_ticks > num_ticks) {
+        return 0;
+    }
+    return min_ticks > FAST_FORWARD_MIN_TICKS ? (int) min_ticks : FAST_FORWARD_MIN_TICKS;
+}
+
+fastforward_t *init_fast_forward(const kernel_t *kernel, const modelparameters_t *parameters, int number_nodes_x,
+                                 int number_nodes_y, int num_ticks, int number_inputs,
+                                 const nodeinputseries_t *inputs, const inputplane_t *input_plane, int min_ticks,
+                                 int num_observationnodes, const nodetimeseries_t *observationnodes) {
+    int *interval_end = malloc(num_ticks * sizeof(int));
+    int longest = 0;
+    int end = num_ticks;
+    for (int tick = num_ticks - 1; tick >= 0; tick--) {
+        if (!is_input_free(tick, number_inputs, inputs, input_plane)) {
+            end = tick;
+        }
+        interval_end[tick] = end;
+        longest = end - tick > longest ? end - tick : longest;
+    }
+    if (longest < min_ticks) {
+        free(interval_end);
+        return NULL;
+    }
+    fastforward_t *fast_forward = malloc(sizeof(fastforward_t));
+    fast_forward->number_nodes_x = number_nodes_x;
+    fast_forward->number_nodes_y = number_nodes_y;
+    fast_forward->interval_end = interval_end;
+    fast_forward->min_ticks = min_ticks;
+    // a DST-I of length n is the imaginary part of the transform of the odd extension of length 2 * (n + 1)
+    init_dft_plan(&fast_forward->plan_x, 2 * (number_nodes_x + 1));
+    init_dft_plan(&fast_forward->plan_y, 2 * (number_nodes_y + 1));
+    size_t number_modes = (size_t) number_nodes_x * number_nodes_y;
+    fast_forward->act_act = malloc(number_modes * sizeof(nodeval_t));
+    fast_forward->act_slope = malloc(number_modes * sizeof(nodeval_t));
+    fast_forward->slope_act = malloc(number_modes * sizeof(nodeval_t));
+    fast_forward->slope_slope = malloc(number_modes * sizeof(nodeval_t));
+    fast_forward->act_modes = malloc(number_modes * sizeof(nodeval_t));
+    fast_forward->slope_modes = malloc(number_modes * sizeof(nodeval_t));
+    init_mode_matrices(fast_forward, kernel, parameters);
+    // the sines of each mode at the observation nodes, including the scaling of the inverse transform
+    fast_forward->num_observationnodes = num_observationnodes;
+    fast_forward->weights_x = malloc((size_t) num_observationnodes * number_nodes_x * sizeof(nodeval_t));
+    fast_forward->weights_y = malloc((size_t) num_observationnodes * number_nodes_y * sizeof(nodeval_t));
+    for (int o = 0; o < num_observationnodes; o++) {
+        for (int p = 0; p < number_nodes_x; p++) {
+            fast_forward->weights_x[(size_t) o * number_nodes_x + p] = 2.0 / (number_nodes_x + 1)
+                    * sin(PI * (p + 1) * (observationnodes[o].x_index + 1) / (number_nodes_x + 1));
+        }
+        for (int q = 0; q < number_nodes_y; q++) {
+            fast_forward->weights_y[(size_t) o * number_nodes_y + q] = 2.0 / (number_nodes_y + 1)
+                    * sin(PI * (q + 1) * (observationnodes[o].y_index + 1) / (number_nodes_y + 1));
+        }
+    }
+    return fast_forward;
+}
+
+void free_fast_forward(fastforward_t *fast_forward) {
+    free(fast_forward->interval_end);
+    free_dft_plan(&fast_forward->plan_x);
+    free_dft_plan(&fast_forward->plan_y);
+    free(fast_forward->act_act);
+    free(fast_forward->act_slope);
+    free(fast_forward->slope_act);
+    free(fast_forward->slope_slope);
+    free(fast_forward->act_modes);
+    free(fast_forward->slope_modes);
+    free(fast_forward->weights_x);
+    free(fast_forward->weights_y);
+    free(fast_forward);
+}
+
+int fast_forward_end(const fastforward_t *fast_forward, int tick_number) {
+    int end = fast_forward->interval_end[tick_number];
+    return end - tick_number >= fast_forward->min_ticks ? end : tick_number;
+}
+
+// applies the (unscaled) DST-I along one axis to lines of the energy levels and slopes in place, element k of line l
+// at [l * line_stride + k * index_stride]
+// both are transformed together as real and imaginary part of the odd extensions
+static void sine_transform_lines(const dftplan_t *plan, nodeval_t *act, nodeval_t *slope, int number_lines,
+                                 size_t line_stride, int length, size_t index_stride) {
+    size_t buffer_size = (size_t) plan->plan.size * FAST_FORWARD_BATCH;
+    nodeval_t *re = malloc(buffer_size * sizeof(nodeval_t));
+    nodeval_t *im = malloc(buffer_size * sizeof(nodeval_t));
+    for (int first_line = 0; first_line < number_lines; first_line += FAST_FORWARD_BATCH) {
+        int width = number_lines - first_line < FAST_FORWARD_BATCH ? number_lines - first_line : FAST_FORWARD_BATCH;
+        // x_0 = x_(n + 1) = 0, x_(2n + 2 - k) = -x_k
+        for (int c = 0; c < width; c++) {
+            re[c] = 0;
+            im[c] = 0;
+            re[(size_t) (length + 1) * width + c] = 0;
+            im[(size_t) (length + 1) * width + c] = 0;
+        }
+        for (int k = 1; k <= length; k++) {
+            for (int c = 0; c < width; c++) {
+                size_t index = (size_t) (first_line + c) * line_stride + (k - 1) * index_stride;
+                re[(size_t) k * width + c] = act[index];
+                im[(size_t) k * width + c] = slope[index];
+                re[(size_t) (2 * length + 2 - k) * width + c] = -act[index];
+                im[(size_t) (2 * length + 2 - k) * width + c] = -slope[index];
+            }
+        }
+        dft_columns(plan, re, im, width);
+        // the transform of the odd extension of x is -2i times its DST-I, act is real, slope imaginary
+        for (int k = 1; k <= length; k++) {
+            for (int c = 0; c < width; c++) {
+                size_t index = (size_t) (first_line + c) * line_stride + (k - 1) * index_stride;
+                act[index] = -0.5 * im[(size_t) k * width + c];
+                slope[index] = 0.5 * re[(size_t) k * width + c];
+            }
+        }
+    }
+    free(re);
+    free(im);
+}
+
+// multiplies the mode's energy level and slope with the ticks-th power of its matrix
+static void power_mode(const fastforward_t *fast_forward, size_t mode, int ticks, nodeval_t *act, nodeval_t *slope) {
+    nodeval_t m_aa = fast_forward->act_act[mode];
+    nodeval_t m_as = fast_forward->act_slope[mode];
+    nodeval_t m_sa = fast_forward->slope_act[mode];
+    nodeval_t m_ss = fast_forward->slope_slope[mode];
+    nodeval_t a = *act;
+    nodeval_t s = *slope;
+    // square and multiply
+    while (ticks > 0) {
+        if (ticks & 1) {
+            nodeval_t new_a = m_aa * a + m_as * s;
+            s = m_sa * a + m_ss * s;
+            a = new_a;
+        }
+        ticks >>= 1;
+        if (ticks > 0) {
+            nodeval_t aa = m_aa * m_aa + m_as * m_sa;
+            nodeval_t as = m_aa * m_as + m_as * m_ss;
+            nodeval_t sa = m_sa * m_aa + m_ss * m_sa;
+            nodeval_t ss = m_sa * m_as + m_ss * m_ss;
+            m_aa = aa;
+            m_as = as;
+            m_sa = sa;
+            m_ss = ss;
+        }
+    }
+    *act = a;
+    *slope = s;
+}
+
+// the partial sum of a row of modes weighted with an observation node's sines along y, with independent partial sums
+// so that consecutive multiply-adds do not wait for each other
+static nodeval_t weighted_row_sum(const nodeval_t *weights, const nodeval_t *act, int length) {
+    nodeval_t sums[4] = {0, 0, 0, 0};
+    int q = 0;
+    for (; q + 4 <= length; q += 4) {
+        sums[0] += weights[q] * act[q];
+        sums[1] += weights[q + 1] * act[q + 1];
+        sums[2] += weights[q + 2] * act[q + 2];
+        sums[3] += weights[q + 3] * act[q + 3];
+    }
+    for (; q < length; q++) {
+        sums[0] += weights[q] * act[q];
+    }
+    return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+
+void fast_forward_load_rows(fastforward_t *fast_forward, nodeval_t **state, nodeval_t **slopes, int first_x,
+                            int end_x) {
+    int number_nodes_y = fast_forward->number_nodes_y;
+    for (int x = first_x; x < end_x; x++) {
+        memcpy(fast_forward->act_modes + (size_t) x * number_nodes_y, state[x], number_nodes_y * sizeof(nodeval_t));
+        memcpy(fast_forward->slope_modes + (size_t) x * number_nodes_y, slopes[x], number_nodes_y * sizeof(nodeval_t));
+    }
+    size_t first = (size_t) first_x * number_nodes_y;
+    sine_transform_lines(&fast_forward->plan_y, fast_forward->act_modes + first, fast_forward->slope_modes + first,
+                         end_x - first_x, number_nodes_y, number_nodes_y, 1);
+}
+
+void fast_forward_transform_columns(fastforward_t *fast_forward, int first_y, int end_y) {
+    sine_transform_lines(&fast_forward->plan_x, fast_forward->act_modes + first_y,
+                         fast_forward->slope_modes + first_y, end_y - first_y, 1, fast_forward->number_nodes_x,
+                         fast_forward->number_nodes_y);
+}
+
+void fast_forward_observe(const fastforward_t *fast_forward, int first, int end, nodetimeseries_t *observationnodes,
+                          int first_tick) {
+    int number_nodes_x = fast_forward->number_nodes_x;
+    int number_nodes_y = fast_forward->number_nodes_y;
+    int num_observationnodes = fast_forward->num_observationnodes;
+    if (first >= end) {
+        return;
+    }
+    for (int o = 0; o < num_observationnodes; o++) {
+        memset(observationnodes[o].timeseries + first_tick + first, 0, (end - first) * sizeof(nodeval_t));
+    }
+    // the modes are only read, each row is copied and advanced to the first tick of the range
+    nodeval_t *act = malloc(number_nodes_y * sizeof(nodeval_t));
+    nodeval_t *slope = malloc(number_nodes_y * sizeof(nodeval_t));
+    // the modes evolve independently, so all ticks are iterated per row of modes while the row is in the cache, and
+    // the row's contributions are added to the observations
+    for (int p = 0; p < number_nodes_x; p++) {
+        size_t row = (size_t) p * number_nodes_y;
+        const nodeval_t *act_act = fast_forward->act_act + row;
+        const nodeval_t *act_slope = fast_forward->act_slope + row;
+        const nodeval_t *slope_act = fast_forward->slope_act + row;
+        const nodeval_t *slope_slope = fast_forward->slope_slope + row;
+        for (int q = 0; q < number_nodes_y; q++) {
+            act[q] = fast_forward->act_modes[row + q];
+            slope[q] = fast_forward->slope_modes[row + q];
+            power_mode(fast_forward, row + q, first, &act[q], &slope[q]);
+        }
+        for (int tick = first; tick < end; tick++) {
+            for (int q = 0; q < number_nodes_y; q++) {
+                nodeval_t new_act = act_act[q] * act[q] + act_slope[q] * slope[q];
+                slope[q] = slope_act[q] * act[q] + slope_slope[q] * slope[q];
+                act[q] = new_act;
+            }
+            for (int o = 0; o < num_observationnodes; o++) {
+                nodeval_t row_sum = weighted_row_sum(fast_forward->weights_y + (size_t) o * number_nodes_y, act,
+                                                     number_nodes_y);
+                nodeval_t weight_x = fast_forward->weights_x[(size_t) o * number_nodes_x + p];
+                observationnodes[o].timeseries[first_tick + tick] += weight_x * row_sum;
+            }
+        }
+    }
+    free(act);
+    free(slope);
+}
+
+void fast_forward_advance_rows(fastforward_t *fast_forward, int ticks, int first_x, int end_x) {
+    size_t end = (size_t) end_x * fast_forward->number_nodes_y;
+    for (size_t mode = (size_t) first_x * fast_forward->number_nodes_y; mode < end; mode++) {
+        power_mode(fast_forward, mode, ticks, &fast_forward->act_modes[mode], &fast_forward->slope_modes[mode]);
+    }
+}
+
+void fast_forward_store_rows(fastforward_t *fast_forward, nodeval_t **state, nodeval_t **slopes, int first_x,
+                             int end_x) {
+    int number_nodes_x = fast_forward->number_nodes_x;
+    int number_nodes_y = fast_forward->number_nodes_y;
+    size_t first = (size_t) first_x * number_nodes_y;
+    sine_transform_lines(&fast_forward->plan_y, fast_forward->act_modes + first, fast_forward->slope_modes + first,
+                         end_x - first_x, number_nodes_y, number_nodes_y, 1);
+    // the DST-I along an axis of length n is its own inverse times (n + 1) / 2
+    nodeval_t scale = 4.0 / ((nodeval_t) (number_nodes_x + 1) * (number_nodes_y + 1));
+    for (int x = first_x; x < end_x; x++) {
+        const nodeval_t *act_row = fast_forward->act_modes + (size_t) x * number_nodes_y;
+        const nodeval_t *slope_row = fast_forward->slope_modes + (size_t) x * number_nodes_y;
+        for (int y = 0; y < number_nodes_y; y++) {
+            state[x][y] = act_row[y] * scale;
+            slopes[x][y] = slope_row[y] * scale;
+        }
+    }
+}
@@ -0,0 +1,208 @@
+#ifndef FASTFORWARD_H
+#define FASTFORWARD_H
+
+#include "definitions.h"
+#include "fft.h"
+
+/**
+ * @file
+ * Spectral fast-forward through ticks without inputs.
+ *
+ * Without inputs, each tick applies the same linear, shift-invariant update to the grid, with zero energy outside of
+ * the grid. For kernels of radius 1, this update is diagonalized by the 2D discrete sine transform (DST-I), which
+ * matches the zero borders exactly: each sine mode (p, q) evolves independently of all others by a 2x2 matrix acting
+ * on its energy level and slope. The state after N ticks is thus computed by transforming the energy levels and
+ * slopes, multiplying each mode with the Nth power of its matrix and transforming back, which costs
+ * O(grid * log grid) instead of O(N * grid).
+ *
+ * The energy levels of the observation nodes inside the skipped ticks are reconstructed from the modes, by iterating
+ * their matrices and summing the modes weighted with their sines at the node. This costs O(grid) per tick and
+ * observation node, so an interval is only fast-forwarded if the estimated cost of the transforms and the
+ * reconstruction is lower than that of simulating its ticks (see fast_forward_min_ticks()). The results equal those
+ * of simulating the ticks up to rounding errors.
+ *
+ * Fast-forwarding is split into steps that the simulation threads execute in turn, each on its own rows, columns or
+ * ticks, waiting for each other between the steps: fast_forward_load_rows(), fast_forward_transform_columns(),
+ * fast_forward_observe() (only with observation nodes), fast_forward_advance_rows(),
+ * fast_forward_transform_columns() and fast_forward_store_rows().
+ */
+
+/**
+ * Value of the fast_forward option fast-forwarding all input-free intervals of at least FAST_FORWARD_MIN_TICKS ticks,
+ * regardless of the estimated costs, e.g., to verify the results.
+ */
+#define FAST_FORWARD_ALWAYS 2
+
+/**
+ * The input-free intervals of a run and the transforms and mode matrices of its grid.
+ */
+struct fastforward {
+    /**
+    * The x-size of the grid.
+    */
+    int number_nodes_x;
+    /**
+    * The y-size of the grid.
+    */
+    int number_nodes_y;
+    /**
+    * The end of the input-free interval starting at each tick, i.e., the first tick at or after it with inputs (or
+    * the number of ticks). Length: number of ticks.
+    */
+    int *interval_end;
+    /**
+    * The minimum length of an interval to be fast-forwarded.
+    */
+    int min_ticks;
+    /**
+    * Transforms of length 2 * (number_nodes_x + 1), computing the DST-I along x.
+    */
+    dftplan_t plan_x;
+    /**
+    * Transforms of length 2 * (number_nodes_y + 1), computing the DST-I along y.
+    */
+    dftplan_t plan_y;
+    /**
+    * The 2x2 matrix of each mode, mode (p, q) at [p * number_nodes_y + q]: new energy level = act_act * energy level
+    * + act_slope * slope, new slope = slope_act * energy level + slope_slope * slope.
+    */
+    nodeval_t *act_act;
+    /**
+    * See act_act.
+    */
+    nodeval_t *act_slope;
+    /**
+    * See act_act.
+    */
+    nodeval_t *slope_act;
+    /**
+    * See act_act.
+    */
+    nodeval_t *slope_slope;
+    /**
+    * The energy levels of the modes, in the same layout.
+    */
+    nodeval_t *act_modes;
+    /**
+    * The slopes of the modes, in the same layout.
+    */
+    nodeval_t *slope_modes;
+    /**
+    * The number of observation nodes to reconstruct the skipped energy levels of.
+    */
+    int num_observationnodes;
+    /**
+    * The sine of each x-mode at each observation node, including the scaling of the inverse transform, x-mode p of
+    * observation node o at [o * number_nodes_x + p].
+    */
+    nodeval_t *weights_x;
+    /**
+    * The sine of each y-mode at each observation node, see weights_x.
+    */
+    nodeval_t *weights_y;
+};
+
+/**
+ * Estimates the minimum length of an input-free interval for fast-forwarding it to cost less than simulating its
+ * ticks.
+ * @param kernel The kernel, must have a radius of 1.
+ * @param number_nodes_x The x-size of the grid.
+ * @param number_nodes_y The y-size of the grid.
+ * @param num_ticks The number of ticks of the run.
+ * @param num_observationnodes The number of observation nodes to reconstruct the skipped energy levels of.
+ * @return The minimum length, at least FAST_FORWARD_MIN_TICKS, or 0 if no interval of the run pays off.
+ */
+int fast_forward_min_ticks(const kernel_t *kernel, int number_nodes_x, int number_nodes_y, int num_ticks,
+                           int num_observationnodes);
+
+/**
+ * Finds the input-free intervals of a run and prepares fast-forwarding through them.
+ * @param kernel The kernel, must have a radius of 1.
+ * @param parameters The uniform model parameters.
+ * @param number_nodes_x The x-size of the grid.
+ * @param number_nodes_y The y-size of the grid.
+ * @param num_ticks The number of ticks of the run.
+ * @param number_inputs The number of sparse inputs.
+ * @param inputs The sparse inputs. Length: number_inputs.
+ * @param input_plane The dense inputs, NULL if there are none.
+ * @param min_ticks The minimum length of the fast-forwarded intervals, e.g., from fast_forward_min_ticks().
+ * @param num_observationnodes The number of observation nodes to reconstruct the skipped energy levels of.
+ * @param observationnodes The observation nodes. Length: num_observationnodes.
+ * @return The fast-forward, or NULL if no input-free interval has at least min_ticks ticks.
+ */
+fastforward_t *init_fast_forward(const kernel_t *kernel, const modelparameters_t *parameters, int number_nodes_x,
+                                 int number_nodes_y, int num_ticks, int number_inputs,
+                                 const nodeinputseries_t *inputs, const inputplane_t *input_plane, int min_ticks,
+                                 int num_observationnodes, const nodetimeseries_t *observationnodes);
+
+/**
+ * Frees a fast-forward created using init_fast_forward().
+ * @param fast_forward The fast-forward.
+ */
+void free_fast_forward(fastforward_t *fast_forward);
+
+/**
+ * Gets the end of the input-free interval starting at a tick, if it is long enough to be fast-forwarded.
+ * @param fast_forward The fast-forward.
+ * @param tick_number The tick.
+ * @return The first tick after the interval, or tick_number if the tick is not fast-forwarded.
+ */
+int fast_forward_end(const fastforward_t *fast_forward, int tick_number);
+
+/**
+ * Copies rows of the energy levels and slopes to the modes and transforms them along y, the first step of
+ * fast-forwarding.
+ * @param fast_forward The fast-forward.
+ * @param state The energy levels. Size number_nodes_x * number_nodes_y.
+ * @param slopes The slopes. Size number_nodes_x * number_nodes_y.
+ * @param first_x The first row.
+ * @param end_x The end of the rows (exclusive).
+ */
+void fast_forward_load_rows(fastforward_t *fast_forward, nodeval_t **state, nodeval_t **slopes, int first_x,
+                            int end_x);
+
+/**
+ * Transforms columns of the modes along x, once all rows are transformed along y (second step) and again once all
+ * modes are advanced (fifth step).
+ * @param fast_forward The fast-forward.
+ * @param first_y The first column.
+ * @param end_y The end of the columns (exclusive).
+ */
+void fast_forward_transform_columns(fastforward_t *fast_forward, int first_y, int end_y);
+
+/**
+ * Reconstructs the energy levels of the observation nodes in a range of the skipped ticks, once all columns are
+ * transformed (third step, only with observation nodes). The modes are not changed.
+ * @param fast_forward The fast-forward.
+ * @param first The first tick of the range, relative to the first skipped tick.
+ * @param end The end of the range (exclusive), at most the number of skipped ticks.
+ * @param observationnodes The observation nodes passed to init_fast_forward(), the energy level after i + 1 ticks is
+ * written to timeseries[first_tick + i].
+ * @param first_tick The first skipped tick.
+ */
+void fast_forward_observe(const fastforward_t *fast_forward, int first, int end, nodetimeseries_t *observationnodes,
+                          int first_tick);
+
+/**
+ * Advances rows of the modes by the skipped ticks, once all columns are transformed and all observations are
+ * reconstructed (fourth step).
+ * @param fast_forward The fast-forward.
+ * @param ticks The number of skipped ticks.
+ * @param first_x The first row.
+ * @param end_x The end of the rows (exclusive).
+ */
+void fast_forward_advance_rows(fastforward_t *fast_forward, int ticks, int first_x, int end_x);
+
+/**
+ * Transforms rows of the modes back along y and stores them as energy levels and slopes, once all columns are
+ * transformed back (last step).
+ * @param fast_forward The fast-forward.
+ * @param state The energy levels. Size number_nodes_x * number_nodes_y.
+ * @param slopes The slopes. Size number_nodes_x * number_nodes_y.
+ * @param first_x The first row.
+ * @param end_x The end of the rows (exclusive).
+ */
+void fast_forward_store_rows(fastforward_t *fast_forward, nodeval_t **state, nodeval_t **slopes, int first_x,
+                             int end_x);
+
+#endif
@@ -0,0 +1,184 @@
+#include "fft.h"
+
+#include <stdlib.h>
+#include <math.h>
+
+#define PI 3.14159265358979323846
+
+void init_fft_plan(fftplan_t *plan, int size) {
+    plan->size = size;
+    plan->twiddle_re = malloc((size / 2 + 1) * sizeof(nodeval_t));
+    plan->twiddle_im = malloc((size / 2 + 1) * sizeof(nodeval_t));
+    for (int k = 0; k < size / 2; k++) {
+        plan->twiddle_re[k] = cos(2 * PI * k / size);
+        plan->twiddle_im[k] = -sin(2 * PI * k / size);
+    }
+    plan->bit_reverse = malloc(size * sizeof(int));
+    int bits = 0;
+    while ((1 << bits) < size) {
+        bits++;
+    }
+    for (int i = 0; i < size; i++) {
+        int reversed = 0;
+        for (int bit = 0; bit < bits; bit++) {
+            if (i & (1 << bit)) {
+                reversed |= 1 << (bits - 1 - bit);
+            }
+        }
+        plan->bit_reverse[i] = reversed;
+    }
+}
+
+void free_fft_plan(fftplan_t *plan) {
+    free(plan->twiddle_re);
+    free(plan->twiddle_im);
+    free(plan->bit_reverse);
+}
+
+static void swap_rows(nodeval_t *values, int a, int b, int width) {
+    nodeval_t *row_a = values + (size_t) a * width;
+    nodeval_t *row_b = values + (size_t) b * width;
+    for (int c = 0; c < width; c++) {
+        nodeval_t tmp = row_a[c];
+        row_a[c] = row_b[c];
+        row_b[c] = tmp;
+    }
+}
+
+void fft_columns(const fftplan_t *plan, nodeval_t *re, nodeval_t *im, int width, int inverse) {
+    int size = plan->size;
+    for (int i = 0; i < size; i++) {
+        int j = plan->bit_reverse[i];
+        if (i < j) {
+            swap_rows(re, i, j, width);
+            swap_rows(im, i, j, width);
+        }
+    }
+    // iterative Cooley-Tukey butterflies, each butterfly combines two whole rows
+    for (int half = 1; half < size; half *= 2) {
+        int step = size / (2 * half);
+        for (int start = 0; start < size; start += 2 * half) {
+            for (int k = 0; k < half; k++) {
+                nodeval_t w_re = plan->twiddle_re[k * step];
+                nodeval_t w_im = inverse ? -plan->twiddle_im[k * step] : plan->twiddle_im[k * step];
+                nodeval_t *a_re = re + (size_t) (start + k) * width;
+                nodeval_t *a_im = im + (size_t) (start + k) * width;
+                nodeval_t *b_re = re + (size_t) (start + k + half) * width;
+                nodeval_t *b_im = im + (size_t) (start + k + half) * width;
+                for (int c = 0; c < width; c++) {
+                    nodeval_t t_re = w_re * b_re[c] - w_im * b_im[c];
+                    nodeval_t t_im = w_re * b_im[c] + w_im * b_re[c];
+                    b_re[c] = a_re[c] - t_re;
+                    b_im[c] = a_im[c] - t_im;
+                    a_re[c] = a_re[c] + t_re;
+                    a_im[c] = a_im[c] + t_im;
+                }
+            }
+        }
+    }
+}
+
+// transposes in blocks, so that both arrays are accessed in cache-sized pieces
+static void transpose(const nodeval_t *values, nodeval_t *result, int size) {
+    const int block = 16;
+    for (int i0 = 0; i0 < size; i0 += block) {
+        for (int j0 = 0; j0 < size; j0 += block) {
+            int i_end = i0 + block < size ? i0 + block : size;
+            int j_end = j0 + block < size ? j0 + block : size;
+            for (int i = i0; i < i_end; i++) {
+                for (int j = j0; j < j_end; j++) {
+                    result[(size_t) j * size + i] = values[(size_t) i * size + j];
+                }
+            }
+        }
+    }
+}
+
+void fft_2d_transposed(const fftplan_t *plan, nodeval_t *re, nodeval_t *im, nodeval_t *result_re,
+                       nodeval_t *result_im, int inverse) {
+    // transforming the columns, transposing and transforming the columns again transforms both dimensions
+    fft_columns(plan, re, im, plan->size, inverse);
+    transpose(re, result_re, plan->size);
+    transpose(im, result_im, plan->size);
+    fft_columns(plan, result_re, result_im, plan->size, inverse);
+}
+
+void init_dft_plan(dftplan_t *plan, int length) {
+    plan->length = length;
+    plan->chirp_re = NULL;
+    plan->chirp_im = NULL;
+    plan->filter_re = NULL;
+    plan->filter_im = NULL;
+    if ((length & (length - 1)) == 0) {
+        init_fft_plan(&plan->plan, length);
+        return;
+    }
+    int size = 1;
+    while (size < 2 * length - 1) {
+        size *= 2;
+    }
+    init_fft_plan(&plan->plan, size);
+    plan->chirp_re = malloc(length * sizeof(nodeval_t));
+    plan->chirp_im = malloc(length * sizeof(nodeval_t));
+    for (int k = 0; k < length; k++) {
+        // k^2 modulo 2 * length keeps the angle small and thus exact
+        long long square = (long long) k * k % (2LL * length);
+        plan->chirp_re[k] = cos(PI * square / length);
+        plan->chirp_im[k] = -sin(PI * square / length);
+    }
+    // the conjugate chirp at offsets -length < m < length, wrapped around
+    plan->filter_re = calloc(size, sizeof(nodeval_t));
+    plan->filter_im = calloc(size, sizeof(nodeval_t));
+    for (int k = 0; k < length; k++) {
+        plan->filter_re[k] = plan->chirp_re[k];
+        plan->filter_im[k] = -plan->chirp_im[k];
+        if (k > 0) {
+            plan->filter_re[size - k] = plan->chirp_re[k];
+            plan->filter_im[size - k] = -plan->chirp_im[k];
+        }
+    }
+    fft_columns(&plan->plan, plan->filter_re, plan->filter_im, 1, 0);
+}
+
+void free_dft_plan(dftplan_t *plan) {
+    free_fft_plan(&plan->plan);
+    free(plan->chirp_re);
+    free(plan->chirp_im);
+    free(plan->filter_re);
+    free(plan->filter_im);
+}
+
+// multiplies each row of a size * width array with a complex factor per row
+static void multiply_rows(nodeval_t *re, nodeval_t *im, const nodeval_t *factor_re, const nodeval_t *factor_im,
+                          int size, int width, nodeval_t scale) {
+    for (int k = 0; k < size; k++) {
+        nodeval_t f_re = factor_re[k] * scale;
+        nodeval_t f_im = factor_im[k] * scale;
+        nodeval_t *row_re = re + (size_t) k * width;
+        nodeval_t *row_im = im + (size_t) k * width;
+        for (int c = 0; c < width; c++) {
+            nodeval_t value_re = row_re[c];
+            row_re[c] = value_re * f_re - row_im[c] * f_im;
+            row_im[c] = value_re * f_im + row_im[c] * f_re;
+        }
+    }
+}
+
+void dft_columns(const dftplan_t *plan, nodeval_t *re, nodeval_t *im, int width) {
+    if (plan->chirp_re == NULL) {
+        fft_columns(&plan->plan, re, im, width, 0);
+        return;
+    }
+    int length = plan->length;
+    int size = plan->plan.size;
+    // X_k = chirp_k * sum_j (x_j * chirp_j) * conj(chirp_(k - j))
+    multiply_rows(re, im, plan->chirp_re, plan->chirp_im, length, width, 1);
+    for (size_t k = (size_t) length * width; k < (size_t) size * width; k++) {
+        re[k] = 0;
+        im[k] = 0;
+    }
+    fft_columns(&plan->plan, re, im, width, 0);
+    multiply_rows(re, im, plan->filter_re, plan->filter_im, size, width, 1);
+    fft_columns(&plan->plan, re, im, width, 1);
+    multiply_rows(re, im, plan->chirp_re, plan->chirp_im, length, width, 1.0 / size);
+}
@@ -0,0 +1,133 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include "definitions.h"
+
+/**
+ * @file
+ * Radix-2 fast fourier transforms and transforms of any length built on them, used for the convolution of large
+ * kernels (see kernels.h), of impulse responses (see superposition.h) and for the spectral fast-forward (see
+ * fastforward.h).
+ *
+ * Complex values are stored as separate arrays of real and imaginary parts. 2D transforms operate on square arrays
+ * stored row by row. All rows (or columns) are transformed together, so that the innermost loops run over contiguous
+ * memory.
+ */
+
+/**
+ * Precomputed twiddle factors and bit reversal permutation for transforms of one size.
+ */
+typedef struct {
+    /**
+    * The size of the transforms, a power of 2.
+    */
+    int size;
+    /**
+    * Real parts of exp(-2 * pi * i * k / size), 0 <= k < size / 2.
+    */
+    nodeval_t *twiddle_re;
+    /**
+    * Imaginary parts of exp(-2 * pi * i * k / size), 0 <= k < size / 2.
+    */
+    nodeval_t *twiddle_im;
+    /**
+    * Bit reversal permutation of the indices. Length: size.
+    */
+    int *bit_reverse;
+}
+        fftplan_t;
+
+/**
+ * Initializes a plan for transforms of the given size.
+ * @param plan The plan to initialize.
+ * @param size The size of the transforms. Must be a power of 2.
+ */
+void init_fft_plan(fftplan_t *plan, int size);
+
+/**
+ * Frees a plan.
+ * @param plan The plan initialized with init_fft_plan().
+ */
+void free_fft_plan(fftplan_t *plan);
+
+/**
+ * Transforms all columns of a size * width array in place, i.e., element (i, c) at [i * width + c] belongs to column
+ * c. The inverse transform is not scaled.
+ * @param plan The plan of the column length.
+ * @param re The real parts.
+ * @param im The imaginary parts.
+ * @param width The number of columns.
+ * @param inverse 1 for the inverse transform, 0 for the forward transform.
+ */
+void fft_columns(const fftplan_t *plan, nodeval_t *re, nodeval_t *im, int width, int inverse);
+
+/**
+ * Transforms a size * size array in two dimensions and writes the result transposed, i.e., the result of element
+ * (i, j) is written to [j * size + i]. Transforming the transposed result with inverse = 1 restores the original
+ * orientation. The inverse transform is not scaled.
+ * @param plan The plan of the size.
+ * @param re The real parts of the input, overwritten.
+ * @param im The imaginary parts of the input, overwritten.
+ * @param result_re The real parts of the transposed result.
+ * @param result_im The imaginary parts of the transposed result.
+ * @param inverse 1 for the inverse transform, 0 for the forward transform.
+ */
+void fft_2d_transposed(const fftplan_t *plan, nodeval_t *re, nodeval_t *im, nodeval_t *result_re,
+                       nodeval_t *result_im, int inverse);
+
+/**
+ * Plan for forward transforms of any length. Lengths other than powers of 2 are computed as convolution with a chirp
+ * using transforms of the next power of 2 of at least twice the length (Bluestein's algorithm).
+ */
+typedef struct {
+    /**
+    * The length of the transforms.
+    */
+    int length;
+    /**
+    * The plan of the power of 2 transforms.
+    */
+    fftplan_t plan;
+    /**
+    * Real parts of the chirp exp(-pi * i * k^2 / length), 0 <= k < length. NULL if length is a power of 2.
+    */
+    nodeval_t *chirp_re;
+    /**
+    * Imaginary parts of the chirp. NULL if length is a power of 2.
+    */
+    nodeval_t *chirp_im;
+    /**
+    * Real parts of the transformed conjugate chirp, the filter of the convolution. Length: plan.size.
+    */
+    nodeval_t *filter_re;
+    /**
+    * Imaginary parts of the transformed conjugate chirp.
+    */
+    nodeval_t *filter_im;
+}
+        dftplan_t;
+
+/**
+ * Initializes a plan for transforms of the given length.
+ * @param plan The plan to initialize.
+ * @param length The length of the transforms.
+ */
+void init_dft_plan(dftplan_t *plan, int length);
+
+/**
+ * Frees a plan.
+ * @param plan The plan initialized with init_dft_plan().
+ */
+void free_dft_plan(dftplan_t *plan);
+
+/**
+ * Transforms all columns of a length * width array in place (forward transform), like fft_columns().
+ * @param plan The plan of the column length.
+ * @param re The real parts. Must have room for plan->plan.size * width values, the values after the first
+ * length * width are overwritten.
+ * @param im The imaginary parts, of the same size.
+ * @param width The number of columns.
+ */
+void dft_columns(const dftplan_t *plan, nodeval_t *re, nodeval_t *im, int width);
+
+#endif
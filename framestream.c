@@ -0,0 +1,303 @@
+#include "framestream.h"
+#include "brainsetup.h"
+#include "utils.h"
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#define FRAMESTREAM_HEADER_SIZE 16
+
+static uint32_t read_uint32_le(const uint8_t *bytes) {
+    return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+static void init_frame_buffer(framebuffer_t *buffer, size_t number_nodes, int num_frequencies,
+                              int frame_duration_ticks) {
+    buffer->node_frequency = calloc(number_nodes, sizeof(uint16_t));
+    buffer->frequency_series = malloc((size_t) num_frequencies * frame_duration_ticks * sizeof(nodeval_t));
+    buffer->frequency_used = calloc(num_frequencies, sizeof(unsigned char));
+    buffer->has_frame = 0;
+}
+
+static void free_frame_buffer(framebuffer_t *buffer) {
+    free(buffer->node_frequency);
+    free(buffer->frequency_series);
+    free(buffer->frequency_used);
+}
+
+// reads up to size bytes of the stream, returns 0 at the end of the stream or when the stream is closed
+static size_t read_stream(framestream_t *stream, uint8_t *target, size_t size) {
+#ifdef _WIN32
+    // a blocking read is cancelled by close_frame_stream()
+    return fread(target, 1, size, stream->file);
+#else
+    // waits for the file and the stop pipe, so that closing the stream never waits for a writer that stalls
+    struct pollfd descriptors[2];
+    descriptors[0].fd = fileno(stream->file);
+    descriptors[0].events = POLLIN;
+    descriptors[1].fd = stream->stop_pipe[0];
+    descriptors[1].events = POLLIN;
+    while (1) {
+        if (poll(descriptors, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 0;
+        }
+        if (descriptors[1].revents != 0) {
+            return 0;
+        }
+        ssize_t read_result = read(descriptors[0].fd, target, size);
+        if (read_result < 0 && (errno == EINTR || errno == EAGAIN)) {
+            continue;
+        }
+        return read_result > 0 ? (size_t) read_result : 0;
+    }
+#endif
+}
+
+// reads the next raw frame and decodes it into the buffer, marks the buffer as empty at the end of the stream
+static void decode_next_frame(framestream_t *stream, framebuffer_t *buffer) {
+    size_t frame_size = (size_t) stream->frame_width * stream->frame_height * stream->channels;
+    size_t read = 0;
+    while (read < frame_size) {
+        size_t read_result = read_stream(stream, stream->raw_frame + read, frame_size - read);
+        if (read_result == 0) {
+            break;
+        }
+        read += read_result;
+    }
+    if (read < frame_size) {
+        lock_thread_mutex(&stream->mutex);
+        int stopped = stream->stop;
+        unlock_thread_mutex(&stream->mutex);
+        if (read > 0 && !stopped) {
+            printf("WARNING: Incomplete frame at the end of the frame stream is ignored.\n");
+        }
+        buffer->has_frame = 0;
+        return;
+    }
+    int lowest_freq = stream->min_freq < stream->max_freq ? stream->min_freq : stream->max_freq;
+    int num_frequencies = abs(stream->max_freq - stream->min_freq) + 1;
+    int width = stream->frame_width < stream->number_nodes_x ? stream->frame_width : stream->number_nodes_x;
+    int height = stream->frame_height < stream->number_nodes_y ? stream->frame_height : stream->number_nodes_y;
+    memset(buffer->frequency_used, 0, num_frequencies * sizeof(unsigned char));
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const uint8_t *pixel = stream->raw_frame + ((size_t) y * stream->frame_width + x) * stream->channels;
+            int value = 0;
+            for (int channel = 0; channel < stream->channels; channel++) {
+                value += pixel[channel];
+            }
+            if (stream->channels == 1) {
+                value *= 3;
+            }
+            uint16_t frequency_class = 0;
+            if (value != 0) {
+                //same linear interpolation as for bitmaps
+                int frequency = stream->min_freq + (stream->max_freq - stream->min_freq) * (value - 1) / 764;
+                frequency_class = frequency - lowest_freq + 1;
+                buffer->frequency_used[frequency_class - 1] = 1;
+            }
+            buffer->node_frequency[(size_t) x * stream->number_nodes_y + y] = frequency_class;
+        }
+    }
+    for (int i = 0; i < num_frequencies; i++) {
+        if (buffer->frequency_used[i]) {
+            nodeval_t *series = generate_sin_time_series(lowest_freq + i, stream->tick_ms,
+                                                         stream->frame_duration_ticks);
+            memcpy(buffer->frequency_series + (size_t) i * stream->frame_duration_ticks, series,
+                   stream->frame_duration_ticks * sizeof(nodeval_t));
+            free(series);
+        }
+    }
+    buffer->has_frame = 1;
+    stream->frames_read++;
+}
+
+static unsigned int read_frames(void *argument) {
+    framestream_t *stream = argument;
+    while (1) {
+        lock_thread_mutex(&stream->mutex);
+        while (stream->back_ready && !stream->stop) {
+            wait_thread_condition(&stream->condition, &stream->mutex);
+        }
+        if (stream->stop) {
+            unlock_thread_mutex(&stream->mutex);
+            return 0;
+        }
+        // the buffers may be swapped as soon as back_ready is set, keep the buffer being decoded
+        framebuffer_t *buffer = stream->back;
+        tracebuffer_t *trace = stream->trace;
+        unlock_thread_mutex(&stream->mutex);
+
+        // decode without holding the lock, the simulation only uses the front buffer in the meantime
+        uint64_t trace_begin = trace != NULL ? trace_clock_ns() : 0;
+        decode_next_frame(stream, buffer);
+        if (trace != NULL) {
+            record_trace_event(trace, TRACE_READ_FRAME, -1, trace_begin, trace_clock_ns());
+        }
+        int has_frame = buffer->has_frame;
+
+        lock_thread_mutex(&stream->mutex);
+        stream->back_ready = 1;
+        broadcast_thread_condition(&stream->condition);
+        unlock_thread_mutex(&stream->mutex);
+        if (!has_frame) {
+            return 0;
+        }
+    }
+}
+
+framestream_t *open_frame_stream(const char *path, int number_nodes_x, int number_nodes_y,
+                                 int min_freq, int max_freq, int frame_duration_ticks, double tick_ms) {
+    FILE *file;
+    int close_file = 1;
+    if (strcmp(path, "-") == 0) {
+        file = stdin;
+        close_file = 0;
+    } else {
+        file = fopen(path, "rb");
+    }
+    if (file == NULL) {
+        printf("ERROR: Could not open frame stream: %s\n", path);
+        return NULL;
+    }
+#ifndef _WIN32
+    // the frames are read from the file descriptor, nothing after the header may end up in the buffer of the file
+    setvbuf(file, NULL, _IONBF, 0);
+#endif
+    uint8_t header[FRAMESTREAM_HEADER_SIZE];
+    if (fread(header, 1, FRAMESTREAM_HEADER_SIZE, file) != FRAMESTREAM_HEADER_SIZE
+        || memcmp(header, FRAMESTREAM_MAGIC, 4) != 0) {
+        printf("ERROR: Not a frame stream (header missing): %s\n", path);
+        if (close_file) {
+            fclose(file);
+        }
+        return NULL;
+    }
+    uint32_t frame_width = read_uint32_le(header + 4);
+    uint32_t frame_height = read_uint32_le(header + 8);
+    uint32_t channels = read_uint32_le(header + 12);
+    int num_frequencies = abs(max_freq - min_freq) + 1;
+    if (frame_width == 0 || frame_height == 0 || (channels != 1 && channels != 3)
+        || frame_duration_ticks < 1 || num_frequencies > UINT16_MAX) {
+        printf("ERROR: Unsupported frame stream (%u x %u pixels, %u channels, %d ticks per frame, %d frequencies): %s\n",
+               frame_width, frame_height, channels, frame_duration_ticks, num_frequencies, path);
+        if (close_file) {
+            fclose(file);
+        }
+        return NULL;
+    }
+
+    framestream_t *stream = malloc(sizeof(framestream_t));
+    stream->file = file;
+    stream->close_file = close_file;
+    stream->frame_width = frame_width;
+    stream->frame_height = frame_height;
+    stream->channels = channels;
+    stream->number_nodes_x = number_nodes_x;
+    stream->number_nodes_y = number_nodes_y;
+    stream->min_freq = min_freq;
+    stream->max_freq = max_freq;
+    stream->frame_duration_ticks = frame_duration_ticks;
+    stream->tick_ms = tick_ms;
+    stream->raw_frame = malloc((size_t) frame_width * frame_height * channels);
+    for (int i = 0; i < 2; i++) {
+        init_frame_buffer(&stream->buffers[i], (size_t) number_nodes_x * number_nodes_y, num_frequencies,
+                          frame_duration_ticks);
+    }
+    stream->front = &stream->buffers[0];
+    stream->back = &stream->buffers[1];
+    stream->front_start_tick = 0;
+    stream->back_ready = 0;
+    stream->stop = 0;
+    stream->frames_read = 0;
+    stream->trace = NULL;
+#ifndef _WIN32
+    if (pipe(stream->stop_pipe) != 0) {
+        printf("WARNING: Could not create the pipe to stop reading the frame stream. Closing the stream waits for "
+               "the frame being read.\n");
+        stream->stop_pipe[0] = -1;
+        stream->stop_pipe[1] = -1;
+    }
+#endif
+    init_thread_mutex(&stream->mutex);
+    init_thread_condition(&stream->condition);
+    printf("Reading frames of %u x %u pixels with %u channels from %s.\n", frame_width, frame_height, channels, path);
+    stream->reader = create_and_run_thread(read_frames, stream);
+    // the first frame becomes the front frame, the reader continues with the second frame
+    advance_frame_stream(stream, 0);
+    return stream;
+}
+
+void advance_frame_stream(framestream_t *stream, int tick_number) {
+    lock_thread_mutex(&stream->mutex);
+    while (!stream->back_ready) {
+        wait_thread_condition(&stream->condition, &stream->mutex);
+    }
+    framebuffer_t *tmp = stream->front;
+    stream->front = stream->back;
+    stream->back = tmp;
+    stream->front_start_tick = tick_number;
+    if (stream->front->has_frame) {
+        // let the reader decode the next frame into the old front buffer
+        stream->back_ready = 0;
+        broadcast_thread_condition(&stream->condition);
+    } else {
+        // the reader has finished, both buffers stay empty from now on
+        if (stream->back->has_frame) {
+            printf("Frame stream ended after %d frames. No further inputs from the stream.\n", stream->frames_read);
+        }
+        stream->back->has_frame = 0;
+    }
+    unlock_thread_mutex(&stream->mutex);
+}
+
+void set_frame_stream_trace(framestream_t *stream, tracebuffer_t *trace) {
+    lock_thread_mutex(&stream->mutex);
+    stream->trace = trace;
+    unlock_thread_mutex(&stream->mutex);
+}
+
+void close_frame_stream(framestream_t *stream) {
+    lock_thread_mutex(&stream->mutex);
+    stream->stop = 1;
+    broadcast_thread_condition(&stream->condition);
+    // a reader waiting for the next frame of a stalled writer is woken up by the stop pipe or by cancelling its read
+#ifdef _WIN32
+    if (!stream->back_ready) {
+        CancelSynchronousIo(*stream->reader);
+    }
+#else
+    if (stream->stop_pipe[1] >= 0) {
+        ssize_t written = write(stream->stop_pipe[1], "", 1);
+        (void) written;
+    }
+#endif
+    unlock_thread_mutex(&stream->mutex);
+    join_and_close_simulation_threads(&stream->reader, 1);
+#ifndef _WIN32
+    if (stream->stop_pipe[0] >= 0) {
+        close(stream->stop_pipe[0]);
+        close(stream->stop_pipe[1]);
+    }
+#endif
+    destroy_thread_condition(&stream->condition);
+    destroy_thread_mutex(&stream->mutex);
+    if (stream->close_file) {
+        fclose(stream->file);
+    }
+    for (int i = 0; i < 2; i++) {
+        free_frame_buffer(&stream->buffers[i]);
+    }
+    free(stream->raw_frame);
+    free(stream);
+}
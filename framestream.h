@@ -0,0 +1,209 @@
+#ifndef FRAMESTREAM_H
+#define FRAMESTREAM_H
+
+#include "definitions.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * @file
+ * Streaming input source reading raw frames from a file, stdin or a named pipe.
+ *
+ * A stream starts with a fixed 16 byte header, followed by any number of frames:
+ * - 4 bytes: the magic characters "BSFS",
+ * - 4 bytes: frame width (unsigned, little-endian),
+ * - 4 bytes: frame height (unsigned, little-endian),
+ * - 4 bytes: number of channels per pixel (unsigned, little-endian), 1 (grayscale) or 3 (RGB).
+ *
+ * Each frame contains width * height pixels with one byte per channel. Pixels are stored row by row, starting with
+ * the top row (y = 0), each row starting at x = 0. Pixel (x, y) is mapped to node (x, y) of the grid.
+ * Like bitmap inputs, the color values of a pixel are summed (grayscale values are tripled) and the sum is
+ * mapped to a sin-frequency, 0 meaning no input. Each frame generates inputs for a fixed number of ticks.
+ *
+ * Frames are read and decoded on a separate reader thread into a back buffer, while the simulation uses
+ * the front buffer.
+ */
+
+/** Magic characters at the start of each frame stream. */
+#define FRAMESTREAM_MAGIC "BSFS"
+
+/**
+ * A decoded frame, ready to be used as input.
+ */
+typedef struct {
+    /**
+    * Frequency class of each node in the grid layout (x * number_nodes_y + y). 0 for nodes without input,
+    * otherwise the index of the node's frequency series in frequency_series plus one.
+    */
+    uint16_t *node_frequency;
+    /**
+    * Sin time series for each frequency class, only generated for the classes used in the frame.
+    * The series of class c starts at frequency_series[(c - 1) * frame_duration_ticks].
+    */
+    nodeval_t *frequency_series;
+    /**
+    * 1 if the frequency of a class is used in this frame. Length: number of frequency classes.
+    */
+    unsigned char *frequency_used;
+    /**
+    * 1 if the buffer contains a frame, 0 after the end of the stream.
+    */
+    int has_frame;
+}
+        framebuffer_t;
+
+/**
+ * State of a frame stream and its reader thread.
+ */
+struct framestream {
+    /**
+    * The file (or pipe) the frames are read from.
+    */
+    FILE *file;
+    /**
+    * 1 if the file has been opened by the stream and must be closed, 0 for stdin.
+    */
+    int close_file;
+    /**
+    * Dimensions of the frames, read from the header.
+    */
+    uint32_t frame_width;
+    /**
+    * Dimensions of the frames, read from the header.
+    */
+    uint32_t frame_height;
+    /**
+    * Number of channels of each pixel, read from the header.
+    */
+    uint32_t channels;
+    /**
+    * The number of nodes in the first dimension of the simulated grid.
+    */
+    int number_nodes_x;
+    /**
+    * The number of nodes in the second dimension of the simulated grid.
+    */
+    int number_nodes_y;
+    /**
+    * The frequency for the minimum non-0 pixel value (1).
+    */
+    int min_freq;
+    /**
+    * The frequency for the maximum pixel value (765).
+    */
+    int max_freq;
+    /**
+    * The number of ticks for which each frame generates inputs.
+    */
+    int frame_duration_ticks;
+    /**
+    * Milliseconds in between each simulation tick.
+    */
+    double tick_ms;
+    /**
+    * Buffer for reading a raw frame. Length: frame_width * frame_height * channels.
+    */
+    uint8_t *raw_frame;
+    /**
+    * The two frame buffers.
+    */
+    framebuffer_t buffers[2];
+    /**
+    * The buffer used by the simulation.
+    */
+    framebuffer_t *front;
+    /**
+    * The buffer the reader thread decodes the next frame into.
+    */
+    framebuffer_t *back;
+    /**
+    * Tick at which the front frame started generating inputs.
+    */
+    int front_start_tick;
+    /**
+    * 1 if the back buffer contains the next decoded frame (or the end of the stream).
+    */
+    int back_ready;
+    /**
+    * Set to 1 to stop the reader thread.
+    */
+    int stop;
+    /**
+    * Number of frames read so far.
+    */
+    int frames_read;
+    /**
+    * Protects back_ready and stop.
+    */
+    threadmutex_t mutex;
+    /**
+    * Signaled whenever back_ready or stop changes.
+    */
+    threadcondition_t condition;
+    /**
+    * The reader thread.
+    */
+    threadhandle_t *reader;
+#ifndef _WIN32
+    /**
+    * Pipe written to by close_frame_stream() to interrupt the reader thread waiting for the next frame.
+    * -1 if the pipe could not be created.
+    */
+    int stop_pipe[2];
+#endif
+    /**
+    * The trace buffer to record the frames read by the reader thread in, NULL if the stream is not traced.
+    */
+    tracebuffer_t *trace;
+};
+
+/**
+ * Opens a frame stream, starts its reader thread and waits until the first frame is available.
+ * @param path Path of the file or named pipe to read from. "-" reads from stdin.
+ * @param number_nodes_x The number of nodes in the first dimension of the simulated grid.
+ * @param number_nodes_y The number of nodes in the second dimension of the simulated grid.
+ * @param min_freq The frequency to generate for the minimum non-0 pixel value (1).
+ * @param max_freq The frequency to generate for the maximum pixel value (765).
+ * @param frame_duration_ticks The number of ticks for which each frame generates inputs.
+ * @param tick_ms The milliseconds in between each simulation tick.
+ * @return The opened stream or NULL if the stream could not be opened.
+ */
+framestream_t *open_frame_stream(const char *path, int number_nodes_x, int number_nodes_y,
+                                 int min_freq, int max_freq, int frame_duration_ticks, double tick_ms);
+
+/**
+ * Replaces the front frame with the next frame of the stream. Waits for the reader thread if the next frame has not
+ * been decoded yet. After the end of the stream, the front buffer contains no frame.
+ * Must not be called while other threads read the front buffer.
+ * @param stream The stream to advance.
+ * @param tick_number The tick at which the next frame starts generating inputs.
+ */
+void advance_frame_stream(framestream_t *stream, int tick_number);
+
+/**
+ * Records the frames read from now on in a trace buffer (see trace.h).
+ * @param stream The stream.
+ * @param trace The trace buffer, only written by the reader thread. NULL to stop tracing.
+ */
+void set_frame_stream_trace(framestream_t *stream, tracebuffer_t *trace);
+
+/**
+ * Stops the reader thread, closes the stream and frees it.
+ * @param stream The stream to close.
+ */
+void close_frame_stream(framestream_t *stream);
+
+/**
+ * Returns the energy the current front frame adds to a node at the given tick.
+ * @param stream The stream.
+ * @param node_frequency The frequency class of the node (see framebuffer_t.node_frequency). Must not be 0.
+ * @param tick_number The current tick.
+ * @return The energy to add.
+ */
+static inline nodeval_t frame_stream_input(const framestream_t *stream, uint16_t node_frequency, int tick_number) {
+    return stream->front->frequency_series[(size_t) (node_frequency - 1) * stream->frame_duration_ticks
+                                           + tick_number - stream->front_start_tick];
+}
+
+#endif
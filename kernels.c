@@ -5,20 +5,490 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 
 
-kernelfunc_t d_kernel_function_factory(char *name) {
-    // we can later on link the given name to a kernel function
-    // for now, we just return the static function
-    kernelfunc_t functionPtr = &d_kernel_4neighbors;
-    return functionPtr;
+// the neighborhoods of the registered kernels, a neighbor at offset (x, y) of a kernel with radius r is either direct,
+// indirect or not part of the kernel
+static int is_direct_neighbor(kerneltype_t type, int radius, int x, int y) {
+    switch (type) {
+        case KERNEL_TYPE_8NEIGHBORS:
+            return abs(x) <= 1 && abs(y) <= 1;
+        case KERNEL_TYPE_MEXICANHAT:
+            // the excitatory center with positive weights
+            return 4 * (x * x + y * y) < radius * radius;
+        default:
+            // 4neighbors, radius<r> and weighted<r>: the nodes on the axes
+            return x == 0 || y == 0;
+    }
+}
+
+static int kernel_type_from_name(const char *name, kerneltype_t *type, int *radius) {
+    char *end;
+    if (name == NULL || name[0] == '\0' || strcmp(name, "4neighbors") == 0) {
+        *type = KERNEL_TYPE_4NEIGHBORS;
+        *radius = 1;
+    } else if (strcmp(name, "8neighbors") == 0) {
+        *type = KERNEL_TYPE_8NEIGHBORS;
+        *radius = 2;
+    } else {
+        // the kernels with a radius, named <prefix><r>
+        static const char *prefixes[] = {"radius", "weighted", "gaussian", "mexicanhat"};
+        static const kerneltype_t types[] = {KERNEL_TYPE_RADIUS, KERNEL_TYPE_WEIGHTED, KERNEL_TYPE_GAUSSIAN,
+                                             KERNEL_TYPE_MEXICANHAT};
+        static const int min_radius[] = {1, 1, 1, 3};
+        static const int max_radius[] = {KERNEL_MAX_RADIUS, KERNEL_MAX_RADIUS, KERNEL_MAX_LARGE_RADIUS,
+                                         KERNEL_MAX_LARGE_RADIUS};
+        for (int k = 0; k < 4; k++) {
+            size_t prefix_length = strlen(prefixes[k]);
+            if (strncmp(name, prefixes[k], prefix_length) == 0) {
+                const char *radius_string = name + prefix_length;
+                long parsed_radius = strtol(radius_string, &end, 10);
+                if (radius_string[0] == '\0' || *end != '\0' || parsed_radius < min_radius[k]
+                    || parsed_radius > max_radius[k]) {
+                    return 1;
+                }
+                *type = types[k];
+                *radius = (int) parsed_radius;
+                return 0;
+            }
+        }
+        return 1;
+    }
+    return 0;
+}
+
+// the gaussian profile of gaussian<r>, with a standard deviation of r / 3
+static nodeval_t gaussian_profile(int radius, int x) {
+    return exp(-4.5 * x * x / ((double) radius * radius));
+}
+
+// the mexican hat of mexicanhat<r>, crossing zero at distance r / 2
+static nodeval_t mexicanhat_weight(int radius, int x, int y) {
+    nodeval_t t = 4.0 * (x * x + y * y) / ((double) radius * radius);
+    return (1 - t) * exp(-t);
+}
+
+// sum of the absolute weights of a neighborhood
+static nodeval_t weight_sum(const kernelneighbor_t *neighbors, int number_neighbors) {
+    nodeval_t sum = 0;
+    for (int k = 0; k < number_neighbors; k++) {
+        sum += fabs(neighbors[k].weight);
+    }
+    return sum;
+}
+
+// normalizes the weights of a neighborhood to a mean absolute value of 1, so that the weighted mean is computed like a
+// mean, negative weights stay negative
+static void normalize_weights(kernelneighbor_t *neighbors, int number_neighbors) {
+    nodeval_t sum = weight_sum(neighbors, number_neighbors);
+    for (int k = 0; k < number_neighbors; k++) {
+        neighbors[k].weight = neighbors[k].weight * number_neighbors / sum;
+    }
+}
+
+static nodeval_t neighbor_weight(kerneltype_t type, const nodeval_t *profile, int radius, int x, int y) {
+    switch (type) {
+        case KERNEL_TYPE_WEIGHTED:
+            return 1 / sqrt(x * x + y * y);
+        case KERNEL_TYPE_GAUSSIAN:
+            return profile[x] * profile[y];
+        case KERNEL_TYPE_MEXICANHAT:
+            return mexicanhat_weight(radius, x, y);
+        default:
+            return 1;
+    }
+}
+
+int init_kernel(kernel_t *kernel, const char *name) {
+    if (kernel_type_from_name(name, &kernel->type, &kernel->radius)) {
+        printf("ERROR: Unknown kernel: %s\n", name);
+        printf("\tAvailable kernels: 4neighbors, 8neighbors, radius<r>, weighted<r> (1 <= r <= %d), gaussian<r>"
+               " (1 <= r <= %d), mexicanhat<r> (3 <= r <= %d).\n", KERNEL_MAX_RADIUS, KERNEL_MAX_LARGE_RADIUS,
+               KERNEL_MAX_LARGE_RADIUS);
+        return 1;
+    }
+    snprintf(kernel->name, sizeof(kernel->name), "%s", name == NULL || name[0] == '\0' ? KERNEL_DEFAULT_NAME : name);
+    int radius = kernel->radius;
+    int width = 2 * radius + 1;
+    kernel->method = KERNEL_METHOD_DIRECT;
+    kernel->profile = NULL;
+    kernel->d_profile_scale = 1;
+    kernel->id_profile_scale = 1;
+    kernel->spectrum_re = NULL;
+    kernel->spectrum_im = NULL;
+    if (kernel->type == KERNEL_TYPE_GAUSSIAN) {
+        kernel->profile = malloc(width * sizeof(nodeval_t));
+        kernel->profile += radius;
+        for (int x = -radius; x <= radius; x++) {
+            kernel->profile[x] = gaussian_profile(radius, x);
+        }
+    }
+    kernel->d_neighbors = malloc(width * width * sizeof(kernelneighbor_t));
+    kernel->id_neighbors = malloc(width * width * sizeof(kernelneighbor_t));
+    kernel->number_d_neighbors = 0;
+    kernel->number_id_neighbors = 0;
+    // all neighbors are enumerated by x offset, then y offset, the order in which they are summed
+    for (int x = -radius; x <= radius; x++) {
+        for (int y = -radius; y <= radius; y++) {
+            if (x == 0 && y == 0) {
+                continue;
+            }
+            kernelneighbor_t neighbor;
+            neighbor.x = x;
+            neighbor.y = y;
+            neighbor.weight = neighbor_weight(kernel->type, kernel->profile, radius, x, y);
+            if (is_direct_neighbor(kernel->type, radius, x, y)) {
+                kernel->d_neighbors[kernel->number_d_neighbors++] = neighbor;
+            } else {
+                kernel->id_neighbors[kernel->number_id_neighbors++] = neighbor;
+            }
+        }
+    }
+    if (kernel_is_weighted(kernel)) {
+        if (kernel->profile != NULL) {
+            kernel->d_profile_scale = kernel->number_d_neighbors
+                                      / weight_sum(kernel->d_neighbors, kernel->number_d_neighbors);
+            kernel->id_profile_scale = kernel->number_id_neighbors
+                                       / weight_sum(kernel->id_neighbors, kernel->number_id_neighbors);
+        }
+        normalize_weights(kernel->d_neighbors, kernel->number_d_neighbors);
+        normalize_weights(kernel->id_neighbors, kernel->number_id_neighbors);
+    }
+    return 0;
+}
+
+void free_kernel(kernel_t *kernel) {
+    free(kernel->d_neighbors);
+    free(kernel->id_neighbors);
+    if (kernel->profile != NULL) {
+        free(kernel->profile - kernel->radius);
+    }
+    if (kernel->method == KERNEL_METHOD_FFT) {
+        free_fft_plan(&kernel->fft_plan);
+        free(kernel->spectrum_re);
+        free(kernel->spectrum_im);
+    }
+}
+
+const char *kernel_method_name(kernelmethod_t method) {
+    switch (method) {
+        case KERNEL_METHOD_SEPARABLE:
+            return "separable";
+        case KERNEL_METHOD_FFT:
+            return "fft";
+        default:
+            return "direct";
+    }
+}
+
+// estimated costs of the methods, in multiply-adds of the direct method, calibrated on x86-64
+#define KERNEL_COST_SEPARABLE_PASS 0.6
+#define KERNEL_COST_FFT_BUTTERFLY 2.0
+// blocks whose 4 buffers exceed this size do not fit into the caches and are slower per butterfly
+#define KERNEL_FFT_CACHE_BYTES (4 << 20)
+
+// the cost per node of both separable passes, each with 2 * radius + 1 multiply-adds per node
+static double separable_cost(int radius) {
+    return KERNEL_COST_SEPARABLE_PASS * 2 * (2 * radius + 1);
+}
+
+// the cost per node of the FFT convolution of all blocks covering the grid
+static double fft_cost(int radius, int size, int number_nodes_x, int number_nodes_y) {
+    int block = size - 2 * radius;
+    int log2_size = 0;
+    while ((1 << log2_size) < size) {
+        log2_size++;
+    }
+    double number_blocks = (double) ((number_nodes_x + block - 1) / block) * ((number_nodes_y + block - 1) / block);
+    // a forward and an inverse 2D transform of size^2 values with log2(size^2) butterfly stages each, per block
+    double cost = KERNEL_COST_FFT_BUTTERFLY * number_blocks * 4.0 * size * size * log2_size
+                  / ((double) number_nodes_x * number_nodes_y);
+    if ((size_t) size * size * 4 * sizeof(nodeval_t) > KERNEL_FFT_CACHE_BYTES) {
+        cost *= 1.5;
+    }
+    return cost;
 }
 
-kernelfunc_t id_kernel_function_factory(char *name) {
-    // we can later on link the given name to a kernel function
-    // for now, we just return the static function
-    kernelfunc_t functionPtr = &id_kernel_4neighbors;
-    return functionPtr;
+// the FFT size with the lowest cost per node, blocks larger than the grid do not pay off
+static int best_fft_size(int radius, int number_nodes_x, int number_nodes_y) {
+    int grid = number_nodes_x > number_nodes_y ? number_nodes_x : number_nodes_y;
+    int best = 0;
+    for (int size = 4; size < 2 * (grid + 2 * radius); size *= 2) {
+        if (size > 2 * radius
+            && (best == 0 || fft_cost(radius, size, number_nodes_x, number_nodes_y)
+                             < fft_cost(radius, best, number_nodes_x, number_nodes_y))) {
+            best = size;
+        }
+    }
+    return best;
+}
+
+// computes the transposed spectrum of both neighborhoods, the direct neighborhood as real and the indirect one as
+// imaginary part, mirrored so that the convolution computes the sums of kernel_sum_table()
+static void init_kernel_spectrum(kernel_t *kernel) {
+    int size = kernel->fft_size;
+    size_t length = (size_t) size * size;
+    nodeval_t *re = calloc(length, sizeof(nodeval_t));
+    nodeval_t *im = calloc(length, sizeof(nodeval_t));
+    for (int k = 0; k < kernel->number_d_neighbors; k++) {
+        const kernelneighbor_t *neighbor = &kernel->d_neighbors[k];
+        re[(size_t) ((size - neighbor->x) % size) * size + (size - neighbor->y) % size] = neighbor->weight;
+    }
+    for (int k = 0; k < kernel->number_id_neighbors; k++) {
+        const kernelneighbor_t *neighbor = &kernel->id_neighbors[k];
+        im[(size_t) ((size - neighbor->x) % size) * size + (size - neighbor->y) % size] = neighbor->weight;
+    }
+    kernel->spectrum_re = malloc(length * sizeof(nodeval_t));
+    kernel->spectrum_im = malloc(length * sizeof(nodeval_t));
+    fft_2d_transposed(&kernel->fft_plan, re, im, kernel->spectrum_re, kernel->spectrum_im, 0);
+    for (size_t i = 0; i < length; i++) {
+        kernel->spectrum_re[i] = kernel->spectrum_re[i] / length;
+        kernel->spectrum_im[i] = kernel->spectrum_im[i] / length;
+    }
+    free(re);
+    free(im);
+}
+
+int init_kernel_method(kernel_t *kernel, const char *method_name, int number_nodes_x, int number_nodes_y) {
+    int large = kernel->type == KERNEL_TYPE_GAUSSIAN || kernel->type == KERNEL_TYPE_MEXICANHAT;
+    int fft_size = large ? best_fft_size(kernel->radius, number_nodes_x, number_nodes_y) : 0;
+    kernelmethod_t method;
+    if (method_name == NULL || strcmp(method_name, "auto") == 0) {
+        method = KERNEL_METHOD_DIRECT;
+        if (large) {
+            double width = 2 * kernel->radius + 1;
+            double cost = width * width;
+            if (kernel->profile != NULL && separable_cost(kernel->radius) < cost) {
+                method = KERNEL_METHOD_SEPARABLE;
+                cost = separable_cost(kernel->radius);
+            }
+            if (fft_cost(kernel->radius, fft_size, number_nodes_x, number_nodes_y) < cost) {
+                method = KERNEL_METHOD_FFT;
+            }
+        }
+    } else if (strcmp(method_name, "direct") == 0) {
+        method = KERNEL_METHOD_DIRECT;
+    } else if (strcmp(method_name, "separable") == 0 && kernel->profile != NULL) {
+        method = KERNEL_METHOD_SEPARABLE;
+    } else if (strcmp(method_name, "fft") == 0 && large) {
+        method = KERNEL_METHOD_FFT;
+    } else {
+        printf("ERROR: Kernel method %s is not supported by kernel %s.\n", method_name, kernel->name);
+        printf("\tAvailable methods: direct, separable (gaussian<r>), fft (gaussian<r>, mexicanhat<r>), auto.\n");
+        return 1;
+    }
+    kernel->method = method;
+    if (method == KERNEL_METHOD_FFT) {
+        kernel->fft_size = fft_size;
+        init_fft_plan(&kernel->fft_plan, fft_size);
+        init_kernel_spectrum(kernel);
+    }
+    return 0;
+}
+
+double kernel_node_cost(const kernel_t *kernel, int number_nodes_x, int number_nodes_y) {
+    switch (kernel->method) {
+        case KERNEL_METHOD_SEPARABLE:
+            return separable_cost(kernel->radius);
+        case KERNEL_METHOD_FFT:
+            return fft_cost(kernel->radius, kernel->fft_size, number_nodes_x, number_nodes_y);
+        default:
+            return kernel->number_d_neighbors + kernel->number_id_neighbors;
+    }
+}
+
+void init_kernel_workspace(kernelworkspace_t *workspace, const kernel_t *kernel, int number_nodes_y, int start_x,
+                           int end_x) {
+    size_t number_nodes = (size_t) (end_x - start_x) * number_nodes_y;
+    workspace->start_x = start_x;
+    workspace->end_x = end_x;
+    workspace->d_sums = malloc(number_nodes * sizeof(nodeval_t));
+    workspace->id_sums = malloc(number_nodes * sizeof(nodeval_t));
+    workspace->buffer = NULL;
+    workspace->buffer_im = NULL;
+    workspace->spectrum_re = NULL;
+    workspace->spectrum_im = NULL;
+    if (kernel->method == KERNEL_METHOD_SEPARABLE) {
+        workspace->buffer = malloc((size_t) (end_x - start_x + 2 * kernel->radius) * number_nodes_y
+                                   * sizeof(nodeval_t));
+    } else if (kernel->method == KERNEL_METHOD_FFT) {
+        size_t block = (size_t) kernel->fft_size * kernel->fft_size;
+        workspace->buffer = malloc(block * sizeof(nodeval_t));
+        workspace->buffer_im = malloc(block * sizeof(nodeval_t));
+        workspace->spectrum_re = malloc(block * sizeof(nodeval_t));
+        workspace->spectrum_im = malloc(block * sizeof(nodeval_t));
+    }
+}
+
+void free_kernel_workspace(kernelworkspace_t *workspace) {
+    free(workspace->d_sums);
+    free(workspace->id_sums);
+    free(workspace->buffer);
+    free(workspace->buffer_im);
+    free(workspace->spectrum_re);
+    free(workspace->spectrum_im);
+}
+
+// the sums of a separable kernel: the sums along y of all needed rows, then the sums along x, split into the axes
+// (the direct neighborhood) and all other nodes (the indirect neighborhood)
+static void kernel_sum_planes_separable(const kernel_t *kernel, kernelworkspace_t *workspace, int number_nodes_x,
+                                        int number_nodes_y, nodeval_t **nodegrid) {
+    const int radius = kernel->radius;
+    const nodeval_t *profile = kernel->profile;
+    const nodeval_t center = profile[0];
+    int first_x = workspace->start_x - radius > 0 ? workspace->start_x - radius : 0;
+    int last_x = workspace->end_x + radius < number_nodes_x ? workspace->end_x + radius : number_nodes_x;
+    for (int x = first_x; x < last_x; x++) {
+        nodeval_t *column_sums = workspace->buffer + (size_t) (x - workspace->start_x + radius) * number_nodes_y;
+        const nodeval_t *row = nodegrid[x];
+        for (int y = 0; y < number_nodes_y; y++) {
+            column_sums[y] = 0;
+        }
+        for (int dy = -radius; dy <= radius; dy++) {
+            nodeval_t weight = profile[dy];
+            int y_start = dy < 0 ? -dy : 0;
+            int y_end = dy > 0 ? number_nodes_y - dy : number_nodes_y;
+            for (int y = y_start; y < y_end; y++) {
+                column_sums[y] += weight * row[y + dy];
+            }
+        }
+    }
+    for (int x = workspace->start_x; x < workspace->end_x; x++) {
+        // the full square is accumulated in id_sums, the line along x in d_sums
+        nodeval_t *d_sums = workspace->d_sums + (size_t) (x - workspace->start_x) * number_nodes_y;
+        nodeval_t *id_sums = workspace->id_sums + (size_t) (x - workspace->start_x) * number_nodes_y;
+        for (int y = 0; y < number_nodes_y; y++) {
+            d_sums[y] = 0;
+            id_sums[y] = 0;
+        }
+        for (int dx = -radius; dx <= radius; dx++) {
+            if (x + dx < 0 || x + dx >= number_nodes_x) {
+                continue;
+            }
+            nodeval_t weight = profile[dx];
+            const nodeval_t *column_sums = workspace->buffer
+                                           + (size_t) (x + dx - workspace->start_x + radius) * number_nodes_y;
+            const nodeval_t *row = nodegrid[x + dx];
+            for (int y = 0; y < number_nodes_y; y++) {
+                id_sums[y] += weight * column_sums[y];
+                d_sums[y] += weight * row[y];
+            }
+        }
+        const nodeval_t *own_column_sums = workspace->buffer + (size_t) (x - workspace->start_x + radius)
+                                                               * number_nodes_y;
+        const nodeval_t *own_row = nodegrid[x];
+        for (int y = 0; y < number_nodes_y; y++) {
+            nodeval_t node = center * center * own_row[y];
+            nodeval_t line_x = center * d_sums[y];
+            nodeval_t line_y = center * own_column_sums[y];
+            d_sums[y] = kernel->d_profile_scale * (line_x + line_y - 2 * node);
+            id_sums[y] = kernel->id_profile_scale * (id_sums[y] - line_x - line_y + node);
+        }
+    }
+}
+
+// the sums of any kernel by FFT convolution of blocks (overlap-save): each block of (size - 2 * radius)^2 nodes is
+// transformed together with its border of radius nodes, multiplied with the spectrum of both neighborhoods and
+// transformed back, the direct sums are the real part and the indirect sums the imaginary part of the result
+static void kernel_sum_planes_fft(const kernel_t *kernel, kernelworkspace_t *workspace, int number_nodes_x,
+                                  int number_nodes_y, nodeval_t **nodegrid) {
+    const int radius = kernel->radius;
+    const int size = kernel->fft_size;
+    const int block = size - 2 * radius;
+    const size_t length = (size_t) size * size;
+    nodeval_t *re = workspace->buffer;
+    nodeval_t *im = workspace->buffer_im;
+    for (int x0 = workspace->start_x; x0 < workspace->end_x; x0 += block) {
+        for (int y0 = 0; y0 < number_nodes_y; y0 += block) {
+            for (int p = 0; p < size; p++) {
+                int x = x0 - radius + p;
+                nodeval_t *block_row = re + (size_t) p * size;
+                for (int q = 0; q < size; q++) {
+                    int y = y0 - radius + q;
+                    block_row[q] = x >= 0 && x < number_nodes_x && y >= 0 && y < number_nodes_y ? nodegrid[x][y] : 0;
+                }
+            }
+            for (size_t i = 0; i < length; i++) {
+                im[i] = 0;
+            }
+            fft_2d_transposed(&kernel->fft_plan, re, im, workspace->spectrum_re, workspace->spectrum_im, 0);
+            for (size_t i = 0; i < length; i++) {
+                nodeval_t a = workspace->spectrum_re[i];
+                nodeval_t b = workspace->spectrum_im[i];
+                workspace->spectrum_re[i] = a * kernel->spectrum_re[i] - b * kernel->spectrum_im[i];
+                workspace->spectrum_im[i] = a * kernel->spectrum_im[i] + b * kernel->spectrum_re[i];
+            }
+            fft_2d_transposed(&kernel->fft_plan, workspace->spectrum_re, workspace->spectrum_im, re, im, 1);
+            int x_end = x0 + block < workspace->end_x ? x0 + block : workspace->end_x;
+            int y_end = y0 + block < number_nodes_y ? y0 + block : number_nodes_y;
+            for (int x = x0; x < x_end; x++) {
+                size_t source = (size_t) (x - x0 + radius) * size + radius;
+                size_t target = (size_t) (x - workspace->start_x) * number_nodes_y;
+                for (int y = y0; y < y_end; y++) {
+                    workspace->d_sums[target + y] = re[source + y - y0];
+                    workspace->id_sums[target + y] = im[source + y - y0];
+                }
+            }
+        }
+    }
+}
+
+void kernel_sum_planes(const kernel_t *kernel, kernelworkspace_t *workspace, int number_nodes_x, int number_nodes_y,
+                       nodeval_t **nodegrid) {
+    if (kernel->method == KERNEL_METHOD_SEPARABLE) {
+        kernel_sum_planes_separable(kernel, workspace, number_nodes_x, number_nodes_y, nodegrid);
+    } else {
+        kernel_sum_planes_fft(kernel, workspace, number_nodes_x, number_nodes_y, nodegrid);
+    }
+}
+
+kernelfunc_t d_kernel_function_factory(const char *name) {
+    kerneltype_t type;
+    int radius;
+    if (kernel_type_from_name(name, &type, &radius)) {
+        return NULL;
+    }
+    switch (type) {
+        case KERNEL_TYPE_4NEIGHBORS:
+            return &d_kernel_4neighbors;
+        case KERNEL_TYPE_8NEIGHBORS:
+            return &d_kernel_8neighbors;
+        default:
+            return NULL;
+    }
+}
+
+kernelfunc_t id_kernel_function_factory(const char *name) {
+    kerneltype_t type;
+    int radius;
+    if (kernel_type_from_name(name, &type, &radius)) {
+        return NULL;
+    }
+    switch (type) {
+        case KERNEL_TYPE_4NEIGHBORS:
+            return &id_kernel_4neighbors;
+        case KERNEL_TYPE_8NEIGHBORS:
+            return &id_kernel_8neighbors;
+        default:
+            return NULL;
+    }
+}
+
+int gather_kernel_neighbors(nodeval_t *result, int number_neighbors, const kernelneighbor_t *neighbors,
+                            int number_nodes_x, int number_nodes_y, nodeval_t **nodegrid, int x, int y) {
+    for (int k = 0; k < number_neighbors; k++) {
+        int neighbor_x = x + neighbors[k].x;
+        int neighbor_y = y + neighbors[k].y;
+        if (neighbor_x >= 0 && neighbor_x < number_nodes_x && neighbor_y >= 0 && neighbor_y < number_nodes_y) {
+            result[k] = neighbors[k].weight * nodegrid[neighbor_x][neighbor_y];
+        } else {
+            // border behavior
+            result[k] = 0;
+        }
+    }
+    return number_neighbors;
 }
 
 int d_kernel_4neighbors(nodeval_t *result, int number_nodes_x, int number_nodes_y, nodeval_t **nodegrid, int x, int y) {
@@ -78,4 +548,46 @@ id_kernel_4neighbors(nodeval_t *result, int number_nodes_x, int number_nodes_y,
         result[3] = 0;
     }
     return 4;
-}
\ No newline at end of file
+}
+
+int d_kernel_8neighbors(nodeval_t *result, int number_nodes_x, int number_nodes_y, nodeval_t **nodegrid, int x, int y) {
+    // we require 8 elements in the given array
+    int count = 0;
+    for (int neighbor_x = x - 1; neighbor_x <= x + 1; neighbor_x++) {
+        for (int neighbor_y = y - 1; neighbor_y <= y + 1; neighbor_y++) {
+            if (neighbor_x == x && neighbor_y == y) {
+                continue;
+            }
+            if (neighbor_x >= 0 && neighbor_x < number_nodes_x && neighbor_y >= 0 && neighbor_y < number_nodes_y) {
+                result[count] = nodegrid[neighbor_x][neighbor_y];
+            } else {
+                // border behavior
+                result[count] = 0;
+            }
+            count++;
+        }
+    }
+    return 8;
+}
+
+int
+id_kernel_8neighbors(nodeval_t *result, int number_nodes_x, int number_nodes_y, nodeval_t **nodegrid, int x, int y) {
+    // we require 16 elements in the given array
+    int count = 0;
+    for (int neighbor_x = x - 2; neighbor_x <= x + 2; neighbor_x++) {
+        for (int neighbor_y = y - 2; neighbor_y <= y + 2; neighbor_y++) {
+            // only the outer ring of the 5x5 square
+            if (neighbor_x != x - 2 && neighbor_x != x + 2 && neighbor_y != y - 2 && neighbor_y != y + 2) {
+                continue;
+            }
+            if (neighbor_x >= 0 && neighbor_x < number_nodes_x && neighbor_y >= 0 && neighbor_y < number_nodes_y) {
+                result[count] = nodegrid[neighbor_x][neighbor_y];
+            } else {
+                // border behavior
+                result[count] = 0;
+            }
+            count++;
+        }
+    }
+    return 16;
+}
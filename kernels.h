@@ -5,28 +5,344 @@
  * Supports different types of kernel-function, which can be chosen live.
  * All kernel functions have to conform to the same interface, in order to be executable.
  * All kernels should, but do not need to come in pairs (d_kernel and id_kernel).
+ *
+ * Kernels are registered by name:
+ * - "4neighbors" (default): the 4 direct neighbors on the axes, the 4 diagonal neighbors as indirect neighbors.
+ * - "8neighbors": the 8 surrounding nodes as direct neighbors, the ring of 16 nodes around them as indirect neighbors.
+ * - "radius<r>" (e.g., "radius3"): all nodes within the square of radius r. Nodes on the axes are direct neighbors,
+ *   all others are indirect neighbors. "radius1" equals "4neighbors".
+ * - "weighted<r>": like "radius<r>", but the means are weighted by the inverse euclidean distance to the node.
+ * - "gaussian<r>" (large kernel): like "weighted<r>", but weighted by a gaussian with a standard deviation of r / 3.
+ * - "mexicanhat<r>" (large kernel, r >= 3): all nodes within the square of radius r, weighted by a mexican hat
+ *   (ricker wavelet) crossing zero at distance r / 2. The excitatory center is the direct neighborhood, the inhibitory
+ *   surround with its negative weights is the indirect neighborhood.
+ *
+ * Out-of-grid neighbors count as neighbors with an energy level of 0.
+ * The simulation executes each kernel using its own specialized sweep (see brainsimulation.c), the kernel functions
+ * and neighbor tables are used by the generic reference engine.
+ *
+ * Large kernels compute the neighborhood sums of all nodes using one of three methods (see kernelmethod_t): directly
+ * from the neighbor tables, using separable 1D passes (gaussian only) or using blocked FFT convolution. By default,
+ * the method with the lowest estimated cost for the radius and grid is chosen.
  */
 
 #ifndef BRAINSIMULATION_KERNELS_H
 #define BRAINSIMULATION_KERNELS_H
 
 #include "definitions.h"
+#include "fft.h"
+
+/** Name of the default kernel. */
+#define KERNEL_DEFAULT_NAME "4neighbors"
+
+/** Maximum radius of the radius<r> and weighted<r> kernels. */
+#define KERNEL_MAX_RADIUS 32
+
+/** Maximum radius of the large gaussian<r> and mexicanhat<r> kernels. */
+#define KERNEL_MAX_LARGE_RADIUS 64
+
+/**
+ * The registered kernel types.
+ */
+typedef enum {
+    KERNEL_TYPE_4NEIGHBORS,
+    KERNEL_TYPE_8NEIGHBORS,
+    KERNEL_TYPE_RADIUS,
+    KERNEL_TYPE_WEIGHTED,
+    KERNEL_TYPE_GAUSSIAN,
+    KERNEL_TYPE_MEXICANHAT
+}
+        kerneltype_t;
+
+/**
+ * The methods computing the neighborhood sums of the large kernels.
+ */
+typedef enum {
+    /**
+    * Sums the weighted neighbors of each node, like the weighted<r> kernels. Cost per node: (2r + 1)^2.
+    */
+    KERNEL_METHOD_DIRECT,
+    /**
+    * Convolves with the 1D profile of a separable kernel along y, then along x. Cost per node: about 4 * (2r + 1).
+    */
+    KERNEL_METHOD_SEPARABLE,
+    /**
+    * Convolves blocks of the grid with both neighborhoods at once using 2D FFTs (overlap-save).
+    * Cost per node: about 2 * size^2 * log2(size) / (size - 2r)^2 for the FFT size.
+    */
+    KERNEL_METHOD_FFT
+}
+        kernelmethod_t;
+
+/**
+ * A single neighbor of a kernel, relative to the node the kernel is executed for.
+ */
+typedef struct {
+    /**
+    * Offset in the first dimension.
+    */
+    int x;
+    /**
+    * Offset in the second dimension.
+    */
+    int y;
+    /**
+    * Weight of the neighbor. The weights of each neighborhood have a mean absolute value of 1, i.e., they are 1 for
+    * unweighted kernels. Only the indirect neighbors of mexicanhat<r> have negative weights.
+    */
+    nodeval_t weight;
+}
+        kernelneighbor_t;
+
+/**
+ * A kernel, consisting of a direct and an indirect neighborhood.
+ */
+struct kernel {
+    /**
+    * The name the kernel was created with.
+    */
+    char name[32];
+    /**
+    * The type of the kernel.
+    */
+    kerneltype_t type;
+    /**
+    * The maximum distance of any neighbor in each dimension.
+    */
+    int radius;
+    /**
+    * The number of direct neighbors.
+    */
+    int number_d_neighbors;
+    /**
+    * The direct neighbors, ordered by x offset, then y offset. Length: number_d_neighbors.
+    */
+    kernelneighbor_t *d_neighbors;
+    /**
+    * The number of indirect neighbors.
+    */
+    int number_id_neighbors;
+    /**
+    * The indirect neighbors, ordered by x offset, then y offset. Length: number_id_neighbors.
+    */
+    kernelneighbor_t *id_neighbors;
+    /**
+    * The method computing the neighborhood sums. Always KERNEL_METHOD_DIRECT for kernels other than the large kernels.
+    * Set by init_kernel_method().
+    */
+    kernelmethod_t method;
+    /**
+    * 1D profile of separable kernels, the weight of an offset (x, y) is profile[x] * profile[y] before normalization.
+    * Indexed by offset, i.e., points to the middle of 2 * radius + 1 values. NULL for non-separable kernels.
+    */
+    nodeval_t *profile;
+    /**
+    * Factor normalizing the profile weights of the direct neighbors to the weights of d_neighbors.
+    */
+    nodeval_t d_profile_scale;
+    /**
+    * Factor normalizing the profile weights of the indirect neighbors to the weights of id_neighbors.
+    */
+    nodeval_t id_profile_scale;
+    /**
+    * Size of the FFT blocks (including the border of radius nodes on each side). Only used by KERNEL_METHOD_FFT.
+    */
+    int fft_size;
+    /**
+    * Plan of the FFTs. Only used by KERNEL_METHOD_FFT.
+    */
+    fftplan_t fft_plan;
+    /**
+    * Transposed spectrum of the direct neighborhood plus i times the spectrum of the indirect neighborhood, including
+    * the scaling of the inverse transform. Length: fft_size^2. Only used by KERNEL_METHOD_FFT.
+    */
+    nodeval_t *spectrum_re;
+    /**
+    * See spectrum_re.
+    */
+    nodeval_t *spectrum_im;
+};
+
+/**
+ * Per-thread buffers of the separable and FFT methods.
+ */
+struct kernelworkspace {
+    /**
+    * First row (inclusive) for which the sums are computed.
+    */
+    int start_x;
+    /**
+    * Last row (exclusive) for which the sums are computed.
+    */
+    int end_x;
+    /**
+    * Sums of the direct neighborhoods, row start_x first. Length: (end_x - start_x) * number_nodes_y.
+    */
+    nodeval_t *d_sums;
+    /**
+    * Sums of the indirect neighborhoods, row start_x first. Length: (end_x - start_x) * number_nodes_y.
+    */
+    nodeval_t *id_sums;
+    /**
+    * KERNEL_METHOD_SEPARABLE: the sums along y of rows start_x - radius to end_x + radius.
+    * KERNEL_METHOD_FFT: the real parts of a block.
+    */
+    nodeval_t *buffer;
+    /**
+    * KERNEL_METHOD_FFT: the imaginary parts of a block.
+    */
+    nodeval_t *buffer_im;
+    /**
+    * KERNEL_METHOD_FFT: the real parts of the spectrum of a block.
+    */
+    nodeval_t *spectrum_re;
+    /**
+    * KERNEL_METHOD_FFT: the imaginary parts of the spectrum of a block.
+    */
+    nodeval_t *spectrum_im;
+};
+
+/**
+ * The neighborhoods of the 4neighbors and 8neighbors kernels as constant tables, in the same order as the tables
+ * created by init_kernel(). Allows sweeps iterating over neighbor tables to be unrolled for these kernels.
+ */
+static const kernelneighbor_t KERNEL_4NEIGHBORS_D_NEIGHBORS[] = {{-1, 0, 1}, {0, -1, 1}, {0, 1, 1}, {1, 0, 1}};
+/** See KERNEL_4NEIGHBORS_D_NEIGHBORS. */
+static const kernelneighbor_t KERNEL_4NEIGHBORS_ID_NEIGHBORS[] = {{-1, -1, 1}, {-1, 1, 1}, {1, -1, 1}, {1, 1, 1}};
+/** See KERNEL_4NEIGHBORS_D_NEIGHBORS. */
+static const kernelneighbor_t KERNEL_8NEIGHBORS_D_NEIGHBORS[] = {{-1, -1, 1}, {-1, 0, 1}, {-1, 1, 1}, {0, -1, 1},
+                                                                 {0, 1, 1}, {1, -1, 1}, {1, 0, 1}, {1, 1, 1}};
+/** See KERNEL_4NEIGHBORS_D_NEIGHBORS. */
+static const kernelneighbor_t KERNEL_8NEIGHBORS_ID_NEIGHBORS[] = {{-2, -2, 1}, {-2, -1, 1}, {-2, 0, 1}, {-2, 1, 1},
+                                                                  {-2, 2, 1}, {-1, -2, 1}, {-1, 2, 1}, {0, -2, 1},
+                                                                  {0, 2, 1}, {1, -2, 1}, {1, 2, 1}, {2, -2, 1},
+                                                                  {2, -1, 1}, {2, 0, 1}, {2, 1, 1}, {2, 2, 1}};
+
+/**
+ * Creates the kernel registered for a name.
+ *
+ * @param kernel The kernel to initialize.
+ * @param name The name of the kernel. NULL or an empty name selects the default kernel.
+ * @return 0 on success, 1 if no kernel is registered for the name.
+ */
+int init_kernel(kernel_t *kernel, const char *name);
+
+/**
+ * Selects the method computing the neighborhood sums of a kernel and prepares it.
+ *
+ * @param kernel The kernel, initialized with init_kernel().
+ * @param method_name "direct", "separable", "fft" or NULL (or "auto") to select the method with the lowest estimated
+ * cost. Methods other than "direct" are only supported by the large kernels, "separable" only by separable kernels.
+ * @param number_nodes_x The number of nodes in the first dimension of the simulated grid.
+ * @param number_nodes_y The number of nodes in the second dimension of the simulated grid.
+ * @return 0 on success, 1 if the method is not supported by the kernel.
+ */
+int init_kernel_method(kernel_t *kernel, const char *method_name, int number_nodes_x, int number_nodes_y);
+
+/**
+ * Estimates the cost of computing the neighborhood sums of a node with the kernel's method, in multiply-adds of the
+ * direct method (the units in which init_kernel_method() selects the cheapest method).
+ *
+ * @param kernel The kernel, its method set by init_kernel_method().
+ * @param number_nodes_x The number of nodes in the first dimension of the simulated grid.
+ * @param number_nodes_y The number of nodes in the second dimension of the simulated grid.
+ * @return The estimated cost per node.
+ */
+double kernel_node_cost(const kernel_t *kernel, int number_nodes_x, int number_nodes_y);
+
+/**
+ * Returns the name of a kernel method.
+ *
+ * @param method The method.
+ * @return The name, as accepted by init_kernel_method().
+ */
+const char *kernel_method_name(kernelmethod_t method);
+
+/**
+ * Frees the neighbor tables of a kernel.
+ *
+ * @param kernel The kernel to free.
+ */
+void free_kernel(kernel_t *kernel);
+
+/**
+ * Allocates the buffers for computing the neighborhood sums of a range of rows. Only needed for kernels using
+ * KERNEL_METHOD_SEPARABLE or KERNEL_METHOD_FFT.
+ *
+ * @param workspace The workspace to initialize.
+ * @param kernel The kernel.
+ * @param number_nodes_y The number of nodes in the second dimension of the simulated grid.
+ * @param start_x First row (inclusive) for which the sums are computed.
+ * @param end_x Last row (exclusive) for which the sums are computed.
+ */
+void init_kernel_workspace(kernelworkspace_t *workspace, const kernel_t *kernel, int number_nodes_y, int start_x,
+                           int end_x);
+
+/**
+ * Frees the buffers of a workspace.
+ *
+ * @param workspace The workspace initialized with init_kernel_workspace().
+ */
+void free_kernel_workspace(kernelworkspace_t *workspace);
+
+/**
+ * Computes the (weighted) direct and indirect neighborhood sums of the rows of a workspace into its d_sums and
+ * id_sums, using the kernel's method. The sums equal those of kernel_sum_table() up to rounding.
+ *
+ * @param kernel The kernel using KERNEL_METHOD_SEPARABLE or KERNEL_METHOD_FFT.
+ * @param workspace The workspace of the rows.
+ * @param number_nodes_x The number of nodes in the first dimension of nodegrid.
+ * @param number_nodes_y The number of nodes in the second dimension of nodegrid.
+ * @param nodegrid 2D array of nodes with their current energy level. Size number_nodes_x * number_nodes_y.
+ */
+void kernel_sum_planes(const kernel_t *kernel, kernelworkspace_t *workspace, int number_nodes_x, int number_nodes_y,
+                       nodeval_t **nodegrid);
+
+/**
+ * Checks if the neighbors of a kernel have weights other than 1.
+ *
+ * @param kernel The kernel.
+ * @return 1 for the weighted<r>, gaussian<r> and mexicanhat<r> kernels, 0 otherwise.
+ */
+static inline int kernel_is_weighted(const kernel_t *kernel) {
+    return kernel->type == KERNEL_TYPE_WEIGHTED || kernel->type == KERNEL_TYPE_GAUSSIAN
+           || kernel->type == KERNEL_TYPE_MEXICANHAT;
+}
 
 /**
  * Returns a function pointer to function of the direct neighborhood kernel.
  *
- * @param name The name of the required function. (Currently not implemented.)
- * @return A function pointer to the specific function.
+ * @param name The name of the required kernel. NULL or an empty name selects the default kernel.
+ * @return A function pointer to the specific function. NULL for kernels without a kernel function, i.e., the
+ * radius<r> and weighted<r> kernels, which are gathered using gather_kernel_neighbors().
  */
-kernelfunc_t d_kernel_function_factory(char *name);
+kernelfunc_t d_kernel_function_factory(const char *name);
 
 /**
  * Returns a function pointer to function of the indirect neighborhood kernel.
  *
- * @param name The name of the required function. (Currently not implemented.)
- * @return A function pointer to the specific function.
+ * @param name The name of the required kernel. NULL or an empty name selects the default kernel.
+ * @return A function pointer to the specific function. NULL for kernels without a kernel function, i.e., the
+ * radius<r> and weighted<r> kernels, which are gathered using gather_kernel_neighbors().
+ */
+kernelfunc_t id_kernel_function_factory(const char *name);
+
+/**
+ * Gathers the (weighted) energy levels of a neighborhood of one specific node of the node grid.
+ *
+ * @param result The array to store the kernel into. Length number_neighbors required.
+ * @param number_neighbors The number of neighbors in the neighborhood.
+ * @param neighbors The neighborhood. Length: number_neighbors.
+ * @param number_nodes_x The number of nodes in the first dimension of nodes.
+ * @param number_nodes_y The number of nodes in the second dimension of nodes.
+ * @param nodegrid 2D array of nodes with their current energy level. Size number_nodes_x * number_nodes_y.
+ * @param x The x-Coordinate of the specific node for which the kernel is to be executed for.
+ * @param y The y-Coordinate of the specific node for which the kernel is to be executed for.
+ *
+ * @return The number of neighbors generated, i.e., the length of the given result array.
  */
-kernelfunc_t id_kernel_function_factory(char *name);
+int gather_kernel_neighbors(nodeval_t *result, int number_neighbors, const kernelneighbor_t *neighbors,
+                            int number_nodes_x, int number_nodes_y, nodeval_t **nodegrid, int x, int y);
 
 /**
  * Calculates the direct kernel for one specific node of the node grid, i.e., the direct neighborhood.
@@ -56,4 +372,185 @@ int d_kernel_4neighbors(nodeval_t *result, int number_nodes_x, int number_nodes_
  */
 int id_kernel_4neighbors(nodeval_t *result, int number_nodes_x, int number_nodes_y, nodeval_t **nodegrid, int x, int y);
 
+/**
+ * Calculates the direct kernel of the 8neighbors kernel, i.e., the 8 surrounding nodes.
+ *
+ * @param result The array to store the kernel into. Length 8 required.
+ * @param number_nodes_x The number of nodes in the first dimension of nodes.
+ * @param number_nodes_y The number of nodes in the second dimension of nodes.
+ * @param nodegrid 2D array of nodes with their current energy level. Size number_nodes_x * number_nodes_y.
+ * @param x The x-Coordinate of the specific node for which the kernel is to be executed for.
+ * @param y The y-Coordinate of the specific node for which the kernel is to be executed for.
+ *
+ * @return The number of neighbors generated, i.e., the length of the given result array.
+ */
+int d_kernel_8neighbors(nodeval_t *result, int number_nodes_x, int number_nodes_y, nodeval_t **nodegrid, int x, int y);
+
+/**
+ * Calculates the indirect kernel of the 8neighbors kernel, i.e., the ring of 16 nodes at distance 2.
+ *
+ * @param result The array to store the kernel into. Length 16 required.
+ * @param number_nodes_x The number of nodes in the first dimension of nodes.
+ * @param number_nodes_y The number of nodes in the second dimension of nodes.
+ * @param nodegrid 2D array of nodes with their current energy level. Size number_nodes_x * number_nodes_y.
+ * @param x The x-Coordinate of the specific node for which the kernel is to be executed for.
+ * @param y The y-Coordinate of the specific node for which the kernel is to be executed for.
+ *
+ * @return The number of neighbors generated, i.e., the length of the given result array.
+ */
+int id_kernel_8neighbors(nodeval_t *result, int number_nodes_x, int number_nodes_y, nodeval_t **nodegrid, int x, int y);
+
+/*
+ * Inlined neighborhood sums for the specialized sweeps. rows points to the row of the node, rows[dx] is the row at
+ * x offset dx or NULL outside of the grid. If checked is 0, all neighbors must be within the grid.
+ * The sums are accumulated in the same order as the kernel functions and process() do, so that the specialized sweeps
+ * produce exactly the results of the reference engine if all model parameters are 1.
+ */
+
+/**
+ * Calculates the direct and indirect sums of the 4neighbors kernel for one node.
+ *
+ * @param rows The rows around the node, indexed by x offset. Rows outside the grid are NULL.
+ * @param j The y-Coordinate of the node.
+ * @param number_nodes_y The number of nodes in the second dimension of nodes.
+ * @param checked 0 if all neighbors are known to be within the grid, 1 otherwise.
+ * @param d_sum_result The sum of the direct neighborhood is written to this pointer.
+ * @param id_sum_result The sum of the indirect neighborhood is written to this pointer.
+ */
+static inline void kernel_sums_4neighbors(const nodeval_t *const *rows, int j, int number_nodes_y, int checked,
+                                          nodeval_t *d_sum_result, nodeval_t *id_sum_result) {
+    const nodeval_t *left = rows[-1];
+    const nodeval_t *row = rows[0];
+    const nodeval_t *right = rows[1];
+    nodeval_t d_sum = 0;
+    nodeval_t id_sum = 0;
+    if (!checked) {
+        d_sum += left[j];
+        d_sum += row[j - 1];
+        d_sum += row[j + 1];
+        d_sum += right[j];
+        id_sum += left[j - 1];
+        id_sum += left[j + 1];
+        id_sum += right[j - 1];
+        id_sum += right[j + 1];
+    } else {
+        int has_down = j - 1 >= 0;
+        int has_up = j + 1 < number_nodes_y;
+        if (left != NULL) {
+            d_sum += left[j];
+        }
+        if (has_down) {
+            d_sum += row[j - 1];
+        }
+        if (has_up) {
+            d_sum += row[j + 1];
+        }
+        if (right != NULL) {
+            d_sum += right[j];
+        }
+        if (left != NULL && has_down) {
+            id_sum += left[j - 1];
+        }
+        if (left != NULL && has_up) {
+            id_sum += left[j + 1];
+        }
+        if (right != NULL && has_down) {
+            id_sum += right[j - 1];
+        }
+        if (right != NULL && has_up) {
+            id_sum += right[j + 1];
+        }
+    }
+    *d_sum_result = d_sum;
+    *id_sum_result = id_sum;
+}
+
+/**
+ * Calculates the direct and indirect sums of the 8neighbors kernel for one node.
+ *
+ * @param rows The rows around the node, indexed by x offset. Rows outside the grid are NULL.
+ * @param j The y-Coordinate of the node.
+ * @param number_nodes_y The number of nodes in the second dimension of nodes.
+ * @param checked 0 if all neighbors are known to be within the grid, 1 otherwise.
+ * @param d_sum_result The sum of the direct neighborhood is written to this pointer.
+ * @param id_sum_result The sum of the indirect neighborhood is written to this pointer.
+ */
+static inline void kernel_sums_8neighbors(const nodeval_t *const *rows, int j, int number_nodes_y, int checked,
+                                          nodeval_t *d_sum_result, nodeval_t *id_sum_result) {
+    nodeval_t d_sum = 0;
+    nodeval_t id_sum = 0;
+    if (!checked) {
+        d_sum += rows[-1][j - 1];
+        d_sum += rows[-1][j];
+        d_sum += rows[-1][j + 1];
+        d_sum += rows[0][j - 1];
+        d_sum += rows[0][j + 1];
+        d_sum += rows[1][j - 1];
+        d_sum += rows[1][j];
+        d_sum += rows[1][j + 1];
+        for (int y = j - 2; y <= j + 2; y++) {
+            id_sum += rows[-2][y];
+        }
+        for (int x = -1; x <= 1; x++) {
+            id_sum += rows[x][j - 2];
+            id_sum += rows[x][j + 2];
+        }
+        for (int y = j - 2; y <= j + 2; y++) {
+            id_sum += rows[2][y];
+        }
+    } else {
+        for (int x = -1; x <= 1; x++) {
+            if (rows[x] != NULL) {
+                for (int y = j - 1; y <= j + 1; y++) {
+                    if ((x != 0 || y != j) && y >= 0 && y < number_nodes_y) {
+                        d_sum += rows[x][y];
+                    }
+                }
+            }
+        }
+        for (int x = -2; x <= 2; x++) {
+            if (rows[x] != NULL) {
+                for (int y = j - 2; y <= j + 2; y++) {
+                    if ((x == -2 || x == 2 || y == j - 2 || y == j + 2) && y >= 0 && y < number_nodes_y) {
+                        id_sum += rows[x][y];
+                    }
+                }
+            }
+        }
+    }
+    *d_sum_result = d_sum;
+    *id_sum_result = id_sum;
+}
+
+/**
+ * Calculates the sum of a neighborhood given by a neighbor table for one node.
+ *
+ * @param rows The rows around the node, indexed by x offset. Rows outside the grid are NULL.
+ * @param j The y-Coordinate of the node.
+ * @param number_nodes_y The number of nodes in the second dimension of nodes.
+ * @param number_neighbors The number of neighbors in the neighborhood.
+ * @param neighbors The neighborhood. Length: number_neighbors.
+ * @param checked 0 if all neighbors are known to be within the grid, 1 otherwise.
+ * @param weighted 1 if the weights of the neighbors are to be applied, 0 if all weights are 1.
+ * @return The (weighted) sum.
+ */
+static inline nodeval_t kernel_sum_table(const nodeval_t *const *rows, int j, int number_nodes_y,
+                                         int number_neighbors, const kernelneighbor_t *neighbors,
+                                         int checked, int weighted) {
+    nodeval_t sum = 0;
+    for (int k = 0; k < number_neighbors; k++) {
+        const nodeval_t *row = rows[neighbors[k].x];
+        int y = j + neighbors[k].y;
+        if (checked && (row == NULL || y < 0 || y >= number_nodes_y)) {
+            continue;
+        }
+        if (weighted) {
+            sum += neighbors[k].weight * row[y];
+        } else {
+            sum += row[y];
+        }
+    }
+    return sum;
+}
+
 #endif //BRAINSIMULATION_KERNELS_H
@@ -2,6 +2,13 @@
 #include "utils.h"
 #include "brainsimulation.h"
 #include "brainsetup.h"
+#include "framestream.h"
+#include "connectome.h"
+#include "volume.h"
+#include "regions.h"
+#include "events.h"
+#include "metrics.h"
+#include "trace.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -19,6 +26,13 @@ const char *FILE_INPUTNODES_PATHS[] = {"./testinput/input10-10.csv", "./testinpu
                                        "./testinput/input30-30.csv",
                                        "./testinput/input100-100.csv"};
 
+// adds the bytes of a written output file to the live metrics, if any
+static void count_output(metrics_t *metrics, long bytes) {
+	if (metrics != NULL) {
+		add_metrics_output(metrics, (uint64_t) bytes);
+	}
+}
+
 static void print_help() {
 	printf("Brainsimulation. Simulates the energy transfer over time between nodes in the human brain.\n");
 	printf("\tRun with: brainsimulation %s X_NODES %s Y_NODES %s SIMULATION_TICKS [OPTIONAL PARAMETERS]\n",
@@ -83,6 +97,94 @@ static void print_help() {
 	printf("\t%s DURATION_TICKS: The generation duration (in ticks) for a bitmap's signal.\n", FLAG_BITMAP_DURATION);
 	printf("\t\t (analogous to a frame's duration in a movie)\n");
 	printf("\t\t Single integer parameter.\n");
+	printf("\t%s PATH: Raw frame stream (file, named pipe or - for stdin) to be used for specifying sin-frequencies.\n",
+		FLAG_FREQ_STREAM);
+	printf("\t\t Frames are read while simulating and interpreted like bitmaps, using %s, %s and %s.\n",
+		FLAG_MIN_BITMAP_FREQ, FLAG_MAX_BITMAP_FREQ, FLAG_BITMAP_DURATION);
+	printf("\t\t The stream starts with the 4 characters BSFS, followed by width, height and channels (1 or 3)\n");
+	printf("\t\t as 32-bit little-endian integers. Each frame is width * height * channels bytes, top row first.\n");
+	printf("\t\t Can be used together with %s. Cannot be used together with %s.\n", FLAG_FREQUENCIES, FLAG_FREQ_BITMAPS);
+	printf("\t\t Single parameter.\n");
+	printf("\t%s NAME: The kernel defining the direct and indirect neighborhood of each node.\n", FLAG_KERNEL);
+	printf("\t\t 4neighbors (default), 8neighbors, radius<r> or weighted<r> (e.g., radius3),\n");
+	printf("\t\t gaussian<r> or mexicanhat<r> (e.g., gaussian20, r <= 64).\n");
+	printf("\t\t Single parameter.\n");
+	printf("\t%s METHOD: The method to compute the sums of the kernel with: direct, separable (gaussian<r> only),\n",
+		FLAG_KERNEL_METHOD);
+	printf("\t\t fft (gaussian<r> and mexicanhat<r> only) or auto (default, the fastest for the kernel and grid).\n");
+	printf("\t\t Single parameter.\n");
+	printf("\t%s PATH: Text file of long-range connections, one per line: source_x source_y target_x target_y weight.\n",
+		FLAG_CONNECTIONS);
+	printf("\t\t Adds weight times the source's energy level of the previous tick to the target. Single parameter.\n");
+	printf("\t%s: Computes the observations by superposing the impulse responses of all input and start nodes.\n",
+		FLAG_SUPERPOSITION);
+	printf("\t\t Simulates one impulse per node, then convolves. Cannot be used with ensembles or %s.\n",
+		FLAG_FREQ_STREAM);
+	printf("\t%s DIR: Directory to cache impulse responses in, reused by runs of the same configuration.\n",
+		FLAG_IMPULSE_CACHE);
+	printf("\t\t Single parameter. Enables %s.\n", FLAG_SUPERPOSITION);
+	printf("\t%s: Skips intervals of at least %d ticks without inputs at once using 2D sine transforms.\n",
+		FLAG_FAST_FORWARD, FAST_FORWARD_MIN_TICKS);
+	printf("\t\t Only for kernels of radius 1 (e.g., 4neighbors) and uniform model parameters.\n");
+	printf("\t%s TOLERANCE: Stops once no energy level changes by more than TOLERANCE for %d ticks (without inputs),\n",
+		FLAG_EARLY_STOP, EARLY_STOP_STEADY_TICKS);
+	printf("\t\t the observations repeat the input period within TOLERANCE, or the grid diverges to inf or NaN.\n");
+	printf("\t\t The remaining observations are extrapolated. Single parameter.\n");
+	printf("\t%s THRESHOLD: Records when nodes rise to or above / fall below THRESHOLD, for all nodes,\n",
+		FLAG_EVENTS);
+	printf("\t\t written to events.csv (tick, x, y, member, event, energy value). Single parameter.\n");
+	printf("\t%s: Also records local maxima at or above the threshold of %s.\n", FLAG_EVENT_PEAKS, FLAG_EVENTS);
+	printf("\t%s X_INDICES, %s Y_INDICES: Only records the events of these nodes.\n", FLAG_X_EVENTNODES,
+		FLAG_Y_EVENTNODES);
+	printf("\t%s PATH: Publishes the progress in a memory-mapped file instead of printing it every 100 ticks:\n",
+		FLAG_METRICS);
+	printf("\t\t ticks, ticks per second, remaining time, memory, output bytes and the times of each thread.\n");
+	printf("\t\t Watch it with brainwatch PATH. Single parameter. Not used for volumes and regions.\n");
+	printf("\t%s PATH: Writes the phases of each thread (compute, barriers, inputs, observations, I/O) to a Chrome\n",
+		FLAG_TRACE);
+	printf("\t\t trace at exit, viewable in Perfetto. Single parameter. Not used for volumes and regions.\n");
+	printf("\t%s N: Traces only every Nth tick to keep the trace small on long runs. Default: 1.\n",
+		FLAG_TRACE_SAMPLE);
+	printf("\t\t Single integer parameter.\n");
+	printf("Model parameters (optional, the defaults are set at compile time and are usually 1):\n");
+	printf("\t%s A1: Factor multiplied with the direct neighbor-energy.\n", FLAG_D_NEIGHBORFACTOR);
+	printf("\t%s A2: Factor multiplied with the indirect neighbor-energy.\n", FLAG_ID_NEIGHBORFACTOR);
+	printf("\t%s B: Factor multiplied with the historical energy for the slope.\n", FLAG_ENERGY_FACTOR);
+	printf("\t%s G: Factor multiplied with the historical energy for the new energy state.\n", FLAG_ENERGY_WEIGHT);
+	printf("\t%s E: Factor multiplied with the current slope vector.\n", FLAG_DELTA_FACTOR);
+	printf("\t%s D: Factor multiplied with the historical slope.\n", FLAG_SLOPE_FACTOR);
+	printf("\t%s H: Factor multiplied with the new slope for the new energy state.\n", FLAG_SLOPE_WEIGHT);
+	printf("\t%s DAMPING: Ratio of energy lost per tick, the new energy level is divided by (1 + DAMPING).\n",
+		FLAG_DAMPING);
+	printf("\t\t Single floating point parameter each.\n");
+	printf("\t\t Multiple values simulate an ensemble: one member per value, all simulated in a single run.\n");
+	printf("\t\t All parameters with multiple values must have the same number of values.\n");
+	printf("\t\t Outputs are written per member (output<x>-<y>-m<member>.csv), parameters to ensemble.csv.\n");
+	printf("\t%s, %s, ..., %s PATH [MIN MAX]: Per-node map of a model parameter\n", FLAG_D_NEIGHBORFACTOR_MAP,
+		FLAG_ID_NEIGHBORFACTOR_MAP, FLAG_DAMPING_MAP);
+	printf("\t\t (the parameter flag followed by \"map\"). PATH is a 24-bit bitmap (.bmp), whose color sums are mapped\n");
+	printf("\t\t linearly from MIN (0) to MAX (765), or a raw file of x * y doubles, node (x, y) at index x * y-size + y.\n");
+	printf("\t\t Cannot be combined with ensembles.\n");
+	printf("Volume parameters (optional, simulate a 3D volume instead of a 2D grid):\n");
+	printf("\t%s Z_NODES: Size of the simulated node volume on the Z axis.\n", FLAG_Z_NODES);
+	printf("\t\t Single integer parameter. Requires %s, %s, %s and %s.\n", FLAG_X_NODES, FLAG_Y_NODES,
+		FLAG_X_OBSERVATIONNODES, FLAG_Y_OBSERVATIONNODES);
+	printf("\t%s, %s, %s Z_INDICES: Z indices of the observed, start and frequency generating nodes.\n",
+		FLAG_Z_OBSERVATIONNODES, FLAG_START_NODES_Z, FLAG_FREQ_NODES_Z);
+	printf("\t\t Must have the same number of parameters as their x and y indices (missing ones are 0).\n");
+	printf("\t\t Volumes use the kernels 6neighbors (default), 18neighbors or 26neighbors (%s) and the uniform\n",
+		FLAG_KERNEL);
+	printf("\t\t model parameters. Outputs are written to output<x>-<y>-<z>.csv.\n");
+	printf("\t\t Flags of the other modes and engine features (e.g., %s, %s, %s) are ignored with a warning.\n",
+		FLAG_FAST_FORWARD, FLAG_EARLY_STOP, FLAG_KERNEL_METHOD);
+	printf("Region parameters (optional, simulate multiple coupled grids instead of a single grid):\n");
+	printf("\t%s PATH: Text file of regions, one entry per line:\n", FLAG_REGIONS);
+	printf("\t\t region NAME X_NODES Y_NODES [KERNEL] [FACTOR=VALUE ...] (e.g., damping=0.01)\n");
+	printf("\t\t start NAME x y level | observe NAME x y | freq NAME x y frequency\n");
+	printf("\t\t link SOURCE_NAME source_x source_y TARGET_NAME target_x target_y weight\n");
+	printf("\t\t Regions default to %s, %s and the model parameters of the command line. Requires %s.\n",
+		FLAG_KERNEL, FLAG_KERNEL_METHOD, FLAG_TICKS);
+	printf("\t\t Outputs are written to output<name>-<x>-<y>.csv.\n");
 	printf("\n");
 	printf("Example:\nbrainsimulation %s 200 %s 200 %s 5000 %s 50 51 %s 50 51 %s 10 11 %s 10 11 %s 10 11 %s 3 5 %s 25 26 %s 25 26\n",
 		FLAG_X_NODES, FLAG_Y_NODES, FLAG_TICKS, FLAG_X_OBSERVATIONNODES, FLAG_Y_OBSERVATIONNODES, FLAG_START_LEVELS,
@@ -94,6 +196,143 @@ static void print_help() {
 	printf("\n");
 }
 
+// warns about each of the given flags that is set, as the kind of simulation ignores it
+static void warn_unsupported_flags(const int argc, const char *argv[], const char *simulation_kind,
+	const char *const *flags, int number_flags) {
+	for (int i = 0; i < number_flags; i++) {
+		if (contains_flag(argc, argv, flags[i])) {
+			printf("WARNING: \"%s\" is not supported for %s and will be ignored.\n", flags[i], simulation_kind);
+		}
+	}
+}
+
+// parses the settings of a volume, simulates it and writes its outputs
+static int run_volume(const int argc, const char *argv[]) {
+	double tick_ms = 1;
+	int num_observationnodes = 0;
+	int num_inputnodes = 0;
+	int num_startnodes = 0;
+	simulationoptions_t options;
+	init_simulation_options(&options);
+	printf("Brainsimulation: Run with --help for help.\n");
+	printf("Parsing volume input parameters.\n");
+	int number_nodes_x = parse_int_arg(argc, argv, FLAG_X_NODES);
+	int number_nodes_y = parse_int_arg(argc, argv, FLAG_Y_NODES);
+	int number_nodes_z = parse_int_arg(argc, argv, FLAG_Z_NODES);
+	if (number_nodes_x < 1 || number_nodes_y < 1 || number_nodes_z < 1) {
+		printf("ERROR: Volumes require positive sizes for %s, %s and %s.\n", FLAG_X_NODES, FLAG_Y_NODES,
+			FLAG_Z_NODES);
+		return 1;
+	}
+	nodetimeseries_t *observationnodes = init_observation_timeseries_from_sh(argc, argv, &num_observationnodes);
+	if (observationnodes == NULL) {
+		return 1;
+	}
+	int num_ticks = observationnodes->timeseries_ticks;
+	if (contains_flag(argc, argv, FLAG_METRICS)) {
+		printf("WARNING: Live metrics are not published for volumes. Printing the progress instead.\n");
+	}
+	if (contains_flag(argc, argv, FLAG_TRACE)) {
+		printf("WARNING: Volumes are not traced.\n");
+	}
+	const char *const unsupported_flags[] = {FLAG_EARLY_STOP, FLAG_EVENTS, FLAG_FAST_FORWARD, FLAG_SUPERPOSITION,
+		FLAG_IMPULSE_CACHE, FLAG_CONNECTIONS, FLAG_KERNEL_METHOD, FLAG_ALL_OBSERVATIONNODES, FLAG_FREQ_BITMAPS,
+		FLAG_FREQ_STREAM, FLAG_D_NEIGHBORFACTOR_MAP, FLAG_ID_NEIGHBORFACTOR_MAP, FLAG_ENERGY_FACTOR_MAP,
+		FLAG_ENERGY_WEIGHT_MAP, FLAG_DELTA_FACTOR_MAP, FLAG_SLOPE_FACTOR_MAP, FLAG_SLOPE_WEIGHT_MAP, FLAG_DAMPING_MAP};
+	warn_unsupported_flags(argc, argv, "volumes", unsupported_flags,
+		(int) (sizeof(unsupported_flags) / sizeof(unsupported_flags[0])));
+	int *z_indices = malloc(num_observationnodes * sizeof(int));
+	parse_z_indices_from_sh(argc, argv, FLAG_Z_OBSERVATIONNODES, num_observationnodes, z_indices);
+	for (int i = 0; i < num_observationnodes; i++) {
+		observationnodes[i].z_index = z_indices[i];
+	}
+	free(z_indices);
+	nodelevel_t *startnodes = init_start_levels_3d_from_sh(argc, argv, &num_startnodes);
+	nodeinputseries_t *inputs = NULL;
+	if (contains_flag(argc, argv, FLAG_FREQUENCIES)) {
+		printf("Parsing input of frequency nodes from command line.\n");
+		inputs = generate_input_frequencies_from_sh(argc, argv, &num_inputnodes, tick_ms);
+		z_indices = malloc((num_inputnodes > 0 ? num_inputnodes : 1) * sizeof(int));
+		parse_z_indices_from_sh(argc, argv, FLAG_FREQ_NODES_Z, num_inputnodes, z_indices);
+		for (int i = 0; i < num_inputnodes; i++) {
+			inputs[i].z_index = z_indices[i];
+		}
+		free(z_indices);
+	}
+	if (contains_flag(argc, argv, FLAG_KERNEL)) {
+		options.kernel_name = parse_string_arg(argc, argv, FLAG_KERNEL);
+	}
+	parse_model_parameters_from_sh(argc, argv, &options.parameters);
+	unsigned int returncode = simulate_volume(tick_ms, num_ticks, number_nodes_x, number_nodes_y, number_nodes_z,
+		num_startnodes, startnodes, num_observationnodes, observationnodes, num_inputnodes, inputs, &options);
+	free(startnodes);
+	if (returncode != 0) {
+		printf("Simulation failed with return code %u.\n", returncode);
+		return returncode;
+	}
+	printf("Output:\n");
+	for (int j = 0; j < num_observationnodes; ++j) {
+		char filename[100];
+		sprintf(filename, "./testoutput/output%d-%d-%d.csv", observationnodes[j].x_index,
+			observationnodes[j].y_index, observationnodes[j].z_index);
+		printf("filename: %s\n", filename);
+		output_to_csv(filename, observationnodes[j].timeseries_ticks, observationnodes[j].timeseries);
+	}
+	printf("Finished.\n");
+	return 0;
+}
+
+// parses the region file, simulates all regions and writes their outputs
+static int run_regions(const int argc, const char *argv[]) {
+	double tick_ms = 1;
+	simulationoptions_t options;
+	init_simulation_options(&options);
+	printf("Brainsimulation: Run with --help for help.\n");
+	printf("Parsing region input parameters.\n");
+	int num_ticks = parse_int_arg(argc, argv, FLAG_TICKS);
+	if (num_ticks < 1) {
+		printf("ERROR: Regions require a positive number of ticks (%s).\n", FLAG_TICKS);
+		return 1;
+	}
+	if (contains_flag(argc, argv, FLAG_KERNEL)) {
+		options.kernel_name = parse_string_arg(argc, argv, FLAG_KERNEL);
+	}
+	if (contains_flag(argc, argv, FLAG_KERNEL_METHOD)) {
+		options.kernel_method = parse_string_arg(argc, argv, FLAG_KERNEL_METHOD);
+	}
+	parse_model_parameters_from_sh(argc, argv, &options.parameters);
+	if (contains_flag(argc, argv, FLAG_METRICS)) {
+		printf("WARNING: Live metrics are not published for regions. Printing the progress instead.\n");
+	}
+	if (contains_flag(argc, argv, FLAG_TRACE)) {
+		printf("WARNING: Regions are not traced.\n");
+	}
+	regionset_t *regions = load_regions(parse_string_arg(argc, argv, FLAG_REGIONS), num_ticks, tick_ms, &options);
+	if (regions == NULL) {
+		return 1;
+	}
+	unsigned int returncode = simulate_regions(tick_ms, num_ticks, regions);
+	if (returncode != 0) {
+		printf("Simulation failed with return code %u.\n", returncode);
+		free_regions(regions);
+		return returncode;
+	}
+	printf("Output:\n");
+	for (int r = 0; r < regions->number_regions; r++) {
+		const region_t *region = &regions->regions[r];
+		for (int j = 0; j < region->num_observationnodes; ++j) {
+			char filename[100];
+			sprintf(filename, "./testoutput/output%s-%d-%d.csv", region->name, region->observationnodes[j].x_index,
+				region->observationnodes[j].y_index);
+			printf("filename: %s\n", filename);
+			output_to_csv(filename, region->observationnodes[j].timeseries_ticks, region->observationnodes[j].timeseries);
+		}
+	}
+	free_regions(regions);
+	printf("Finished.\n");
+	return 0;
+}
+
 int main(const int argc, const char *argv[]) {
 	int num_observationnodes = 0;
 	int num_inputnodes = 0;
@@ -104,6 +343,11 @@ int main(const int argc, const char *argv[]) {
 	nodetimeseries_t *observationnodes;
 	nodeval_t **nodegrid;
 	nodeinputseries_t *inputs;
+	simulationoptions_t options;
+	init_simulation_options(&options);
+	struct timeval setup_start, setup_end;
+	get_daytime(&setup_start);
+	uint64_t trace_setup_start = trace_clock_ns();
 
 	//unsigned int size_x;
 	//unsigned int size_y;
@@ -118,6 +362,10 @@ int main(const int argc, const char *argv[]) {
 	if (contains_flag(argc, argv, FLAG_HELP)) {
 		print_help();
 		return 0;
+	} else if (contains_flag(argc, argv, FLAG_Z_NODES)) {
+		return run_volume(argc, argv);
+	} else if (contains_flag(argc, argv, FLAG_REGIONS)) {
+		return run_regions(argc, argv);
 	} else if (argc == 1){
 		// no arguments were given
 		printf("Brainsimulation: Run with --help for help.\n");
@@ -186,14 +434,132 @@ int main(const int argc, const char *argv[]) {
 				printf("\tCommand-line specified input nodes (using \"%s\") will be ignored.\n", FLAG_FREQUENCIES);
 			}
 			inputs = generate_input_frequencies_from_sh_bitmap(argc, argv, &num_inputnodes, tick_ms);
+		} else if (contains_flag(argc, argv, FLAG_FREQ_STREAM)) {
+			//all inputs are read from the frame stream
+			num_inputnodes = 0;
+			inputs = NULL;
 		} else {
             printf("No input about frequencies of nodes found. Using default values.\n");
             inputs = generate_input_frequencies_default(&num_inputnodes, tick_ms);
 		}
 	}
-    simulate(tick_ms, num_ticks, number_nodes_x, number_nodes_y, nodegrid,
-		num_observationnodes, observationnodes, num_inputnodes, inputs);
+	if (argc > 1 && contains_flag(argc, argv, FLAG_KERNEL)) {
+		options.kernel_name = parse_string_arg(argc, argv, FLAG_KERNEL);
+	}
+	if (argc > 1 && contains_flag(argc, argv, FLAG_KERNEL_METHOD)) {
+		options.kernel_method = parse_string_arg(argc, argv, FLAG_KERNEL_METHOD);
+	}
+	if (argc > 1 && contains_flag(argc, argv, FLAG_CONNECTIONS)) {
+		options.connectome = load_connectome(parse_string_arg(argc, argv, FLAG_CONNECTIONS), number_nodes_x,
+			number_nodes_y);
+		if (options.connectome == NULL) {
+			return 1;
+		}
+	}
+	if (argc > 1 && contains_flag(argc, argv, FLAG_SUPERPOSITION)) {
+		options.superposition = 1;
+	}
+	if (argc > 1 && contains_flag(argc, argv, FLAG_FAST_FORWARD)) {
+		options.fast_forward = 1;
+	}
+	if (argc > 1 && contains_flag(argc, argv, FLAG_EARLY_STOP)) {
+		options.early_stop_tolerance = parse_nodeval_arg(argc, argv, FLAG_EARLY_STOP);
+		if (!(options.early_stop_tolerance > 0)) {
+			printf("ERROR: The tolerance of %s must be positive.\n", FLAG_EARLY_STOP);
+			return 1;
+		}
+	}
+	if (argc > 1 && contains_flag(argc, argv, FLAG_EVENTS)) {
+		options.events = init_event_log_from_sh(argc, argv, number_nodes_x, number_nodes_y);
+		if (options.events == NULL) {
+			return 1;
+		}
+	}
+	if (argc > 1 && contains_flag(argc, argv, FLAG_IMPULSE_CACHE)) {
+		options.superposition = 1;
+		options.impulse_cache = parse_string_arg(argc, argv, FLAG_IMPULSE_CACHE);
+	}
+	if (argc > 1) {
+		parse_model_parameters_from_sh(argc, argv, &options.parameters);
+		unsigned int map_error;
+		options.parameter_maps = parse_parameter_maps_from_sh(argc, argv, number_nodes_x, number_nodes_y,
+			&options.parameters, &map_error);
+		if (map_error) {
+			return 1;
+		}
+		options.ensemble_parameters = parse_ensemble_parameters_from_sh(argc, argv, &options.parameters,
+			&options.ensemble_size);
+		if (options.ensemble_size == 0) {
+			return 1;
+		}
+		if (options.ensemble_size > 1) {
+			printf("Simulating an ensemble of %d parameter sets.\n", options.ensemble_size);
+			init_ensemble_observation_timeseries(observationnodes, num_observationnodes, options.ensemble_size);
+		}
+	}
+	if (argc > 1 && contains_flag(argc, argv, FLAG_FREQ_STREAM)) {
+		if (contains_flag(argc, argv, FLAG_FREQ_BITMAPS)) {
+			printf("WARNING: \"%s\" and \"%s\" were set at the same time. This is not supported.\n", FLAG_FREQ_STREAM, FLAG_FREQ_BITMAPS);
+			printf("\tThe frame stream (specified using \"%s\") will be ignored.\n", FLAG_FREQ_STREAM);
+		} else {
+			printf("Opening frame stream for frequency input.\n");
+			options.input_stream = open_frame_stream_from_sh(argc, argv, number_nodes_x, number_nodes_y, tick_ms);
+			if (options.input_stream == NULL) {
+				return 1;
+			}
+		}
+	}
+	if (argc > 1 && contains_flag(argc, argv, FLAG_METRICS)) {
+		options.metrics = open_metrics(parse_string_arg(argc, argv, FLAG_METRICS), simulation_thread_count(),
+			num_ticks);
+		if (options.metrics == NULL) {
+			return 1;
+		}
+	}
+	if (argc > 1 && contains_flag(argc, argv, FLAG_TRACE)) {
+		int sample_ticks = 1;
+		if (contains_flag(argc, argv, FLAG_TRACE_SAMPLE)) {
+			sample_ticks = parse_int_arg(argc, argv, FLAG_TRACE_SAMPLE);
+			if (sample_ticks < 1) {
+				printf("ERROR: %s must be positive.\n", FLAG_TRACE_SAMPLE);
+				return 1;
+			}
+		}
+		options.trace = open_trace(parse_string_arg(argc, argv, FLAG_TRACE), simulation_thread_count(), num_ticks,
+			sample_ticks);
+		if (options.input_stream != NULL) {
+			set_frame_stream_trace(options.input_stream, &options.trace->stream);
+		}
+	}
+	get_daytime(&setup_end);
+	options.setup_seconds = (double) (setup_end.tv_usec - setup_start.tv_usec) / 1000000 +
+		(double) (setup_end.tv_sec - setup_start.tv_sec);
+	if (options.trace != NULL) {
+		record_trace_event(&options.trace->main, TRACE_SETUP, -1, trace_setup_start, trace_clock_ns());
+	}
+    unsigned int returncode = simulate(tick_ms, num_ticks, number_nodes_x, number_nodes_y, nodegrid,
+		num_observationnodes, observationnodes, num_inputnodes, inputs, &options);
+	if (options.input_stream != NULL) {
+		close_frame_stream(options.input_stream);
+	}
+	if (options.connectome != NULL) {
+		free_connectome(options.connectome);
+	}
+	if (returncode != 0) {
+		printf("Simulation failed with return code %u.\n", returncode);
+		if (options.metrics != NULL) {
+			close_metrics(options.metrics, METRICS_FAILED);
+		}
+		if (options.trace != NULL) {
+			close_trace(options.trace);
+		}
+		return returncode;
+	}
+	if (options.metrics != NULL) {
+		set_metrics_state(options.metrics, METRICS_WRITING_OUTPUT);
+	}
     printf("Output:\n");
+	uint64_t trace_output_start = options.trace != NULL ? trace_clock_ns() : 0;
 	for (int j = 0; j < num_observationnodes; ++j) {
         //printf("    Node %d: (%d|%d):\n", j, observationnodes[j].x_index, observationnodes[j].y_index);
         //int i;
@@ -207,9 +573,37 @@ int main(const int argc, const char *argv[]) {
         strcat(filename, "-");
         sprintf(str, "%d", observationnodes[j].y_index);
         strcat(filename, str);
+        if (options.ensemble_size > 1) {
+            //one file per member, tagged with the member's index in ensemble.csv
+            char member_filename[120];
+            for (int m = 0; m < options.ensemble_size; m++) {
+                sprintf(member_filename, "%s-m%d.csv", filename, m);
+                count_output(options.metrics,
+                             output_to_csv(member_filename, observationnodes[j].timeseries_ticks,
+                                           observationnodes[j].timeseries
+                                           + (size_t) m * observationnodes[j].timeseries_ticks));
+            }
+            continue;
+        }
         strcat(filename, ".csv");
         printf("filename: %s\n", filename);
-        output_to_csv(filename, observationnodes[j].timeseries_ticks, observationnodes[j].timeseries);
+        count_output(options.metrics,
+                     output_to_csv(filename, observationnodes[j].timeseries_ticks, observationnodes[j].timeseries));
+    }
+    if (options.ensemble_size > 1) {
+        count_output(options.metrics, ensemble_to_csv("./testoutput/ensemble.csv", options.ensemble_size,
+                                                      options.ensemble_parameters));
+    }
+    if (options.events != NULL) {
+        count_output(options.metrics, events_to_csv("./testoutput/events.csv", options.events));
+        free_event_log(options.events);
+    }
+    if (options.trace != NULL) {
+        record_trace_event(&options.trace->main, TRACE_OUTPUT, -1, trace_output_start, trace_clock_ns());
+        count_output(options.metrics, close_trace(options.trace));
+    }
+    if (options.metrics != NULL) {
+        close_metrics(options.metrics, METRICS_FINISHED);
     }
     printf("Finished.\n");
     return 0;
@@ -0,0 +1,190 @@
+#include "metrics.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// orders the stores of the sequence counter and the values it guards
+static inline void metrics_fence() {
+#ifdef _MSC_VER
+    MemoryBarrier();
+#else
+    __sync_synchronize();
+#endif
+}
+
+// maps size bytes of a file, creating and sizing it if writable
+static void *map_metrics_file(const char *path, size_t size, int writable) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, writable ? CREATE_ALWAYS : OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                        (DWORD) ((unsigned long long) size >> 32), (DWORD) size, NULL);
+    void *view = NULL;
+    if (mapping != NULL) {
+        view = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+        // the view keeps the mapping alive
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    return view;
+#else
+    int fd = open(path, writable ? O_RDWR | O_CREAT | O_TRUNC : O_RDONLY, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+    // the file is truncated and zero-filled when writable, a file mapped for reading must hold the whole mapping
+    struct stat status;
+    if ((writable && ftruncate(fd, (off_t) size) != 0)
+        || (!writable && (fstat(fd, &status) != 0 || (size_t) status.st_size < size))) {
+        close(fd);
+        return NULL;
+    }
+    void *view = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping keeps the file open
+    close(fd);
+    return view == MAP_FAILED ? NULL : view;
+#endif
+}
+
+static void unmap_metrics_file(const void *view, size_t size) {
+#ifdef _WIN32
+    UnmapViewOfFile(view);
+#else
+    munmap((void *) view, size);
+#endif
+}
+
+// the resident memory of this process in bytes, 0 if unknown
+static uint64_t resident_memory_bytes() {
+#ifdef __linux__
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (fp == NULL) {
+        return 0;
+    }
+    unsigned long long pages = 0;
+    unsigned long long resident = 0;
+    int read = fscanf(fp, "%llu %llu", &pages, &resident);
+    fclose(fp);
+    return read == 2 ? (uint64_t) resident * (uint64_t) sysconf(_SC_PAGESIZE) : 0;
+#else
+    return 0;
+#endif
+}
+
+metrics_t *open_metrics(const char *path, int num_threads, int num_ticks) {
+    size_t size = sizeof(metricspage_t) + (size_t) num_threads * sizeof(threadmetrics_t);
+    void *view = map_metrics_file(path, size, 1);
+    if (view == NULL) {
+        printf("ERROR: Cannot create the metrics file %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    metrics_t *metrics = calloc(1, sizeof(metrics_t));
+    metrics->page = view;
+    metrics->threads = (threadmetrics_t *) (metrics->page + 1);
+    metrics->size = size;
+    metrics->start_ns = metrics_clock_ns();
+    metrics->last_update_ns = metrics->start_ns;
+    metrics->page->version = METRICS_VERSION;
+    metrics->page->num_threads = (uint32_t) num_threads;
+    metrics->page->num_ticks = num_ticks;
+#ifdef _WIN32
+    metrics->page->pid = (int64_t) GetCurrentProcessId();
+#else
+    metrics->page->pid = (int64_t) getpid();
+#endif
+    metrics->page->state = METRICS_SETUP;
+    metrics->page->memory_bytes = resident_memory_bytes();
+    // readers recognize the file once the header is complete
+    metrics_fence();
+    memcpy(metrics->page->magic, METRICS_MAGIC, 4);
+    return metrics;
+}
+
+// publishes the derived values of the given number of completed ticks, the rate is kept if no tick completed since
+// the last update
+static void publish_metrics(metrics_t *metrics, int64_t completed_ticks, uint64_t now) {
+    metricspage_t *page = metrics->page;
+    page->sequence++;
+    metrics_fence();
+    page->elapsed_seconds = (double) (now - metrics->start_ns) * 1e-9;
+    if (completed_ticks > metrics->last_update_tick) {
+        page->ticks_per_second = (double) (completed_ticks - metrics->last_update_tick)
+                                 / ((double) (now - metrics->last_update_ns) * 1e-9);
+        metrics->last_update_tick = completed_ticks;
+    }
+    page->eta_seconds = page->ticks_per_second > 0
+                        ? (double) (page->num_ticks - completed_ticks) / page->ticks_per_second : -1;
+    page->memory_bytes = resident_memory_bytes();
+    metrics_fence();
+    page->sequence++;
+    metrics->last_update_ns = now;
+}
+
+void update_metrics(metrics_t *metrics, int completed_ticks) {
+    metrics->page->tick = completed_ticks;
+    uint64_t now = metrics_clock_ns();
+    if (now - metrics->last_update_ns >= (uint64_t) METRICS_INTERVAL_MS * 1000000u) {
+        publish_metrics(metrics, completed_ticks, now);
+    }
+}
+
+void set_metrics_state(metrics_t *metrics, metricsstate_t state) {
+    if (state == METRICS_SIMULATING) {
+        metrics->page->tick = 0;
+        metrics->last_update_tick = 0;
+        metrics->last_update_ns = metrics_clock_ns();
+    }
+    publish_metrics(metrics, metrics->page->tick, metrics_clock_ns());
+    metrics->page->state = state;
+}
+
+void add_metrics_output(metrics_t *metrics, uint64_t bytes) {
+    metrics->page->output_bytes += bytes;
+}
+
+void close_metrics(metrics_t *metrics, metricsstate_t state) {
+    set_metrics_state(metrics, state);
+    unmap_metrics_file(metrics->page, metrics->size);
+    free(metrics);
+}
+
+const metricspage_t *map_metrics_page(const char *path, size_t *size) {
+    const metricspage_t *page = map_metrics_file(path, sizeof(metricspage_t), 0);
+    if (page == NULL || memcmp(page->magic, METRICS_MAGIC, 4) != 0 || page->version != METRICS_VERSION) {
+        if (page != NULL) {
+            unmap_metrics_file(page, sizeof(metricspage_t));
+        }
+        return NULL;
+    }
+    size_t full_size = sizeof(metricspage_t) + (size_t) page->num_threads * sizeof(threadmetrics_t);
+    unmap_metrics_file(page, sizeof(metricspage_t));
+    *size = full_size;
+    return map_metrics_file(path, full_size, 0);
+}
+
+void read_metrics_page(const metricspage_t *page, metricspage_t *copy) {
+    uint64_t sequence;
+    do {
+        sequence = page->sequence;
+        metrics_fence();
+        memcpy(copy, (const void *) page, sizeof(metricspage_t));
+        metrics_fence();
+    } while ((sequence & 1) || sequence != page->sequence);
+}
+
+void unmap_metrics_page(const metricspage_t *page, size_t size) {
+    unmap_metrics_file(page, size);
+}
@@ -0,0 +1,244 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "definitions.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
+/**
+ * @file
+ * Live metrics of a running simulation in a memory-mapped file (see brainwatch, watch.c).
+ *
+ * The file holds a metricspage_t followed by one threadmetrics_t per simulation thread. The simulation writes it
+ * without locks while other processes map and read it: each thread adds the time it computed its rows and the time
+ * it spent on the rest of each tick (waiting, extraction, management) to its own cache line, the management thread
+ * stores the number of completed ticks after each tick and, at most every METRICS_INTERVAL_MS, the derived rates,
+ * the estimated remaining time and the memory in use. The derived values are guarded by a sequence counter, which is
+ * odd while they are written, so that readers can retry instead of reading a half-written update.
+ */
+
+/** The first bytes of a metrics file. */
+#define METRICS_MAGIC "BSMP"
+
+/** The version of the layout of metrics files. */
+#define METRICS_VERSION 1
+
+/**
+ * The stages of a run published in a metrics file.
+ */
+typedef enum {
+    /** Setting up the simulation. */
+    METRICS_SETUP,
+    /** Simulating ticks. */
+    METRICS_SIMULATING,
+    /** Writing the outputs. */
+    METRICS_WRITING_OUTPUT,
+    /** The run finished. */
+    METRICS_FINISHED,
+    /** The run failed. */
+    METRICS_FAILED
+} metricsstate_t;
+
+/**
+ * The metrics of one simulation thread, one cache line each.
+ */
+typedef struct {
+    /**
+    * The summed nanoseconds the thread spent computing its rows, including their inputs.
+    */
+    volatile uint64_t compute_ns;
+    /**
+    * The summed nanoseconds the thread spent on the rest of the ticks: waiting at barriers, extracting observation
+    * nodes, managing the run and fast-forwarding.
+    */
+    volatile uint64_t other_ns;
+    /**
+    * The number of ticks the thread completed.
+    */
+    volatile uint64_t ticks;
+    char padding[40];
+}
+        threadmetrics_t;
+
+/**
+ * The header of a metrics file, 128 bytes, followed by the metrics of each thread.
+ */
+typedef struct {
+    /**
+    * METRICS_MAGIC, without terminating 0.
+    */
+    char magic[4];
+    /**
+    * METRICS_VERSION.
+    */
+    uint32_t version;
+    /**
+    * The number of threads following the header.
+    */
+    uint32_t num_threads;
+    /**
+    * The stage of the run, a metricsstate_t.
+    */
+    volatile uint32_t state;
+    /**
+    * The number of ticks of the run.
+    */
+    int64_t num_ticks;
+    /**
+    * The process id of the simulation.
+    */
+    int64_t pid;
+    /**
+    * The number of completed ticks, stored after each tick.
+    */
+    volatile int64_t tick;
+    /**
+    * The sequence counter of the derived values below, odd while they are written.
+    */
+    volatile uint64_t sequence;
+    /**
+    * The seconds since the file was opened.
+    */
+    volatile double elapsed_seconds;
+    /**
+    * The ticks per second since the last update.
+    */
+    volatile double ticks_per_second;
+    /**
+    * The estimated seconds until the last tick, at the rate since the last update.
+    */
+    volatile double eta_seconds;
+    /**
+    * The resident memory of the process in bytes, 0 if unknown.
+    */
+    volatile uint64_t memory_bytes;
+    /**
+    * The bytes of output files written so far.
+    */
+    volatile uint64_t output_bytes;
+    char reserved[40];
+}
+        metricspage_t;
+
+struct metrics {
+    /**
+    * The mapped header of the file.
+    */
+    metricspage_t *page;
+    /**
+    * The mapped metrics of the threads, right after the header.
+    */
+    threadmetrics_t *threads;
+    /**
+    * The size of the mapping in bytes.
+    */
+    size_t size;
+    /**
+    * The time the file was opened, of the last update of the derived values and the number of completed ticks at
+    * the last update.
+    */
+    uint64_t start_ns;
+    uint64_t last_update_ns;
+    int64_t last_update_tick;
+};
+
+/**
+ * Reads a monotonic clock.
+ * @return The clock in nanoseconds.
+ */
+static inline uint64_t metrics_clock_ns() {
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t) ((double) counter.QuadPart * 1e9 / (double) frequency.QuadPart);
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+#endif
+}
+
+/**
+ * Adds the times of completed ticks to the metrics of a thread. Only called by the thread itself.
+ * @param thread The metrics of the thread.
+ * @param compute_ns The nanoseconds the thread computed its rows in the ticks.
+ * @param other_ns The nanoseconds the thread spent on the rest of the ticks.
+ * @param ticks The number of completed ticks.
+ */
+static inline void publish_thread_metrics(threadmetrics_t *thread, uint64_t compute_ns, uint64_t other_ns,
+                                          int ticks) {
+    thread->compute_ns += compute_ns;
+    thread->other_ns += other_ns;
+    thread->ticks += ticks;
+}
+
+/**
+ * Creates (or overwrites) a metrics file and maps it.
+ * @param path The path of the file, e.g. on a tmpfs such as /dev/shm.
+ * @param num_threads The number of simulation threads.
+ * @param num_ticks The number of ticks of the run.
+ * @return The mapped metrics, or NULL if the file cannot be created or mapped.
+ */
+metrics_t *open_metrics(const char *path, int num_threads, int num_ticks);
+
+/**
+ * Publishes the number of completed ticks and, at most every METRICS_INTERVAL_MS, the derived values. Only called by
+ * the management thread.
+ * @param metrics The metrics.
+ * @param completed_ticks The number of completed ticks.
+ */
+void update_metrics(metrics_t *metrics, int completed_ticks);
+
+/**
+ * Publishes the stage of the run. Entering METRICS_SIMULATING restarts the count of completed ticks, which happens for
+ * each impulse response when simulating by superposition.
+ * @param metrics The metrics.
+ * @param state The stage.
+ */
+void set_metrics_state(metrics_t *metrics, metricsstate_t state);
+
+/**
+ * Adds bytes of written output files.
+ * @param metrics The metrics.
+ * @param bytes The number of written bytes.
+ */
+void add_metrics_output(metrics_t *metrics, uint64_t bytes);
+
+/**
+ * Publishes the final values and the stage of the run, and unmaps the file. The file stays in place.
+ * @param metrics The metrics.
+ * @param state The final stage, METRICS_FINISHED or METRICS_FAILED.
+ */
+void close_metrics(metrics_t *metrics, metricsstate_t state);
+
+/**
+ * Maps an existing metrics file for reading.
+ * @param path The path of the file.
+ * @param size Set to the size of the mapping.
+ * @return The mapped header, followed by the metrics of its threads, or NULL if the file is no metrics file.
+ */
+const metricspage_t *map_metrics_page(const char *path, size_t *size);
+
+/**
+ * Copies the header of a mapped metrics file, retrying while the simulation writes the derived values.
+ * @param page The mapped header.
+ * @param copy Set to a consistent copy of the header.
+ */
+void read_metrics_page(const metricspage_t *page, metricspage_t *copy);
+
+/**
+ * Unmaps a metrics file mapped by map_metrics_page().
+ * @param page The mapped header.
+ * @param size The size of the mapping.
+ */
+void unmap_metrics_page(const metricspage_t *page, size_t size);
+
+#endif
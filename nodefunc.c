@@ -3,16 +3,17 @@
  */
 #include "nodefunc.h"
 
+#include <stdlib.h>
+#include <math.h>
+
 nodestate_t process(nodeval_t act_old, nodeval_t slope_old, int number_d_neighbors, nodeval_t *d_neighbors,
-                    int number_id_neighbors, nodeval_t *id_neighbors) {
+                    int number_id_neighbors, nodeval_t *id_neighbors, const modelparameters_t *parameters) {
     // calculate mean over all madn nodes
     nodeval_t madn = 0;
     for (int i = 0; i < number_d_neighbors; ++i) {
         madn = madn + d_neighbors[i];
     }
     madn = madn / number_d_neighbors;
-    // add direct neighbor factor
-    madn = madn * D_NEIGHBORFACTOR;
 
     // calculate mean over all maidn nodes
     nodeval_t maidn = 0;
@@ -20,35 +21,152 @@ nodestate_t process(nodeval_t act_old, nodeval_t slope_old, int number_d_neighbo
         maidn = maidn + id_neighbors[i];
     }
     maidn = maidn / number_id_neighbors;
-    // add indirect neighbor factor
-    maidn = maidn * ID_NEIGHBORFACTOR;
 
-    // add factor
-    nodeval_t act_old_factored = act_old * ENERGY_FACTOR;
+    return process_means(act_old, slope_old, madn, maidn, parameters);
+}
 
-    // calculate slope
-    nodeval_t slope_d = madn - act_old_factored;
-    nodeval_t slope_id = maidn - act_old_factored;
-    nodeval_t slope_vector = slope_d + slope_id;
+void init_model_parameters(modelparameters_t *parameters) {
+    parameters->d_neighborfactor = D_NEIGHBORFACTOR;
+    parameters->id_neighborfactor = ID_NEIGHBORFACTOR;
+    parameters->energy_factor = ENERGY_FACTOR;
+    parameters->energy_weight = ENERGY_WEIGHT;
+    parameters->delta_factor = DELTA_FACTOR;
+    parameters->slope_factor = SLOPE_FACTOR;
+    parameters->slope_weight = SLOPE_WEIGHT;
+    parameters->damping = DAMPING;
+}
 
-    // add factor
-    slope_vector = slope_vector * DELTA_FACTOR;
-    slope_old = slope_old * SLOPE_FACTOR;
+void init_model_coefficients(modelcoefficients_t *coefficients, const modelparameters_t *parameters,
+                             int number_d_neighbors, int number_id_neighbors) {
+    // slope_new = slope_factor * slope_old
+    //     + delta_factor * ((d_neighborfactor * d_mean - energy_factor * act_old)
+    //                       + (id_neighborfactor * id_mean - energy_factor * act_old))
+    // act_new = (energy_weight * act_old + slope_weight * slope_new) / (1 + damping)
+    coefficients->d = parameters->delta_factor * parameters->d_neighborfactor / number_d_neighbors;
+    coefficients->id = parameters->delta_factor * parameters->id_neighborfactor / number_id_neighbors;
+    coefficients->act = -2 * parameters->delta_factor * parameters->energy_factor;
+    coefficients->slope = parameters->slope_factor;
+    coefficients->energy_weight = parameters->energy_weight / (1 + parameters->damping);
+    coefficients->slope_weight = parameters->slope_weight / (1 + parameters->damping);
+    coefficients->unit = parameters->d_neighborfactor == 1 && parameters->id_neighborfactor == 1
+                         && parameters->energy_factor == 1 && parameters->energy_weight == 1
+                         && parameters->delta_factor == 1 && parameters->slope_factor == 1
+                         && parameters->slope_weight == 1 && parameters->damping == 0;
+}
 
-    // calculate new slope
-    nodeval_t slope_new = slope_old + slope_vector;
+void init_ensemble_coefficients(ensemblecoefficients_t *coefficients, const modelparameters_t *members,
+                                int ensemble_size, int ensemble_lanes, int number_d_neighbors,
+                                int number_id_neighbors) {
+    nodeval_t *block = malloc(6 * ensemble_lanes * sizeof(nodeval_t));
+    coefficients->d = block;
+    coefficients->id = block + ensemble_lanes;
+    coefficients->act = block + 2 * ensemble_lanes;
+    coefficients->slope = block + 3 * ensemble_lanes;
+    coefficients->energy_weight = block + 4 * ensemble_lanes;
+    coefficients->slope_weight = block + 5 * ensemble_lanes;
+    for (int m = 0; m < ensemble_lanes; m++) {
+        // padding lanes repeat the last member, their results are never observed
+        modelcoefficients_t member;
+        init_model_coefficients(&member, &members[m < ensemble_size ? m : ensemble_size - 1],
+                                number_d_neighbors, number_id_neighbors);
+        coefficients->d[m] = member.d;
+        coefficients->id[m] = member.id;
+        coefficients->act[m] = member.act;
+        coefficients->slope[m] = member.slope;
+        coefficients->energy_weight[m] = member.energy_weight;
+        coefficients->slope_weight[m] = member.slope_weight;
+    }
+}
 
-    // add factors
-    nodeval_t slope_new_weighted = slope_new * SLOPE_WEIGHT;
-    nodeval_t act_old_weighted = act_old * ENERGY_WEIGHT;
+void free_ensemble_coefficients(ensemblecoefficients_t *coefficients) {
+    free(coefficients->d);
+}
 
-    // calculate new energy levels
-    nodeval_t act_new = act_old_weighted + slope_new_weighted;
+void node_model_parameters(modelparameters_t *node_parameters, const modelparameters_t *parameters,
+                           const parametermaps_t *maps, size_t node) {
+    *node_parameters = *parameters;
+    if (maps->d_neighborfactor != NULL) {
+        node_parameters->d_neighborfactor = maps->d_neighborfactor[node];
+    }
+    if (maps->id_neighborfactor != NULL) {
+        node_parameters->id_neighborfactor = maps->id_neighborfactor[node];
+    }
+    if (maps->energy_factor != NULL) {
+        node_parameters->energy_factor = maps->energy_factor[node];
+    }
+    if (maps->energy_weight != NULL) {
+        node_parameters->energy_weight = maps->energy_weight[node];
+    }
+    if (maps->delta_factor != NULL) {
+        node_parameters->delta_factor = maps->delta_factor[node];
+    }
+    if (maps->slope_factor != NULL) {
+        node_parameters->slope_factor = maps->slope_factor[node];
+    }
+    if (maps->slope_weight != NULL) {
+        node_parameters->slope_weight = maps->slope_weight[node];
+    }
+    if (maps->damping != NULL) {
+        node_parameters->damping = maps->damping[node];
+    }
+}
+
+// allocates a coefficient plane if the coefficient depends on a non-uniform parameter
+static nodeval_t *alloc_coefficient_map(int non_uniform, size_t number_nodes) {
+    return non_uniform ? malloc(number_nodes * sizeof(nodeval_t)) : NULL;
+}
+
+void init_coefficient_maps(coefficientmaps_t *coefficients, const modelparameters_t *parameters,
+                           const parametermaps_t *maps, size_t first_node, size_t number_nodes,
+                           int number_d_neighbors, int number_id_neighbors) {
+    // see init_model_coefficients() for the parameters each coefficient is folded from
+    coefficients->d = alloc_coefficient_map(maps->delta_factor != NULL || maps->d_neighborfactor != NULL,
+                                            number_nodes);
+    coefficients->id = alloc_coefficient_map(maps->delta_factor != NULL || maps->id_neighborfactor != NULL,
+                                             number_nodes);
+    coefficients->act = alloc_coefficient_map(maps->delta_factor != NULL || maps->energy_factor != NULL,
+                                              number_nodes);
+    coefficients->slope = alloc_coefficient_map(maps->slope_factor != NULL, number_nodes);
+    coefficients->energy_weight = alloc_coefficient_map(maps->energy_weight != NULL || maps->damping != NULL,
+                                                        number_nodes);
+    coefficients->slope_weight = alloc_coefficient_map(maps->slope_weight != NULL || maps->damping != NULL,
+                                                       number_nodes);
+    for (size_t k = 0; k < number_nodes; k++) {
+        modelparameters_t node_parameters;
+        modelcoefficients_t node;
+        node_model_parameters(&node_parameters, parameters, maps, first_node + k);
+        init_model_coefficients(&node, &node_parameters, number_d_neighbors, number_id_neighbors);
+        if (coefficients->d != NULL) {
+            coefficients->d[k] = node.d;
+        }
+        if (coefficients->id != NULL) {
+            coefficients->id[k] = node.id;
+        }
+        if (coefficients->act != NULL) {
+            coefficients->act[k] = node.act;
+        }
+        if (coefficients->slope != NULL) {
+            coefficients->slope[k] = node.slope;
+        }
+        if (coefficients->energy_weight != NULL) {
+            coefficients->energy_weight[k] = node.energy_weight;
+        }
+        if (coefficients->slope_weight != NULL) {
+            coefficients->slope_weight[k] = node.slope_weight;
+        }
+    }
+}
 
-    // store results
-    nodestate_t res;
-    res.act = act_new;
-    res.slope = slope_new;
+void free_coefficient_maps(coefficientmaps_t *coefficients) {
+    free(coefficients->d);
+    free(coefficients->id);
+    free(coefficients->act);
+    free(coefficients->slope);
+    free(coefficients->energy_weight);
+    free(coefficients->slope_weight);
+}
 
-    return res;
+int zero_is_fixed_point(const modelcoefficients_t *coefficients) {
+    nodestate_t res = process_sums(0, 0, 0, 0, coefficients);
+    return res.act == 0 && !signbit(res.act) && res.slope == 0 && !signbit(res.slope);
 }
\ No newline at end of file
@@ -18,10 +18,191 @@
 * @param d_neighbors: Array of direct neighboring states. Length: number_d_neighbors.
 * @param number_id_neighbors The number of indirect neighbors.
 * @param id_neighbors: Array of indirect neighboring states. Length: number_id_neighbors.
+* @param parameters: The model parameters.
 *
 * @returns The new resulting energy level.
 */
 nodestate_t process(nodeval_t act_old, nodeval_t slope_old, int number_d_neighbors, nodeval_t *d_neighbors,
-                    int number_id_neighbors, nodeval_t *id_neighbors);
+                    int number_id_neighbors, nodeval_t *id_neighbors, const modelparameters_t *parameters);
+
+/**
+* Initializes model parameters with their compile-time defaults.
+*
+* @param parameters: The parameters to initialize.
+*/
+void init_model_parameters(modelparameters_t *parameters);
+
+/**
+* Folds the model parameters into the coefficients used by the specialized sweeps.
+*
+* @param coefficients: The coefficients to compute.
+* @param parameters: The model parameters.
+* @param number_d_neighbors The number of direct neighbors of the kernel.
+* @param number_id_neighbors The number of indirect neighbors of the kernel.
+*/
+void init_model_coefficients(modelcoefficients_t *coefficients, const modelparameters_t *parameters,
+                             int number_d_neighbors, int number_id_neighbors);
+
+/**
+* Folds the model parameters of all members of an ensemble into coefficients for the given kernel.
+* Free using free_ensemble_coefficients().
+*
+* @param coefficients: The coefficients to initialize.
+* @param members: The model parameters of each member. Length: ensemble_size.
+* @param ensemble_size: The number of members.
+* @param ensemble_lanes: The padded number of members, i.e., the length of the coefficient arrays.
+* @param number_d_neighbors: The number of direct neighbors of the kernel.
+* @param number_id_neighbors: The number of indirect neighbors of the kernel.
+*/
+void init_ensemble_coefficients(ensemblecoefficients_t *coefficients, const modelparameters_t *members,
+                                int ensemble_size, int ensemble_lanes, int number_d_neighbors,
+                                int number_id_neighbors);
+
+/**
+* Frees the coefficient arrays of an ensemble.
+*
+* @param coefficients: The coefficients initialized with init_ensemble_coefficients().
+*/
+void free_ensemble_coefficients(ensemblecoefficients_t *coefficients);
+
+/**
+* Gets the model parameters of a single node of a heterogeneous grid.
+*
+* @param node_parameters: The parameters of the node to set.
+* @param parameters: The uniform model parameters.
+* @param maps: The per-node parameters overriding the uniform parameters.
+* @param node: The index of the node in the grid layout (x * number_nodes_y + y).
+*/
+void node_model_parameters(modelparameters_t *node_parameters, const modelparameters_t *parameters,
+                           const parametermaps_t *maps, size_t node);
+
+/**
+* Folds the per-node model parameters of a range of nodes into per-node coefficients for the given kernel.
+* Only the coefficients depending on a non-uniform parameter get a plane. Free using free_coefficient_maps().
+*
+* @param coefficients: The coefficient planes to initialize. Node first_node + k is stored at index k.
+* @param parameters: The uniform model parameters.
+* @param maps: The per-node parameters overriding the uniform parameters.
+* @param first_node: The index of the first node in the grid layout.
+* @param number_nodes: The number of nodes to compute.
+* @param number_d_neighbors: The number of direct neighbors of the kernel.
+* @param number_id_neighbors: The number of indirect neighbors of the kernel.
+*/
+void init_coefficient_maps(coefficientmaps_t *coefficients, const modelparameters_t *parameters,
+                           const parametermaps_t *maps, size_t first_node, size_t number_nodes,
+                           int number_d_neighbors, int number_id_neighbors);
+
+/**
+* Frees the coefficient planes of a heterogeneous grid.
+*
+* @param coefficients: The coefficients initialized with init_coefficient_maps().
+*/
+void free_coefficient_maps(coefficientmaps_t *coefficients);
+
+/**
+* Checks whether a node with zero energy level, slope and neighbors stays exactly +0.0, i.e., whether it can be
+* skipped without changing any results.
+*
+* @param coefficients: The folded model coefficients of the node.
+*
+* @returns 1 if energy level and slope stay +0.0, 0 otherwise (e.g., for negative coefficients turning them into
+* -0.0).
+*/
+int zero_is_fixed_point(const modelcoefficients_t *coefficients);
+
+/**
+* The process done by each agent, given the means of its neighborhoods.
+* process() calls it after computing the means.
+*
+* @param act_old: The old state information.
+* @param slope_old: The old slope.
+* @param d_mean: The mean energy level of the direct neighbors.
+* @param id_mean: The mean energy level of the indirect neighbors.
+* @param parameters: The model parameters.
+*
+* @returns The new resulting energy level.
+*/
+static inline nodestate_t process_means(nodeval_t act_old, nodeval_t slope_old, nodeval_t d_mean, nodeval_t id_mean,
+                                        const modelparameters_t *parameters) {
+    // add direct neighbor factor
+    nodeval_t madn = d_mean * parameters->d_neighborfactor;
+    // add indirect neighbor factor
+    nodeval_t maidn = id_mean * parameters->id_neighborfactor;
+
+    // add factor
+    nodeval_t act_old_factored = act_old * parameters->energy_factor;
+
+    // calculate slope
+    nodeval_t slope_d = madn - act_old_factored;
+    nodeval_t slope_id = maidn - act_old_factored;
+    nodeval_t slope_vector = slope_d + slope_id;
+
+    // add factor
+    slope_vector = slope_vector * parameters->delta_factor;
+    slope_old = slope_old * parameters->slope_factor;
+
+    // calculate new slope
+    nodeval_t slope_new = slope_old + slope_vector;
+
+    // add factors
+    nodeval_t slope_new_weighted = slope_new * parameters->slope_weight;
+    nodeval_t act_old_weighted = act_old * parameters->energy_weight;
+
+    // calculate new energy levels
+    nodeval_t act_new = act_old_weighted + slope_new_weighted;
+
+    // apply damping
+    if (parameters->damping != 0) {
+        act_new = act_new / (1 + parameters->damping);
+    }
+
+    // store results
+    nodestate_t res;
+    res.act = act_new;
+    res.slope = slope_new;
+
+    return res;
+}
+
+/**
+* Fast path of process_means() if all model parameters are 1. Inlined into the specialized sweeps.
+* Produces exactly the same results as process_means() with all parameters set to 1.
+*
+* @param act_old: The old state information.
+* @param slope_old: The old slope.
+* @param d_mean: The mean energy level of the direct neighbors.
+* @param id_mean: The mean energy level of the indirect neighbors.
+*
+* @returns The new resulting energy level.
+*/
+static inline nodestate_t process_means_unit(nodeval_t act_old, nodeval_t slope_old, nodeval_t d_mean,
+                                             nodeval_t id_mean) {
+    nodeval_t slope_vector = (d_mean - act_old) + (id_mean - act_old);
+    nodestate_t res;
+    res.slope = slope_old + slope_vector;
+    res.act = act_old + res.slope;
+    return res;
+}
+
+/**
+* The process done by each agent using the folded model coefficients, given the sums of its neighborhoods.
+* Inlined into the specialized sweeps.
+*
+* @param act_old: The old state information.
+* @param slope_old: The old slope.
+* @param d_sum: The (weighted) sum of the energy levels of the direct neighbors.
+* @param id_sum: The (weighted) sum of the energy levels of the indirect neighbors.
+* @param coefficients: The model coefficients for the kernel.
+*
+* @returns The new resulting energy level.
+*/
+static inline nodestate_t process_sums(nodeval_t act_old, nodeval_t slope_old, nodeval_t d_sum, nodeval_t id_sum,
+                                       const modelcoefficients_t *coefficients) {
+    nodestate_t res;
+    res.slope = coefficients->slope * slope_old + coefficients->d * d_sum + coefficients->id * id_sum
+                + coefficients->act * act_old;
+    res.act = coefficients->energy_weight * act_old + coefficients->slope_weight * res.slope;
+    return res;
+}
 
 #endif
@@ -0,0 +1,236 @@
+#include "perfcounters.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if PERF_COUNTERS && defined(__linux__)
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+static const char *PERF_EVENT_NAMES[NUM_PERF_EVENTS] = {"cycles", "instructions", "L1D misses", "LLC misses",
+                                                        "branch misses"};
+
+// the size of the cache lines loaded from memory per last level cache miss
+#define PERF_CACHE_LINE_BYTES 64
+
+perfcounters_t *init_perf_counters(int num_threads) {
+    perfcounters_t *counters = calloc(num_threads, sizeof(perfcounters_t));
+    for (int i = 0; i < num_threads; i++) {
+        counters[i].leader = -1;
+        for (int event = 0; event < NUM_PERF_EVENTS; event++) {
+            counters[i].fds[event] = -1;
+        }
+    }
+    return counters;
+}
+
+#if PERF_COUNTERS && defined(__linux__)
+// the values read from a group with PERF_FORMAT_GROUP, PERF_FORMAT_TOTAL_TIME_ENABLED and
+// PERF_FORMAT_TOTAL_TIME_RUNNING
+typedef struct {
+    uint64_t number;
+    uint64_t time_enabled;
+    uint64_t time_running;
+    uint64_t values[NUM_PERF_EVENTS];
+} perfgroupvalues_t;
+
+static void perf_event_attributes(struct perf_event_attr *attributes, perfevent_t event) {
+    memset(attributes, 0, sizeof(struct perf_event_attr));
+    attributes->size = sizeof(struct perf_event_attr);
+    attributes->read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attributes->exclude_kernel = 1;
+    attributes->exclude_hv = 1;
+    switch (event) {
+        case PERF_CYCLES:
+            attributes->type = PERF_TYPE_HARDWARE;
+            attributes->config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PERF_INSTRUCTIONS:
+            attributes->type = PERF_TYPE_HARDWARE;
+            attributes->config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PERF_L1D_MISSES:
+            attributes->type = PERF_TYPE_HW_CACHE;
+            attributes->config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                 | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case PERF_LLC_MISSES:
+            attributes->type = PERF_TYPE_HARDWARE;
+            attributes->config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        default:
+            attributes->type = PERF_TYPE_HARDWARE;
+            attributes->config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+    }
+}
+
+// reads all counters of the group, returns 0 on success
+static int read_perf_group(const perfcounters_t *counters, perfgroupvalues_t *values) {
+    ssize_t expected = (ssize_t) ((3 + counters->num_open) * sizeof(uint64_t));
+    return read(counters->leader, values, sizeof(perfgroupvalues_t)) == expected ? 0 : 1;
+}
+#endif
+
+void open_perf_counters(perfcounters_t *counters, double nodes_per_tick) {
+    counters->nodes_per_tick = nodes_per_tick;
+#if PERF_COUNTERS && defined(__linux__)
+    for (int event = 0; event < NUM_PERF_EVENTS; event++) {
+        struct perf_event_attr attributes;
+        perf_event_attributes(&attributes, (perfevent_t) event);
+        // the leader starts disabled, so that all events of the group start counting together
+        attributes.disabled = counters->leader < 0;
+        // this thread on any processor
+        int fd = (int) syscall(SYS_perf_event_open, &attributes, 0, -1, counters->leader, 0);
+        if (fd < 0) {
+            if (counters->error == 0) {
+                counters->error = errno;
+            }
+            continue;
+        }
+        if (counters->leader < 0) {
+            counters->leader = fd;
+        }
+        counters->fds[event] = fd;
+        counters->num_open++;
+    }
+    if (counters->leader < 0) {
+        return;
+    }
+    ioctl(counters->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(counters->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    perfgroupvalues_t values;
+    if (read_perf_group(counters, &values) != 0) {
+        close_perf_counters(counters);
+        counters->error = EIO;
+        return;
+    }
+    int k = 0;
+    for (int event = 0; event < NUM_PERF_EVENTS; event++) {
+        if (counters->fds[event] >= 0) {
+            counters->last[event] = values.values[k++];
+        }
+    }
+    counters->last_enabled = values.time_enabled;
+    counters->last_running = values.time_running;
+#else
+    counters->error = -1;
+#endif
+}
+
+void read_perf_counters(perfcounters_t *counters, phase_t phase) {
+    if (phase == PHASE_COMPUTE) {
+        counters->node_updates += counters->nodes_per_tick;
+    }
+#if PERF_COUNTERS && defined(__linux__)
+    perfgroupvalues_t values;
+    if (counters->leader < 0 || read_perf_group(counters, &values) != 0) {
+        return;
+    }
+    int k = 0;
+    for (int event = 0; event < NUM_PERF_EVENTS; event++) {
+        if (counters->fds[event] >= 0) {
+            counters->totals[phase][event] += values.values[k] - counters->last[event];
+            counters->last[event] = values.values[k++];
+        }
+    }
+    counters->enabled[phase] += values.time_enabled - counters->last_enabled;
+    counters->running[phase] += values.time_running - counters->last_running;
+    counters->last_enabled = values.time_enabled;
+    counters->last_running = values.time_running;
+#endif
+}
+
+void close_perf_counters(perfcounters_t *counters) {
+#if PERF_COUNTERS && defined(__linux__)
+    if (counters->leader >= 0) {
+        ioctl(counters->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+    // the members of the group before its leader
+    for (int event = NUM_PERF_EVENTS - 1; event >= 0; event--) {
+        if (counters->fds[event] >= 0) {
+            close(counters->fds[event]);
+        }
+    }
+#endif
+    // the counted totals are kept for print_perf_counters()
+    counters->leader = -1;
+}
+
+// prints a count per node update, or n/a if the event was not counted
+static void print_per_update(double count, double node_updates, int counted) {
+    if (counted && node_updates > 0) {
+        printf(" %14.3f", count / node_updates);
+    } else {
+        printf(" %14s", "n/a");
+    }
+}
+
+void print_perf_counters(perfcounters_t *counters, int num_threads) {
+    // an event is reported if all threads counted it
+    int counted[NUM_PERF_EVENTS];
+    double node_updates = 0;
+    for (int event = 0; event < NUM_PERF_EVENTS; event++) {
+        counted[event] = 1;
+    }
+    for (int i = 0; i < num_threads; i++) {
+        for (int event = 0; event < NUM_PERF_EVENTS; event++) {
+            counted[event] &= counters[i].fds[event] >= 0;
+        }
+        node_updates += counters[i].node_updates;
+    }
+    int any_counted = 0;
+    for (int event = 0; event < NUM_PERF_EVENTS; event++) {
+        any_counted |= counted[event];
+        if (!counted[event]) {
+            printf("WARNING: The hardware performance counter of %s is not available (%s).\n",
+                   PERF_EVENT_NAMES[event], counters[0].error > 0 ? strerror(counters[0].error) : "not supported");
+        }
+    }
+    if (!any_counted) {
+        return;
+    }
+    printf("Hardware performance counters (user space, per node update of %.0f node updates):\n", node_updates);
+    printf("%-15s %8s %14s %14s %14s %14s %14s %9s\n", "phase", "IPC", "cycles", "L1D misses", "LLC misses",
+           "LLC bytes", "branch misses", "counted");
+    for (int phase = 0; phase < NUM_PHASES; phase++) {
+        double totals[NUM_PERF_EVENTS] = {0};
+        double enabled = 0;
+        double running = 0;
+        for (int i = 0; i < num_threads; i++) {
+            // counts of multiplexed groups are scaled to the time the group was enabled
+            double scale = counters[i].running[phase] > 0
+                           ? (double) counters[i].enabled[phase] / (double) counters[i].running[phase] : 0;
+            for (int event = 0; event < NUM_PERF_EVENTS; event++) {
+                totals[event] += (double) counters[i].totals[phase][event] * scale;
+            }
+            enabled += (double) counters[i].enabled[phase];
+            running += (double) counters[i].running[phase];
+        }
+        if (enabled == 0) {
+            continue;
+        }
+        printf("%-15s", phase_name((phase_t) phase));
+        if (counted[PERF_CYCLES] && counted[PERF_INSTRUCTIONS] && totals[PERF_CYCLES] > 0) {
+            printf(" %8.3f", totals[PERF_INSTRUCTIONS] / totals[PERF_CYCLES]);
+        } else {
+            printf(" %8s", "n/a");
+        }
+        print_per_update(totals[PERF_CYCLES], node_updates, counted[PERF_CYCLES]);
+        print_per_update(totals[PERF_L1D_MISSES], node_updates, counted[PERF_L1D_MISSES]);
+        print_per_update(totals[PERF_LLC_MISSES], node_updates, counted[PERF_LLC_MISSES]);
+        print_per_update(totals[PERF_LLC_MISSES] * PERF_CACHE_LINE_BYTES, node_updates, counted[PERF_LLC_MISSES]);
+        print_per_update(totals[PERF_BRANCH_MISSES], node_updates, counted[PERF_BRANCH_MISSES]);
+        // the share of the time the counters were counting, below 100% if the kernel multiplexed them
+        printf(" %8.2f%%\n", 100.0 * running / enabled);
+    }
+}
+
+void free_perf_counters(perfcounters_t *counters) {
+    free(counters);
+}
@@ -0,0 +1,139 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include "definitions.h"
+#include "phasetiming.h"
+
+#include <stdint.h>
+
+/**
+ * @file
+ * Hardware performance counters of the phases of the tick loop, compiled in with PERF_COUNTERS (Linux only).
+ *
+ * Each thread opens a group of counters for itself with perf_event_open() when it starts its part of the run, reads
+ * all counters of the group at once at the boundaries of the phases of each tick (see phasetiming.h) and adds the
+ * differences to the totals of the ended phase. Only user space is counted, which ordinary users may count for their
+ * own threads. Counters the processor or kernel do not offer are left out, and if no counter can be opened, the run
+ * continues without them. After the run, the totals of all threads are printed per phase as instructions per cycle
+ * and as cache misses, bytes loaded from memory and branch misses per node update. The counting is not part of the
+ * phase timing, but reading the counters costs a system call at each phase boundary, so phases are timed best
+ * without it.
+ */
+
+/**
+ * The counted hardware events.
+ */
+typedef enum {
+    /** Processor cycles. */
+    PERF_CYCLES,
+    /** Retired instructions. */
+    PERF_INSTRUCTIONS,
+    /** Loads missing the L1 data cache. */
+    PERF_L1D_MISSES,
+    /** Accesses missing the last level cache, each loading a cache line from memory. */
+    PERF_LLC_MISSES,
+    /** Mispredicted branches. */
+    PERF_BRANCH_MISSES,
+    /** The number of counted events. */
+    NUM_PERF_EVENTS
+} perfevent_t;
+
+struct perfcounters {
+    /**
+    * The file descriptor of each event, -1 if the event is not counted. The first open event leads the group.
+    */
+    int fds[NUM_PERF_EVENTS];
+    /**
+    * The file descriptor of the group leader, -1 if no event is counted.
+    */
+    int leader;
+    /**
+    * The number of counted events, in the order of fds.
+    */
+    int num_open;
+    /**
+    * The errno of the first event that could not be opened, 0 if all were opened.
+    */
+    int error;
+    /**
+    * The values of the counters, the time the group was enabled and the time it was counting at the last read.
+    */
+    uint64_t last[NUM_PERF_EVENTS];
+    uint64_t last_enabled;
+    uint64_t last_running;
+    /**
+    * The summed differences of each event per phase.
+    */
+    uint64_t totals[NUM_PHASES][NUM_PERF_EVENTS];
+    /**
+    * The summed times the group was enabled and counting per phase, to scale multiplexed counts.
+    */
+    uint64_t enabled[NUM_PHASES];
+    uint64_t running[NUM_PHASES];
+    /**
+    * The number of node updates computed by this thread.
+    */
+    double node_updates;
+    /**
+    * The number of node updates of one tick of this thread.
+    */
+    double nodes_per_tick;
+    /**
+    * Padding, so that the threads do not share cache lines.
+    */
+    char padding[64];
+};
+
+#if PERF_COUNTERS
+/** Reads the counters of a thread at the end of a phase. */
+#define PERF_COUNTERS_LAP(context, phase) \
+    do { \
+        if ((context)->counters != NULL) { \
+            read_perf_counters((context)->counters, phase); \
+        } \
+    } while (0)
+#else
+#define PERF_COUNTERS_LAP(context, phase)
+#endif
+
+/**
+ * Allocates the counters of the threads of a run, none of them opened yet.
+ * @param num_threads The number of threads.
+ * @return The counters, one per thread.
+ */
+perfcounters_t *init_perf_counters(int num_threads);
+
+/**
+ * Opens and starts the counters of the calling thread. Events that cannot be counted are left out.
+ * @param counters The counters of the calling thread.
+ * @param nodes_per_tick The number of node updates of one tick of the calling thread.
+ */
+void open_perf_counters(perfcounters_t *counters, double nodes_per_tick);
+
+/**
+ * Reads the counters of the calling thread and adds the differences since the last read to a phase.
+ * @param counters The counters of the calling thread.
+ * @param phase The ended phase.
+ */
+void read_perf_counters(perfcounters_t *counters, phase_t phase);
+
+/**
+ * Stops and closes the counters of the calling thread.
+ * @param counters The counters of the calling thread.
+ */
+void close_perf_counters(perfcounters_t *counters);
+
+/**
+ * Prints the summed counters of all threads of a run per phase and per node update.
+ * @param counters The counters of all threads.
+ * @param num_threads The number of threads.
+ */
+void print_perf_counters(perfcounters_t *counters, int num_threads);
+
+/**
+ * Frees the counters of the threads of a run, after all of them have been closed.
+ * @param counters The counters of all threads.
+ */
+void free_perf_counters(perfcounters_t *counters);
+
+#endif
@@ -0,0 +1,91 @@
+#include "phasetiming.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *PHASE_NAMES[NUM_PHASES] = {"compute", "inputs", "wait_computed", "management", "extraction",
+                                               "connections", "wait_next_tick", "fast_forward"};
+
+const char *phase_name(phase_t phase) {
+    return PHASE_NAMES[phase];
+}
+
+threadtiming_t *init_thread_timings(int num_threads) {
+    threadtiming_t *timings = calloc(num_threads, sizeof(threadtiming_t));
+    get_daytime(&timings[0].start_time);
+    timings[0].start_clock = phase_clock();
+    return timings;
+}
+
+// the upper bound of the bucket below which the given share of the durations falls
+static uint64_t histogram_quantile(const uint64_t *histogram, uint64_t count, double share) {
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < PHASE_HISTOGRAM_BUCKETS; bucket++) {
+        seen += histogram[bucket];
+        if (seen > 0 && (double) seen >= share * count) {
+            return bucket == 0 ? 0 : (uint64_t) 1 << bucket;
+        }
+    }
+    return (uint64_t) 1 << (PHASE_HISTOGRAM_BUCKETS - 1);
+}
+
+void print_thread_timings(threadtiming_t *timings, int num_threads) {
+    uint64_t end_clock = phase_clock();
+    struct timeval end_time;
+    get_daytime(&end_time);
+    double wall_ns = (double) (end_time.tv_sec - timings[0].start_time.tv_sec) * 1e9
+                     + (double) (end_time.tv_usec - timings[0].start_time.tv_usec) * 1e3;
+    double ns_per_unit = end_clock > timings[0].start_clock ? wall_ns / (double) (end_clock - timings[0].start_clock)
+                                                            : 1;
+    printf("Phase timing (%.3f ns per timer unit, histogram quantiles are upper bounds of power-of-two buckets):\n",
+           ns_per_unit);
+    printf("%-15s %12s %8s %12s %12s %12s %12s %12s\n", "phase", "total ms", "share", "mean us", "p50 us", "p90 us",
+           "p99 us", "max us");
+    for (int phase = 0; phase < NUM_PHASES; phase++) {
+        phasestats_t all = {0};
+        for (int i = 0; i < num_threads; i++) {
+            const phasestats_t *stats = &timings[i].phases[phase];
+            if (stats->count > 0 && (all.count == 0 || stats->min < all.min)) {
+                all.min = stats->min;
+            }
+            all.total += stats->total;
+            all.count += stats->count;
+            all.max = stats->max > all.max ? stats->max : all.max;
+            for (int bucket = 0; bucket < PHASE_HISTOGRAM_BUCKETS; bucket++) {
+                all.histogram[bucket] += stats->histogram[bucket];
+            }
+        }
+        if (all.count == 0) {
+            continue;
+        }
+        // the share of the summed wall time of all threads, the inputs are part of the compute phase and are shown
+        // indented below it without a share of their own, so that the shares add up to 100%
+        if (phase == PHASE_INPUTS) {
+            printf("  %-13s %12.3f %8s", PHASE_NAMES[phase], all.total * ns_per_unit * 1e-6, "-");
+        } else {
+            printf("%-15s %12.3f %7.2f%%", PHASE_NAMES[phase], all.total * ns_per_unit * 1e-6,
+                   100.0 * all.total * ns_per_unit / (wall_ns * num_threads));
+        }
+        printf(" %12.3f %12.3f %12.3f %12.3f %12.3f\n", all.total * ns_per_unit * 1e-3 / all.count,
+               histogram_quantile(all.histogram, all.count, 0.5) * ns_per_unit * 1e-3,
+               histogram_quantile(all.histogram, all.count, 0.9) * ns_per_unit * 1e-3,
+               histogram_quantile(all.histogram, all.count, 0.99) * ns_per_unit * 1e-3,
+               all.max * ns_per_unit * 1e-3);
+    }
+    printf("Per thread (total ms):\n%-8s", "thread");
+    for (int phase = 0; phase < NUM_PHASES; phase++) {
+        printf(" %15s", PHASE_NAMES[phase]);
+    }
+    printf("\n");
+    for (int i = 0; i < num_threads; i++) {
+        printf("%-8d", i);
+        for (int phase = 0; phase < NUM_PHASES; phase++) {
+            printf(" %15.3f", timings[i].phases[phase].total * ns_per_unit * 1e-6);
+        }
+        printf("\n");
+    }
+}
+
+void free_thread_timings(threadtiming_t *timings) {
+    free(timings);
+}
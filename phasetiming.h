@@ -0,0 +1,211 @@
+#ifndef PHASETIMING_H
+#define PHASETIMING_H
+
+#include "definitions.h"
+#include "utils.h"
+
+#include <stdint.h>
+
+#if PHASE_TIMING && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define PHASE_TIMING_RDTSC 1
+#elif PHASE_TIMING && !defined(_WIN32)
+#include <time.h>
+#endif
+
+/**
+ * @file
+ * Per-thread timing of the phases of the tick loop, compiled in with PHASE_TIMING.
+ *
+ * Each thread reads a timer (the time stamp counter on x86, a monotonic clock otherwise) at the boundaries of the
+ * phases of each tick and adds the duration of each phase to its own statistics: the total, minimum, maximum and a
+ * histogram of power-of-two buckets. After the run, the durations are converted to nanoseconds using the wall time
+ * of the run and printed per phase and per thread. Without PHASE_TIMING, all timing macros expand to nothing.
+ * With PERF_COUNTERS, the phase boundaries also read the hardware performance counters (see perfcounters.h).
+ */
+
+/**
+ * The phases of a tick.
+ */
+typedef enum {
+    /** Computing the tick's rows in execute_partial_tick(), including the inputs. */
+    PHASE_COMPUTE,
+    /** Adding the inputs and connection sums to the computed rows (part of PHASE_COMPUTE). */
+    PHASE_INPUTS,
+    /** Waiting for all threads to compute the tick. */
+    PHASE_WAIT_COMPUTED,
+    /** Work of the management thread between the barriers (progress, input stream, early termination). */
+    PHASE_MANAGEMENT,
+    /** Extracting the observations of the tick. */
+    PHASE_EXTRACTION,
+    /** Gathering the sums of the long-range connections. */
+    PHASE_CONNECTIONS,
+    /** Waiting for all threads to finish the tick before the next one. */
+    PHASE_WAIT_NEXT_TICK,
+    /** Fast-forwarding an input-free interval, including waiting for it. */
+    PHASE_FAST_FORWARD,
+    /** The number of phases. */
+    NUM_PHASES
+} phase_t;
+
+/** Number of power-of-two buckets of the histograms: bucket b counts durations in [2^(b-1), 2^b) timer units. */
+#define PHASE_HISTOGRAM_BUCKETS 48
+
+/**
+ * The durations of one phase in one thread, in timer units.
+ */
+typedef struct {
+    /**
+    * The sum of all durations.
+    */
+    uint64_t total;
+    /**
+    * The number of durations.
+    */
+    uint64_t count;
+    /**
+    * The shortest duration.
+    */
+    uint64_t min;
+    /**
+    * The longest duration.
+    */
+    uint64_t max;
+    /**
+    * The number of durations per power-of-two bucket.
+    */
+    uint64_t histogram[PHASE_HISTOGRAM_BUCKETS];
+}
+        phasestats_t;
+
+struct threadtiming {
+    /**
+    * The durations of each phase.
+    */
+    phasestats_t phases[NUM_PHASES];
+    /**
+    * The durations of the inputs of the rows of the current tick, recorded as one duration per tick.
+    */
+    uint64_t row_inputs;
+    /**
+    * The timer at the start of the run (first thread only).
+    */
+    uint64_t start_clock;
+    /**
+    * The wall time at the start of the run (first thread only).
+    */
+    struct timeval start_time;
+    /**
+    * Padding, so that the threads do not share cache lines.
+    */
+    char padding[64];
+};
+
+/**
+ * Reads the timer.
+ * @return The timer in timer units.
+ */
+static inline uint64_t phase_clock() {
+#if PHASE_TIMING_RDTSC
+    return __rdtsc();
+#elif PHASE_TIMING && !defined(_WIN32)
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Adds a duration of a phase to the statistics of a thread.
+ * @param timing The statistics of the thread.
+ * @param phase The phase.
+ * @param duration The duration in timer units.
+ */
+static inline void record_phase(threadtiming_t *timing, phase_t phase, uint64_t duration) {
+    phasestats_t *stats = &timing->phases[phase];
+    int bucket = 0;
+    while (bucket < PHASE_HISTOGRAM_BUCKETS - 1 && duration >> bucket) {
+        bucket++;
+    }
+    stats->total += duration;
+    stats->min = stats->count == 0 || duration < stats->min ? duration : stats->min;
+    stats->max = duration > stats->max ? duration : stats->max;
+    stats->count++;
+    stats->histogram[bucket]++;
+}
+
+#if PHASE_TIMING
+/** Declares the variable holding the end of the last phase of a thread and starts timing. */
+#define PHASE_START(last) uint64_t last = phase_clock()
+/** Records the phase since the end of the last phase and starts the next one. Also reads the counters. */
+#define PHASE_LAP(context, phase, last) \
+    do { \
+        uint64_t phase_now = phase_clock(); \
+        if ((context)->timing != NULL) { \
+            record_phase((context)->timing, phase, phase_now - (last)); \
+        } \
+        last = phase_now; \
+        PERF_COUNTERS_LAP(context, phase); \
+    } while (0)
+/** Adds the time since start to the inputs of the rows of the current tick. */
+#define PHASE_ADD_INPUTS(context, start) \
+    do { \
+        if ((context)->timing != NULL) { \
+            (context)->timing->row_inputs += phase_clock() - (start); \
+        } \
+    } while (0)
+/** Records the inputs of the rows of the current tick as one duration. */
+#define PHASE_FLUSH_INPUTS(context) \
+    do { \
+        if ((context)->timing != NULL) { \
+            record_phase((context)->timing, PHASE_INPUTS, (context)->timing->row_inputs); \
+            (context)->timing->row_inputs = 0; \
+        } \
+    } while (0)
+#elif PERF_COUNTERS
+#define PHASE_START(last)
+#define PHASE_LAP(context, phase, last) PERF_COUNTERS_LAP(context, phase)
+#define PHASE_ADD_INPUTS(context, start)
+#define PHASE_FLUSH_INPUTS(context)
+#else
+#define PHASE_START(last)
+#define PHASE_LAP(context, phase, last)
+#define PHASE_ADD_INPUTS(context, start)
+#define PHASE_FLUSH_INPUTS(context)
+#endif
+
+/**
+ * Returns the name of a phase.
+ * @param phase The phase.
+ * @return The name of the phase, as printed by print_thread_timings().
+ */
+const char *phase_name(phase_t phase);
+
+/**
+ * Allocates zeroed statistics for the threads of a run and starts measuring its wall time.
+ * @param num_threads The number of threads.
+ * @return The statistics, one per thread.
+ */
+threadtiming_t *init_thread_timings(int num_threads);
+
+/**
+ * Prints the statistics of all threads of a run, converted to nanoseconds using the wall time since
+ * init_thread_timings().
+ * @param timings The statistics of all threads.
+ * @param num_threads The number of threads.
+ */
+void print_thread_timings(threadtiming_t *timings, int num_threads);
+
+/**
+ * Frees the statistics of the threads of a run.
+ * @param timings The statistics of all threads.
+ */
+void free_thread_timings(threadtiming_t *timings);
+
+#endif
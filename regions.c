@@ -0,0 +1,656 @@
+#include "regions.h"
+#include "brainsimulation.h"
+#include "brainsetup.h"
+#include "kernels.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+// estimated cost of the node process in multiply-adds of the direct method (see kernel_node_cost()), added to the
+// kernel's cost per node when balancing the rows of the regions across the threads
+#define REGION_COST_PROCESS 8.0
+
+// the model parameter names of the region file and the offsets of the parameters in modelparameters_t
+static const char *REGION_PARAMETER_NAMES[] = {"d_neighborfactor", "id_neighborfactor", "energy_factor",
+                                               "energy_weight", "delta_factor", "slope_factor", "slope_weight",
+                                               "damping"};
+static const size_t REGION_PARAMETER_OFFSETS[] = {offsetof(modelparameters_t, d_neighborfactor),
+                                                  offsetof(modelparameters_t, id_neighborfactor),
+                                                  offsetof(modelparameters_t, energy_factor),
+                                                  offsetof(modelparameters_t, energy_weight),
+                                                  offsetof(modelparameters_t, delta_factor),
+                                                  offsetof(modelparameters_t, slope_factor),
+                                                  offsetof(modelparameters_t, slope_weight),
+                                                  offsetof(modelparameters_t, damping)};
+#define NUM_REGION_PARAMETERS 8
+
+// a start, observation or input node while reading
+typedef struct {
+    int region;
+    int x;
+    int y;
+    nodeval_t value;
+} regionnodeentry_t;
+
+// a link while reading
+typedef struct {
+    int source_region;
+    connectionnode_t source;
+    int target_region;
+    connectionnode_t target;
+    nodeval_t weight;
+} linkentry_t;
+
+// the entries of a region file while reading
+typedef struct {
+    regionset_t *set;
+    int region_capacity;
+    regionnodeentry_t *nodes[3];
+    int number_nodes[3];
+    int node_capacity[3];
+    linkentry_t *links;
+    int link_capacity;
+} regionfile_t;
+
+#define REGION_ENTRY_START 0
+#define REGION_ENTRY_OBSERVE 1
+#define REGION_ENTRY_FREQ 2
+
+// a range of rows of one region
+typedef struct {
+    int region;
+    int start_x;
+    int end_x;
+} regionrows_t;
+
+// the work of one thread: the row ranges of the regions it sweeps and the link rows it gathers
+typedef struct {
+    regionset_t *set;
+    int num_ticks;
+    // the swept row ranges and one partial context per range
+    int number_items;
+    regionrows_t *rows;
+    partialsimulationcontext_t *items;
+    // the link rows of each region gathered by the thread. Length: number of regions
+    int *link_first_row;
+    int *link_end_row;
+    threadbarrier_t *barrier;
+} regionthread_t;
+
+static int find_region(const regionset_t *set, const char *name) {
+    for (int r = 0; r < set->number_regions; r++) {
+        if (strcmp(set->regions[r].name, name) == 0) {
+            return r;
+        }
+    }
+    return -1;
+}
+
+static int inside_region(const region_t *region, int x, int y) {
+    return x >= 0 && x < region->number_nodes_x && y >= 0 && y < region->number_nodes_y;
+}
+
+static int compare_links(const void *a, const void *b) {
+    const linkentry_t *link_a = a;
+    const linkentry_t *link_b = b;
+    if (link_a->target_region != link_b->target_region) {
+        return link_a->target_region - link_b->target_region;
+    }
+    if (link_a->target.x != link_b->target.x) {
+        return link_a->target.x - link_b->target.x;
+    }
+    if (link_a->target.y != link_b->target.y) {
+        return link_a->target.y - link_b->target.y;
+    }
+    if (link_a->source_region != link_b->source_region) {
+        return link_a->source_region - link_b->source_region;
+    }
+    if (link_a->source.x != link_b->source.x) {
+        return link_a->source.x - link_b->source.x;
+    }
+    return link_a->source.y - link_b->source.y;
+}
+
+// parses "region NAME X_NODES Y_NODES [KERNEL] [FACTOR=VALUE ...]", the tokens after "region"
+static int parse_region(regionfile_t *file, char **tokens, int number_tokens, const simulationoptions_t *defaults) {
+    regionset_t *set = file->set;
+    if (number_tokens < 3 || strlen(tokens[0]) >= REGION_NAME_LENGTH) {
+        printf("Expected: region NAME X_NODES Y_NODES [KERNEL] [FACTOR=VALUE ...], names of at most %d "
+               "characters.\n", REGION_NAME_LENGTH - 1);
+        return 1;
+    }
+    if (find_region(set, tokens[0]) >= 0) {
+        printf("Region %s is declared twice.\n", tokens[0]);
+        return 1;
+    }
+    if (set->number_regions == file->region_capacity) {
+        file->region_capacity *= 2;
+        set->regions = realloc(set->regions, file->region_capacity * sizeof(region_t));
+    }
+    region_t *region = &set->regions[set->number_regions];
+    memset(region, 0, sizeof(region_t));
+    strcpy(region->name, tokens[0]);
+    region->number_nodes_x = atoi(tokens[1]);
+    region->number_nodes_y = atoi(tokens[2]);
+    if (region->number_nodes_x < 1 || region->number_nodes_y < 1) {
+        printf("Region %s must have positive sizes.\n", region->name);
+        return 1;
+    }
+    init_simulation_options(&region->options);
+    region->options.kernel_name = defaults->kernel_name;
+    region->options.kernel_method = defaults->kernel_method;
+    region->options.parameters = defaults->parameters;
+    for (int k = 3; k < number_tokens; k++) {
+        char *value = strchr(tokens[k], '=');
+        if (value == NULL) {
+            if (k > 3 || strlen(tokens[k]) >= REGION_NAME_LENGTH) {
+                printf("Expected FACTOR=VALUE instead of %s.\n", tokens[k]);
+                return 1;
+            }
+            strcpy(region->kernel_name, tokens[k]);
+            continue;
+        }
+        *value = '\0';
+        int parameter = -1;
+        for (int i = 0; i < NUM_REGION_PARAMETERS; i++) {
+            if (strcmp(tokens[k], REGION_PARAMETER_NAMES[i]) == 0) {
+                parameter = i;
+            }
+        }
+        if (parameter < 0) {
+            printf("Unknown model parameter %s.\n", tokens[k]);
+            return 1;
+        }
+        *(nodeval_t *) ((char *) &region->options.parameters + REGION_PARAMETER_OFFSETS[parameter]) =
+                atof(value + 1);
+    }
+    set->number_regions++;
+    return 0;
+}
+
+// parses "start|observe|freq NAME x y [value]", the tokens after the keyword
+static int parse_region_node(regionfile_t *file, int type, char **tokens, int number_tokens) {
+    if (number_tokens < (type == REGION_ENTRY_OBSERVE ? 3 : 4)) {
+        printf("Expected: %s NAME x y%s.\n", type == REGION_ENTRY_START ? "start" :
+                                            type == REGION_ENTRY_OBSERVE ? "observe" : "freq",
+               type == REGION_ENTRY_START ? " level" : type == REGION_ENTRY_OBSERVE ? "" : " frequency");
+        return 1;
+    }
+    regionnodeentry_t entry;
+    entry.region = find_region(file->set, tokens[0]);
+    if (entry.region < 0) {
+        printf("Unknown region %s.\n", tokens[0]);
+        return 1;
+    }
+    entry.x = atoi(tokens[1]);
+    entry.y = atoi(tokens[2]);
+    entry.value = type == REGION_ENTRY_OBSERVE ? 0 : atof(tokens[3]);
+    if (!inside_region(&file->set->regions[entry.region], entry.x, entry.y)) {
+        printf("Node (%d;%d) is outside of region %s.\n", entry.x, entry.y, tokens[0]);
+        return 1;
+    }
+    if (file->number_nodes[type] == file->node_capacity[type]) {
+        file->node_capacity[type] *= 2;
+        file->nodes[type] = realloc(file->nodes[type], file->node_capacity[type] * sizeof(regionnodeentry_t));
+    }
+    file->nodes[type][file->number_nodes[type]++] = entry;
+    return 0;
+}
+
+// parses "link SOURCE_NAME source_x source_y TARGET_NAME target_x target_y weight", the tokens after "link"
+static int parse_link(regionfile_t *file, char **tokens, int number_tokens) {
+    if (number_tokens < 7) {
+        printf("Expected: link SOURCE_NAME source_x source_y TARGET_NAME target_x target_y weight.\n");
+        return 1;
+    }
+    linkentry_t link;
+    link.source_region = find_region(file->set, tokens[0]);
+    link.target_region = find_region(file->set, tokens[3]);
+    if (link.source_region < 0 || link.target_region < 0) {
+        printf("Unknown region %s.\n", link.source_region < 0 ? tokens[0] : tokens[3]);
+        return 1;
+    }
+    link.source.x = atoi(tokens[1]);
+    link.source.y = atoi(tokens[2]);
+    link.target.x = atoi(tokens[4]);
+    link.target.y = atoi(tokens[5]);
+    link.weight = atof(tokens[6]);
+    if (!inside_region(&file->set->regions[link.source_region], link.source.x, link.source.y)
+        || !inside_region(&file->set->regions[link.target_region], link.target.x, link.target.y)) {
+        printf("The link connects nodes outside of its regions.\n");
+        return 1;
+    }
+    if (file->set->number_links == file->link_capacity) {
+        file->link_capacity *= 2;
+        file->links = realloc(file->links, file->link_capacity * sizeof(linkentry_t));
+    }
+    file->links[file->set->number_links++] = link;
+    return 0;
+}
+
+// stores the sorted and merged links into a region as connectome in CSR format, one row per target node
+static void init_region_links(region_t *region, const linkentry_t *links, int number_links) {
+    connectome_t *connectome = malloc(sizeof(connectome_t));
+    int number_rows = 0;
+    for (int k = 0; k < number_links; k++) {
+        if (k == 0 || links[k].target.x != links[k - 1].target.x || links[k].target.y != links[k - 1].target.y) {
+            number_rows++;
+        }
+    }
+    connectome->number_rows = number_rows;
+    connectome->number_connections = number_links;
+    connectome->row_offsets = malloc((number_rows + 1) * sizeof(int));
+    connectome->sources = malloc(number_links * sizeof(connectionnode_t));
+    connectome->weights = malloc(number_links * sizeof(nodeval_t));
+    connectome->row_targets = malloc(number_rows * sizeof(connectionnode_t));
+    connectome->sums = calloc(number_rows, sizeof(nodeval_t));
+    region->link_source_regions = malloc(number_links * sizeof(int));
+    int row = -1;
+    for (int k = 0; k < number_links; k++) {
+        if (k == 0 || links[k].target.x != links[k - 1].target.x || links[k].target.y != links[k - 1].target.y) {
+            row++;
+            connectome->row_offsets[row] = k;
+            connectome->row_targets[row] = links[k].target;
+        }
+        connectome->sources[k] = links[k].source;
+        connectome->weights[k] = links[k].weight;
+        region->link_source_regions[k] = links[k].source_region;
+    }
+    connectome->row_offsets[number_rows] = number_links;
+    // the rows are sorted by target position, so that the targets of each grid row are consecutive and sorted by y
+    connectome->grid_row_offsets = calloc(region->number_nodes_x + 1, sizeof(int));
+    connectome->grid_targets = malloc(number_rows * sizeof(connectiontarget_t));
+    for (int r = 0; r < number_rows; r++) {
+        connectome->grid_row_offsets[connectome->row_targets[r].x + 1]++;
+        connectiontarget_t target = {connectome->row_targets[r].y, r};
+        connectome->grid_targets[r] = target;
+    }
+    for (int x = 0; x < region->number_nodes_x; x++) {
+        connectome->grid_row_offsets[x + 1] += connectome->grid_row_offsets[x];
+    }
+    region->options.connectome = connectome;
+}
+
+// allocates the states of the regions, sets their start levels and creates their observation and input nodes and links
+static void init_region_nodes(regionfile_t *file, int num_ticks, double tick_ms) {
+    regionset_t *set = file->set;
+    for (int r = 0; r < set->number_regions; r++) {
+        region_t *region = &set->regions[r];
+        // the names are only referenced once the regions do not move anymore
+        if (region->kernel_name[0] != '\0') {
+            region->options.kernel_name = region->kernel_name;
+        }
+        region->state[0] = alloc_2d(region->number_nodes_x, region->number_nodes_y);
+        region->state[1] = alloc_2d(region->number_nodes_x, region->number_nodes_y);
+        region->slopes = alloc_2d(region->number_nodes_x, region->number_nodes_y);
+        init_zeros_2d(region->state[0], region->number_nodes_x, region->number_nodes_y);
+        init_zeros_2d(region->slopes, region->number_nodes_x, region->number_nodes_y);
+    }
+    for (int k = 0; k < file->number_nodes[REGION_ENTRY_START]; k++) {
+        const regionnodeentry_t *entry = &file->nodes[REGION_ENTRY_START][k];
+        set->regions[entry->region].state[0][entry->x][entry->y] = entry->value;
+    }
+    for (int k = 0; k < file->number_nodes[REGION_ENTRY_OBSERVE]; k++) {
+        set->regions[file->nodes[REGION_ENTRY_OBSERVE][k].region].num_observationnodes++;
+    }
+    for (int k = 0; k < file->number_nodes[REGION_ENTRY_FREQ]; k++) {
+        set->regions[file->nodes[REGION_ENTRY_FREQ][k].region].number_inputs++;
+    }
+    for (int r = 0; r < set->number_regions; r++) {
+        region_t *region = &set->regions[r];
+        region->observationnodes = malloc((region->num_observationnodes + 1) * sizeof(nodetimeseries_t));
+        region->inputs = malloc((region->number_inputs + 1) * sizeof(nodeinputseries_t));
+        region->num_observationnodes = 0;
+        region->number_inputs = 0;
+    }
+    for (int k = 0; k < file->number_nodes[REGION_ENTRY_OBSERVE]; k++) {
+        const regionnodeentry_t *entry = &file->nodes[REGION_ENTRY_OBSERVE][k];
+        region_t *region = &set->regions[entry->region];
+        nodetimeseries_t *observation = &region->observationnodes[region->num_observationnodes++];
+        observation->x_index = entry->x;
+        observation->y_index = entry->y;
+        observation->z_index = 0;
+        observation->timeseries = malloc(num_ticks * sizeof(nodeval_t));
+        observation->timeseries_ticks = num_ticks;
+    }
+    for (int k = 0; k < file->number_nodes[REGION_ENTRY_FREQ]; k++) {
+        const regionnodeentry_t *entry = &file->nodes[REGION_ENTRY_FREQ][k];
+        region_t *region = &set->regions[entry->region];
+        nodeinputseries_t *input = &region->inputs[region->number_inputs++];
+        input->x_index = entry->x;
+        input->y_index = entry->y;
+        input->z_index = 0;
+        input->timeseries = generate_sin_frequency((int) entry->value, tick_ms);
+        input->timeseries_ticks = calculate_period_length((int) entry->value, tick_ms);
+    }
+    // merge duplicate links, which are next to each other after sorting, then split them by target region
+    qsort(file->links, set->number_links, sizeof(linkentry_t), compare_links);
+    int number_links = 0;
+    for (int k = 0; k < set->number_links; k++) {
+        if (number_links > 0 && compare_links(&file->links[k], &file->links[number_links - 1]) == 0) {
+            file->links[number_links - 1].weight += file->links[k].weight;
+        } else {
+            file->links[number_links++] = file->links[k];
+        }
+    }
+    set->number_links = number_links;
+    for (int first = 0; first < number_links;) {
+        int end = first;
+        while (end < number_links && file->links[end].target_region == file->links[first].target_region) {
+            end++;
+        }
+        init_region_links(&set->regions[file->links[first].target_region], file->links + first, end - first);
+        first = end;
+    }
+}
+
+regionset_t *load_regions(const char *path, int num_ticks, double tick_ms, const simulationoptions_t *defaults) {
+    FILE *input = fopen(path, "r");
+    if (input == NULL) {
+        printf("ERROR: Cannot open region file %s.\n", path);
+        return NULL;
+    }
+    regionfile_t file;
+    file.set = malloc(sizeof(regionset_t));
+    file.set->number_regions = 0;
+    file.set->number_links = 0;
+    file.region_capacity = 8;
+    file.set->regions = malloc(file.region_capacity * sizeof(region_t));
+    for (int type = 0; type < 3; type++) {
+        file.number_nodes[type] = 0;
+        file.node_capacity[type] = 64;
+        file.nodes[type] = malloc(file.node_capacity[type] * sizeof(regionnodeentry_t));
+    }
+    file.link_capacity = 1024;
+    file.links = malloc(file.link_capacity * sizeof(linkentry_t));
+    char line[1024];
+    int line_number = 0;
+    int error = 0;
+    while (!error && fgets(line, sizeof(line), input) != NULL) {
+        line_number++;
+        char *tokens[32];
+        int number_tokens = 0;
+        for (char *token = strtok(line, " ,\t\r\n"); token != NULL && number_tokens < 32;
+             token = strtok(NULL, " ,\t\r\n")) {
+            tokens[number_tokens++] = token;
+        }
+        if (number_tokens == 0 || tokens[0][0] == '#') {
+            continue;
+        }
+        if (strcmp(tokens[0], "region") == 0) {
+            error = parse_region(&file, tokens + 1, number_tokens - 1, defaults);
+        } else if (strcmp(tokens[0], "start") == 0) {
+            error = parse_region_node(&file, REGION_ENTRY_START, tokens + 1, number_tokens - 1);
+        } else if (strcmp(tokens[0], "observe") == 0) {
+            error = parse_region_node(&file, REGION_ENTRY_OBSERVE, tokens + 1, number_tokens - 1);
+        } else if (strcmp(tokens[0], "freq") == 0) {
+            error = parse_region_node(&file, REGION_ENTRY_FREQ, tokens + 1, number_tokens - 1);
+        } else if (strcmp(tokens[0], "link") == 0) {
+            error = parse_link(&file, tokens + 1, number_tokens - 1);
+        } else {
+            printf("Unknown entry %s, expected region, start, observe, freq or link.\n", tokens[0]);
+            error = 1;
+        }
+        if (error) {
+            printf("ERROR: Invalid entry in line %d of %s.\n", line_number, path);
+        }
+    }
+    fclose(input);
+    if (!error && file.set->number_regions == 0) {
+        printf("ERROR: %s does not declare any region.\n", path);
+        error = 1;
+    }
+    if (error) {
+        free(file.set->regions);
+        free(file.set);
+        file.set = NULL;
+    } else {
+        init_region_nodes(&file, num_ticks, tick_ms);
+    }
+    for (int type = 0; type < 3; type++) {
+        free(file.nodes[type]);
+    }
+    free(file.links);
+    return file.set;
+}
+
+void free_regions(regionset_t *set) {
+    for (int r = 0; r < set->number_regions; r++) {
+        region_t *region = &set->regions[r];
+        free_2d(region->state[0], region->number_nodes_x);
+        free_2d(region->state[1], region->number_nodes_x);
+        free_2d(region->slopes, region->number_nodes_x);
+        for (int i = 0; i < region->num_observationnodes; i++) {
+            free(region->observationnodes[i].timeseries);
+        }
+        for (int i = 0; i < region->number_inputs; i++) {
+            free(region->inputs[i].timeseries);
+        }
+        free(region->observationnodes);
+        free(region->inputs);
+        if (region->options.connectome != NULL) {
+            free_connectome(region->options.connectome);
+        }
+        free(region->link_source_regions);
+    }
+    free(set->regions);
+    free(set);
+}
+
+// computes the sums of a range of the link rows into a region from the energy levels of all regions in a state
+static void gather_links(const regionset_t *set, const region_t *region, int first_row, int end_row, int state) {
+    connectome_t *connectome = region->options.connectome;
+    for (int r = first_row; r < end_row; r++) {
+        nodeval_t sum = 0;
+        for (int k = connectome->row_offsets[r]; k < connectome->row_offsets[r + 1]; k++) {
+            const connectionnode_t *source = &connectome->sources[k];
+            sum += connectome->weights[k]
+                   * set->regions[region->link_source_regions[k]].state[state][source->x][source->y];
+        }
+        connectome->sums[r] = sum;
+    }
+}
+
+static void gather_thread_links(const regionthread_t *thread, int state) {
+    for (int r = 0; r < thread->set->number_regions; r++) {
+        if (thread->set->regions[r].options.connectome != NULL) {
+            gather_links(thread->set, &thread->set->regions[r], thread->link_first_row[r], thread->link_end_row[r],
+                         state);
+        }
+    }
+}
+
+static unsigned int execute_region_thread(void *argument) {
+    regionthread_t *thread = argument;
+    // the link sums of the first tick, all sums must be computed before any thread adds them
+    gather_thread_links(thread, 0);
+#if MULTITHREADING
+    wait_at_barrier(thread->barrier);
+#endif
+    for (int j = 0; j < thread->num_ticks; j++) {
+        for (int k = 0; k < thread->number_items; k++) {
+            int returncode = execute_partial_tick(&thread->items[k], j);
+            if (returncode != 0) {
+                printf("Executing tick %d failed with return code %d. Aborting simulation.\n", j, returncode);
+                return returncode;
+            }
+        }
+#if MULTITHREADING
+        if (wait_at_barrier(thread->barrier)) {
+#endif
+            if (!(j % 100)) {
+                printf("Executed tick %d.\n", j);
+            }
+#if MULTITHREADING
+        }
+#endif
+        for (int k = 0; k < thread->number_items; k++) {
+            partialsimulationcontext_t *item = &thread->items[k];
+            extract_observationnodes(j, item->num_partial_obervationnodes, item->partial_observationnodes,
+                                     item->new_state);
+            nodeval_t **tmp = item->old_state;
+            item->old_state = item->new_state;
+            item->new_state = tmp;
+        }
+        // the link sums of the next tick, from the new energy levels of tick j (state[0] holds the even ticks)
+        gather_thread_links(thread, (j + 1) & 1);
+#if MULTITHREADING
+        wait_at_barrier(thread->barrier);
+#endif
+    }
+    return 0;
+}
+
+// splits the rows of all regions into one contiguous range of about the same cost per thread, each range split into
+// the row ranges of the regions it covers
+static void schedule_regions(regionthread_t *threads, int num_threads, regionset_t *set, const double *row_costs) {
+    double total_cost = 0;
+    for (int r = 0; r < set->number_regions; r++) {
+        total_cost += row_costs[r] * set->regions[r].number_nodes_x;
+    }
+    double cost = 0;
+    for (int r = 0; r < set->number_regions; r++) {
+        int item_thread = -1;
+        for (int x = 0; x < set->regions[r].number_nodes_x; x++) {
+            // each row goes to the thread whose share of the total cost contains its middle
+            int t = (int) ((cost + row_costs[r] / 2) * num_threads / total_cost);
+            t = t < num_threads ? t : num_threads - 1;
+            cost += row_costs[r];
+            if (t != item_thread) {
+                item_thread = t;
+                regionrows_t rows = {r, x, x};
+                threads[t].rows[threads[t].number_items++] = rows;
+            }
+            threads[t].rows[threads[t].number_items - 1].end_x = x + 1;
+        }
+    }
+}
+
+unsigned int simulate_regions(double tick_ms, int num_ticks, regionset_t *set) {
+    int number_regions = set->number_regions;
+    kernel_t *kernels = malloc(number_regions * sizeof(kernel_t));
+    double *row_costs = malloc(number_regions * sizeof(double));
+    long long number_nodes = 0;
+    for (int r = 0; r < number_regions; r++) {
+        region_t *region = &set->regions[r];
+        if (init_kernel(&kernels[r], region->options.kernel_name)
+            || init_kernel_method(&kernels[r], region->options.kernel_method, region->number_nodes_x,
+                                  region->number_nodes_y)) {
+            printf("ERROR: Invalid kernel of region %s.\n", region->name);
+            for (int i = 0; i < r; i++) {
+                free_kernel(&kernels[i]);
+            }
+            free(kernels);
+            free(row_costs);
+            return 1;
+        }
+        row_costs[r] = region->number_nodes_y
+                       * (kernel_node_cost(&kernels[r], region->number_nodes_x, region->number_nodes_y)
+                          + REGION_COST_PROCESS);
+        number_nodes += (long long) region->number_nodes_x * region->number_nodes_y;
+    }
+    int num_threads = simulation_thread_count();
+    int total_rows = 0;
+    for (int r = 0; r < number_regions; r++) {
+        total_rows += set->regions[r].number_nodes_x;
+    }
+    num_threads = num_threads < total_rows ? num_threads : total_rows;
+    printf("Starting simulation.\n");
+    printf("Regions: %d => %lld simulated nodes, %d links between them.\n", number_regions, number_nodes,
+           set->number_links);
+    for (int r = 0; r < number_regions; r++) {
+        const region_t *region = &set->regions[r];
+        const modelparameters_t *parameters = &region->options.parameters;
+        printf("Region %s: %d x %d nodes, kernel %s (%s), %d observation nodes, %d inputs, %d incoming links.\n",
+               region->name, region->number_nodes_x, region->number_nodes_y, kernels[r].name,
+               kernel_method_name(kernels[r].method), region->num_observationnodes, region->number_inputs,
+               region->options.connectome != NULL ? region->options.connectome->number_connections : 0);
+        printf("\td_neighborfactor = %g, id_neighborfactor = %g, energy_factor = %g, energy_weight = %g, "
+               "delta_factor = %g, slope_factor = %g, slope_weight = %g, damping = %g\n",
+               parameters->d_neighborfactor, parameters->id_neighborfactor, parameters->energy_factor,
+               parameters->energy_weight, parameters->delta_factor, parameters->slope_factor,
+               parameters->slope_weight, parameters->damping);
+    }
+    printf("Number of ticks: %d\n", num_ticks);
+    printf("Length of each tick (ms): %f\n", tick_ms);
+    printf("Number of threads: %d\n", num_threads);
+    struct timeval tv1, tv2;
+    get_daytime(&tv1);
+
+    threadbarrier_t barrier;
+    regionthread_t *threads = malloc(num_threads * sizeof(regionthread_t));
+    for (int t = 0; t < num_threads; t++) {
+        threads[t].set = set;
+        threads[t].num_ticks = num_ticks;
+        threads[t].number_items = 0;
+        // a contiguous range of rows covers each region at most once
+        threads[t].rows = malloc(number_regions * sizeof(regionrows_t));
+        threads[t].items = malloc(number_regions * sizeof(partialsimulationcontext_t));
+        threads[t].link_first_row = calloc(number_regions, sizeof(int));
+        threads[t].link_end_row = calloc(number_regions, sizeof(int));
+        threads[t].barrier = &barrier;
+        for (int r = 0; r < number_regions; r++) {
+            if (set->regions[r].options.connectome != NULL) {
+                // the threads sum similar numbers of links, independent of the rows they sweep
+                connectome_row_range(set->regions[r].options.connectome, t, t + 1, num_threads,
+                                     &threads[t].link_first_row[r], &threads[t].link_end_row[r]);
+            }
+        }
+    }
+    schedule_regions(threads, num_threads, set, row_costs);
+    for (int t = 0; t < num_threads; t++) {
+        for (int k = 0; k < threads[t].number_items; k++) {
+            const regionrows_t *rows = &threads[t].rows[k];
+            region_t *region = &set->regions[rows->region];
+            init_partial_simulation_context(&threads[t].items[k], num_ticks, tick_ms, region->number_nodes_x,
+                                            region->number_nodes_y, region->num_observationnodes,
+                                            region->observationnodes, region->state[0], region->state[1],
+                                            region->slopes, NULL, NULL, NULL, &kernels[rows->region],
+                                            region->number_inputs, region->inputs, NULL, NULL, NULL,
+                                            &region->options, rows->start_x, rows->end_x, &barrier);
+        }
+    }
+#if MULTITHREADING
+    init_thread_barrier(&barrier, num_threads);
+    threadhandle_t **handles = malloc(num_threads * sizeof(threadhandle_t *));
+    for (int t = 0; t < num_threads; t++) {
+        handles[t] = create_and_run_thread(execute_region_thread, &threads[t]);
+    }
+    join_and_close_simulation_threads(handles, num_threads);
+    destroy_thread_barrier(&barrier);
+    free(handles);
+#else
+    execute_region_thread(threads);
+#endif
+    for (int t = 0; t < num_threads; t++) {
+        for (int k = 0; k < threads[t].number_items; k++) {
+            partialsimulationcontext_t *item = &threads[t].items[k];
+            free(item->partial_observationnodes);
+            free(item->partial_inputs);
+            free(item->partial_input_row_offsets);
+            if (item->kernel_workspace != NULL) {
+                free_kernel_workspace(item->kernel_workspace);
+                free(item->kernel_workspace);
+            }
+        }
+        free(threads[t].rows);
+        free(threads[t].items);
+        free(threads[t].link_first_row);
+        free(threads[t].link_end_row);
+    }
+    free(threads);
+    for (int r = 0; r < number_regions; r++) {
+        free_kernel(&kernels[r]);
+    }
+    free(kernels);
+    free(row_costs);
+    printf("Simulation finished succesfully!\n");
+    get_daytime(&tv2);
+    double seconds = (double) (tv2.tv_usec - tv1.tv_usec) / 1000000 + (double) (tv2.tv_sec - tv1.tv_sec);
+    printf("Total time = %f seconds\n", seconds);
+    printf("Node updates per second = %g\n", (double) number_nodes * num_ticks / seconds);
+    return 0;
+}
@@ -0,0 +1,140 @@
+#ifndef REGIONS_H
+#define REGIONS_H
+
+#include "definitions.h"
+#include "connectome.h"
+
+/**
+ * @file
+ * Simulation of multiple coupled grids (regions) in one run.
+ *
+ * Each region is a grid of its own size, kernel and model parameters. Regions are coupled by sparse links, each adding
+ * the energy level of its source node at the previous tick, multiplied with the link's weight, to the new energy level
+ * of its target node in another (or the same) region, like the long-range connections of a single grid (see
+ * connectome.h). The regions are read from a text file with one entry per line:
+ *
+ *     region NAME X_NODES Y_NODES [KERNEL] [FACTOR=VALUE ...]
+ *     start NAME x y level
+ *     observe NAME x y
+ *     freq NAME x y frequency
+ *     link SOURCE_NAME source_x source_y TARGET_NAME target_x target_y weight
+ *
+ * FACTOR is the name of a model parameter (d_neighborfactor, id_neighborfactor, energy_factor, energy_weight,
+ * delta_factor, slope_factor, slope_weight or damping). Kernels and parameters not given for a region are taken from
+ * the command line. Values are separated by whitespace or commas, empty lines and lines starting with '#' are ignored.
+ * Regions must be declared before they are referenced.
+ *
+ * All regions are swept together by the same threads in each tick. The rows of all regions are split into contiguous
+ * ranges of about the same estimated cost (see kernel_node_cost()), so that a thread may sweep the end of one region
+ * and the start of the next, and small regions do not leave threads idle. The links into each region are stored in CSR
+ * format, one row per target node, and their sums are gathered by all threads between the ticks, each thread summing a
+ * range of rows with about the same number of links. The sums are added to the targets during the next sweep, like
+ * inputs.
+ */
+
+/** Maximum length of a region name, including the terminating zero. */
+#define REGION_NAME_LENGTH 32
+
+/**
+ * A region of a multi-region run.
+ */
+typedef struct {
+    /**
+    * The name of the region, used in the region file and the output file names.
+    */
+    char name[REGION_NAME_LENGTH];
+    /**
+    * The x-size of the region.
+    */
+    int number_nodes_x;
+    /**
+    * The y-size of the region.
+    */
+    int number_nodes_y;
+    /**
+    * The name of the region's kernel, an empty name for the kernel given on the command line.
+    */
+    char kernel_name[REGION_NAME_LENGTH];
+    /**
+    * The settings of the region: its kernel, model parameters and incoming links (as connectome).
+    */
+    simulationoptions_t options;
+    /**
+    * The energy levels of even (state[0], starting with the start levels) and odd ticks.
+    */
+    nodeval_t **state[2];
+    /**
+    * The slopes of the nodes.
+    */
+    nodeval_t **slopes;
+    /**
+    * The number of observed nodes of the region.
+    */
+    int num_observationnodes;
+    /**
+    * The observed nodes of the region. Length: num_observationnodes.
+    */
+    nodetimeseries_t *observationnodes;
+    /**
+    * The number of frequency generating nodes of the region.
+    */
+    int number_inputs;
+    /**
+    * The frequency generating nodes of the region. Length: number_inputs.
+    */
+    nodeinputseries_t *inputs;
+    /**
+    * The region of the source of each link into this region, in the order of options.connectome->sources. NULL
+    * without incoming links.
+    */
+    int *link_source_regions;
+}
+        region_t;
+
+/**
+ * The regions of a multi-region run.
+ */
+typedef struct {
+    /**
+    * The number of regions.
+    */
+    int number_regions;
+    /**
+    * The regions. Length: number_regions.
+    */
+    region_t *regions;
+    /**
+    * The number of links between all regions.
+    */
+    int number_links;
+}
+        regionset_t;
+
+/**
+ * Reads the regions, their start levels, observation and input nodes and the links between them from a file.
+ * @param path The path of the region file.
+ * @param num_ticks The number of ticks to simulate, the length of the observation series.
+ * @param tick_ms Milliseconds in between each simulation tick.
+ * @param defaults The settings of the command line, providing the kernel, kernel method and model parameters of all
+ * regions that do not set their own.
+ * @return The regions, or NULL if the file could not be read or contains invalid entries.
+ */
+regionset_t *load_regions(const char *path, int num_ticks, double tick_ms, const simulationoptions_t *defaults);
+
+/**
+ * Frees regions loaded using load_regions(), including their observation series.
+ * @param regions The regions.
+ */
+void free_regions(regionset_t *regions);
+
+/**
+ * Simulates all regions together. The counterpart of simulate() for multiple coupled grids.
+ * @param tick_ms Milliseconds in between each simulation tick.
+ * @param num_ticks The number of ticks to simulate.
+ * @param regions The regions. The energy level of observation node i of a region after tick j is written to its
+ * timeseries[j].
+ * @return Return-codes.
+ */
+unsigned int simulate_regions(double tick_ms, int num_ticks, regionset_t *regions);
+
+#endif
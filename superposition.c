@@ -0,0 +1,441 @@
+#include "superposition.h"
+#include "brainsimulation.h"
+#include "kernels.h"
+#include "connectome.h"
+#include "fft.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// a node receiving inputs or start energy
+typedef struct {
+    int x;
+    int y;
+    // the energy added to the node before tick m - 1: the start level at [0], the sum of its inputs at tick m - 1 at
+    // [m], length: num_ticks + 1
+    nodeval_t *excitation;
+} impulsesource_t;
+
+// FNV-1a
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for (size_t k = 0; k < size; k++) {
+        hash ^= bytes[k];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t hash_plane(uint64_t hash, const nodeval_t *plane, size_t size) {
+    unsigned char present = plane != NULL;
+    hash = hash_bytes(hash, &present, 1);
+    return plane != NULL ? hash_bytes(hash, plane, size * sizeof(nodeval_t)) : hash;
+}
+
+// the hash of everything the impulse responses depend on besides the positions of the nodes
+static uint64_t configuration_hash(int number_nodes_x, int number_nodes_y, const simulationoptions_t *options) {
+    uint64_t hash = 14695981039346656037ULL;
+    hash = hash_bytes(hash, &number_nodes_x, sizeof(int));
+    hash = hash_bytes(hash, &number_nodes_y, sizeof(int));
+    const char *kernel_name = options->kernel_name != NULL && options->kernel_name[0] != '\0' ? options->kernel_name
+                                                                                             : KERNEL_DEFAULT_NAME;
+    hash = hash_bytes(hash, kernel_name, strlen(kernel_name) + 1);
+    const modelparameters_t *parameters = &options->parameters;
+    const nodeval_t factors[] = {parameters->d_neighborfactor, parameters->id_neighborfactor,
+                                 parameters->energy_factor, parameters->energy_weight, parameters->delta_factor,
+                                 parameters->slope_factor, parameters->slope_weight, parameters->damping};
+    hash = hash_bytes(hash, factors, sizeof(factors));
+    const parametermaps_t *maps = options->parameter_maps;
+    if (maps != NULL) {
+        size_t size = (size_t) number_nodes_x * number_nodes_y;
+        hash = hash_plane(hash, maps->d_neighborfactor, size);
+        hash = hash_plane(hash, maps->id_neighborfactor, size);
+        hash = hash_plane(hash, maps->energy_factor, size);
+        hash = hash_plane(hash, maps->energy_weight, size);
+        hash = hash_plane(hash, maps->delta_factor, size);
+        hash = hash_plane(hash, maps->slope_factor, size);
+        hash = hash_plane(hash, maps->slope_weight, size);
+        hash = hash_plane(hash, maps->damping, size);
+    }
+    const connectome_t *connectome = options->connectome;
+    if (connectome != NULL) {
+        hash = hash_bytes(hash, &connectome->number_rows, sizeof(int));
+        hash = hash_bytes(hash, connectome->row_offsets, (connectome->number_rows + 1) * sizeof(int));
+        hash = hash_bytes(hash, connectome->row_targets, connectome->number_rows * sizeof(connectionnode_t));
+        hash = hash_bytes(hash, connectome->sources, connectome->number_connections * sizeof(connectionnode_t));
+        hash = hash_bytes(hash, connectome->weights, connectome->number_connections * sizeof(nodeval_t));
+    }
+    return hash;
+}
+
+static void cache_file_path(char *path, const char *cache, uint64_t hash, int source_x, int source_y, int node_x,
+                            int node_y) {
+    sprintf(path, "%s/%016llx-%d-%d-%d-%d.bin", cache, (unsigned long long) hash, source_x, source_y, node_x, node_y);
+}
+
+// reads the first num_ticks ticks of a cached response, returns 0 if it is not cached for that many ticks
+// only checks whether it is cached if response is NULL
+static int read_cached_response(const char *path, int num_ticks, nodeval_t *response) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    char magic[4];
+    int32_t ticks;
+    int found = fread(magic, 1, 4, file) == 4 && memcmp(magic, "BSIR", 4) == 0
+                && fread(&ticks, sizeof(int32_t), 1, file) == 1 && ticks >= num_ticks
+                && (response == NULL
+                    || fread(response, sizeof(nodeval_t), num_ticks, file) == (size_t) num_ticks);
+    fclose(file);
+    return found;
+}
+
+static void write_cached_response(const char *path, int num_ticks, const nodeval_t *response) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        printf("WARNING: Cannot write impulse response cache file %s.\n", path);
+        return;
+    }
+    int32_t ticks = num_ticks;
+    fwrite("BSIR", 1, 4, file);
+    fwrite(&ticks, sizeof(int32_t), 1, file);
+    fwrite(response, sizeof(nodeval_t), num_ticks, file);
+    fclose(file);
+}
+
+// collects the nodes with inputs or start levels, inputs outside of the grid are ignored like by simulate()
+static impulsesource_t *find_sources(int num_ticks, int number_nodes_x, int number_nodes_y, nodeval_t **nodes,
+                                     int number_inputs, const nodeinputseries_t *inputs, int *number_sources) {
+    int *source_index = malloc((size_t) number_nodes_x * number_nodes_y * sizeof(int));
+    for (size_t node = 0; node < (size_t) number_nodes_x * number_nodes_y; node++) {
+        source_index[node] = -1;
+    }
+    int capacity = 16;
+    int count = 0;
+    impulsesource_t *sources = malloc(capacity * sizeof(impulsesource_t));
+    for (int k = -number_nodes_x * number_nodes_y; k < number_inputs; k++) {
+        // negative k scan the start levels, the others the inputs
+        int x, y;
+        if (k < 0) {
+            int node = k + number_nodes_x * number_nodes_y;
+            x = node / number_nodes_y;
+            y = node % number_nodes_y;
+            if (nodes[x][y] == 0) {
+                continue;
+            }
+        } else {
+            x = inputs[k].x_index;
+            y = inputs[k].y_index;
+            if (x < 0 || x >= number_nodes_x || y < 0 || y >= number_nodes_y) {
+                continue;
+            }
+        }
+        int *index = &source_index[(size_t) x * number_nodes_y + y];
+        if (*index < 0) {
+            if (count == capacity) {
+                capacity *= 2;
+                sources = realloc(sources, capacity * sizeof(impulsesource_t));
+            }
+            sources[count].x = x;
+            sources[count].y = y;
+            sources[count].excitation = calloc(num_ticks + 1, sizeof(nodeval_t));
+            *index = count++;
+        }
+        nodeval_t *excitation = sources[*index].excitation;
+        if (k < 0) {
+            excitation[0] = nodes[x][y];
+        } else {
+            for (int tick = 0; tick < num_ticks; tick++) {
+                excitation[tick + 1] += inputs[k].timeseries[tick % inputs[k].timeseries_ticks];
+            }
+        }
+    }
+    free(source_index);
+    *number_sources = count;
+    return sources;
+}
+
+// whether the response of a node to an impulse at another node equals the response of the other node to an impulse
+// at the node: all kernels are symmetric, so the update is symmetric with uniform parameters and without connections
+static int is_reciprocal(const simulationoptions_t *options) {
+    return options->parameter_maps == NULL && options->connectome == NULL;
+}
+
+// the cache file of the response of a node to an impulse, named after the input or start node and the observation
+// node, which are swapped when simulating an impulse at the observation node
+static void impulse_cache_path(char *path, const char *cache, uint64_t hash, const nodetimeseries_t *impulse,
+                               const nodetimeseries_t *node, int reciprocal) {
+    if (reciprocal) {
+        cache_file_path(path, cache, hash, node->x_index, node->y_index, impulse->x_index, impulse->y_index);
+    } else {
+        cache_file_path(path, cache, hash, impulse->x_index, impulse->y_index, node->x_index, node->y_index);
+    }
+}
+
+// the number of impulses whose responses are not all cached
+static int count_uncached_impulses(int num_ticks, int number_impulses, const nodetimeseries_t *impulses,
+                                   int number_nodes, const nodetimeseries_t *nodes, int reciprocal,
+                                   const char *cache, uint64_t hash) {
+    if (cache == NULL) {
+        return number_impulses;
+    }
+    char path[4096];
+    int count = 0;
+    for (int i = 0; i < number_impulses; i++) {
+        int cached = 1;
+        for (int n = 0; n < number_nodes && cached; n++) {
+            impulse_cache_path(path, cache, hash, &impulses[i], &nodes[n], reciprocal);
+            cached = read_cached_response(path, num_ticks, NULL);
+        }
+        count += !cached;
+    }
+    return count;
+}
+
+// computes the responses of the nodes to a unit start level at the impulse node, the response of node n at
+// [n * (num_ticks + 1) + m] is its energy level m ticks after the impulse
+static unsigned int impulse_responses(double tick_ms, int num_ticks, int number_nodes_x, int number_nodes_y,
+                                      const nodetimeseries_t *impulse, int number_nodes, const nodetimeseries_t *nodes,
+                                      int reciprocal, const simulationoptions_t *options, uint64_t hash,
+                                      nodeval_t *responses) {
+    const char *cache = options->impulse_cache;
+    char path[4096];
+    int cached = cache != NULL;
+    for (int n = 0; n < number_nodes && cached; n++) {
+        impulse_cache_path(path, cache, hash, impulse, &nodes[n], reciprocal);
+        cached = read_cached_response(path, num_ticks, responses + (size_t) n * (num_ticks + 1) + 1);
+    }
+    if (!cached) {
+        nodeval_t **state = alloc_2d(number_nodes_x, number_nodes_y);
+        init_zeros_2d(state, number_nodes_x, number_nodes_y);
+        state[impulse->x_index][impulse->y_index] = 1;
+        nodetimeseries_t *impulse_observations = malloc(number_nodes * sizeof(nodetimeseries_t));
+        for (int n = 0; n < number_nodes; n++) {
+            impulse_observations[n].x_index = nodes[n].x_index;
+            impulse_observations[n].y_index = nodes[n].y_index;
+            impulse_observations[n].z_index = nodes[n].z_index;
+            impulse_observations[n].timeseries = responses + (size_t) n * (num_ticks + 1) + 1;
+            impulse_observations[n].timeseries_ticks = num_ticks;
+        }
+        simulationoptions_t impulse_options = *options;
+        impulse_options.superposition = 0;
+        impulse_options.setup_seconds = 0;
+        unsigned int returncode = simulate(tick_ms, num_ticks, number_nodes_x, number_nodes_y, state, number_nodes,
+                                           impulse_observations, 0, NULL, &impulse_options);
+        free(impulse_observations);
+        free_2d(state, number_nodes_x);
+        if (returncode != 0) {
+            return returncode;
+        }
+        if (cache != NULL) {
+            for (int n = 0; n < number_nodes; n++) {
+                impulse_cache_path(path, cache, hash, impulse, &nodes[n], reciprocal);
+                write_cached_response(path, num_ticks, responses + (size_t) n * (num_ticks + 1) + 1);
+            }
+        }
+    }
+    for (int n = 0; n < number_nodes; n++) {
+        responses[(size_t) n * (num_ticks + 1)] = nodes[n].x_index == impulse->x_index
+                                                  && nodes[n].y_index == impulse->y_index;
+    }
+    return 0;
+}
+
+// copies a series into the real parts of a transform, padded with zeros
+static void load_series(nodeval_t *re, const nodeval_t *series, int length, int size) {
+    memcpy(re, series, length * sizeof(nodeval_t));
+    memset(re + length, 0, (size - length) * sizeof(nodeval_t));
+}
+
+// adds the product of the transforms of an excitation and a response to the sum of a pair of observation nodes, the
+// series of the second node of the pair is the imaginary part of the pair's series, i.e., its transform is multiplied
+// by i
+static void add_product(nodeval_t *sum_re, nodeval_t *sum_im, const nodeval_t *excitation_re,
+                        const nodeval_t *excitation_im, const nodeval_t *response_re, const nodeval_t *response_im,
+                        int size, int imaginary) {
+    for (int k = 0; k < size; k++) {
+        nodeval_t product_re = excitation_re[k] * response_re[k] - excitation_im[k] * response_im[k];
+        nodeval_t product_im = excitation_re[k] * response_im[k] + excitation_im[k] * response_re[k];
+        if (imaginary) {
+            sum_re[k] -= product_im;
+            sum_im[k] += product_re;
+        } else {
+            sum_re[k] += product_re;
+            sum_im[k] += product_im;
+        }
+    }
+}
+
+unsigned int simulate_superposition(double tick_ms, int num_ticks, int number_nodes_x, int number_nodes_y,
+                                    nodeval_t **nodes, int num_obervationnodes, nodetimeseries_t *observationnodes,
+                                    int number_inputs, nodeinputseries_t *inputs, const simulationoptions_t *options) {
+    struct timeval tv1, tv2;
+    get_daytime(&tv1);
+    if (options->ensemble_size > 1) {
+        printf("ERROR: Ensembles cannot be simulated by superposition.\n");
+        return 1;
+    }
+    if (options->input_stream != NULL) {
+        printf("ERROR: Input streams cannot be simulated by superposition.\n");
+        return 1;
+    }
+    int number_sources;
+    impulsesource_t *sources = find_sources(num_ticks, number_nodes_x, number_nodes_y, nodes, number_inputs, inputs,
+                                            &number_sources);
+    nodetimeseries_t *source_nodes = calloc(number_sources > 0 ? number_sources : 1, sizeof(nodetimeseries_t));
+    for (int s = 0; s < number_sources; s++) {
+        source_nodes[s].x_index = sources[s].x;
+        source_nodes[s].y_index = sources[s].y;
+    }
+    uint64_t hash = configuration_hash(number_nodes_x, number_nodes_y, options);
+    // with a symmetric update, one impulse per observation node yields the same responses as one per source
+    int reciprocal = is_reciprocal(options) && num_obervationnodes < number_sources;
+    int number_impulses = reciprocal ? num_obervationnodes : number_sources;
+    const nodetimeseries_t *impulses = reciprocal ? observationnodes : source_nodes;
+    int number_responses = reciprocal ? number_sources : num_obervationnodes;
+    const nodetimeseries_t *responding = reciprocal ? source_nodes : observationnodes;
+    if (options->impulse_cache != NULL) {
+#ifdef _WIN32
+        _mkdir(options->impulse_cache);
+#else
+        mkdir(options->impulse_cache, 0777);
+#endif
+    }
+    // each impulse that is not cached costs a simulation of all ticks, a direct run costs one
+    int number_uncached = count_uncached_impulses(num_ticks, number_impulses, impulses, number_responses, responding,
+                                                  reciprocal, options->impulse_cache, hash);
+    if (number_uncached > 1 && options->superposition != SUPERPOSITION_ALWAYS) {
+        if (options->impulse_cache == NULL) {
+            printf("WARNING: Superposing costs %d simulations of %d ticks without an impulse response cache, a direct "
+                   "run costs one. Simulating directly.\n", number_uncached, num_ticks);
+            for (int s = 0; s < number_sources; s++) {
+                free(sources[s].excitation);
+            }
+            free(sources);
+            free(source_nodes);
+            simulationoptions_t direct_options = *options;
+            direct_options.superposition = 0;
+            return simulate(tick_ms, num_ticks, number_nodes_x, number_nodes_y, nodes, num_obervationnodes,
+                            observationnodes, number_inputs, inputs, &direct_options);
+        }
+        printf("WARNING: %d of %d impulse responses are not cached, computing them costs %d simulations of %d ticks "
+               "(a direct run costs one). Later runs of this configuration read them.\n", number_uncached,
+               number_impulses, number_uncached, num_ticks);
+    }
+    if (options->early_stop_tolerance > 0) {
+        printf("WARNING: Runs simulated by superposition cannot stop early, only their impulse responses stop once "
+               "they decayed. Superposing all ticks.\n");
+    }
+    if (reciprocal) {
+        printf("Simulating by superposition of the impulse responses of %d nodes, simulated as the responses to "
+               "impulses at %d observation nodes.\n", number_sources, num_obervationnodes);
+    } else {
+        printf("Simulating by superposition of the impulse responses of %d nodes.\n", number_sources);
+    }
+    if (options->impulse_cache != NULL) {
+        printf("Impulse response cache: %s (configuration %016llx).\n", options->impulse_cache,
+               (unsigned long long) hash);
+    }
+    // the linear convolution of two series of num_ticks + 1 values must not wrap around
+    int size = 1;
+    while (size <= 2 * num_ticks) {
+        size *= 2;
+    }
+    fftplan_t plan;
+    init_fft_plan(&plan, size);
+    // the series of two observation nodes are convolved together, as real and imaginary part of one transform
+    int number_pairs = (num_obervationnodes + 1) / 2;
+    nodeval_t *sums_re = calloc((size_t) number_pairs * size, sizeof(nodeval_t));
+    nodeval_t *sums_im = calloc((size_t) number_pairs * size, sizeof(nodeval_t));
+    nodeval_t *excitation_re = malloc(size * sizeof(nodeval_t));
+    nodeval_t *excitation_im = malloc(size * sizeof(nodeval_t));
+    nodeval_t *response_re = malloc(size * sizeof(nodeval_t));
+    nodeval_t *response_im = malloc(size * sizeof(nodeval_t));
+    nodeval_t *responses = malloc((size_t) number_responses * (num_ticks + 1) * sizeof(nodeval_t));
+    unsigned int returncode = 0;
+    for (int i = 0; i < number_impulses && returncode == 0; i++) {
+        printf("Impulse response %d of %d: node (%d;%d).\n", i + 1, number_impulses, impulses[i].x_index,
+               impulses[i].y_index);
+        returncode = impulse_responses(tick_ms, num_ticks, number_nodes_x, number_nodes_y, &impulses[i],
+                                       number_responses, responding, reciprocal, options, hash, responses);
+        if (returncode != 0) {
+            break;
+        }
+        if (reciprocal) {
+            // the responses of all sources to the impulse at observation node i
+            nodeval_t *sum_re = sums_re + (size_t) (i / 2) * size;
+            nodeval_t *sum_im = sums_im + (size_t) (i / 2) * size;
+            // the excitations and responses are transformed separately, the responses may be orders of magnitude
+            // larger than the excitations and would drown them in rounding errors if transformed together
+            for (int s = 0; s < number_sources; s++) {
+                load_series(excitation_re, sources[s].excitation, num_ticks + 1, size);
+                memset(excitation_im, 0, size * sizeof(nodeval_t));
+                fft_columns(&plan, excitation_re, excitation_im, 1, 0);
+                load_series(response_re, responses + (size_t) s * (num_ticks + 1), num_ticks + 1, size);
+                memset(response_im, 0, size * sizeof(nodeval_t));
+                fft_columns(&plan, response_re, response_im, 1, 0);
+                add_product(sum_re, sum_im, excitation_re, excitation_im, response_re, response_im, size, i % 2);
+            }
+            continue;
+        }
+        load_series(excitation_re, sources[i].excitation, num_ticks + 1, size);
+        memset(excitation_im, 0, size * sizeof(nodeval_t));
+        fft_columns(&plan, excitation_re, excitation_im, 1, 0);
+        for (int p = 0; p < number_pairs; p++) {
+            load_series(response_re, responses + (size_t) 2 * p * (num_ticks + 1), num_ticks + 1, size);
+            if (2 * p + 1 < num_obervationnodes) {
+                load_series(response_im, responses + (size_t) (2 * p + 1) * (num_ticks + 1), num_ticks + 1, size);
+            } else {
+                memset(response_im, 0, size * sizeof(nodeval_t));
+            }
+            fft_columns(&plan, response_re, response_im, 1, 0);
+            add_product(sums_re + (size_t) p * size, sums_im + (size_t) p * size, excitation_re, excitation_im,
+                        response_re, response_im, size, 0);
+        }
+    }
+    if (returncode == 0) {
+        // the energy added before tick m - 1 reaches the observation after tick t after t + 1 - m ticks
+        for (int p = 0; p < number_pairs; p++) {
+            nodeval_t *sum_re = sums_re + (size_t) p * size;
+            nodeval_t *sum_im = sums_im + (size_t) p * size;
+            fft_columns(&plan, sum_re, sum_im, 1, 1);
+            for (int tick = 0; tick < num_ticks; tick++) {
+                observationnodes[2 * p].timeseries[tick] = sum_re[tick + 1] / size;
+                if (2 * p + 1 < num_obervationnodes) {
+                    observationnodes[2 * p + 1].timeseries[tick] = sum_im[tick + 1] / size;
+                }
+            }
+        }
+    }
+    for (int s = 0; s < number_sources; s++) {
+        free(sources[s].excitation);
+    }
+    free(sources);
+    free(source_nodes);
+    free(responses);
+    free(response_re);
+    free(response_im);
+    free(excitation_re);
+    free(excitation_im);
+    free(sums_re);
+    free(sums_im);
+    free_fft_plan(&plan);
+    if (returncode != 0) {
+        return returncode;
+    }
+    printf("Superposition finished succesfully!\n");
+    get_daytime(&tv2);
+    printf("Setup time = %f seconds\n", options->setup_seconds);
+    printf("Total time = %f seconds\n",
+           (double) (tv2.tv_usec - tv1.tv_usec) / 1000000 +
+           (double) (tv2.tv_sec - tv1.tv_sec));
+    return 0;
+}
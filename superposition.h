@@ -0,0 +1,57 @@
+#ifndef SUPERPOSITION_H
+#define SUPERPOSITION_H
+
+#include "definitions.h"
+
+/**
+ * @file
+ * Simulation by superposition of impulse responses.
+ *
+ * The node process is linear in the energy levels and slopes, and inputs, start levels and long-range connections are
+ * added linearly. Thus, each observation series is the sum of the input series of all input nodes, each convolved with
+ * the response of the observation node to a unit impulse at the input node, plus the start levels times the same
+ * responses. The responses of all observation nodes to an impulse at one node are computed by simulating the impulse
+ * once, the series are then computed by FFT convolution. This costs one simulation per input or start node, instead of
+ * one for all of them, but the responses depend only on the grid, kernel and model, not on the inputs. They are cached
+ * on disk, so that runs with other inputs (e.g., other frequencies) on the same configuration only convolve.
+ *
+ * Each cached response is stored in its own file, named after a hash of the configuration (grid size, kernel, model
+ * parameters, parameter maps and long-range connections) and the positions of the impulse and observation node. The
+ * file contains the 4 characters BSIR, the number of ticks as 32-bit integer and the response at ticks 1 to that
+ * number as doubles, in native byte order. Responses of longer runs are reused for shorter ones.
+ *
+ * With uniform model parameters and without long-range connections, the update is symmetric, so that the response of
+ * an observation node to an impulse at an input node equals the response of the input node to an impulse at the
+ * observation node. With fewer observation nodes than input and start nodes, the responses are thus computed by
+ * simulating one impulse per observation node instead. Without a cache, superposing more than one simulated impulse
+ * costs more than a direct run, which is simulated instead.
+ */
+
+/**
+ * Value of the superposition option superposing even if simulating the impulse responses costs more than a direct
+ * run, e.g., to verify the results.
+ */
+#define SUPERPOSITION_ALWAYS 2
+
+/**
+ * Simulates the brain by superposing impulse responses. Takes the same arguments as simulate(), the results are the
+ * same up to rounding errors. Ensembles and input streams are not supported. Simulates directly if more than one
+ * impulse response would have to be simulated without a cache, unless options->superposition is
+ * SUPERPOSITION_ALWAYS.
+ * @param tick_ms Milliseconds in between each simulation tick.
+ * @param num_ticks The number of ticks to simulate.
+ * @param number_nodes_x The number of nodes in the first dimension of nodes.
+ * @param number_nodes_y The number of nodes in the second dimension of nodes.
+ * @param nodes 2D array of nodes with their starting energy level.
+ * @param num_obervationnodes The number of nodes to observe during simulation.
+ * @param observationnodes The nodes to observe, see simulate().
+ * @param number_inputs The number of input nodes.
+ * @param inputs The inputs, see simulate().
+ * @param options Optional settings of the simulation run, options->impulse_cache is the cache directory.
+ * @return Return-codes.
+ */
+unsigned int simulate_superposition(double tick_ms, int num_ticks, int number_nodes_x, int number_nodes_y,
+                                    nodeval_t **nodes, int num_obervationnodes, nodetimeseries_t *observationnodes,
+                                    int number_inputs, nodeinputseries_t *inputs, const simulationoptions_t *options);
+
+#endif
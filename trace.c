@@ -0,0 +1,154 @@
+#include "trace.h"
+#include "definitions.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// the name and the category of each phase, in the order of tracephase_t
+static const char *trace_phase_names[NUM_TRACE_PHASES] = {
+        "setup", "compute", "wait computed", "management", "input", "observation", "connections", "wait next tick",
+        "fast forward", "read frame", "output"
+};
+static const char *trace_phase_categories[NUM_TRACE_PHASES] = {
+        "setup", "compute", "barrier", "management", "input", "observation", "compute", "barrier", "compute", "io",
+        "io"
+};
+
+// the track of the main thread and the reader thread, the simulation threads follow
+#define TRACE_MAIN_TID 0
+#define TRACE_STREAM_TID 1
+#define TRACE_FIRST_THREAD_TID 2
+
+const char *trace_phase_name(tracephase_t phase) {
+    return trace_phase_names[phase];
+}
+
+static void init_trace_buffer(tracebuffer_t *buffer, size_t capacity, int sample_ticks) {
+    memset(buffer, 0, sizeof(tracebuffer_t));
+    buffer->events = malloc(capacity * sizeof(traceevent_t));
+    buffer->capacity = capacity;
+    buffer->sample_ticks = sample_ticks;
+}
+
+tracelog_t *open_trace(const char *path, int num_threads, int num_ticks, int sample_ticks) {
+    tracelog_t *log = calloc(1, sizeof(tracelog_t));
+    log->path = malloc(strlen(path) + 1);
+    strcpy(log->path, path);
+    init_trace_buffer(&log->main, TRACE_MAIN_EVENTS, 1);
+    init_trace_buffer(&log->stream, TRACE_STREAM_EVENTS, 1);
+    // the events of the sampled ticks, the initial connection sums and the fast-forwarded intervals
+    size_t capacity = ((size_t) num_ticks / sample_ticks + 1) * TRACE_EVENTS_PER_TICK
+                      + (size_t) num_ticks / FAST_FORWARD_MIN_TICKS + 2;
+    log->num_threads = num_threads;
+    log->threads = malloc(num_threads * sizeof(tracebuffer_t));
+    for (int i = 0; i < num_threads; i++) {
+        init_trace_buffer(&log->threads[i], capacity, sample_ticks);
+    }
+    return log;
+}
+
+// the earliest recorded clock of a buffer, or the given clock if it is earlier
+static uint64_t earliest_event(const tracebuffer_t *buffer, uint64_t earliest) {
+    for (size_t i = 0; i < buffer->count; i++) {
+        if (buffer->events[i].begin_ns < earliest) {
+            earliest = buffer->events[i].begin_ns;
+        }
+    }
+    return earliest;
+}
+
+// writes the name of a track as a metadata event
+static void write_thread_name(FILE *fp, int pid, int tid, const char *name) {
+    fprintf(fp, ",\n{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}",
+            pid, tid, name);
+    // sorted by the track, not by the name
+    fprintf(fp, ",\n{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"thread_sort_index\",\"args\":{\"sort_index\":%d}}",
+            pid, tid, tid);
+}
+
+// writes the events of a buffer as complete events in microseconds since the origin
+static void write_trace_events(FILE *fp, int pid, int tid, const tracebuffer_t *buffer, uint64_t origin_ns) {
+    for (size_t i = 0; i < buffer->count; i++) {
+        const traceevent_t *event = &buffer->events[i];
+        fprintf(fp, ",\n{\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"name\":\"%s\",\"cat\":\"%s\",\"ts\":%.3f,\"dur\":%.3f",
+                pid, tid, trace_phase_names[event->phase], trace_phase_categories[event->phase],
+                (double) (event->begin_ns - origin_ns) * 1e-3, (double) (event->end_ns - event->begin_ns) * 1e-3);
+        if (event->tick >= 0) {
+            fprintf(fp, ",\"args\":{\"tick\":%d", event->tick);
+            if (event->phase == TRACE_COMPUTE) {
+                fprintf(fp, ",\"inputs_us\":%.3f", (double) event->inputs_ns * 1e-3);
+            }
+            fprintf(fp, "}");
+        }
+        fprintf(fp, "}");
+    }
+}
+
+static void free_trace_buffer(tracebuffer_t *buffer) {
+    free(buffer->events);
+}
+
+long close_trace(tracelog_t *log) {
+    long bytes = 0;
+    FILE *fp = fopen(log->path, "w");
+    if (fp == NULL) {
+        printf("ERROR: Cannot create the trace file %s: %s\n", log->path, strerror(errno));
+    } else {
+#ifdef _WIN32
+        int pid = (int) GetCurrentProcessId();
+#else
+        int pid = (int) getpid();
+#endif
+        uint64_t origin_ns = earliest_event(&log->main, earliest_event(&log->stream, UINT64_MAX));
+        size_t dropped = log->main.dropped + log->stream.dropped;
+        int sample_ticks = 1;
+        for (int i = 0; i < log->num_threads; i++) {
+            origin_ns = earliest_event(&log->threads[i], origin_ns);
+            dropped += log->threads[i].dropped;
+            sample_ticks = log->threads[i].sample_ticks;
+        }
+        fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"sample_ticks\":%d,\"dropped_events\":%zu},\n",
+                sample_ticks, dropped);
+        fprintf(fp, "\"traceEvents\":[\n");
+        fprintf(fp, "{\"ph\":\"M\",\"pid\":%d,\"name\":\"process_name\",\"args\":{\"name\":\"brainsimulation\"}}", pid);
+        write_thread_name(fp, pid, TRACE_MAIN_TID, "main");
+        if (log->stream.count > 0) {
+            write_thread_name(fp, pid, TRACE_STREAM_TID, "input stream");
+        }
+        for (int i = 0; i < log->num_threads; i++) {
+            char name[32];
+            snprintf(name, sizeof(name), "simulation %d", i);
+            write_thread_name(fp, pid, TRACE_FIRST_THREAD_TID + i, name);
+        }
+        write_trace_events(fp, pid, TRACE_MAIN_TID, &log->main, origin_ns);
+        write_trace_events(fp, pid, TRACE_STREAM_TID, &log->stream, origin_ns);
+        for (int i = 0; i < log->num_threads; i++) {
+            write_trace_events(fp, pid, TRACE_FIRST_THREAD_TID + i, &log->threads[i], origin_ns);
+        }
+        fprintf(fp, "\n]}\n");
+        bytes = ftell(fp);
+        fclose(fp);
+        printf("Wrote the trace of %d thread(s) to %s", log->num_threads, log->path);
+        if (dropped > 0) {
+            printf(" (%zu events did not fit into the buffers and were dropped)", dropped);
+        }
+        printf(".\n");
+    }
+    free_trace_buffer(&log->main);
+    free_trace_buffer(&log->stream);
+    for (int i = 0; i < log->num_threads; i++) {
+        free_trace_buffer(&log->threads[i]);
+    }
+    free(log->threads);
+    free(log->path);
+    free(log);
+    return bytes;
+}
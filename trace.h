@@ -0,0 +1,228 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "definitions.h"
+#include "metrics.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file
+ * Timeline of the phases of each thread, exported as a Chrome trace (viewable in Perfetto or chrome://tracing).
+ *
+ * Each simulation thread appends a begin and end time for each phase of the sampled ticks (every sample_ticks-th
+ * tick) to its own preallocated buffer: computing its rows, waiting at the barriers, managing the run, advancing the
+ * input stream, extracting the observations and gathering the connection sums. Fast-forwarded intervals are always
+ * recorded. The main thread records the setup and the output files, the reader thread of an input stream each frame
+ * it reads. Events that do not fit into a buffer are dropped and counted, nothing is allocated while simulating.
+ * At exit, all buffers are written as complete ("X") events of the trace event format, one track per thread.
+ */
+
+/** Maximum number of events recorded per sampled tick by a simulation thread. */
+#define TRACE_EVENTS_PER_TICK 8
+
+/** Number of events of the main thread (setup and output). */
+#define TRACE_MAIN_EVENTS 16
+
+/** Number of frames of an input stream recorded by its reader thread. */
+#define TRACE_STREAM_EVENTS 1024
+
+/**
+ * The traced phases.
+ */
+typedef enum {
+    /** Setting up the run before simulating (main thread). */
+    TRACE_SETUP,
+    /** Computing the tick's rows in execute_partial_tick(), including the inputs. */
+    TRACE_COMPUTE,
+    /** Waiting for all threads to compute the tick. */
+    TRACE_WAIT_COMPUTED,
+    /** Work of the management thread between the barriers (progress, early termination). */
+    TRACE_MANAGEMENT,
+    /** Swapping in the next frame of the input stream, including waiting for the reader thread. */
+    TRACE_INPUT,
+    /** Extracting the observations of the tick. */
+    TRACE_OBSERVATION,
+    /** Gathering the sums of the long-range connections. */
+    TRACE_CONNECTIONS,
+    /** Waiting for all threads to finish the tick before the next one. */
+    TRACE_WAIT_NEXT_TICK,
+    /** Fast-forwarding an input-free interval, including waiting for it. */
+    TRACE_FAST_FORWARD,
+    /** Reading and decoding a frame of the input stream (reader thread). */
+    TRACE_READ_FRAME,
+    /** Writing the output files (main thread). */
+    TRACE_OUTPUT,
+    /** The number of phases. */
+    NUM_TRACE_PHASES
+} tracephase_t;
+
+/**
+ * A phase of one thread.
+ */
+typedef struct {
+    /**
+    * The clock at the begin of the phase in nanoseconds.
+    */
+    uint64_t begin_ns;
+    /**
+    * The clock at the end of the phase in nanoseconds.
+    */
+    uint64_t end_ns;
+    /**
+    * The nanoseconds spent adding the inputs of the rows within a TRACE_COMPUTE phase, 0 for other phases.
+    */
+    uint64_t inputs_ns;
+    /**
+    * The tick of the phase, -1 outside of the tick loop.
+    */
+    int tick;
+    /**
+    * The phase, a tracephase_t.
+    */
+    int phase;
+}
+        traceevent_t;
+
+struct tracebuffer {
+    /**
+    * The recorded events, in the order of recording. Length: count.
+    */
+    traceevent_t *events;
+    /**
+    * The number of recorded events.
+    */
+    size_t count;
+    /**
+    * The number of events that fit into events.
+    */
+    size_t capacity;
+    /**
+    * The number of events dropped because the buffer was full.
+    */
+    size_t dropped;
+    /**
+    * Every sample_ticks-th tick is traced.
+    */
+    int sample_ticks;
+    /**
+    * The nanoseconds spent on the inputs of the rows of the current tick, recorded with its TRACE_COMPUTE phase.
+    */
+    uint64_t inputs_ns;
+    /**
+    * Padding, so that the threads do not share cache lines.
+    */
+    char padding[64];
+};
+
+struct tracelog {
+    /**
+    * The path of the trace file written by close_trace().
+    */
+    char *path;
+    /**
+    * The buffer of the main thread.
+    */
+    tracebuffer_t main;
+    /**
+    * The buffer of the reader thread of the input stream.
+    */
+    tracebuffer_t stream;
+    /**
+    * The number of simulation threads.
+    */
+    int num_threads;
+    /**
+    * One buffer per simulation thread. Length: num_threads.
+    */
+    tracebuffer_t *threads;
+};
+
+/**
+ * Reads the clock of the trace.
+ * @return The clock in nanoseconds.
+ */
+static inline uint64_t trace_clock_ns() {
+    return metrics_clock_ns();
+}
+
+/**
+ * Returns the buffer to trace a tick in, if the tick is sampled.
+ * @param buffer The buffer of the thread, NULL if the run is not traced.
+ * @param tick_number The tick.
+ * @return The buffer, or NULL if the run is not traced or the tick is not sampled.
+ */
+static inline tracebuffer_t *traced_tick(tracebuffer_t *buffer, int tick_number) {
+    return buffer != NULL && tick_number % buffer->sample_ticks == 0 ? buffer : NULL;
+}
+
+/**
+ * Appends a phase to a buffer, or counts it as dropped if the buffer is full. A TRACE_COMPUTE phase takes the
+ * inputs time collected in the buffer.
+ * @param buffer The buffer of the thread.
+ * @param phase The phase.
+ * @param tick_number The tick of the phase, -1 outside of the tick loop.
+ * @param begin_ns The clock at the begin of the phase.
+ * @param end_ns The clock at the end of the phase.
+ */
+static inline void record_trace_event(tracebuffer_t *buffer, tracephase_t phase, int tick_number, uint64_t begin_ns,
+                                      uint64_t end_ns) {
+    uint64_t inputs_ns = 0;
+    if (phase == TRACE_COMPUTE) {
+        inputs_ns = buffer->inputs_ns;
+        buffer->inputs_ns = 0;
+    }
+    if (buffer->count == buffer->capacity) {
+        buffer->dropped++;
+        return;
+    }
+    traceevent_t *event = &buffer->events[buffer->count++];
+    event->begin_ns = begin_ns;
+    event->end_ns = end_ns;
+    event->inputs_ns = inputs_ns;
+    event->tick = tick_number;
+    event->phase = phase;
+}
+
+/**
+ * Records the phase since the end of the last phase of a traced tick and starts the next one.
+ * @param buffer The buffer of the tick (see traced_tick()), NULL if the tick is not traced.
+ * @param phase The phase.
+ * @param tick_number The tick.
+ * @param last The end of the last phase, set to the end of this phase.
+ */
+static inline void trace_lap(tracebuffer_t *buffer, tracephase_t phase, int tick_number, uint64_t *last) {
+    if (buffer != NULL) {
+        uint64_t now = trace_clock_ns();
+        record_trace_event(buffer, phase, tick_number, *last, now);
+        *last = now;
+    }
+}
+
+/**
+ * Returns the name of a phase.
+ * @param phase The phase.
+ * @return The name of the phase, as written to the trace.
+ */
+const char *trace_phase_name(tracephase_t phase);
+
+/**
+ * Creates a trace with preallocated buffers for a run.
+ * @param path The path of the trace file, written by close_trace().
+ * @param num_threads The number of simulation threads.
+ * @param num_ticks The number of ticks of the run.
+ * @param sample_ticks Every sample_ticks-th tick is traced, must be positive.
+ * @return The trace.
+ */
+tracelog_t *open_trace(const char *path, int num_threads, int num_ticks, int sample_ticks);
+
+/**
+ * Writes all recorded events as a Chrome trace (JSON trace event format) and frees the trace. Must be called after
+ * all threads stopped recording.
+ * @param log The trace.
+ * @return The number of bytes written, 0 if the file could not be created.
+ */
+long close_trace(tracelog_t *log);
+
+#endif
@@ -1,4 +1,7 @@
 #include "utils.h"
+#include "nodefunc.h"
+#include "kernels.h"
+#include "connectome.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -18,37 +21,112 @@
 static const unsigned __int64 EPOCH = ((unsigned __int64)116444736000000000ULL);
 #endif
 
+// orders input pointers by x, then y. Inputs on the same node keep their order within the global input array.
+static int compare_inputs_by_position(const void *a, const void *b) {
+    const nodeinputseries_t *input_a = *(nodeinputseries_t * const *) a;
+    const nodeinputseries_t *input_b = *(nodeinputseries_t * const *) b;
+    if (input_a->x_index != input_b->x_index) {
+        return input_a->x_index < input_b->x_index ? -1 : 1;
+    }
+    if (input_a->y_index != input_b->y_index) {
+        return input_a->y_index < input_b->y_index ? -1 : 1;
+    }
+    if (input_a != input_b) {
+        return input_a < input_b ? -1 : 1;
+    }
+    return 0;
+}
+
+/**
+ * \cond HIDDEN_SYMBOLS
+ */
+
+// arguments of a single thread of run_parallel_range
+typedef struct {
+    parallelrangefunc_t callback;
+    void *argument;
+    int start;
+    int end;
+} parallelrange_t;
+
+// arguments for the parallel allocation and initialization of arrays
+typedef struct {
+    void **arr;
+    int n;
+    int o;
+    int p;
+} parallelalloc_t;
+
+/**
+ * \endcond
+ */
+
+static unsigned int run_range(void *range) {
+    parallelrange_t *parallel_range = range;
+    parallel_range->callback(parallel_range->start, parallel_range->end, parallel_range->argument);
+    return 0;
+}
+
+static void alloc_2d_range(int start, int end, void *argument) {
+    parallelalloc_t *alloc = argument;
+    for (int i = start; i < end; ++i) {
+        alloc->arr[i] = malloc(alloc->n * sizeof(nodeval_t));
+    }
+}
+
+static void alloc_4d_range(int start, int end, void *argument) {
+    parallelalloc_t *alloc = argument;
+    nodeval_t ****arr = (nodeval_t ****) alloc->arr;
+    for (int i = start; i < end; i++) {
+        arr[i] = malloc(alloc->n * sizeof(**arr));
+        for (int j = 0; j < alloc->n; j++) {
+            arr[i][j] = malloc(alloc->o * sizeof(*arr));
+            for (int k = 0; k < alloc->o; k++) {
+                arr[i][j][k] = malloc(alloc->p * sizeof(nodeval_t));
+            }
+        }
+    }
+}
+
+static void init_zeros_2d_range(int start, int end, void *argument) {
+    parallelalloc_t *alloc = argument;
+    nodeval_t **nodes = (nodeval_t **) alloc->arr;
+    for (int i = start; i < end; i++) {
+        for (int j = 0; j < alloc->n; j++) {
+            nodes[i][j] = 0.0;
+        }
+    }
+}
+
+int ensemble_lane_count(int ensemble_size) {
+    return (ensemble_size + ENSEMBLE_LANES - 1) / ENSEMBLE_LANES * ENSEMBLE_LANES;
+}
+
 nodeval_t **alloc_2d(const int m, const int n) {
     nodeval_t **arr = malloc(m * sizeof(*arr));
-    int i;
-    for (i = 0; i < m; ++i) {
-        arr[i] = malloc(n * sizeof(nodeval_t));
-    }
+    parallelalloc_t alloc = {(void **) arr, n, 0, 0};
+    run_parallel_range(m, 64, alloc_2d_range, &alloc);
     return arr;
 }
 
+void free_2d(nodeval_t **arr, const int m) {
+    for (int i = 0; i < m; ++i) {
+        free(arr[i]);
+    }
+    free(arr);
+}
+
 nodeval_t ****alloc_4d(const int m, const int n, const int o, const int p) {
-    int i, j, k;
     nodeval_t ****arr = malloc(m * sizeof(***arr));
-    for (i = 0; i < m; i++) {
-        arr[i] = malloc(n * sizeof(**arr));
-        for (j = 0; j < n; j++) {
-            arr[i][j] = malloc(o * sizeof(*arr));
-            for (k = 0; k < o; k++) {
-                arr[i][j][k] = malloc(p * sizeof(nodeval_t));
-            }
-        }
-    }
+    parallelalloc_t alloc = {(void **) arr, n, o, p};
+    run_parallel_range(m, 8, alloc_4d_range, &alloc);
     return arr;
 }
 
 void init_zeros_2d(nodeval_t **nodes, int number_nodes_x, int number_nodes_y) {
     //initialize all nodes with 0
-    for (int i = 0; i < number_nodes_x; i++) {
-        for (int j = 0; j < number_nodes_y; j++) {
-            nodes[i][j] = 0.0;
-        }
-    }
+    parallelalloc_t alloc = {(void **) nodes, number_nodes_y, 0, 0};
+    run_parallel_range(number_nodes_x, 64, init_zeros_2d_range, &alloc);
 }
 
 
@@ -62,22 +140,77 @@ const unsigned int system_processor_online_count() {
 #endif
 }
 
-threadhandle_t *
-create_and_run_simulation_thread(unsigned int(*callback)(partialsimulationcontext_t *),
-                                 partialsimulationcontext_t *context) {
+const unsigned int simulation_thread_count() {
+    if (MULTITHREADING) {
+        int num_threads = (int) (THREADFACTOR * system_processor_online_count());
+        return num_threads > 0 ? num_threads : 1;
+    } else {
+        return 1;
+    }
+}
+
+void run_parallel_range(int num_items, int min_items_per_thread, parallelrangefunc_t callback, void *argument) {
+    int num_threads = simulation_thread_count();
+    if (min_items_per_thread < 1) {
+        min_items_per_thread = 1;
+    }
+    if (num_threads > num_items / min_items_per_thread) {
+        num_threads = num_items / min_items_per_thread;
+    }
+    if (num_threads <= 1) {
+        callback(0, num_items, argument);
+        return;
+    }
+    parallelrange_t *ranges = malloc(num_threads * sizeof(parallelrange_t));
+    threadhandle_t **handles = malloc(num_threads * sizeof(threadhandle_t *));
+    for (int i = 0; i < num_threads; i++) {
+        ranges[i].callback = callback;
+        ranges[i].argument = argument;
+        ranges[i].start = (int) (((long long) i * num_items) / num_threads);
+        ranges[i].end = (int) (((long long) (i + 1) * num_items) / num_threads);
+    }
+    //the calling thread processes the first range itself, and every range no thread could be created for
+    int num_created = 0;
+    for (int i = 1; i < num_threads; i++) {
+        threadhandle_t *handle = create_and_run_thread(run_range, &ranges[i]);
+        if (handle != NULL) {
+            handles[num_created++] = handle;
+        } else {
+            run_range(&ranges[i]);
+        }
+    }
+    run_range(&ranges[0]);
+    join_and_close_simulation_threads(handles, num_created);
+    free(handles);
+    free(ranges);
+}
+
+threadhandle_t *create_and_run_thread(unsigned int(*callback)(void *), void *argument) {
     threadhandle_t *handle = malloc(sizeof(threadhandle_t));
 #ifdef _WIN32
-    *handle = (threadhandle_t) _beginthreadex(0, 0, callback, context, 0, 0);
+    *handle = (threadhandle_t) _beginthreadex(0, 0, callback, argument, 0, 0);
+    if (*handle == 0) {
+        printf("Error initializing thread. Error code %d.\n", errno);
+        free(handle);
+        return NULL;
+    }
 #else
-    int ret = pthread_create(handle, NULL, (void *(*)(void *)) callback, context);
+    int ret = pthread_create(handle, NULL, (void *(*)(void *)) callback, argument);
     if (ret) {
         printf("Error initializing thread. Error code %d.\n", ret);
+        free(handle);
         return NULL;
     }
 #endif
     return handle;
 }
 
+threadhandle_t *
+create_and_run_simulation_thread(unsigned int(*callback)(partialsimulationcontext_t *),
+                                 partialsimulationcontext_t *context) {
+    return create_and_run_thread((unsigned int (*)(void *)) callback, context);
+}
+
 void join_and_close_simulation_threads(threadhandle_t **handles, const int num_threads) {
     for (int i = 0; i < num_threads; i++) {
 #ifdef _WIN32
@@ -122,13 +255,79 @@ unsigned int wait_at_barrier(threadbarrier_t *barrier) {
 #endif
 }
 
+void init_thread_mutex(threadmutex_t *mutex) {
+#ifdef _WIN32
+    InitializeCriticalSection(mutex);
+#else
+    pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+void destroy_thread_mutex(threadmutex_t *mutex) {
+#ifdef _WIN32
+    DeleteCriticalSection(mutex);
+#else
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+void lock_thread_mutex(threadmutex_t *mutex) {
+#ifdef _WIN32
+    EnterCriticalSection(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+void unlock_thread_mutex(threadmutex_t *mutex) {
+#ifdef _WIN32
+    LeaveCriticalSection(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+void init_thread_condition(threadcondition_t *condition) {
+#ifdef _WIN32
+    InitializeConditionVariable(condition);
+#else
+    pthread_cond_init(condition, NULL);
+#endif
+}
+
+void destroy_thread_condition(threadcondition_t *condition) {
+#ifdef _WIN32
+    // condition variables need no cleanup on windows
+#else
+    pthread_cond_destroy(condition);
+#endif
+}
+
+void wait_thread_condition(threadcondition_t *condition, threadmutex_t *mutex) {
+#ifdef _WIN32
+    SleepConditionVariableCS(condition, mutex, INFINITE);
+#else
+    pthread_cond_wait(condition, mutex);
+#endif
+}
+
+void broadcast_thread_condition(threadcondition_t *condition) {
+#ifdef _WIN32
+    WakeAllConditionVariable(condition);
+#else
+    pthread_cond_broadcast(condition);
+#endif
+}
+
 void init_partial_simulation_context(partialsimulationcontext_t *context, int num_ticks, double tick_ms,
 					int number_nodes_x, int number_nodes_y,
 					int num_global_obervationnodes, nodetimeseries_t *global_observationnodes,
 					nodeval_t **old_state,
 					nodeval_t **new_state, nodeval_t **slopes, nodeval_t ****kernels,
-					kernelfunc_t d_ptr, kernelfunc_t id_ptr,
+					kernelfunc_t d_ptr, kernelfunc_t id_ptr, const kernel_t *kernel,
 					int number_global_inputs, nodeinputseries_t *global_inputs,
+					inputplane_t *input_plane, activitymap_t *activity, fastforward_t *fast_forward,
+					const simulationoptions_t *options,
 					int thread_start_x, int thread_end_x, threadbarrier_t *barrier) {
     context->num_ticks = num_ticks;
     context->tick_ms = tick_ms;
@@ -142,8 +341,58 @@ void init_partial_simulation_context(partialsimulationcontext_t *context, int nu
     context->kernels = kernels;
     context->d_ptr = d_ptr;
     context->id_ptr = id_ptr;
+    context->kernel = kernel;
+    context->reference_engine = options->reference_engine;
+    context->parameters = &options->parameters;
+    init_model_coefficients(&context->coefficients, &options->parameters, kernel->number_d_neighbors,
+                            kernel->number_id_neighbors);
+    context->parameter_maps = options->parameter_maps;
+    if (options->parameter_maps != NULL) {
+        //each thread folds the coefficients of its own rows
+        init_coefficient_maps(&context->coefficient_maps, &options->parameters, options->parameter_maps,
+                              (size_t) thread_start_x * number_nodes_y,
+                              (size_t) (thread_end_x - thread_start_x) * number_nodes_y,
+                              kernel->number_d_neighbors, kernel->number_id_neighbors);
+    }
+    context->kernel_workspace = NULL;
+    if (kernel->method != KERNEL_METHOD_DIRECT) {
+        context->kernel_workspace = malloc(sizeof(kernelworkspace_t));
+        init_kernel_workspace(context->kernel_workspace, kernel, number_nodes_y, thread_start_x, thread_end_x);
+    }
+    context->connectome = options->connectome;
+    if (options->connectome != NULL) {
+        // the threads compute the sums of similar numbers of connections, independent of their targets
+        connectome_row_range(options->connectome, thread_start_x, thread_end_x, number_nodes_x,
+                             &context->connection_first_row, &context->connection_end_row);
+    }
+    context->ensemble_size = 1;
+    context->ensemble_lanes = 0;
+    if (options->ensemble_size > 1) {
+        context->ensemble_size = options->ensemble_size;
+        context->ensemble_lanes = ensemble_lane_count(options->ensemble_size);
+        init_ensemble_coefficients(&context->ensemble_coefficients, options->ensemble_parameters,
+                                   context->ensemble_size, context->ensemble_lanes, kernel->number_d_neighbors,
+                                   kernel->number_id_neighbors);
+    }
     context->number_global_inputs = number_global_inputs;
     context->global_inputs = global_inputs;
+    context->input_plane = input_plane;
+    context->activity = activity;
+    context->fast_forward = fast_forward;
+    context->monitor = NULL;
+    context->monitor_slot = 0;
+    context->events = NULL;
+    context->event_buffer = NULL;
+    context->timing = NULL;
+    context->counters = NULL;
+    context->metrics = NULL;
+    context->metrics_slot = 0;
+    context->trace_buffer = NULL;
+    context->active_tiles = NULL;
+    if (activity != NULL) {
+        context->active_tiles = malloc(2 * (size_t) activity->number_tiles);
+    }
+    context->input_stream = options->input_stream;
     context->thread_start_x = thread_start_x;
     context->thread_end_x = thread_end_x;
     context->barrier = barrier;
@@ -166,11 +415,12 @@ void init_partial_simulation_context(partialsimulationcontext_t *context, int nu
 		}
 	}
 
-    //derive the partial inputs
+    //derive the partial inputs, inputs outside of the grid are ignored
 	context->number_partial_inputs = 0;
 	for (int i = 0; i < number_global_inputs; i++) { //count partial array elements
 		if (global_inputs != NULL
-			&& global_inputs[i].x_index >= thread_start_x && global_inputs[i].x_index < thread_end_x) {
+			&& global_inputs[i].x_index >= thread_start_x && global_inputs[i].x_index < thread_end_x
+			&& global_inputs[i].y_index >= 0 && global_inputs[i].y_index < number_nodes_y) {
 			context->number_partial_inputs++;
 		}
 	}
@@ -178,25 +428,38 @@ void init_partial_simulation_context(partialsimulationcontext_t *context, int nu
 	j = 0;
 	for (int i = 0; i < number_global_inputs; i++) {
 		if (global_inputs != NULL
-			&& global_inputs[i].x_index >= thread_start_x && global_inputs[i].x_index < thread_end_x) {
+			&& global_inputs[i].x_index >= thread_start_x && global_inputs[i].x_index < thread_end_x
+			&& global_inputs[i].y_index >= 0 && global_inputs[i].y_index < number_nodes_y) {
 			context->partial_inputs[j] = &(global_inputs[i]);
 			j++;
 		}
 	}
+
+	//sort the partial inputs into a sparse row index, so that they can be applied during the sweep
+	qsort(context->partial_inputs, context->number_partial_inputs, sizeof(nodeinputseries_t *),
+		compare_inputs_by_position);
+	int number_rows = thread_end_x - thread_start_x;
+	context->partial_input_row_offsets = malloc((number_rows + 1) * sizeof(int));
+	j = 0;
+	for (int row = 0; row <= number_rows; row++) {
+		while (j < context->number_partial_inputs && context->partial_inputs[j]->x_index < thread_start_x + row) {
+			j++;
+		}
+		context->partial_input_row_offsets[row] = j;
+	}
 }
 
 void init_executioncontext(executioncontext_t *context) {
-    if (MULTITHREADING) {
-        context->num_threads = (int) (THREADFACTOR * system_processor_online_count());
-    } else {
-        context->num_threads = 1;
-    }
+    context->num_threads = simulation_thread_count();
     context->handles = malloc(context->num_threads * sizeof(threadhandle_t *));
     context->contexts = malloc(context->num_threads * sizeof(partialsimulationcontext_t));
+    context->timings = NULL;
+    context->counters = NULL;
 }
 
-void output_to_csv(char *filename, int length, nodeval_t *values) {
+long output_to_csv(char *filename, int length, nodeval_t *values) {
     printf("Creating %s file\n", filename);
+    long bytes = 0;
     FILE *fp = fopen(filename, "w+");
     if (fp == NULL) {
         printf("File is null.\n Error: %s\n", strerror(errno));
@@ -207,9 +470,33 @@ void output_to_csv(char *filename, int length, nodeval_t *values) {
         for (i = 0; i < length; i++) {
             fprintf(fp, "\n%f,", values[i]);
         }
+        bytes = ftell(fp);
+        fclose(fp);
+        printf("%s file created.\n", filename);
+    }
+    return bytes;
+}
+
+long ensemble_to_csv(char *filename, int ensemble_size, const modelparameters_t *members) {
+    printf("Creating %s file\n", filename);
+    long bytes = 0;
+    FILE *fp = fopen(filename, "w+");
+    if (fp == NULL) {
+        printf("File is null.\n Error: %s\n", strerror(errno));
+
+    } else {
+        fprintf(fp, "Member,d_neighborfactor,id_neighborfactor,energy_factor,energy_weight,delta_factor,slope_factor,"
+                    "slope_weight,damping");
+        for (int m = 0; m < ensemble_size; m++) {
+            fprintf(fp, "\n%d,%g,%g,%g,%g,%g,%g,%g,%g", m, members[m].d_neighborfactor,
+                    members[m].id_neighborfactor, members[m].energy_factor, members[m].energy_weight,
+                    members[m].delta_factor, members[m].slope_factor, members[m].slope_weight, members[m].damping);
+        }
+        bytes = ftell(fp);
         fclose(fp);
         printf("%s file created.\n", filename);
     }
+    return bytes;
 }
 
 int get_daytime(struct timeval *tp) {
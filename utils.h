@@ -43,10 +43,35 @@ typedef struct {
      * Synchronization barrier to be used by all threads that run in this execution.
      */
     threadbarrier_t barrier;
+
+    /**
+     * The phase timing statistics of the threads, one per thread. NULL if the phases are not timed.
+     */
+    threadtiming_t *timings;
+
+    /**
+     * The hardware performance counters of the threads, one per thread. NULL if they are not read.
+     */
+    perfcounters_t *counters;
 }
         executioncontext_t;
 
 
+/**
+ * Function interface for work that is split into ranges of work items, which are executed in parallel.
+ * Processes the work items from start (inclusive) to end (exclusive).
+ */
+typedef void (*parallelrangefunc_t)(int start, int end, void *argument);
+
+/**
+* Returns the padded number of members of an ensemble, i.e., the number of values stored per node by the ensemble
+* engine. The members are padded to a multiple of ENSEMBLE_LANES.
+* @param ensemble_size The number of members of the ensemble.
+*
+* @return The padded number of members.
+*/
+int ensemble_lane_count(int ensemble_size);
+
 /**
 * Allocates a new 2d array with m pointers, pointing to a list of n elements.
 * @param m The number of nodes in the first dimension (x-axis).
@@ -56,6 +81,13 @@ typedef struct {
 */
 nodeval_t **alloc_2d(const int m, const int n);
 
+/**
+* Frees a 2d array allocated using alloc_2d().
+* @param arr The array.
+* @param m The number of nodes in the first dimension (x-axis).
+*/
+void free_2d(nodeval_t **arr, const int m);
+
 
 /**
 * Allocates a new 4d array with m pointers, pointing to a list of n elements, pointing to a list of o elements,
@@ -83,6 +115,33 @@ void init_zeros_2d(nodeval_t **nodes, int number_nodes_x, int number_nodes_y);
  */
 const unsigned int system_processor_online_count();
 
+/**
+ * Returns the number of worker threads used by the simulation and the parallel setup.
+ * Derived from the number of logical processors, THREADFACTOR and MULTITHREADING.
+ * @return The number of worker threads, at least 1.
+ */
+const unsigned int simulation_thread_count();
+
+/**
+ * Splits num_items work items into equally sized ranges and executes them in parallel on the simulation's
+ * worker threads (see simulation_thread_count()). Returns after all ranges have been processed.
+ * Uses fewer threads if there are less than min_items_per_thread items per thread, down to executing all items
+ * in the calling thread. The ranges of threads that cannot be created are executed in the calling thread.
+ * @param num_items The number of work items.
+ * @param min_items_per_thread The minimal number of work items for which to start a separate thread.
+ * @param callback The function to process a range of work items.
+ * @param argument The argument to pass to each call of the callback.
+ */
+void run_parallel_range(int num_items, int min_items_per_thread, parallelrangefunc_t callback, void *argument);
+
+/**
+ * Creates a new platform-specific thread and starts it.
+ * @param callback The callback function to run. Must return 0 or an error code.
+ * @param argument The argument to pass to the callback.
+ * @return A handle for the running thread, NULL if the thread could not be created.
+ */
+threadhandle_t *create_and_run_thread(unsigned int(*callback)(void *), void *argument);
+
 /**
  * Creates a new platform-specific thread with the context and starts it.
  * @param callback The callback function to run.
@@ -113,6 +172,56 @@ void destroy_thread_barrier(threadbarrier_t *barrier);
 */
 unsigned int wait_at_barrier(threadbarrier_t *barrier);
 
+/**
+ * Initializes a mutex.
+ * @param mutex The mutex to initialize.
+ */
+void init_thread_mutex(threadmutex_t *mutex);
+
+/**
+ * Destroys a mutex.
+ * @param mutex The mutex to destroy.
+ */
+void destroy_thread_mutex(threadmutex_t *mutex);
+
+/**
+ * Locks a mutex. Blocks until the mutex is available.
+ * @param mutex The mutex to lock.
+ */
+void lock_thread_mutex(threadmutex_t *mutex);
+
+/**
+ * Unlocks a mutex.
+ * @param mutex The mutex to unlock.
+ */
+void unlock_thread_mutex(threadmutex_t *mutex);
+
+/**
+ * Initializes a condition variable.
+ * @param condition The condition variable to initialize.
+ */
+void init_thread_condition(threadcondition_t *condition);
+
+/**
+ * Destroys a condition variable.
+ * @param condition The condition variable to destroy.
+ */
+void destroy_thread_condition(threadcondition_t *condition);
+
+/**
+ * Atomically unlocks the mutex and waits for the condition variable to be signaled.
+ * The mutex is locked again before returning. May return spuriously.
+ * @param condition The condition variable to wait for.
+ * @param mutex The locked mutex protecting the condition.
+ */
+void wait_thread_condition(threadcondition_t *condition, threadmutex_t *mutex);
+
+/**
+ * Wakes all threads waiting for the condition variable.
+ * @param condition The condition variable to signal.
+ */
+void broadcast_thread_condition(threadcondition_t *condition);
+
 /**
  * Joins all threads and then closes them. Frees all thread handles.
  * @param handles Array of thread handle pointers.
@@ -137,15 +246,20 @@ void join_and_close_simulation_threads(threadhandle_t **handles, const int num_t
  * number_nodes_y.
  * @param slopes 2D array of nodes with their slope from the last tick iteration level. Size number_nodes_x *
  * number_nodes_y.
- * @param kernels 2D array containing the kernels of each node at each index.Each index node points to an array
- * containing(currently) two kernels, each(currently) containing 4 neighbouring noides.Dimensions: number_nodes_x *
- * number_nodes_y * 2 * 4.
+ * @param kernels 2D array containing the kernels of each node at each index. Each index node points to an array
+ * containing two kernels, each containing the neighbouring nodes of one neighborhood. Dimensions: number_nodes_x *
+ * number_nodes_y * 2 * (maximum number of neighbors per neighborhood). Only used by the reference engine.
  * @param d_ptr Function pointer pointing to the kernel function for the direct neighborhood.
  * @param id_ptr Function pointer pointing to the kernel function for the indirect neighborhood.
+ * @param kernel The kernel to simulate with.
  * @param number_global_inputs Number of all inputs on the entire node-grid inputs to be processed.
  * @param global_inputs Inputs on the entire node-grid inputs to be processed. Length: number_partial_inputs.
  * Partial inputs in the sub-grid (defined by thread_start_x and thread_end_x) are automatically derived
  * from this global list. 
+ * @param input_plane Dense input planes of the entire node grid. NULL if all inputs are passed as global_inputs.
+ * @param activity The non-zero tiles of the entire grid. NULL to compute all nodes in each tick.
+ * @param fast_forward The input-free intervals to fast-forward through. NULL to simulate all ticks.
+ * @param options Optional settings of the simulation run.
  * @param thread_start_x Node x index at which to start working in this thread (inclusive).
  * @param thread_end_x Node x index at which to stop working in this thread (exclusive).
  * @param barrier The barrier for threads to wait at. May be uninitialized in if MULTITHREADING is disabled.
@@ -155,8 +269,10 @@ void init_partial_simulation_context(partialsimulationcontext_t *context, int nu
                                      int num_global_obervationnodes, nodetimeseries_t *global_observationnodes,
                                      nodeval_t **old_state,
                                      nodeval_t **new_state, nodeval_t **slopes, nodeval_t ****kernels,
-                                     kernelfunc_t d_ptr, kernelfunc_t id_ptr,
+                                     kernelfunc_t d_ptr, kernelfunc_t id_ptr, const kernel_t *kernel,
                                      int number_global_inputs, nodeinputseries_t *global_inputs,
+                                     inputplane_t *input_plane, activitymap_t *activity,
+                                     fastforward_t *fast_forward, const simulationoptions_t *options,
                                      int thread_start_x, int thread_end_x, threadbarrier_t *barrier);
 
 /**
@@ -173,8 +289,20 @@ void init_executioncontext(executioncontext_t *context);
  * @param filename Name of the file to write to.
  * @param length Number of entries to write.
  * @param values The values to write. Length length.
+ * @return The number of bytes written, 0 if the file could not be created.
+ */
+long output_to_csv(char *filename, int length, nodeval_t *values);
+
+/**
+ * Writes the model parameters of each member of an ensemble to a .csv with one line per member, so that the
+ * output files tagged with a member index can be related to their parameters.
+ *
+ * @param filename Name of the file to write to.
+ * @param ensemble_size Number of members.
+ * @param members The model parameters of each member. Length ensemble_size.
+ * @return The number of bytes written, 0 if the file could not be created.
  */
-void output_to_csv(char *filename, int length, nodeval_t *values);
+long ensemble_to_csv(char *filename, int ensemble_size, const modelparameters_t *members);
 
 /**
  * Get the time of day.
@@ -0,0 +1,1378 @@
+#include "definitions.h"
+#include "utils.h"
+#include "brainsimulation.h"
+#include "brainsetup.h"
+#include "kernels.h"
+#include "connectome.h"
+#include "nodefunc.h"
+#include "convergence.h"
+#include "events.h"
+#include "regions.h"
+#include "volume.h"
+#include "fastforward.h"
+#include "superposition.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define dup _dup
+#define dup2 _dup2
+#define close _close
+#define open _open
+#define NULL_DEVICE "NUL"
+#else
+#include <unistd.h>
+#define NULL_DEVICE "/dev/null"
+#endif
+
+/**
+ * @file
+ * Differential correctness harness of the optimized engines, built and run by `make verify`.
+ *
+ * Generates randomized scenarios (grid size, kernel, model parameters, parameter maps, long-range connections, start
+ * levels, sparse or dense inputs and observation nodes, at least one start node or input) and simulates each of them
+ * with the generic reference engine (execute_partial_tick() gathering the kernels and executing process()) and with
+ * each applicable optimized engine. Each engine is run twice: once observing a few nodes, whose series are compared at
+ * all ticks, and once observing all nodes, whose grids are compared at VERIFY_GRID_TICKS evenly spaced ticks. The
+ * light-cone engine only runs the first, as observing all nodes disables the pruning. For each comparison, the maximum
+ * absolute, relative and ULP errors are reported, as well as the first tick and node at which an error exceeds the
+ * engine's tolerance times the largest energy level of any node in the reference run. Relative and ULP errors are only
+ * taken of values above that limit.
+ *
+ * The features that change what a run produces are checked against results derived from the reference run: early
+ * stopping against the reference observations extrapolated by a convergence monitor replaying the reference grids,
+ * threshold events against the events of the reference grids, multi-region runs against the reference by simulating
+ * the scenario as two identical regions whose links cross between them, and volumes against a generic 3D engine
+ * gathering the neighbors of each node. The scenarios are the same for the same seed. Exits with 1 if any engine or
+ * feature diverged.
+ *
+ * Usage: brainverify [--scenarios N] [--seed S] [--engine NAME] [--tolerance T] [--verbose]
+ */
+
+/** Default number of randomized scenarios. */
+#define VERIFY_SCENARIOS 24
+/** Number of evenly spaced ticks (including the last one) at which the full grids are compared. */
+#define VERIFY_GRID_TICKS 4
+/** Maximum number of observation, start and input nodes of a sparse scenario. */
+#define VERIFY_MAX_NODES 8
+/** Maximum number of impulse sources (inputs and start nodes) of scenarios checked by superposition. */
+#define VERIFY_MAX_SUPERPOSITION_SOURCES 16
+/** Maximum number of long-range connections of a scenario. */
+#define VERIFY_MAX_CONNECTIONS 32
+/** Maximum z-size of the volume of a scenario. */
+#define VERIFY_MAX_NODES_Z 8
+/** Tolerance of the runs stopping early, relative to the largest energy level of the reference run. */
+#define VERIFY_EARLY_STOP_TOLERANCE 1e-3
+/** Threshold of the recorded events, relative to the largest energy level of the reference run. */
+#define VERIFY_EVENT_THRESHOLD 0.1
+/** Temporary connection file of the scenarios with long-range connections. */
+#define VERIFY_CONNECTION_FILE "./verify-connections.txt"
+/** Temporary region file of the multi-region runs. */
+#define VERIFY_REGION_FILE "./verify-regions.txt"
+
+/**
+ * A randomized scenario, simulated by each engine.
+ */
+typedef struct {
+    /**
+    * The index of the scenario.
+    */
+    int index;
+    /**
+    * The x-size of the grid.
+    */
+    int number_nodes_x;
+    /**
+    * The y-size of the grid.
+    */
+    int number_nodes_y;
+    /**
+    * The number of ticks.
+    */
+    int ticks;
+    /**
+    * The name of the kernel.
+    */
+    char kernel_name[32];
+    /**
+    * The kernel (for checking which engines apply).
+    */
+    kernel_t kernel;
+    /**
+    * The uniform model parameters.
+    */
+    modelparameters_t parameters;
+    /**
+    * The per-node model parameters, NULL if uniform.
+    */
+    parametermaps_t *parameter_maps;
+    /**
+    * The number of long-range connections (written to VERIFY_CONNECTION_FILE), 0 if there are none.
+    */
+    int number_connections;
+    /**
+    * The source nodes of the connections.
+    */
+    connectionnode_t connection_sources[VERIFY_MAX_CONNECTIONS];
+    /**
+    * The target nodes of the connections.
+    */
+    connectionnode_t connection_targets[VERIFY_MAX_CONNECTIONS];
+    /**
+    * The weights of the connections.
+    */
+    nodeval_t connection_weights[VERIFY_MAX_CONNECTIONS];
+    /**
+    * The number of start nodes.
+    */
+    int number_starts;
+    /**
+    * The x indices of the start nodes.
+    */
+    int start_x[VERIFY_MAX_NODES];
+    /**
+    * The y indices of the start nodes.
+    */
+    int start_y[VERIFY_MAX_NODES];
+    /**
+    * The start levels.
+    */
+    nodeval_t start_levels[VERIFY_MAX_NODES];
+    /**
+    * The number of input nodes.
+    */
+    int number_inputs;
+    /**
+    * The inputs.
+    */
+    nodeinputseries_t *inputs;
+    /**
+    * The frequencies of the inputs.
+    */
+    int *input_frequencies;
+    /**
+    * The number of observation nodes.
+    */
+    int number_observations;
+    /**
+    * The x indices of the observation nodes.
+    */
+    int observation_x[VERIFY_MAX_NODES];
+    /**
+    * The y indices of the observation nodes.
+    */
+    int observation_y[VERIFY_MAX_NODES];
+    /**
+    * The z-size of the scenario simulated as a volume, whose x- and y-sizes are the grid's.
+    */
+    int number_nodes_z;
+    /**
+    * The name of the volume kernel.
+    */
+    char volume_kernel_name[32];
+    /**
+    * The z indices of the start nodes in the volume.
+    */
+    int start_z[VERIFY_MAX_NODES];
+    /**
+    * The z indices of the inputs in the volume.
+    */
+    int *input_z;
+    /**
+    * The z indices of the observation nodes in the volume.
+    */
+    int observation_z[VERIFY_MAX_NODES];
+}
+        verifyscenario_t;
+
+/**
+ * An optimized engine, i.e., the options selecting it.
+ */
+typedef struct {
+    /**
+    * The name of the engine.
+    */
+    const char *name;
+    /**
+    * The default tolerance, relative to the largest energy level of the reference run.
+    */
+    double tolerance;
+    /**
+    * Returns 1 if the engine supports the scenario.
+    */
+    int (*applies)(const verifyscenario_t *scenario);
+    /**
+    * Sets the options selecting the engine.
+    */
+    void (*configure)(simulationoptions_t *options);
+    /**
+    * Number of ensemble members simulated, whose results are all compared to the reference.
+    */
+    int ensemble_size;
+    /**
+    * 1 to also compare the grids of a run observing all nodes, 0 to only compare the series of the observation nodes.
+    */
+    int grids;
+}
+        verifyengine_t;
+
+/**
+ * The runs of the reference engine on a scenario.
+ */
+typedef struct {
+    /**
+    * The series of the scenario's observation nodes.
+    */
+    nodetimeseries_t *series;
+    /**
+    * The number of observation nodes.
+    */
+    int number_series;
+    /**
+    * The series of all nodes.
+    */
+    nodetimeseries_t *grids;
+    /**
+    * The number of nodes.
+    */
+    int number_nodes;
+    /**
+    * The largest finite energy level of any node at any tick.
+    */
+    double scale;
+}
+        verifyreference_t;
+
+/**
+ * A feature changing what a run produces, checked against results derived from the reference runs.
+ */
+typedef struct {
+    /**
+    * The name of the feature.
+    */
+    const char *name;
+    /**
+    * The default tolerance, relative to the largest energy level of the reference run.
+    */
+    double tolerance;
+    /**
+    * Returns 1 if the feature supports the scenario.
+    */
+    int (*applies)(const verifyscenario_t *scenario);
+    /**
+    * Checks the feature on the scenario with the tolerance, printing the comparisons. Returns 1 if it diverged.
+    */
+    int (*verify)(const verifyscenario_t *scenario, const verifyreference_t *reference, double tolerance,
+                  int verbose);
+}
+        verifyfeature_t;
+
+/**
+ * The errors of one comparison.
+ */
+typedef struct {
+    /**
+    * Maximum absolute error.
+    */
+    double max_absolute;
+    /**
+    * Maximum error relative to the reference value, over all reference values above the limit of the comparison.
+    */
+    double max_relative;
+    /**
+    * Maximum distance in units in the last place, over all reference values above the limit of the comparison.
+    */
+    uint64_t max_ulps;
+    /**
+    * The first tick with an error above the tolerance, -1 if there is none.
+    */
+    int diverged_tick;
+    /**
+    * The x index of the first diverging node.
+    */
+    int diverged_x;
+    /**
+    * The y index of the first diverging node.
+    */
+    int diverged_y;
+    /**
+    * The ensemble member of the first diverging node.
+    */
+    int diverged_member;
+    /**
+    * The value of the first diverging node.
+    */
+    nodeval_t diverged_value;
+    /**
+    * The reference value of the first diverging node.
+    */
+    nodeval_t diverged_reference;
+}
+        verifyerrors_t;
+
+// xorshift64*, the same scenarios on every platform
+static uint64_t random_state;
+
+static uint64_t random_next() {
+    random_state ^= random_state >> 12;
+    random_state ^= random_state << 25;
+    random_state ^= random_state >> 27;
+    return random_state * 2685821657736338717ULL;
+}
+
+static int random_int(int min, int max) {
+    return min + (int) (random_next() % (uint64_t) (max - min + 1));
+}
+
+static double random_double(double min, double max) {
+    return min + (max - min) * (double) (random_next() >> 11) / 9007199254740992.0;
+}
+
+/* ---- engines ---- */
+
+static int is_large_kernel(const verifyscenario_t *scenario) {
+    return scenario->kernel.type == KERNEL_TYPE_GAUSSIAN || scenario->kernel.type == KERNEL_TYPE_MEXICANHAT;
+}
+
+static int applies_always(const verifyscenario_t *scenario) {
+    return 1;
+}
+
+static int applies_separable(const verifyscenario_t *scenario) {
+    return scenario->kernel.type == KERNEL_TYPE_GAUSSIAN;
+}
+
+static int applies_ensemble(const verifyscenario_t *scenario) {
+    return scenario->parameter_maps == NULL && scenario->number_connections == 0;
+}
+
+static int applies_fast_forward(const verifyscenario_t *scenario) {
+    return scenario->kernel.radius == 1 && scenario->parameter_maps == NULL && scenario->number_connections == 0;
+}
+
+// the sweeps prune to the light cones of at most one observation node per tile, unless connections reach beyond them
+static int applies_light_cone(const verifyscenario_t *scenario) {
+    int number_tiles = (scenario->number_nodes_y + ACTIVITY_TILE_SIZE - 1) / ACTIVITY_TILE_SIZE;
+    return scenario->number_connections == 0 && scenario->number_observations <= number_tiles;
+}
+
+static int applies_superposition(const verifyscenario_t *scenario) {
+    return scenario->number_inputs + scenario->number_starts <= VERIFY_MAX_SUPERPOSITION_SOURCES;
+}
+
+static void configure_direct(simulationoptions_t *options) {
+    options->kernel_method = "direct";
+}
+
+static void configure_separable(simulationoptions_t *options) {
+    options->kernel_method = "separable";
+}
+
+static void configure_fft(simulationoptions_t *options) {
+    options->kernel_method = "fft";
+}
+
+// all intervals regardless of the estimated costs, which rule out observing all nodes
+static void configure_fast_forward(simulationoptions_t *options) {
+    options->fast_forward = FAST_FORWARD_ALWAYS;
+}
+
+// even without a cache, which would otherwise simulate most scenarios directly
+static void configure_superposition(simulationoptions_t *options) {
+    options->superposition = SUPERPOSITION_ALWAYS;
+}
+
+// the sweeps summing the kernel directly are exact up to the order of the additions, the other methods are not
+// the light-cone engine is the specialized sweep observing only a few nodes, as observing all of them disables pruning
+static const verifyengine_t engines[] = {
+        {"specialized",   1e-12, applies_always,        configure_direct,        1, 1},
+        {"lightcone",     1e-12, applies_light_cone,    configure_direct,        1, 0},
+        {"separable",     1e-10, applies_separable,     configure_separable,     1, 1},
+        {"fft",           1e-10, is_large_kernel,       configure_fft,           1, 1},
+        {"ensemble",      1e-12, applies_ensemble,      configure_direct,        3, 1},
+        {"fastforward",   1e-9,  applies_fast_forward,  configure_fast_forward,  1, 1},
+        {"superposition", 1e-9,  applies_superposition, configure_superposition, 1, 1},
+};
+
+/* ---- scenarios ---- */
+
+static void random_parameters(modelparameters_t *parameters) {
+    init_model_parameters(parameters);
+    // a few scenarios keep the unit parameters, which select the sweeps without multiplications
+    if (random_int(0, 4) == 0) {
+        return;
+    }
+    parameters->d_neighborfactor = random_double(0.5, 1);
+    parameters->id_neighborfactor = random_double(0.5, 1);
+    parameters->energy_factor = random_double(0.5, 1);
+    parameters->energy_weight = random_double(0.5, 1);
+    parameters->delta_factor = random_double(0.5, 1);
+    parameters->slope_factor = random_double(0.5, 1);
+    parameters->slope_weight = random_double(0.5, 1);
+    parameters->damping = random_double(0, 0.1);
+}
+
+// a map of the damping and a map of the slope weight, in [min, max)
+static parametermaps_t *random_parameter_maps(int number_nodes_x, int number_nodes_y) {
+    parametermaps_t *maps = calloc(1, sizeof(parametermaps_t));
+    size_t size = (size_t) number_nodes_x * number_nodes_y;
+    maps->damping = malloc(size * sizeof(nodeval_t));
+    maps->slope_weight = malloc(size * sizeof(nodeval_t));
+    for (size_t k = 0; k < size; k++) {
+        maps->damping[k] = random_double(0, 0.1);
+        maps->slope_weight[k] = random_double(0.5, 1);
+    }
+    return maps;
+}
+
+static void free_parameter_maps(parametermaps_t *maps) {
+    free(maps->damping);
+    free(maps->slope_weight);
+    free(maps);
+}
+
+static int write_connections(const verifyscenario_t *scenario) {
+    FILE *file = fopen(VERIFY_CONNECTION_FILE, "w");
+    if (file == NULL) {
+        printf("ERROR: Could not write %s.\n", VERIFY_CONNECTION_FILE);
+        return 1;
+    }
+    for (int c = 0; c < scenario->number_connections; c++) {
+        fprintf(file, "%d %d %d %d %.17g\n", scenario->connection_sources[c].x, scenario->connection_sources[c].y,
+                scenario->connection_targets[c].x, scenario->connection_targets[c].y, scenario->connection_weights[c]);
+    }
+    fclose(file);
+    return 0;
+}
+
+static void random_connections(verifyscenario_t *scenario) {
+    scenario->number_connections = random_int(1, VERIFY_MAX_CONNECTIONS);
+    for (int c = 0; c < scenario->number_connections; c++) {
+        scenario->connection_sources[c].x = random_int(0, scenario->number_nodes_x - 1);
+        scenario->connection_sources[c].y = random_int(0, scenario->number_nodes_y - 1);
+        scenario->connection_targets[c].x = random_int(0, scenario->number_nodes_x - 1);
+        scenario->connection_targets[c].y = random_int(0, scenario->number_nodes_y - 1);
+        scenario->connection_weights[c] = random_double(-0.2, 0.2);
+    }
+}
+
+// the volume of the scenario: its grid extended along z, with each start, input and observation node at a random z
+static void random_volume(verifyscenario_t *scenario) {
+    static const char *kernel_names[] = {"6neighbors", "18neighbors", "26neighbors"};
+    scenario->number_nodes_z = random_int(1, VERIFY_MAX_NODES_Z);
+    strcpy(scenario->volume_kernel_name,
+           kernel_names[random_int(0, sizeof(kernel_names) / sizeof(kernel_names[0]) - 1)]);
+    for (int k = 0; k < scenario->number_starts; k++) {
+        scenario->start_z[k] = random_int(0, scenario->number_nodes_z - 1);
+    }
+    scenario->input_z = malloc((scenario->number_inputs + 1) * sizeof(int));
+    for (int k = 0; k < scenario->number_inputs; k++) {
+        scenario->input_z[k] = random_int(0, scenario->number_nodes_z - 1);
+    }
+    for (int k = 0; k < scenario->number_observations; k++) {
+        scenario->observation_z[k] = random_int(0, scenario->number_nodes_z - 1);
+    }
+}
+
+static int init_scenario(verifyscenario_t *scenario, int index) {
+    static const char *kernel_names[] = {"4neighbors", "8neighbors", "radius2", "weighted3", "gaussian4",
+                                         "mexicanhat6"};
+    scenario->index = index;
+    // rows wider than a few tiles, so that light-cone pruning applies to the runs observing few nodes
+    scenario->number_nodes_x = random_int(8, 48);
+    scenario->number_nodes_y = random_int(8, 4 * ACTIVITY_TILE_SIZE);
+    scenario->ticks = random_int(40, 120);
+    strcpy(scenario->kernel_name, kernel_names[random_int(0, sizeof(kernel_names) / sizeof(kernel_names[0]) - 1)]);
+    if (init_kernel(&scenario->kernel, scenario->kernel_name)) {
+        return 1;
+    }
+    random_parameters(&scenario->parameters);
+    scenario->parameter_maps = random_int(0, 3) == 0 ? random_parameter_maps(scenario->number_nodes_x,
+                                                                             scenario->number_nodes_y) : NULL;
+    scenario->number_connections = 0;
+    if (random_int(0, 3) == 0) {
+        random_connections(scenario);
+        if (write_connections(scenario)) {
+            return 1;
+        }
+    }
+    // no inputs (fast-forwarded entirely), a few sparse inputs or inputs on most nodes (stored as dense planes)
+    int input_mode = random_int(0, 3);
+    // runs without inputs start with at least one node, otherwise all grids stay zero and nothing is compared
+    scenario->number_starts = random_int(input_mode >= 2 ? 1 : 0, VERIFY_MAX_NODES);
+    for (int k = 0; k < scenario->number_starts; k++) {
+        scenario->start_x[k] = random_int(0, scenario->number_nodes_x - 1);
+        scenario->start_y[k] = random_int(0, scenario->number_nodes_y - 1);
+        scenario->start_levels[k] = random_double(-10, 10);
+    }
+    int capacity = scenario->number_nodes_x * scenario->number_nodes_y;
+    int *x_indices = malloc(capacity * sizeof(int));
+    int *y_indices = malloc(capacity * sizeof(int));
+    scenario->input_frequencies = malloc(capacity * sizeof(int));
+    scenario->number_inputs = 0;
+    if (input_mode == 0) {
+        int frequency = random_int(5, 50);
+        for (int x = 0; x < scenario->number_nodes_x; x++) {
+            for (int y = 0; y < scenario->number_nodes_y; y++) {
+                if (random_int(0, 9) < 7) {
+                    x_indices[scenario->number_inputs] = x;
+                    y_indices[scenario->number_inputs] = y;
+                    scenario->input_frequencies[scenario->number_inputs++] = frequency;
+                }
+            }
+        }
+    } else if (input_mode == 1) {
+        scenario->number_inputs = random_int(1, VERIFY_MAX_NODES);
+        for (int k = 0; k < scenario->number_inputs; k++) {
+            x_indices[k] = random_int(0, scenario->number_nodes_x - 1);
+            y_indices[k] = random_int(0, scenario->number_nodes_y - 1);
+            scenario->input_frequencies[k] = random_int(5, 50);
+        }
+    }
+    scenario->inputs = scenario->number_inputs > 0 ? generate_input_frequencies(scenario->number_inputs, x_indices,
+                                                                                y_indices,
+                                                                                scenario->input_frequencies, 1)
+                                                   : NULL;
+    free(x_indices);
+    free(y_indices);
+    scenario->number_observations = random_int(1, 3);
+    for (int k = 0; k < scenario->number_observations; k++) {
+        scenario->observation_x[k] = random_int(0, scenario->number_nodes_x - 1);
+        scenario->observation_y[k] = random_int(0, scenario->number_nodes_y - 1);
+    }
+    random_volume(scenario);
+    return 0;
+}
+
+static void free_scenario(verifyscenario_t *scenario) {
+    for (int k = 0; k < scenario->number_inputs; k++) {
+        free(scenario->inputs[k].timeseries);
+    }
+    free(scenario->inputs);
+    free(scenario->input_frequencies);
+    free(scenario->input_z);
+    if (scenario->parameter_maps != NULL) {
+        free_parameter_maps(scenario->parameter_maps);
+    }
+    free_kernel(&scenario->kernel);
+}
+
+/* ---- runs ---- */
+
+// redirects stdout to the null device, returns the descriptor restoring it
+static int silence_stdout() {
+    fflush(stdout);
+    int saved = dup(fileno(stdout));
+    int null_device = open(NULL_DEVICE, O_WRONLY);
+    if (null_device >= 0) {
+        dup2(null_device, fileno(stdout));
+        close(null_device);
+    }
+    return saved;
+}
+
+static void restore_stdout(int saved) {
+    fflush(stdout);
+    if (saved >= 0) {
+        dup2(saved, fileno(stdout));
+        close(saved);
+    }
+}
+
+// the options simulating the scenario with the sweeps chosen for its kernel
+static void init_scenario_options(simulationoptions_t *options, const verifyscenario_t *scenario) {
+    init_simulation_options(options);
+    options->kernel_name = scenario->kernel_name;
+    options->parameters = scenario->parameters;
+    options->parameter_maps = scenario->parameter_maps;
+}
+
+// simulates the scenario with the options, observing all nodes or only the scenario's observation nodes, returns the
+// observations or NULL if the simulation failed
+static nodetimeseries_t *run_simulation(const verifyscenario_t *scenario, simulationoptions_t *options,
+                                        int all_nodes, int verbose, int *number_observations) {
+    if (scenario->number_connections > 0) {
+        options->connectome = load_connectome(VERIFY_CONNECTION_FILE, scenario->number_nodes_x,
+                                              scenario->number_nodes_y);
+    }
+    nodeval_t **state = alloc_2d(scenario->number_nodes_x, scenario->number_nodes_y);
+    init_zeros_2d(state, scenario->number_nodes_x, scenario->number_nodes_y);
+    for (int k = 0; k < scenario->number_starts; k++) {
+        state[scenario->start_x[k]][scenario->start_y[k]] = scenario->start_levels[k];
+    }
+    nodetimeseries_t *observations;
+    if (all_nodes) {
+        *number_observations = scenario->number_nodes_x * scenario->number_nodes_y;
+        observations = init_all_observation_timeseries(scenario->number_nodes_x, scenario->number_nodes_y,
+                                                       scenario->ticks);
+    } else {
+        *number_observations = scenario->number_observations;
+        observations = init_observation_timeseries(scenario->number_observations, scenario->observation_x,
+                                                   scenario->observation_y, scenario->ticks);
+    }
+    if (options->ensemble_size > 1) {
+        init_ensemble_observation_timeseries(observations, *number_observations, options->ensemble_size);
+    }
+    int saved_stdout = verbose ? -1 : silence_stdout();
+    unsigned int returncode = simulate(1, scenario->ticks, scenario->number_nodes_x, scenario->number_nodes_y, state,
+                                       *number_observations, observations, scenario->number_inputs,
+                                       scenario->inputs, options);
+    if (!verbose) {
+        restore_stdout(saved_stdout);
+    }
+    if (options->connectome != NULL) {
+        free_connectome(options->connectome);
+        options->connectome = NULL;
+    }
+    free_2d(state, scenario->number_nodes_x);
+    if (returncode != 0) {
+        for (int k = 0; k < *number_observations; k++) {
+            free(observations[k].timeseries);
+        }
+        free(observations);
+        return NULL;
+    }
+    return observations;
+}
+
+// simulates the scenario with the engine (the reference engine if NULL), observing all nodes or only the scenario's
+// observation nodes, returns the observations or NULL if the simulation failed
+static nodetimeseries_t *run_engine(const verifyscenario_t *scenario, const verifyengine_t *engine, int all_nodes,
+                                    int verbose, int *number_observations) {
+    simulationoptions_t options;
+    init_scenario_options(&options, scenario);
+    int ensemble_size = engine != NULL ? engine->ensemble_size : 1;
+    modelparameters_t *members = NULL;
+    if (ensemble_size > 1) {
+        members = malloc(ensemble_size * sizeof(modelparameters_t));
+        for (int m = 0; m < ensemble_size; m++) {
+            members[m] = scenario->parameters;
+        }
+        options.ensemble_size = ensemble_size;
+        options.ensemble_parameters = members;
+    }
+    if (engine != NULL) {
+        engine->configure(&options);
+    } else {
+        options.reference_engine = 1;
+    }
+    nodetimeseries_t *observations = run_simulation(scenario, &options, all_nodes, verbose, number_observations);
+    free(members);
+    return observations;
+}
+
+static void free_observations(nodetimeseries_t *observations, int number_observations) {
+    for (int k = 0; k < number_observations; k++) {
+        free(observations[k].timeseries);
+    }
+    free(observations);
+}
+
+/* ---- comparison ---- */
+
+// the number of representable doubles between a and b
+static uint64_t ulp_distance(double a, double b) {
+    if (a == b) {
+        return 0;
+    }
+    if (isnan(a) || isnan(b)) {
+        return UINT64_MAX;
+    }
+    int64_t bits_a, bits_b;
+    memcpy(&bits_a, &a, sizeof(double));
+    memcpy(&bits_b, &b, sizeof(double));
+    // maps the sign-magnitude representation to a monotonic one
+    uint64_t ordered_a = bits_a < 0 ? (uint64_t) 0x8000000000000000ULL - (uint64_t) bits_a
+                                    : (uint64_t) bits_a + 0x8000000000000000ULL;
+    uint64_t ordered_b = bits_b < 0 ? (uint64_t) 0x8000000000000000ULL - (uint64_t) bits_b
+                                    : (uint64_t) bits_b + 0x8000000000000000ULL;
+    return ordered_a > ordered_b ? ordered_a - ordered_b : ordered_b - ordered_a;
+}
+
+static void init_errors(verifyerrors_t *errors) {
+    memset(errors, 0, sizeof(verifyerrors_t));
+    errors->diverged_tick = -1;
+}
+
+// compares one value, an error above limit diverges
+// the values of a tick must be compared in node order and the ticks in ascending order
+static void compare_value(verifyerrors_t *errors, nodeval_t value, nodeval_t reference, double limit, int tick,
+                          const nodetimeseries_t *node, int member) {
+    int both_nan = isnan(value) && isnan(reference);
+    double absolute = both_nan ? 0 : fabs(value - reference);
+    if (isnan(absolute)) {
+        absolute = INFINITY;
+    }
+    if (absolute > errors->max_absolute) {
+        errors->max_absolute = absolute;
+    }
+    // values below the limit are rounding noise, e.g., of cancelling sums, their relative and ulp errors are not
+    if (fabs(reference) > limit) {
+        if (absolute / fabs(reference) > errors->max_relative) {
+            errors->max_relative = absolute / fabs(reference);
+        }
+        uint64_t ulps = both_nan ? 0 : ulp_distance(value, reference);
+        if (ulps > errors->max_ulps) {
+            errors->max_ulps = ulps;
+        }
+    }
+    if (absolute > limit && errors->diverged_tick < 0) {
+        errors->diverged_tick = tick;
+        errors->diverged_x = node->x_index;
+        errors->diverged_y = node->y_index;
+        errors->diverged_member = member;
+        errors->diverged_value = value;
+        errors->diverged_reference = reference;
+    }
+}
+
+// the value of member m of a series at a tick
+static inline nodeval_t series_value(const nodetimeseries_t *node, int member, int tick) {
+    return node->timeseries[(size_t) member * node->timeseries_ticks + tick];
+}
+
+// compares the observation series at all ticks
+static void compare_series(verifyerrors_t *errors, const nodetimeseries_t *observations,
+                           const nodetimeseries_t *reference, int number_observations, int members, int ticks,
+                           double limit) {
+    for (int t = 0; t < ticks; t++) {
+        for (int k = 0; k < number_observations; k++) {
+            for (int m = 0; m < members; m++) {
+                compare_value(errors, series_value(&observations[k], m, t), reference[k].timeseries[t], limit, t,
+                              &reference[k], m);
+            }
+        }
+    }
+}
+
+// compares the full grids at VERIFY_GRID_TICKS evenly spaced ticks, the last one included
+static void compare_grids(verifyerrors_t *errors, const nodetimeseries_t *observations,
+                          const nodetimeseries_t *reference, int number_nodes, int members, int ticks, double limit) {
+    for (int g = 1; g <= VERIFY_GRID_TICKS; g++) {
+        int t = g * ticks / VERIFY_GRID_TICKS - 1;
+        for (int k = 0; k < number_nodes; k++) {
+            for (int m = 0; m < members; m++) {
+                compare_value(errors, series_value(&observations[k], m, t), reference[k].timeseries[t], limit, t,
+                              &reference[k], m);
+            }
+        }
+    }
+}
+
+// the largest finite energy level of any node at any tick
+static double largest_level(const nodetimeseries_t *grids, int number_nodes, int ticks) {
+    double scale = 0;
+    for (int k = 0; k < number_nodes; k++) {
+        for (int t = 0; t < ticks; t++) {
+            if (isfinite(grids[k].timeseries[t])) {
+                scale = fmax(scale, fabs(grids[k].timeseries[t]));
+            }
+        }
+    }
+    return scale;
+}
+
+static void print_errors(const char *what, const verifyerrors_t *errors, int members) {
+    printf("    %-6s max abs %.3e, max rel %.3e, max %llu ulps", what, errors->max_absolute, errors->max_relative,
+           (unsigned long long) errors->max_ulps);
+    if (errors->diverged_tick < 0) {
+        printf(": OK\n");
+    } else if (members > 1) {
+        printf(": DIVERGED at tick %d, node (%d;%d), member %d: %.17g (reference %.17g)\n", errors->diverged_tick,
+               errors->diverged_x, errors->diverged_y, errors->diverged_member, errors->diverged_value,
+               errors->diverged_reference);
+    } else {
+        printf(": DIVERGED at tick %d, node (%d;%d): %.17g (reference %.17g)\n", errors->diverged_tick,
+               errors->diverged_x, errors->diverged_y, errors->diverged_value, errors->diverged_reference);
+    }
+}
+
+/* ---- features ---- */
+
+// the energy levels of all nodes after a tick of the reference run observing all nodes, the start levels before tick 0
+static void reference_state(nodeval_t **state, const verifyscenario_t *scenario, const verifyreference_t *reference,
+                            int tick) {
+    if (tick < 0) {
+        init_zeros_2d(state, scenario->number_nodes_x, scenario->number_nodes_y);
+        for (int k = 0; k < scenario->number_starts; k++) {
+            state[scenario->start_x[k]][scenario->start_y[k]] = scenario->start_levels[k];
+        }
+        return;
+    }
+    for (int k = 0; k < reference->number_nodes; k++) {
+        state[reference->grids[k].x_index][reference->grids[k].y_index] = reference->grids[k].timeseries[tick];
+    }
+}
+
+static nodetimeseries_t *copy_observations(const nodetimeseries_t *observations, int number_observations) {
+    nodetimeseries_t *copy = malloc(number_observations * sizeof(nodetimeseries_t));
+    for (int k = 0; k < number_observations; k++) {
+        copy[k] = observations[k];
+        copy[k].timeseries = malloc(observations[k].timeseries_ticks * sizeof(nodeval_t));
+        memcpy(copy[k].timeseries, observations[k].timeseries, observations[k].timeseries_ticks * sizeof(nodeval_t));
+    }
+    return copy;
+}
+
+// the observations of a run stopping early: replays a convergence monitor on the reference grids and extrapolates the
+// copied reference observations after the tick it stops in, like a run does with its own, returns the monitor
+static convergencemonitor_t *expect_early_stop(const verifyscenario_t *scenario, const verifyreference_t *reference,
+                                               nodeval_t tolerance, nodetimeseries_t *expected,
+                                               int number_expected) {
+    convergencemonitor_t *monitor = init_convergence_monitor(tolerance, 1, (double) reference->number_nodes,
+                                                             scenario->ticks, scenario->number_inputs,
+                                                             scenario->inputs, NULL, NULL);
+    nodeval_t **old_state = alloc_2d(scenario->number_nodes_x, scenario->number_nodes_y);
+    nodeval_t **new_state = alloc_2d(scenario->number_nodes_x, scenario->number_nodes_y);
+    reference_state(old_state, scenario, reference, -1);
+    // a run checks all ticks but the last one
+    for (int t = 0; t + 1 < scenario->ticks; t++) {
+        reference_state(new_state, scenario, reference, t);
+        reset_convergence_slot(&monitor->slots[0]);
+        for (int x = 0; x < scenario->number_nodes_x; x++) {
+            monitor_convergence_row(&monitor->slots[0], old_state[x], new_state[x], scenario->number_nodes_y);
+        }
+        if (update_convergence_monitor(monitor, t, number_expected, expected, new_state, 1, 1)) {
+            extrapolate_observations(monitor, scenario->ticks, number_expected, expected, 1);
+            break;
+        }
+        nodeval_t **swap = old_state;
+        old_state = new_state;
+        new_state = swap;
+    }
+    free_2d(old_state, scenario->number_nodes_x);
+    free_2d(new_state, scenario->number_nodes_x);
+    return monitor;
+}
+
+// describes when and why the run of a monitor stops
+static void describe_stop(char *description, size_t size, const convergencemonitor_t *monitor, int ticks) {
+    switch (monitor->status) {
+        case CONVERGENCE_STEADY_STATE:
+            snprintf(description, size, "steady state after tick %d of %d", monitor->stop_tick, ticks);
+            break;
+        case CONVERGENCE_PERIODIC:
+            snprintf(description, size, "periodic orbit of %d ticks after tick %d of %d", monitor->period,
+                     monitor->stop_tick, ticks);
+            break;
+        case CONVERGENCE_DIVERGED:
+            snprintf(description, size, "diverged in tick %d of %d", monitor->stop_tick, ticks);
+            break;
+        default:
+            snprintf(description, size, "all %d ticks", ticks);
+            break;
+    }
+}
+
+// runs stopping early must match the reference observations up to the tick their monitor stops in and its
+// extrapolation afterwards, both for the observation nodes and for all nodes
+static int verify_early_stop(const verifyscenario_t *scenario, const verifyreference_t *reference, double tolerance,
+                             int verbose) {
+    double limit = tolerance * reference->scale;
+    nodeval_t early_stop_tolerance = VERIFY_EARLY_STOP_TOLERANCE * reference->scale;
+    simulationoptions_t options;
+    init_scenario_options(&options, scenario);
+    configure_direct(&options);
+    options.early_stop_tolerance = early_stop_tolerance;
+    int number_series, number_nodes;
+    nodetimeseries_t *series = run_simulation(scenario, &options, 0, verbose, &number_series);
+    nodetimeseries_t *grids = run_simulation(scenario, &options, 1, verbose, &number_nodes);
+    nodetimeseries_t *expected_series = copy_observations(reference->series, reference->number_series);
+    nodetimeseries_t *expected_grids = copy_observations(reference->grids, reference->number_nodes);
+    convergencemonitor_t *series_monitor = expect_early_stop(scenario, reference, early_stop_tolerance,
+                                                             expected_series, reference->number_series);
+    convergencemonitor_t *grid_monitor = expect_early_stop(scenario, reference, early_stop_tolerance, expected_grids,
+                                                           reference->number_nodes);
+    char series_stop[64], grid_stop[64];
+    describe_stop(series_stop, sizeof(series_stop), series_monitor, scenario->ticks);
+    describe_stop(grid_stop, sizeof(grid_stop), grid_monitor, scenario->ticks);
+    printf("  earlystop (tolerance %g, stopping at changes of %g):\n", tolerance, early_stop_tolerance);
+    printf("    reference stops: series %s, grids %s\n", series_stop, grid_stop);
+    int failed;
+    if (series == NULL || grids == NULL) {
+        printf("    FAILED to simulate\n");
+        failed = 1;
+    } else {
+        verifyerrors_t series_errors, grid_errors;
+        init_errors(&series_errors);
+        init_errors(&grid_errors);
+        compare_series(&series_errors, series, expected_series, number_series, 1, scenario->ticks, limit);
+        compare_grids(&grid_errors, grids, expected_grids, number_nodes, 1, scenario->ticks, limit);
+        print_errors("series", &series_errors, 1);
+        print_errors("grids", &grid_errors, 1);
+        failed = series_errors.diverged_tick >= 0 || grid_errors.diverged_tick >= 0;
+    }
+    if (series != NULL) {
+        free_observations(series, number_series);
+    }
+    if (grids != NULL) {
+        free_observations(grids, number_nodes);
+    }
+    free_observations(expected_series, reference->number_series);
+    free_observations(expected_grids, reference->number_nodes);
+    free_convergence_monitor(series_monitor);
+    free_convergence_monitor(grid_monitor);
+    return failed;
+}
+
+// the events of the reference grids, recorded like a run records its own
+static eventlog_t *expect_events(const verifyscenario_t *scenario, const verifyreference_t *reference,
+                                 nodeval_t threshold) {
+    eventlog_t *log = init_event_log(threshold, 1, scenario->number_nodes_x, scenario->number_nodes_y, 0, NULL, NULL);
+    start_event_recording(log, 1, 1, 1);
+    nodeval_t **old_state = alloc_2d(scenario->number_nodes_x, scenario->number_nodes_y);
+    nodeval_t **new_state = alloc_2d(scenario->number_nodes_x, scenario->number_nodes_y);
+    reference_state(old_state, scenario, reference, -1);
+    for (int t = 0; t < scenario->ticks; t++) {
+        reference_state(new_state, scenario, reference, t);
+        for (int x = 0; x < scenario->number_nodes_x; x++) {
+            record_row_events(log, &log->buffers[0], t, x, old_state[x], new_state[x]);
+        }
+        nodeval_t **swap = old_state;
+        old_state = new_state;
+        new_state = swap;
+    }
+    free_2d(old_state, scenario->number_nodes_x);
+    free_2d(new_state, scenario->number_nodes_x);
+    finish_event_recording(log);
+    return log;
+}
+
+// the order of the sorted events of a log
+static int event_order(const nodeevent_t *a, const nodeevent_t *b) {
+    if (a->tick != b->tick) {
+        return a->tick < b->tick ? -1 : 1;
+    }
+    if (a->x != b->x) {
+        return a->x < b->x ? -1 : 1;
+    }
+    if (a->y != b->y) {
+        return a->y < b->y ? -1 : 1;
+    }
+    if (a->member != b->member) {
+        return a->member < b->member ? -1 : 1;
+    }
+    return (int) a->kind - (int) b->kind;
+}
+
+// compares the events of a run with the reference events, the values of matching events like observations, an event
+// missing in either log diverges with a NaN value on its side
+static void compare_events(verifyerrors_t *errors, const eventlog_t *events, const eventlog_t *reference,
+                           double limit) {
+    size_t i = 0;
+    size_t j = 0;
+    while (i < events->number_events || j < reference->number_events) {
+        const nodeevent_t *event = i < events->number_events ? &events->events[i] : NULL;
+        const nodeevent_t *expected = j < reference->number_events ? &reference->events[j] : NULL;
+        int order = event == NULL ? 1 : expected == NULL ? -1 : event_order(event, expected);
+        const nodeevent_t *first = order <= 0 ? event : expected;
+        nodetimeseries_t node = {first->x, first->y, 0, NULL, 0};
+        compare_value(errors, order <= 0 ? event->value : NAN, order >= 0 ? expected->value : NAN, limit,
+                      first->tick, &node, first->member);
+        i += order <= 0;
+        j += order >= 0;
+    }
+}
+
+// a run recording the crossings and peaks of all nodes must record the events of the reference grids
+static int verify_events(const verifyscenario_t *scenario, const verifyreference_t *reference, double tolerance,
+                         int verbose) {
+    double limit = tolerance * reference->scale;
+    nodeval_t threshold = VERIFY_EVENT_THRESHOLD * reference->scale;
+    simulationoptions_t options;
+    init_scenario_options(&options, scenario);
+    configure_direct(&options);
+    options.events = init_event_log(threshold, 1, scenario->number_nodes_x, scenario->number_nodes_y, 0, NULL, NULL);
+    int number_series;
+    nodetimeseries_t *series = run_simulation(scenario, &options, 0, verbose, &number_series);
+    eventlog_t *expected = expect_events(scenario, reference, threshold);
+    printf("  events (tolerance %g, threshold %g, %zu reference events):\n", tolerance, threshold,
+           expected->number_events);
+    int failed;
+    if (series == NULL) {
+        printf("    FAILED to simulate\n");
+        failed = 1;
+    } else {
+        verifyerrors_t series_errors, event_errors;
+        init_errors(&series_errors);
+        init_errors(&event_errors);
+        compare_series(&series_errors, series, reference->series, number_series, 1, scenario->ticks, limit);
+        compare_events(&event_errors, options.events, expected, limit);
+        print_errors("series", &series_errors, 1);
+        print_errors("events", &event_errors, 1);
+        failed = series_errors.diverged_tick >= 0 || event_errors.diverged_tick >= 0;
+        free_observations(series, number_series);
+    }
+    free_event_log(options.events);
+    free_event_log(expected);
+    return failed;
+}
+
+// writes the scenario as two identical regions with the connections leading from each region to the other one, so
+// that both regions simulate the scenario's grid
+static int write_regions(const verifyscenario_t *scenario, const char **names) {
+    FILE *file = fopen(VERIFY_REGION_FILE, "w");
+    if (file == NULL) {
+        printf("ERROR: Could not write %s.\n", VERIFY_REGION_FILE);
+        return 1;
+    }
+    const modelparameters_t *parameters = &scenario->parameters;
+    for (int r = 0; r < 2; r++) {
+        fprintf(file, "region %s %d %d %s d_neighborfactor=%.17g id_neighborfactor=%.17g energy_factor=%.17g "
+                      "energy_weight=%.17g delta_factor=%.17g slope_factor=%.17g slope_weight=%.17g damping=%.17g\n",
+                names[r], scenario->number_nodes_x, scenario->number_nodes_y, scenario->kernel_name,
+                parameters->d_neighborfactor, parameters->id_neighborfactor, parameters->energy_factor,
+                parameters->energy_weight, parameters->delta_factor, parameters->slope_factor,
+                parameters->slope_weight, parameters->damping);
+    }
+    for (int r = 0; r < 2; r++) {
+        for (int k = 0; k < scenario->number_starts; k++) {
+            fprintf(file, "start %s %d %d %.17g\n", names[r], scenario->start_x[k], scenario->start_y[k],
+                    scenario->start_levels[k]);
+        }
+        for (int k = 0; k < scenario->number_observations; k++) {
+            fprintf(file, "observe %s %d %d\n", names[r], scenario->observation_x[k], scenario->observation_y[k]);
+        }
+        for (int k = 0; k < scenario->number_inputs; k++) {
+            fprintf(file, "freq %s %d %d %d\n", names[r], scenario->inputs[k].x_index, scenario->inputs[k].y_index,
+                    scenario->input_frequencies[k]);
+        }
+        for (int c = 0; c < scenario->number_connections; c++) {
+            fprintf(file, "link %s %d %d %s %d %d %.17g\n", names[r], scenario->connection_sources[c].x,
+                    scenario->connection_sources[c].y, names[1 - r], scenario->connection_targets[c].x,
+                    scenario->connection_targets[c].y, scenario->connection_weights[c]);
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+// both regions of a multi-region run of the scenario must match the reference observations
+static int verify_regions(const verifyscenario_t *scenario, const verifyreference_t *reference, double tolerance,
+                          int verbose) {
+    static const char *names[] = {"first", "second"};
+    double limit = tolerance * reference->scale;
+    simulationoptions_t defaults;
+    init_scenario_options(&defaults, scenario);
+    configure_direct(&defaults);
+    int saved_stdout = verbose ? -1 : silence_stdout();
+    regionset_t *regions = write_regions(scenario, names) ? NULL
+                                                          : load_regions(VERIFY_REGION_FILE, scenario->ticks, 1,
+                                                                         &defaults);
+    unsigned int returncode = regions != NULL ? simulate_regions(1, scenario->ticks, regions) : 1;
+    if (!verbose) {
+        restore_stdout(saved_stdout);
+    }
+    printf("  regions (tolerance %g, %d links):\n", tolerance, regions != NULL ? regions->number_links : 0);
+    int failed = 0;
+    if (returncode != 0) {
+        printf("    FAILED to simulate\n");
+        failed = 1;
+    } else {
+        for (int r = 0; r < regions->number_regions; r++) {
+            verifyerrors_t errors;
+            init_errors(&errors);
+            compare_series(&errors, regions->regions[r].observationnodes, reference->series,
+                           reference->number_series, 1, scenario->ticks, limit);
+            print_errors(names[r], &errors, 1);
+            failed |= errors.diverged_tick >= 0;
+        }
+    }
+    if (regions != NULL) {
+        free_regions(regions);
+    }
+    return failed;
+}
+
+// the index of node (x, y, z) of the scenario's volume in the arrays of the generic 3D engine
+static inline size_t volume_node(const verifyscenario_t *scenario, int x, int y, int z) {
+    return ((size_t) x * scenario->number_nodes_y + y) * scenario->number_nodes_z + z;
+}
+
+// the energy level of a node of the scenario's volume, 0 outside of it
+static inline nodeval_t volume_level(const verifyscenario_t *scenario, const nodeval_t *act, int x, int y, int z) {
+    if (x < 0 || y < 0 || z < 0 || x >= scenario->number_nodes_x || y >= scenario->number_nodes_y
+        || z >= scenario->number_nodes_z) {
+        return 0;
+    }
+    return act[volume_node(scenario, x, y, z)];
+}
+
+// the generic 3D engine: gathers the neighbors of each node of the scenario's volume (the nodes sharing a face
+// directly, the nodes sharing an edge or a corner indirectly, as far as the kernel has them) and executes process() on
+// them, returns the largest finite energy level of any node at any tick
+static double simulate_volume_reference(const verifyscenario_t *scenario, nodetimeseries_t *observations) {
+    int number_id_neighbors = strcmp(scenario->volume_kernel_name, "6neighbors") == 0 ? 0
+                              : strcmp(scenario->volume_kernel_name, "18neighbors") == 0 ? 12 : 20;
+    size_t size = (size_t) scenario->number_nodes_x * scenario->number_nodes_y * scenario->number_nodes_z;
+    nodeval_t *act = calloc(size, sizeof(nodeval_t));
+    nodeval_t *act_new = malloc(size * sizeof(nodeval_t));
+    nodeval_t *slopes = calloc(size, sizeof(nodeval_t));
+    for (int k = 0; k < scenario->number_starts; k++) {
+        act[volume_node(scenario, scenario->start_x[k], scenario->start_y[k], scenario->start_z[k])] =
+                scenario->start_levels[k];
+    }
+    double scale = 0;
+    for (int t = 0; t < scenario->ticks; t++) {
+        for (int x = 0; x < scenario->number_nodes_x; x++) {
+            for (int y = 0; y < scenario->number_nodes_y; y++) {
+                for (int z = 0; z < scenario->number_nodes_z; z++) {
+                    nodeval_t d_neighbors[6];
+                    // without indirect neighbors, their mean counts as 0, i.e., that of a single neighbor at 0
+                    nodeval_t id_neighbors[20] = {0};
+                    int number_d = 0;
+                    int number_id = 0;
+                    for (int dx = -1; dx <= 1; dx++) {
+                        for (int dy = -1; dy <= 1; dy++) {
+                            for (int dz = -1; dz <= 1; dz++) {
+                                int distance = abs(dx) + abs(dy) + abs(dz);
+                                if (distance == 1) {
+                                    d_neighbors[number_d++] = volume_level(scenario, act, x + dx, y + dy, z + dz);
+                                } else if ((distance == 2 && number_id_neighbors >= 12)
+                                           || (distance == 3 && number_id_neighbors == 20)) {
+                                    id_neighbors[number_id++] = volume_level(scenario, act, x + dx, y + dy, z + dz);
+                                }
+                            }
+                        }
+                    }
+                    size_t node = volume_node(scenario, x, y, z);
+                    nodestate_t state = process(act[node], slopes[node], number_d, d_neighbors,
+                                                number_id > 0 ? number_id : 1, id_neighbors, &scenario->parameters);
+                    act_new[node] = state.act;
+                    slopes[node] = state.slope;
+                }
+            }
+        }
+        for (int k = 0; k < scenario->number_inputs; k++) {
+            const nodeinputseries_t *input = &scenario->inputs[k];
+            act_new[volume_node(scenario, input->x_index, input->y_index, scenario->input_z[k])] +=
+                    input->timeseries[t % input->timeseries_ticks];
+        }
+        for (int k = 0; k < scenario->number_observations; k++) {
+            observations[k].timeseries[t] = act_new[volume_node(scenario, observations[k].x_index,
+                                                                observations[k].y_index, observations[k].z_index)];
+        }
+        for (size_t node = 0; node < size; node++) {
+            if (isfinite(act_new[node])) {
+                scale = fmax(scale, fabs(act_new[node]));
+            }
+        }
+        nodeval_t *swap = act;
+        act = act_new;
+        act_new = swap;
+    }
+    free(act);
+    free(act_new);
+    free(slopes);
+    return scale;
+}
+
+// the observations of the scenario's volume, at the observation nodes of its grid and their z indices
+static nodetimeseries_t *init_volume_observations(const verifyscenario_t *scenario) {
+    nodetimeseries_t *observations = init_observation_timeseries(scenario->number_observations,
+                                                                 scenario->observation_x, scenario->observation_y,
+                                                                 scenario->ticks);
+    for (int k = 0; k < scenario->number_observations; k++) {
+        observations[k].z_index = scenario->observation_z[k];
+    }
+    return observations;
+}
+
+// the blocked sweep of the scenario's volume must match the generic 3D engine, relative to the largest energy level
+// of the volume
+static int verify_volume(const verifyscenario_t *scenario, const verifyreference_t *reference, double tolerance,
+                         int verbose) {
+    nodelevel_t startnodes[VERIFY_MAX_NODES];
+    for (int k = 0; k < scenario->number_starts; k++) {
+        startnodes[k].x_index = scenario->start_x[k];
+        startnodes[k].y_index = scenario->start_y[k];
+        startnodes[k].z_index = scenario->start_z[k];
+        startnodes[k].level = scenario->start_levels[k];
+    }
+    // the input series are shared with the scenario
+    nodeinputseries_t *inputs = malloc((scenario->number_inputs + 1) * sizeof(nodeinputseries_t));
+    for (int k = 0; k < scenario->number_inputs; k++) {
+        inputs[k] = scenario->inputs[k];
+        inputs[k].z_index = scenario->input_z[k];
+    }
+    simulationoptions_t options;
+    init_simulation_options(&options);
+    options.kernel_name = scenario->volume_kernel_name;
+    options.parameters = scenario->parameters;
+    nodetimeseries_t *observations = init_volume_observations(scenario);
+    int saved_stdout = verbose ? -1 : silence_stdout();
+    unsigned int returncode = simulate_volume(1, scenario->ticks, scenario->number_nodes_x, scenario->number_nodes_y,
+                                              scenario->number_nodes_z, scenario->number_starts, startnodes,
+                                              scenario->number_observations, observations, scenario->number_inputs,
+                                              inputs, &options);
+    if (!verbose) {
+        restore_stdout(saved_stdout);
+    }
+    nodetimeseries_t *expected = init_volume_observations(scenario);
+    double scale = simulate_volume_reference(scenario, expected);
+    printf("  volume (tolerance %g, %d x %d x %d, %s):\n", tolerance, scenario->number_nodes_x,
+           scenario->number_nodes_y, scenario->number_nodes_z, scenario->volume_kernel_name);
+    int failed;
+    if (returncode != 0) {
+        printf("    FAILED to simulate\n");
+        failed = 1;
+    } else {
+        verifyerrors_t errors;
+        init_errors(&errors);
+        compare_series(&errors, observations, expected, scenario->number_observations, 1, scenario->ticks,
+                       tolerance * scale);
+        print_errors("series", &errors, 1);
+        failed = errors.diverged_tick >= 0;
+    }
+    free_observations(observations, scenario->number_observations);
+    free_observations(expected, scenario->number_observations);
+    free(inputs);
+    return failed;
+}
+
+// regions have uniform model parameters
+static int applies_regions(const verifyscenario_t *scenario) {
+    return scenario->parameter_maps == NULL;
+}
+
+// volumes have uniform model parameters and no connections
+static int applies_volume(const verifyscenario_t *scenario) {
+    return scenario->parameter_maps == NULL && scenario->number_connections == 0;
+}
+
+// all features sum the kernels directly
+static const verifyfeature_t features[] = {
+        {"earlystop", 1e-12, applies_always,  verify_early_stop},
+        {"events",    1e-12, applies_always,  verify_events},
+        {"regions",   1e-12, applies_regions, verify_regions},
+        {"volume",    1e-12, applies_volume,  verify_volume},
+};
+
+// verifies all selected engines and features against the reference on one scenario, returns the number of failed
+// engines and features
+static int verify_scenario(const verifyscenario_t *scenario, const char *engine_name, double tolerance,
+                           int verbose) {
+    printf("Scenario %d: %d x %d, %d ticks, %s, %d start nodes, %d inputs%s%s%s\n", scenario->index,
+           scenario->number_nodes_x, scenario->number_nodes_y, scenario->ticks, scenario->kernel_name,
+           scenario->number_starts, scenario->number_inputs,
+           scenario->parameters.damping == 0 && scenario->parameters.slope_weight == 1 ? ", unit parameters" : "",
+           scenario->parameter_maps != NULL ? ", parameter maps" : "",
+           scenario->number_connections > 0 ? ", connections" : "");
+    verifyreference_t reference;
+    reference.series = run_engine(scenario, NULL, 0, verbose, &reference.number_series);
+    reference.grids = run_engine(scenario, NULL, 1, verbose, &reference.number_nodes);
+    if (reference.series == NULL || reference.grids == NULL) {
+        printf("  reference: FAILED to simulate\n");
+        return 1;
+    }
+    reference.scale = largest_level(reference.grids, reference.number_nodes, scenario->ticks);
+    int failures = 0;
+    for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]); e++) {
+        const verifyengine_t *engine = &engines[e];
+        if ((engine_name != NULL && strcmp(engine_name, engine->name) != 0) || !engine->applies(scenario)) {
+            continue;
+        }
+        double engine_tolerance = tolerance > 0 ? tolerance : engine->tolerance;
+        double limit = engine_tolerance * reference.scale;
+        printf("  %s (tolerance %g):\n", engine->name, engine_tolerance);
+        int number_observations;
+        nodetimeseries_t *series = run_engine(scenario, engine, 0, verbose, &number_observations);
+        nodetimeseries_t *grids = engine->grids ? run_engine(scenario, engine, 1, verbose, &number_observations)
+                                                : NULL;
+        if (series == NULL || (engine->grids && grids == NULL)) {
+            printf("    FAILED to simulate\n");
+            failures++;
+        } else {
+            verifyerrors_t series_errors, grid_errors;
+            init_errors(&series_errors);
+            init_errors(&grid_errors);
+            compare_series(&series_errors, series, reference.series, reference.number_series, engine->ensemble_size,
+                           scenario->ticks, limit);
+            print_errors("series", &series_errors, engine->ensemble_size);
+            if (engine->grids) {
+                compare_grids(&grid_errors, grids, reference.grids, reference.number_nodes, engine->ensemble_size,
+                              scenario->ticks, limit);
+                print_errors("grids", &grid_errors, engine->ensemble_size);
+            }
+            failures += series_errors.diverged_tick >= 0 || grid_errors.diverged_tick >= 0;
+        }
+        if (series != NULL) {
+            free_observations(series, reference.number_series);
+        }
+        if (grids != NULL) {
+            free_observations(grids, reference.number_nodes);
+        }
+    }
+    for (size_t f = 0; f < sizeof(features) / sizeof(features[0]); f++) {
+        const verifyfeature_t *feature = &features[f];
+        if ((engine_name != NULL && strcmp(engine_name, feature->name) != 0) || !feature->applies(scenario)) {
+            continue;
+        }
+        failures += feature->verify(scenario, &reference, tolerance > 0 ? tolerance : feature->tolerance, verbose);
+    }
+    free_observations(reference.series, reference.number_series);
+    free_observations(reference.grids, reference.number_nodes);
+    return failures;
+}
+
+int main(int argc, const char *argv[]) {
+    int number_scenarios = VERIFY_SCENARIOS;
+    if (contains_flag(argc, argv, "--scenarios")) {
+        number_scenarios = parse_int_arg(argc, argv, "--scenarios");
+    }
+    int seed = 1;
+    if (contains_flag(argc, argv, "--seed")) {
+        seed = parse_int_arg(argc, argv, "--seed");
+    }
+    const char *engine_name = NULL;
+    if (contains_flag(argc, argv, "--engine")) {
+        engine_name = parse_string_arg(argc, argv, "--engine");
+    }
+    double tolerance = 0;
+    if (contains_flag(argc, argv, "--tolerance")) {
+        tolerance = parse_nodeval_arg(argc, argv, "--tolerance");
+    }
+    int verbose = contains_flag(argc, argv, "--verbose");
+    int known_engine = engine_name == NULL;
+    for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]) && !known_engine; e++) {
+        known_engine = strcmp(engine_name, engines[e].name) == 0;
+    }
+    for (size_t f = 0; f < sizeof(features) / sizeof(features[0]) && !known_engine; f++) {
+        known_engine = strcmp(engine_name, features[f].name) == 0;
+    }
+    if (number_scenarios < 1 || !known_engine || tolerance < 0) {
+        printf("Usage: brainverify [--scenarios N] [--seed S] [--engine NAME] [--tolerance T] [--verbose]\n");
+        printf("Engines: specialized, lightcone, separable, fft, ensemble, fastforward, superposition\n");
+        printf("Features: earlystop, events, regions, volume\n");
+        return 1;
+    }
+    random_state = 0x9E3779B97F4A7C15ULL ^ (uint64_t) (unsigned int) seed;
+    int failures = 0;
+    for (int s = 0; s < number_scenarios; s++) {
+        verifyscenario_t scenario;
+        int saved_stdout = verbose ? -1 : silence_stdout();
+        int error = init_scenario(&scenario, s);
+        if (!verbose) {
+            restore_stdout(saved_stdout);
+        }
+        if (error) {
+            return 1;
+        }
+        failures += verify_scenario(&scenario, engine_name, tolerance, verbose);
+        free_scenario(&scenario);
+    }
+    remove(VERIFY_CONNECTION_FILE);
+    remove(VERIFY_REGION_FILE);
+    if (failures > 0) {
+        printf("%d engine and feature runs diverged from the reference engine.\n", failures);
+        return 1;
+    }
+    printf("All engines and features match the reference engine on %d scenarios (seed %d).\n", number_scenarios, seed);
+    return 0;
+}
@@ -0,0 +1,328 @@
+#include "volume.h"
+#include "brainsimulation.h"
+#include "nodefunc.h"
+#include "utils.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// number of values per cache line, the z-lines are padded to multiples of it
+#define VOLUME_LINE_VALUES (64 / sizeof(nodeval_t))
+
+// the state of one thread sweeping a column of the volume
+typedef struct {
+    volume_t *volume;
+    int num_ticks;
+    int number_id_neighbors;
+    modelcoefficients_t coefficients;
+    // the column of the x-y plane owned by the thread
+    int start_x;
+    int end_x;
+    int start_y;
+    int end_y;
+    // number of y-lines per cache block
+    int block_y;
+    int num_obervationnodes;
+    nodetimeseries_t *observationnodes;
+    int number_inputs;
+    nodeinputseries_t *inputs;
+    threadbarrier_t *barrier;
+} volumecontext_t;
+
+// gets the number of indirect neighbors of a volume kernel, -1 for unknown names
+static int volume_kernel_id_neighbors(const char *name) {
+    if (name == NULL || name[0] == '\0' || strcmp(name, "6neighbors") == 0) {
+        return 0;
+    } else if (strcmp(name, "18neighbors") == 0) {
+        return 12;
+    } else if (strcmp(name, "26neighbors") == 0) {
+        return 20;
+    }
+    return -1;
+}
+
+static unsigned int init_volume(volume_t *volume, int number_nodes_x, int number_nodes_y, int number_nodes_z) {
+    volume->number_nodes_x = number_nodes_x;
+    volume->number_nodes_y = number_nodes_y;
+    volume->number_nodes_z = number_nodes_z;
+    volume->stride_y = (number_nodes_z + 2 + VOLUME_LINE_VALUES - 1) / VOLUME_LINE_VALUES * VOLUME_LINE_VALUES;
+    volume->stride_x = volume->stride_y * (number_nodes_y + 2);
+    size_t size = volume->stride_x * (number_nodes_x + 2);
+    // calloc leaves the pages untouched until the sweeping threads first write them, which places them close to the
+    // thread owning them
+    volume->act[0] = calloc(size, sizeof(nodeval_t));
+    volume->act[1] = calloc(size, sizeof(nodeval_t));
+    volume->slopes = calloc(size, sizeof(nodeval_t));
+    if (volume->act[0] == NULL || volume->act[1] == NULL || volume->slopes == NULL) {
+        printf("ERROR: Could not allocate %zu MiB for the volume.\n", 3 * size * sizeof(nodeval_t) >> 20);
+        free(volume->act[0]);
+        free(volume->act[1]);
+        free(volume->slopes);
+        return 1;
+    }
+    return 0;
+}
+
+static void free_volume(volume_t *volume) {
+    free(volume->act[0]);
+    free(volume->act[1]);
+    free(volume->slopes);
+}
+
+static int inside_volume(const volume_t *volume, int x, int y, int z) {
+    return x >= 0 && x < volume->number_nodes_x && y >= 0 && y < volume->number_nodes_y
+           && z >= 0 && z < volume->number_nodes_z;
+}
+
+// splits the x-y plane into columns_x * columns_y columns with the shortest borders for the number of threads
+static void split_columns(int number_threads, int number_nodes_x, int number_nodes_y, int *columns_x,
+                          int *columns_y) {
+    *columns_x = 1;
+    *columns_y = 1;
+    double best_border = -1;
+    for (int cx = 1; cx <= number_threads; cx++) {
+        int cy = number_threads / cx;
+        if (cx * cy != number_threads || cx > number_nodes_x || cy > number_nodes_y) {
+            continue;
+        }
+        double border = (double) number_nodes_x / cx + (double) number_nodes_y / cy;
+        if (best_border < 0 || border < best_border) {
+            best_border = border;
+            *columns_x = cx;
+            *columns_y = cy;
+        }
+    }
+}
+
+// updates the z-line starting at center, all neighbors are read from the halo-padded layout without border checks
+// number_id_neighbors is a constant in each call, so that the unused neighborhoods are compiled out
+static inline void sweep_line(const nodeval_t *center, size_t stride_x, size_t stride_y, nodeval_t *act_new,
+                              nodeval_t *slopes, int number_nodes_z, const modelcoefficients_t *coefficients,
+                              int number_id_neighbors) {
+    // the z-lines at x + dx, y + dy
+    const nodeval_t *xm = center - stride_x;
+    const nodeval_t *xp = center + stride_x;
+    const nodeval_t *ym = center - stride_y;
+    const nodeval_t *yp = center + stride_y;
+    const nodeval_t *xmym = xm - stride_y;
+    const nodeval_t *xmyp = xm + stride_y;
+    const nodeval_t *xpym = xp - stride_y;
+    const nodeval_t *xpyp = xp + stride_y;
+    for (int z = 0; z < number_nodes_z; z++) {
+        nodeval_t d_sum = xm[z] + xp[z] + ym[z] + yp[z] + center[z - 1] + center[z + 1];
+        nodeval_t id_sum = 0;
+        if (number_id_neighbors >= 12) {
+            id_sum = xmym[z] + xmyp[z] + xpym[z] + xpyp[z]
+                     + xm[z - 1] + xm[z + 1] + xp[z - 1] + xp[z + 1]
+                     + ym[z - 1] + ym[z + 1] + yp[z - 1] + yp[z + 1];
+        }
+        if (number_id_neighbors == 20) {
+            id_sum += xmym[z - 1] + xmym[z + 1] + xmyp[z - 1] + xmyp[z + 1]
+                      + xpym[z - 1] + xpym[z + 1] + xpyp[z - 1] + xpyp[z + 1];
+        }
+        nodestate_t state = process_sums(center[z], slopes[z], d_sum, id_sum, coefficients);
+        act_new[z] = state.act;
+        slopes[z] = state.slope;
+    }
+}
+
+// sweeps the column of the thread in blocks of y-lines, walking along x within each block
+static void sweep_column(volumecontext_t *context, const nodeval_t *act_old, nodeval_t *act_new) {
+    volume_t *volume = context->volume;
+    for (int block_start = context->start_y; block_start < context->end_y; block_start += context->block_y) {
+        int block_end = block_start + context->block_y < context->end_y ? block_start + context->block_y
+                                                                          : context->end_y;
+        for (int x = context->start_x; x < context->end_x; x++) {
+            for (int y = block_start; y < block_end; y++) {
+                size_t index = volume_index(volume, x, y, 0);
+                switch (context->number_id_neighbors) {
+                    case 0:
+                        sweep_line(act_old + index, volume->stride_x, volume->stride_y, act_new + index,
+                                   volume->slopes + index, volume->number_nodes_z, &context->coefficients, 0);
+                        break;
+                    case 12:
+                        sweep_line(act_old + index, volume->stride_x, volume->stride_y, act_new + index,
+                                   volume->slopes + index, volume->number_nodes_z, &context->coefficients, 12);
+                        break;
+                    default:
+                        sweep_line(act_old + index, volume->stride_x, volume->stride_y, act_new + index,
+                                   volume->slopes + index, volume->number_nodes_z, &context->coefficients, 20);
+                        break;
+                }
+            }
+        }
+    }
+}
+
+// adds the inputs of the tick to the new energy levels and extracts the observation nodes, done by a single thread
+static void finish_tick(volumecontext_t *context, nodeval_t *act_new, int tick_number) {
+    volume_t *volume = context->volume;
+    for (int i = 0; i < context->number_inputs; i++) {
+        const nodeinputseries_t *input = &context->inputs[i];
+        act_new[volume_index(volume, input->x_index, input->y_index, input->z_index)] +=
+                input->timeseries[tick_number % input->timeseries_ticks];
+    }
+    for (int i = 0; i < context->num_obervationnodes; i++) {
+        nodetimeseries_t *observation = &context->observationnodes[i];
+        observation->timeseries[tick_number] =
+                act_new[volume_index(volume, observation->x_index, observation->y_index, observation->z_index)];
+    }
+    if (!(tick_number % 100)) {
+        printf("Executed tick %d.\n", tick_number);
+    }
+}
+
+static unsigned int execute_partial_volume_simulation(void *argument) {
+    volumecontext_t *context = argument;
+    for (int j = 0; j < context->num_ticks; j++) {
+        const nodeval_t *act_old = context->volume->act[j & 1];
+        nodeval_t *act_new = context->volume->act[(j + 1) & 1];
+        sweep_column(context, act_old, act_new);
+#if MULTITHREADING
+        // the management thread finishes the tick, all threads wait for it before reading the new energy levels
+        if (wait_at_barrier(context->barrier)) {
+            finish_tick(context, act_new, j);
+        }
+        wait_at_barrier(context->barrier);
+#else
+        finish_tick(context, act_new, j);
+#endif
+    }
+    return 0;
+}
+
+unsigned int simulate_volume(double tick_ms, int num_ticks, int number_nodes_x, int number_nodes_y,
+                             int number_nodes_z, int num_startnodes, const nodelevel_t *startnodes,
+                             int num_obervationnodes, nodetimeseries_t *observationnodes, int number_inputs,
+                             nodeinputseries_t *inputs, const simulationoptions_t *options) {
+    simulationoptions_t default_options;
+    if (options == NULL) {
+        init_simulation_options(&default_options);
+        options = &default_options;
+    }
+    const char *kernel_name = options->kernel_name;
+    int number_id_neighbors = volume_kernel_id_neighbors(kernel_name);
+    if (number_id_neighbors < 0) {
+        printf("ERROR: Unknown volume kernel: %s.\n", kernel_name);
+        printf("\tAvailable volume kernels: 6neighbors, 18neighbors, 26neighbors.\n");
+        return 1;
+    }
+    if (kernel_name == NULL || kernel_name[0] == '\0') {
+        kernel_name = VOLUME_KERNEL_DEFAULT_NAME;
+    }
+    if (options->ensemble_size > 1 || options->parameter_maps != NULL || options->connectome != NULL
+        || options->input_stream != NULL || options->superposition || options->fast_forward
+        || options->reference_engine) {
+        printf("WARNING: Volumes only support the kernel and the uniform model parameters, all other options are "
+               "ignored.\n");
+    }
+    volume_t volume;
+    if (init_volume(&volume, number_nodes_x, number_nodes_y, number_nodes_z)) {
+        return 1;
+    }
+    for (int i = 0; i < num_startnodes; i++) {
+        if (!inside_volume(&volume, startnodes[i].x_index, startnodes[i].y_index, startnodes[i].z_index)) {
+            printf("ERROR: Start node (%d;%d;%d) is outside of the volume.\n", startnodes[i].x_index,
+                   startnodes[i].y_index, startnodes[i].z_index);
+            free_volume(&volume);
+            return 1;
+        }
+        volume.act[0][volume_index(&volume, startnodes[i].x_index, startnodes[i].y_index, startnodes[i].z_index)] =
+                startnodes[i].level;
+    }
+    for (int i = 0; i < num_obervationnodes; i++) {
+        if (!inside_volume(&volume, observationnodes[i].x_index, observationnodes[i].y_index,
+                           observationnodes[i].z_index)) {
+            printf("ERROR: Observation node (%d;%d;%d) is outside of the volume.\n", observationnodes[i].x_index,
+                   observationnodes[i].y_index, observationnodes[i].z_index);
+            free_volume(&volume);
+            return 1;
+        }
+    }
+    for (int i = 0; i < number_inputs; i++) {
+        if (!inside_volume(&volume, inputs[i].x_index, inputs[i].y_index, inputs[i].z_index)) {
+            printf("ERROR: Input node (%d;%d;%d) is outside of the volume.\n", inputs[i].x_index, inputs[i].y_index,
+                   inputs[i].z_index);
+            free_volume(&volume);
+            return 1;
+        }
+    }
+
+    int num_threads = simulation_thread_count();
+    int columns_x, columns_y;
+    split_columns(num_threads, number_nodes_x, number_nodes_y, &columns_x, &columns_y);
+    num_threads = columns_x * columns_y;
+    int block_y = VOLUME_CACHE_SIZE / (int) (3 * volume.stride_y * sizeof(nodeval_t)) - 2;
+    if (block_y < 1) {
+        block_y = 1;
+    } else if (block_y > number_nodes_y) {
+        block_y = number_nodes_y;
+    }
+    printf("Starting simulation.\n");
+    printf("Volume size: %d x %d x %d => %lld simulated nodes.\n", number_nodes_x, number_nodes_y, number_nodes_z,
+           (long long) number_nodes_x * number_nodes_y * number_nodes_z);
+    printf("Number of ticks: %d\n", num_ticks);
+    printf("Length of each tick (ms): %f\n", tick_ms);
+    printf("Number of threads: %d (%d x %d columns, blocks of %d y-lines)\n", num_threads, columns_x, columns_y,
+           block_y);
+    printf("Number of observation nodes: %d\n", num_obervationnodes);
+    for (int i = 0; i < num_obervationnodes; ++i) {
+        printf("(%d;%d;%d), ", observationnodes[i].x_index, observationnodes[i].y_index,
+               observationnodes[i].z_index);
+    }
+    printf("\n");
+    printf("Kernel: %s (6 direct, %d indirect neighbors).\n", kernel_name, number_id_neighbors);
+    struct timeval tv1, tv2;
+    get_daytime(&tv1);
+
+    // without indirect neighbors, their mean counts as 0
+    modelcoefficients_t coefficients;
+    init_model_coefficients(&coefficients, &options->parameters, 6,
+                            number_id_neighbors > 0 ? number_id_neighbors : 1);
+    if (number_id_neighbors == 0) {
+        coefficients.id = 0;
+    }
+    volumecontext_t *contexts = malloc(num_threads * sizeof(volumecontext_t));
+    threadbarrier_t barrier;
+    for (int i = 0; i < num_threads; i++) {
+        int column_x = i / columns_y;
+        int column_y = i % columns_y;
+        volumecontext_t *context = &contexts[i];
+        context->volume = &volume;
+        context->num_ticks = num_ticks;
+        context->number_id_neighbors = number_id_neighbors;
+        context->coefficients = coefficients;
+        context->start_x = (column_x * number_nodes_x) / columns_x;
+        context->end_x = ((column_x + 1) * number_nodes_x) / columns_x;
+        context->start_y = (column_y * number_nodes_y) / columns_y;
+        context->end_y = ((column_y + 1) * number_nodes_y) / columns_y;
+        context->block_y = block_y;
+        context->num_obervationnodes = num_obervationnodes;
+        context->observationnodes = observationnodes;
+        context->number_inputs = number_inputs;
+        context->inputs = inputs;
+        context->barrier = &barrier;
+    }
+#if MULTITHREADING
+    init_thread_barrier(&barrier, num_threads);
+    threadhandle_t **handles = malloc(num_threads * sizeof(threadhandle_t *));
+    for (int i = 0; i < num_threads; i++) {
+        handles[i] = create_and_run_thread(execute_partial_volume_simulation, &contexts[i]);
+    }
+    join_and_close_simulation_threads(handles, num_threads);
+    destroy_thread_barrier(&barrier);
+    free(handles);
+#else
+    execute_partial_volume_simulation(contexts);
+#endif
+    free(contexts);
+    free_volume(&volume);
+    printf("Simulation finished succesfully!\n");
+    get_daytime(&tv2);
+    double seconds = (double) (tv2.tv_usec - tv1.tv_usec) / 1000000 + (double) (tv2.tv_sec - tv1.tv_sec);
+    printf("Total time = %f seconds\n", seconds);
+    printf("Node updates per second = %g\n", (double) number_nodes_x * number_nodes_y * number_nodes_z * num_ticks
+                                             / seconds);
+    return 0;
+}
@@ -0,0 +1,103 @@
+#ifndef VOLUME_H
+#define VOLUME_H
+
+#include "definitions.h"
+
+/**
+ * @file
+ * Simulation of volumetric (3D) grids.
+ *
+ * Each node of a volume runs the same model as the nodes of a 2D grid (see nodefunc.h), its neighborhoods are the
+ * nodes of the 3x3x3 cube around it. The kernels are registered by name:
+ * - "6neighbors" (default): the 6 nodes sharing a face as direct neighbors, no indirect neighbors (their mean counts
+ *   as 0).
+ * - "18neighbors": the 6 nodes sharing a face as direct neighbors, the 12 nodes sharing an edge as indirect neighbors.
+ * - "26neighbors": the 6 nodes sharing a face as direct neighbors, the 12 nodes sharing an edge and the 8 nodes
+ *   sharing a corner as indirect neighbors.
+ *
+ * Out-of-volume neighbors count as neighbors with an energy level of 0, like in 2D.
+ *
+ * A stencil over a volume moves far more memory per node than it computes, so the layout and sweep are built around
+ * memory bandwidth. Each array of the volume is a single block with a halo of one zero node on each side, so that
+ * the sweep reads all neighbors without checking the borders, and the z-lines are padded to full cache lines. The
+ * threads own columns of the x-y plane (z is never split, so that the innermost loop runs over long contiguous
+ * z-lines), and each thread sweeps its column in blocks of y-lines that fit into VOLUME_CACHE_SIZE: within a block,
+ * the three x-planes of the block read by the stencil stay cached while the sweep walks along x, so that each energy
+ * level is loaded from memory about once per tick.
+ */
+
+/** Name of the default volume kernel. */
+#define VOLUME_KERNEL_DEFAULT_NAME "6neighbors"
+
+/**
+ * The storage of a volume: energy levels (double buffered) and slopes in the padded layout.
+ */
+typedef struct {
+    /**
+    * The x-size of the volume.
+    */
+    int number_nodes_x;
+    /**
+    * The y-size of the volume.
+    */
+    int number_nodes_y;
+    /**
+    * The z-size of the volume.
+    */
+    int number_nodes_z;
+    /**
+    * Distance between neighboring z-lines: number_nodes_z + 2 halo nodes, rounded up to full cache lines.
+    */
+    size_t stride_y;
+    /**
+    * Distance between neighboring x-planes: stride_y * (number_nodes_y + 2).
+    */
+    size_t stride_x;
+    /**
+    * The energy levels of the current and the next tick, each of stride_x * (number_nodes_x + 2) values. Node
+    * (x, y, z) is at index(x, y, z) (see volume_index()), the halo stays 0.
+    */
+    nodeval_t *act[2];
+    /**
+    * The slopes, in the same layout. Updated in place, as each node only reads its own slope.
+    */
+    nodeval_t *slopes;
+}
+        volume_t;
+
+/**
+ * Gets the index of a node in the arrays of a volume.
+ * @param volume The volume.
+ * @param x The x index of the node, -1 to number_nodes_x for the halo.
+ * @param y The y index of the node, -1 to number_nodes_y for the halo.
+ * @param z The z index of the node, -1 to number_nodes_z for the halo.
+ * @return The index.
+ */
+static inline size_t volume_index(const volume_t *volume, int x, int y, int z) {
+    return (size_t) (x + 1) * volume->stride_x + (size_t) (y + 1) * volume->stride_y + (size_t) (z + 1);
+}
+
+/**
+ * Simulates a volume. The counterpart of simulate() for 3D grids.
+ * @param tick_ms Milliseconds in between each simulation tick.
+ * @param num_ticks The number of ticks to simulate.
+ * @param number_nodes_x The number of nodes in the first dimension of the volume.
+ * @param number_nodes_y The number of nodes in the second dimension of the volume.
+ * @param number_nodes_z The number of nodes in the third dimension of the volume.
+ * @param num_startnodes The number of nodes with a non-zero start level.
+ * @param startnodes The nodes with a non-zero start level, all other nodes start at 0. Length: num_startnodes.
+ * @param num_obervationnodes The number of nodes to observe during simulation.
+ * @param observationnodes The nodes to observe, including their z index. The energy level after tick i is written to
+ * timeseries[i].
+ * @param number_inputs The number of input nodes.
+ * @param inputs The inputs, including their z index. Input i is added to the node after each tick, repeating its
+ * series.
+ * @param options Optional settings of the simulation run, only the kernel name and the model parameters apply.
+ * @return Return-codes.
+ */
+unsigned int simulate_volume(double tick_ms, int num_ticks, int number_nodes_x, int number_nodes_y,
+                             int number_nodes_z, int num_startnodes, const nodelevel_t *startnodes,
+                             int num_obervationnodes, nodetimeseries_t *observationnodes, int number_inputs,
+                             nodeinputseries_t *inputs, const simulationoptions_t *options);
+
+#endif
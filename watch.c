@@ -0,0 +1,118 @@
+#include "metrics.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+/**
+ * @file
+ * Watches the live metrics file of a running simulation (brainsimulation --metrics PATH), built by `make`.
+ *
+ * Prints the progress, rates and memory of the run and the times of its threads every interval until the run
+ * finished, failed or its process is gone.
+ *
+ * Usage: brainwatch PATH [--interval MS] [--once]
+ */
+
+/** Default number of milliseconds between two printed updates. */
+#define WATCH_INTERVAL_MS 1000
+
+static const char *STATE_NAMES[] = {"setup", "simulating", "writing output", "finished", "failed"};
+
+static void sleep_ms(int milliseconds) {
+#ifdef _WIN32
+    Sleep(milliseconds);
+#else
+    usleep((useconds_t) milliseconds * 1000);
+#endif
+}
+
+// 1 if the process of the simulation is still running, or if it cannot be told
+static int process_alive(int64_t pid) {
+#ifdef _WIN32
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD) pid);
+    if (process == NULL) {
+        return 0;
+    }
+    int alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+    CloseHandle(process);
+    return alive;
+#else
+    return kill((pid_t) pid, 0) == 0 || errno == EPERM;
+#endif
+}
+
+static void print_metrics(const metricspage_t *page) {
+    metricspage_t header;
+    read_metrics_page(page, &header);
+    const threadmetrics_t *threads = (const threadmetrics_t *) (page + 1);
+    const char *state = header.state <= METRICS_FAILED ? STATE_NAMES[header.state] : "unknown";
+    printf("[%s] tick %lld/%lld (%.1f%%), %.1f ticks/s, ", state, (long long) header.tick,
+           (long long) header.num_ticks, header.num_ticks > 0 ? 100.0 * header.tick / header.num_ticks : 0,
+           header.ticks_per_second);
+    if (header.state == METRICS_SIMULATING && header.eta_seconds >= 0) {
+        printf("ETA %.1f s, ", header.eta_seconds);
+    }
+    printf("elapsed %.1f s, memory %.1f MiB, output %.1f KiB\n", header.elapsed_seconds,
+           header.memory_bytes / (1024.0 * 1024.0), header.output_bytes / 1024.0);
+    printf("%-8s %12s %12s %9s %12s\n", "thread", "compute ms", "other ms", "compute", "us/tick");
+    for (uint32_t i = 0; i < header.num_threads; i++) {
+        double compute_ms = threads[i].compute_ns * 1e-6;
+        double other_ms = threads[i].other_ns * 1e-6;
+        uint64_t ticks = threads[i].ticks;
+        printf("%-8u %12.1f %12.1f %8.1f%% %12.2f\n", i, compute_ms, other_ms,
+               compute_ms + other_ms > 0 ? 100.0 * compute_ms / (compute_ms + other_ms) : 0,
+               ticks > 0 ? (compute_ms + other_ms) * 1e3 / (double) ticks : 0);
+    }
+    fflush(stdout);
+}
+
+int main(int argc, const char *argv[]) {
+    const char *path = NULL;
+    int interval = WATCH_INTERVAL_MS;
+    int once = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--once") == 0) {
+            once = 1;
+        } else if (path == NULL && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (path == NULL || interval < 1) {
+        printf("Usage: brainwatch PATH [--interval MS] [--once]\n");
+        return 1;
+    }
+    size_t size;
+    const metricspage_t *page = map_metrics_page(path, &size);
+    if (page == NULL) {
+        printf("ERROR: %s is no metrics file of a simulation (yet).\n", path);
+        return 1;
+    }
+    while (1) {
+        print_metrics(page);
+        if (once || page->state == METRICS_FINISHED || page->state == METRICS_FAILED) {
+            break;
+        }
+        if (!process_alive(page->pid)) {
+            printf("WARNING: The simulation (process %lld) ended without finishing.\n", (long long) page->pid);
+            break;
+        }
+        sleep_ms(interval);
+        printf("\n");
+    }
+    unmap_metrics_page(page, size);
+    return 0;
+}